@@ -42,6 +42,12 @@
 #define KMALLOC_MIN_HEAP_SIZE       KMALLOC_MAX_ALIGN
 
 #define PROCESS_CMDLINE_BUF_SIZE                  256
+#define TASK_BUF_POOL_MAX_ELEMS                     8
+#define TASK_BUF_POOL_MAX_BYTES              (128 * KB)
+#define EXEC_CACHE_MAX_ENTRIES                     16
+#define PAGECACHE_MAX_PAGES                       256
+#define MEM_RECLAIM_LOW_WMARK_PCT                   4
+#define MEM_RECLAIM_HIGH_WMARK_PCT                  8
 #define MAX_MOUNTPOINTS                            16
 #define MAX_NESTED_INTERRUPTS                      32
 
@@ -49,3 +55,11 @@
 #define WTH_MAX_PRIO_QUEUE_SIZE                    32
 #define WTH_KB_QUEUE_SIZE                          32
 #define WTH_SERIAL_QUEUE_SIZE                      32
+#define WTH_PRINTK_QUEUE_SIZE                       4
+#define WTH_JOBS_BATCH                              8
+#define WTH_MAX_SPARE_NODES                      1024
+#define WTH_MAX_OVERFLOW_JOBS                    1024
+
+#define SERIAL_RX_BUF_SIZE                       4096
+#define SERIAL_BASE_BAUD                       115200
+#define SERIAL_DEFAULT_BAUD                    115200
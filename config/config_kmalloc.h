@@ -16,6 +16,7 @@
 #cmakedefine01 KMALLOC_HEAVY_STATS
 #cmakedefine01 KMALLOC_SUPPORT_DEBUG_LOG
 #cmakedefine01 KMALLOC_SUPPORT_LEAK_DETECTOR
+#cmakedefine01 KMALLOC_FREE_LISTS
 
 
 /*
@@ -28,6 +28,9 @@
 
 #define USERAPP_MAX_ARGS_COUNT                                 32
 
+/* Max number of POSIX timers (timer_create) per process */
+#define MAX_POSIX_TIMERS                                       32
+
 
 /*
  * execve recursion limit with #!/path/to/executable scripts
@@ -19,6 +19,7 @@
 #cmakedefine01    KERNEL_SHOW_LOGO
 #cmakedefine01    SERIAL_CON_IN_VIDEO_MODE
 #cmakedefine01    KRN_PRINTK_ON_CURR_TTY
+#cmakedefine01    KRN_PRINTK_ASYNC
 
 #ifdef KERNEL_TEST
    #define MOD_console_actual 1
@@ -42,3 +43,4 @@
 #define TTY_INPUT_BS                                              1024
 #define FAILSAFE_COLS                                              80u
 #define FAILSAFE_ROWS                                              25u
+#define TERM_MAX_SCROLL_BUF_SIZE                              (4 * MB)
@@ -34,6 +34,9 @@
 #define X86_PC_MATH_COPROC_IRQ    13
 #define X86_PC_HD_IRQ             14
 
+/* Pseudo-IRQ used for the local APIC timer, when the APIC is enabled */
+#define X86_LAPIC_TIMER_IRQ       16
+
 
 /*
  * The following FAULTs are valid both for x86 (i386+) and for x86_64.
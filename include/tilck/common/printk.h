@@ -23,6 +23,7 @@
       int vsnprintk(char *buf, size_t size, const char *fmt, va_list args);
       int snprintk(char *buf, size_t size, const char *fmt, ...);
       void printk_flush_ringbuf(void);
+      void init_printk_worker(void);
 
    #else
 
@@ -33,10 +34,37 @@
 
    #ifndef UNIT_TEST_ENVIRONMENT
       #define NO_PREFIX          "\x01\x01\x20\x20"
+      #define PRINTK_LVL_STR(n)  "\x01" #n "\x20\x20"
    #else
       #define NO_PREFIX          ""
+      #define PRINTK_LVL_STR(n)  ""
    #endif
 
+   /*
+    * Message levels: like NO_PREFIX, they must be at the very beginning of the
+    * format string. Lower levels are more urgent. Messages without an explicit
+    * level starting with "ERROR" or "WARNING" get the corresponding level, all
+    * the others get PRINTK_LVL_DEFAULT.
+    */
+   #define PRINTK_LVL_EMERG       0
+   #define PRINTK_LVL_ALERT       1
+   #define PRINTK_LVL_CRIT        2
+   #define PRINTK_LVL_ERR         3
+   #define PRINTK_LVL_WARNING     4
+   #define PRINTK_LVL_NOTICE      5
+   #define PRINTK_LVL_INFO        6
+   #define PRINTK_LVL_DEBUG       7
+   #define PRINTK_LVL_DEFAULT     PRINTK_LVL_INFO
+
+   #define KERN_EMERG             PRINTK_LVL_STR(0)
+   #define KERN_ALERT             PRINTK_LVL_STR(1)
+   #define KERN_CRIT              PRINTK_LVL_STR(2)
+   #define KERN_ERR               PRINTK_LVL_STR(3)
+   #define KERN_WARNING           PRINTK_LVL_STR(4)
+   #define KERN_NOTICE            PRINTK_LVL_STR(5)
+   #define KERN_INFO              PRINTK_LVL_STR(6)
+   #define KERN_DEBUG             PRINTK_LVL_STR(7)
+
 #else
 
    /*
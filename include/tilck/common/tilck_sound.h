@@ -16,6 +16,17 @@
 #define TILCK_IOCTL_SOUND_CONTINUE           5
 #define TILCK_IOCTL_SOUND_GET_INFO           6
 #define TILCK_IOCTL_SOUND_WAIT_COMPLETION    7
+#define TILCK_IOCTL_SOUND_SET_FRAGS          8
+#define TILCK_IOCTL_SOUND_GET_STATUS         9
+#define TILCK_IOCTL_SOUND_COMMIT            10   /* arg: bytes, by value */
+
+/*
+ * The device's mmap() area: a read-only page with the `tilck_sound_status`
+ * followed by the DMA ring, where a player can write the samples directly,
+ * making them available for playback with TILCK_IOCTL_SOUND_COMMIT.
+ */
+#define TILCK_SOUND_MMAP_STATUS_OFF          0
+#define TILCK_SOUND_MMAP_RING_OFF         4096
 
 /* Used with TILCK_IOCTL_SOUND_GET_INFO */
 struct tilck_sound_card_info {
@@ -34,3 +45,27 @@ struct tilck_sound_params {
    u8 channels;      /* 1 or 2 */
    u8 sign;          /* 0 = unsigned, 1 = signed */
 };
+
+/* Used with TILCK_IOCTL_SOUND_SET_FRAGS */
+struct tilck_sound_frags {
+
+   u32 frag_size;    /* power of 2, from 1 KB to 32 KB */
+   u32 frag_count;   /* power of 2, >= 2 and frag_size * frag_count <= 64 KB */
+};
+
+/*
+ * Used with TILCK_IOCTL_SOUND_GET_STATUS and shared with the mmap() area.
+ *
+ * The positions are free-running byte counters: the offset in the ring is
+ * `pos % ring_size` and `appl_pos - hw_pos` is the amount of committed data
+ * not played yet. The hardware position moves by one fragment at a time.
+ */
+struct tilck_sound_status {
+
+   u32 hw_pos;       /* bytes played by the hardware */
+   u32 appl_pos;     /* bytes committed by the application */
+   u32 ring_size;    /* frag_size * frag_count */
+   u32 frag_size;
+   u32 underruns;    /* times the playback stopped because of missing data */
+   u32 playing;
+};
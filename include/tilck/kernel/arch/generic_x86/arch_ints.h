@@ -5,8 +5,8 @@
 #include <tilck/kernel/list.h>
 
 extern const char *x86_exception_names[32];
-extern struct list irq_handlers_lists[16];
-extern void (*irq_entry_points[16])(void);
+extern struct list irq_handlers_lists[17];
+extern void (*irq_entry_points[17])(void);
 extern soft_int_handler_t fault_handlers[32];
 
 static ALWAYS_INLINE int int_to_irq(int int_num)
@@ -13,6 +13,7 @@ extern long kopt_ttys;
 extern bool kopt_sercon;
 extern bool kopt_sched_alive_thread;
 extern bool kopt_noacpi;
+extern bool kopt_noapic;
 extern bool kopt_fb_no_opt;
 extern bool kopt_fb_no_wc;
 extern bool kopt_no_fpu_memcpy;
@@ -21,7 +22,12 @@ extern bool kopt_panic_nobt;
 extern bool kopt_panic_regs;
 extern bool kopt_panic_mmap;
 extern bool kopt_big_scroll_buf;
+extern long kopt_scrollback;
 extern bool kopt_ps2_log;
 extern bool kopt_ps2_selftest;
+extern bool kopt_printk_async;
+extern long kopt_printk_sync_lvl;
+extern long kopt_serial_baud;
+extern long kopt_serial_base_baud;
 
 void parse_kernel_cmdline(const char *cmdline);
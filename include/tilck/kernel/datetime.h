@@ -36,10 +36,22 @@ bool clock_in_full_resync(void);
 struct k_timeval k_ts64_to_k_timeval(struct k_timespec64 ts);
 void ticks_to_timespec(u64 ticks, struct k_timespec64 *tp);
 u64 timespec_to_ticks(const struct k_timespec64 *tp);
+u64 timespec_to_ns(const struct k_timespec64 *tp);
+u64 timer_timespec_to_ns(const struct k_timespec64 *tp); /* saturating */
+void ns_to_timespec(u64 ns, struct k_timespec64 *tp);
+int do_clock_gettime(clockid_t clk_id, struct k_timespec64 *tp);
 void real_time_get_timespec(struct k_timespec64 *tp);
 void monotonic_time_get_timespec(struct k_timespec64 *tp);
 void clock_get_resync_stats(struct clock_resync_stats *s);
 
+int itimerspec_to_ns(clockid_t clk_id,
+                     bool abs,
+                     const struct k_itimerspec64 *its,
+                     u64 *delta,
+                     u64 *interval);
+
+void ns_to_itimerspec(u64 rem, u64 interval, struct k_itimerspec64 *its);
+
 static ALWAYS_INLINE struct k_timespec32
 to_k_timespec32(struct k_timespec64 tp)
 {
@@ -54,6 +66,24 @@ to_k_timespec32(struct k_timespec64 tp)
    return res;
 }
 
+static ALWAYS_INLINE struct k_itimerspec32
+to_k_itimerspec32(struct k_itimerspec64 its)
+{
+   return (struct k_itimerspec32) {
+      .it_interval = to_k_timespec32(its.it_interval),
+      .it_value = to_k_timespec32(its.it_value),
+   };
+}
+
+static ALWAYS_INLINE struct k_itimerspec64
+from_k_itimerspec32(struct k_itimerspec32 its)
+{
+   return (struct k_itimerspec64) {
+      .it_interval = { its.it_interval.tv_sec, its.it_interval.tv_nsec },
+      .it_value = { its.it_value.tv_sec, its.it_value.tv_nsec },
+   };
+}
+
 #ifdef BITS32
    #define to_stat_timespec(tp)  to_k_timespec32(tp)
 #else
@@ -4,6 +4,7 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/kernel/paging.h>
+#include <tilck/kernel/fs/vfs_base.h>
 
 #define ELF_RAW_HEADER_SIZE   128
 
@@ -33,3 +34,24 @@ struct elf_program_info {
 int load_elf_program(const char *filepath,
                      char *header_buf,
                      struct elf_program_info *pinfo);
+
+/*
+ * Cache of the parsed and validated ELF images (and of the headers of the
+ * "#!" scripts), keyed by (fs, inode, ino, mtime, size). The VFS invalidates
+ * the entries when a file is written, truncated or unlinked.
+ */
+
+struct exec_cache_stats {
+
+   ulong hits;
+   ulong misses;
+   ulong invalidations;
+   ulong entries;
+};
+
+void exec_cache_invalidate(struct mnt_fs *fs, vfs_inode_ptr_t inode);
+void exec_cache_invalidate_h(fs_handle h);
+void exec_cache_get_stats(struct exec_cache_stats *stats);
+
+/* Drops all the entries. Returns the (approximate) freed bytes */
+size_t exec_cache_shrink(void);
@@ -0,0 +1,9 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/kernel/fs/vfs_base.h>
+
+#define EFD_SEMAPHORE                   (1 << 0)
+#define EFD_MAX_COUNTER     0xfffffffffffffffeull
+
+fs_handle eventfd_create_handle(u32 initval, bool semaphore, int fl_flags);
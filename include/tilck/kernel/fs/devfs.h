@@ -71,6 +71,7 @@ struct driver_info {
 
 struct mnt_fs *create_devfs(void);
 void init_devfs(void);
+void init_memdevs(void);
 int register_driver(struct driver_info *info, int major);
 
 int create_dev_file(const char *filename, u16 major, u16 minor, void **devfile);
@@ -0,0 +1,72 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/fs/vfs_base.h>
+#include <tilck/kernel/bintree.h>
+#include <tilck/kernel/list.h>
+
+/*
+ * Kernel-wide page cache.
+ *
+ * File systems that cannot map their data directly in memory implement the
+ * get_page() hook in their fs_ops and then use the generic pagecache_*()
+ * functions below to serve read(), pread() and mmap(). The cache keeps, for
+ * each inode, a tree of page-sized copies of the file's content, indexed by
+ * page number. Writable file systems implement release_page() as well, used
+ * to write back the dirty pages.
+ *
+ * All the pages belong to a global LRU list. The clean pages not used by
+ * anybody (not even mapped in user space) are evicted when the cache grows
+ * beyond PAGECACHE_MAX_PAGES or when pagecache_shrink() is called.
+ */
+
+struct page_cache;
+
+struct pc_page {
+
+   struct bintree_node node;
+   struct list_node lru_node;
+   ulong pgnum;                  /* page number in the file (tree key) */
+   struct page_cache *pc;        /* the cache of the inode */
+   void *vaddr;                  /* page's data, in the kernel */
+   int users;                    /* pagecache_get_page() refs */
+   u32 sync_seq;                 /* last pagecache_sync() pass */
+   bool dirty;
+};
+
+struct pagecache_stats {
+
+   ulong pages;
+   ulong dirty;
+   ulong hits;
+   ulong misses;
+   ulong evictions;
+};
+
+int
+pagecache_get_page(struct mnt_fs *fs,
+                   vfs_inode_ptr_t inode,
+                   ulong pgnum,
+                   struct pc_page **out);
+
+void pagecache_put_page(struct pc_page *pg, bool dirty);
+
+/* Generic read() and mmap() implementations over the page cache */
+ssize_t pagecache_read(fs_handle h, char *buf, size_t len, offt *pos, offt sz);
+int pagecache_mmap(struct user_mapping *um, pdir_t *pdir, int flags, offt sz);
+
+/* Write back the dirty pages of `inode` or of the whole `fs` (inode = NULL) */
+int pagecache_sync(struct mnt_fs *fs, vfs_inode_ptr_t inode);
+
+/*
+ * Drop all the pages of `inode` or of the whole `fs` (inode = NULL), dirty or
+ * not. None of them can be in use.
+ */
+void pagecache_invalidate(struct mnt_fs *fs, vfs_inode_ptr_t inode);
+
+/* Evict up to `count` clean and unused pages. Returns the evicted count. */
+size_t pagecache_shrink(size_t count);
+
+void pagecache_get_stats(struct pagecache_stats *stats);
@@ -69,6 +69,11 @@ typedef int     (*func_trunc)  (struct mnt_fs *,
 
 typedef int     (*func_exlock_noblk) (struct mnt_fs *, vfs_inode_ptr_t);
 
+typedef int     (*func_page_io) (struct mnt_fs *,
+                                 vfs_inode_ptr_t,
+                                 ulong,
+                                 void *);
+
 /* file ops */
 typedef ssize_t        (*func_read)         (fs_handle, char *, size_t, offt *);
 typedef ssize_t        (*func_write)        (fs_handle, char *, size_t, offt *);
@@ -151,6 +156,10 @@ struct fs_ops {
    /* per-file lock funcs */
    func_exlock_noblk exlock_noblk;     /* if NULL -> -ENOLOCK  */
    func_exlock_noblk exunlock;         /* if NULL -> 0         */
+
+   /* page cache hooks (see pagecache.h) */
+   func_page_io get_page;              /* if NULL -> no page cache     */
+   func_page_io release_page;          /* if NULL -> no dirty pages    */
 };
 
 struct file_ops {
@@ -45,6 +45,7 @@
    #define COM3 2
    #define COM4 3
    #define X86_PC_TIMER_IRQ 0
+   #define X86_LAPIC_TIMER_IRQ 16
 
    static ALWAYS_INLINE bool are_interrupts_enabled(void)
    {
@@ -171,6 +172,12 @@ void on_first_pdir_update(void);
 extern void (*hw_read_clock)(struct datetime *out);
 void hw_read_clock_cmos(struct datetime *out);
 u32 hw_timer_setup(u32 hz);
+u32 hw_timer_get_elapsed_ns(void);
+u32 hw_timer_get_freq_khz(void);
+bool hw_has_tsc(bool *invariant);
+void hw_hrtimer_calib_start(void);
+bool hw_hrtimer_calib_end(u64 elapsed_ns);
+void hw_hrtimer_program(u32 delta_ns);
 
 bool allocate_fpu_regs(arch_task_members_t *arch_fields);
 void copy_main_tss_on_regs(regs_t *ctx);
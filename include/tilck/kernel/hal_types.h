@@ -56,6 +56,7 @@ enum irq_action {
 
    IRQ_NOT_HANDLED     = 0,
    IRQ_HANDLED         = 1,
+   IRQ_WAKE_THREAD     = 2,     /* threaded IRQs only: see irq.h */
 };
 
 typedef void (*soft_int_handler_t)(regs_t *);
@@ -0,0 +1,55 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/list.h>
+
+/*
+ * High-resolution timers.
+ *
+ * Each timer has an absolute expiration time, in nanoseconds on the
+ * hrtimer_now() clock. The active timers are kept in a single queue, ordered
+ * by expiration time, so that only its head has to be checked on every event.
+ * When the HW offers a one-shot event device (e.g. the local APIC timer), it is
+ * programmed to fire exactly at the expiration of the head of the queue, when
+ * that's before the next timer tick. Otherwise, the timers expire with tick
+ * granularity.
+ *
+ * The callbacks run with interrupts disabled, in IRQ context: they must be
+ * short and must not sleep.
+ */
+
+typedef void (*hrtimer_func)(void *arg);
+
+struct hrtimer {
+
+   struct list_node node;
+   u64 expires;                  /* absolute time, in ns */
+   hrtimer_func func;
+   void *arg;
+   bool active;
+};
+
+void hrtimer_init(struct hrtimer *t, hrtimer_func func, void *arg);
+
+/* Arm (or re-arm) the timer to expire at the absolute time `expires` */
+void hrtimer_start(struct hrtimer *t, u64 expires);
+
+/* Arm (or re-arm) the timer to expire `delta` ns from now */
+void hrtimer_start_rel(struct hrtimer *t, u64 delta);
+
+/*
+ * Disarm the timer. Returns the number of ns left before its expiration, at
+ * least 1 if the timer was still active, or 0 if it was not.
+ */
+u64 hrtimer_cancel(struct hrtimer *t);
+
+/* Monotonic time since the timer started, in ns, with sub-tick precision */
+u64 hrtimer_now(void);
+
+/* Run the callbacks of all the expired timers. Called by the timer IRQs. */
+void hrtimer_run_expired(void);
+
+/* True if a one-shot event device is used to fire the timers */
+bool hrtimer_has_event_dev(void);
+void hrtimer_set_event_dev(bool available);
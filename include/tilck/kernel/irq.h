@@ -6,6 +6,8 @@
 #include <tilck/kernel/hal_types.h>
 #include <tilck/kernel/interrupts.h>
 
+struct worker_thread;
+
 struct irq_handler_node {
 
    struct list_node node;
@@ -29,3 +31,81 @@ void irq_uninstall_handler(u8 irq, struct irq_handler_node *n);
 void irq_set_mask(int irq);
 void irq_clear_mask(int irq);
 bool irq_is_masked(int irq);
+
+/* Mask `irq` and acknowledge it, as done when entering an IRQ handler */
+void irq_mask_and_send_eoi(int irq);
+
+/* Name of the interrupt controller in use (e.g. "I/O APIC") */
+const char *irq_get_controller_name(void);
+
+/*
+ * Threaded IRQ handlers.
+ *
+ * The `check` handler runs in IRQ context, like a regular handler: it must
+ * quickly check and ACK the device, returning IRQ_NOT_HANDLED when the IRQ
+ * didn't come from it, IRQ_HANDLED when there's nothing more to do or
+ * IRQ_WAKE_THREAD when `thread_fn` has to run in a worker thread. From that
+ * moment, until `thread_fn` returns, the IRQ line stays masked and any further
+ * wakeup request is coalesced with the pending one.
+ *
+ * Handlers that fully quiesce their device in `check` (e.g. by draining a
+ * FIFO) can keep the line unmasked with IRQ_THREAD_FL_NO_MASK. In that case,
+ * a wakeup requested while `thread_fn` is running makes it run once more.
+ */
+
+#define IRQ_THREAD_FL_NO_MASK          (1 << 0)
+
+struct irq_thread_stats {
+
+   u32 wakeups;               /* times `thread_fn` has been queued */
+   u32 coalesced;             /* wakeups merged with an already pending one */
+   u32 dropped;               /* wakeups that couldn't be queued */
+   u64 tot_latency_ns;        /* sum of the IRQ-to-thread latencies */
+   u64 max_latency_ns;
+};
+
+struct threaded_irq {
+
+   struct irq_handler_node hn;
+   struct list_node node;     /* node in the list of all threaded IRQs */
+   const char *name;
+   irq_handler_t check;
+   void (*thread_fn)(void *ctx);
+   void *context;             /* device-specific context, passed to both */
+   struct worker_thread *wth; /* NULL means any high-priority worker thread */
+   u64 wake_time;
+   u8 irq;
+   u8 flags;                  /* IRQ_THREAD_FL_* */
+   volatile bool pending;
+   volatile bool rerun;
+   struct irq_thread_stats stats;
+};
+
+enum irq_action threaded_irq_handler(void *ctx);
+
+#define DEFINE_THREADED_IRQ(var, dev_name, check_func, thread_func, ctx, fl) \
+   static struct threaded_irq var = {                                     \
+      .hn = {                                                             \
+         .node = STATIC_LIST_NODE_INIT(var.hn.node),                      \
+         .handler = &threaded_irq_handler,                                \
+         .context = &var,                                                 \
+      },                                                                  \
+      .node = STATIC_LIST_NODE_INIT(var.node),                            \
+      .name = (dev_name),                                                 \
+      .check = (check_func),                                              \
+      .thread_fn = (thread_func),                                         \
+      .context = (ctx),                                                   \
+      .flags = (fl),                                                      \
+   };
+
+void irq_install_threaded_handler(u8 irq,
+                                  struct threaded_irq *ti,
+                                  struct worker_thread *wth);
+
+void irq_uninstall_threaded_handler(struct threaded_irq *ti);
+
+/* Returns the idx-th threaded IRQ handler or NULL */
+struct threaded_irq *irq_get_threaded_handler(int idx);
+
+/* Atomically copies the stats of the given threaded IRQ handler */
+void irq_get_thread_stats(struct threaded_irq *ti, struct irq_thread_stats *s);
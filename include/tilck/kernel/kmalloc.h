@@ -117,9 +117,18 @@ kzmalloc(size_t size);
 size_t
 kmalloc_get_heap_struct_size(void);
 
+size_t
+kmalloc_get_heap_metadata_size(struct kmalloc_heap *h);
+
 size_t
 kmalloc_get_max_tot_heap_free(void);
 
+size_t
+kmalloc_get_tot_heap_free(void);
+
+size_t
+kmalloc_trim_small_heaps(void);
+
 void *
 aligned_kmalloc(size_t size, u32 align);
 
@@ -44,6 +44,12 @@ debug_kmalloc_get_heap_info_by_ptr(struct kmalloc_heap *h,
 void
 debug_kmalloc_get_stats(struct debug_kmalloc_stats *stats);
 
+size_t
+debug_kmalloc_get_heap_largest_free_block(int heap_num);
+
+void
+debug_kmalloc_set_free_lists(bool enabled);
+
 void
 debug_kmalloc_chunks_stats_start_read(struct debug_kmalloc_chunks_ctx *ctx);
 
@@ -0,0 +1,44 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/common/basic_defs.h>
+
+/*
+ * The kernel log (kmsg): a lock-free, append-only circular buffer containing
+ * the text of all the printk() messages. Positions in the log are free-running
+ * 32-bit counters, so that a reader can detect when it has been lapped by the
+ * writers and some data has been lost.
+ */
+
+#if TINY_KERNEL
+   #define KMSG_BUF_SIZE             (4 * KB)
+#else
+   #define KMSG_BUF_SIZE            (32 * KB)
+#endif
+
+void kmsg_append(const char *s1, u32 len1, const char *s2, u32 len2);
+
+/* Position of the oldest byte still available in the log */
+u32 kmsg_get_first_pos(void);
+
+/* Position right after the last committed byte in the log */
+u32 kmsg_get_end_pos(void);
+
+/*
+ * Reads up to `size` bytes starting from `*pos` and advances it. In case the
+ * data at `*pos` has been overwritten, `*pos` is moved forward to the oldest
+ * available byte and `*lost` is set to true.
+ */
+u32 kmsg_read(u32 *pos, char *buf, u32 size, bool *lost);
+
+static inline bool kmsg_has_data(u32 pos) {
+   return kmsg_get_end_pos() != pos;
+}
+
+/* /dev/kmsg interface */
+struct devfs_file_info;
+
+bool kmsg_has_readers(void);
+void kmsg_wakeup_readers(void);
+void kmsg_set_dev_file_info(struct devfs_file_info *nfo);
+void init_kmsg_dev(void);
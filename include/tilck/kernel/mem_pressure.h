@@ -0,0 +1,76 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/kernel/list.h>
+
+/*
+ * Memory pressure handling.
+ *
+ * Kernel caches register a shrinker, a callback able to give back some memory
+ * on request. The shrinkers are called:
+ *
+ *    - synchronously by kmalloc(), when an allocation fails and the caller is
+ *      not in a critical section (preemption enabled)
+ *
+ *    - in background by a worker thread, when the free heap memory goes below
+ *      the low watermark, until it's back above the high watermark
+ *
+ *    - by the page fault handlers, when they cannot allocate a page
+ *
+ * When reclaiming is not enough, the page fault handlers use the OOM killer
+ * as last resort: the user process with the highest score (the one mapping the
+ * most memory) is killed and the faulting task waits for its memory, by
+ * yielding and retrying the faulting instruction.
+ */
+
+struct shrinker {
+
+   struct list_node node;
+   const char *name;
+
+   /* Frees up to `bytes` bytes (or more). Returns the freed bytes. */
+   size_t (*shrink)(size_t bytes);
+};
+
+struct mem_pressure_stats {
+
+   ulong free_kb;             /* free memory in the kernel heaps */
+   ulong low_wmark_kb;
+   ulong high_wmark_kb;
+   ulong direct_reclaims;     /* synchronous reclaims (kmalloc, faults) */
+   ulong bg_reclaims;         /* background reclaim jobs */
+   ulong reclaimed_kb;
+   ulong fault_waits;         /* faults retried, waiting for memory */
+   ulong oom_kills;
+};
+
+extern size_t mem_reclaim_low_wmark;   /* 0 until init_mem_pressure() */
+
+void init_mem_pressure(void);
+void register_shrinker(struct shrinker *s);
+void unregister_shrinker(struct shrinker *s);
+
+/* Calls the shrinkers until `bytes` are freed. Returns the freed bytes. */
+size_t mem_reclaim(size_t bytes);
+
+/* Schedules a background reclaim job, unless there's one already */
+void mem_pressure_wakeup(void);
+
+static ALWAYS_INLINE void mem_pressure_check(size_t free_mem)
+{
+   if (UNLIKELY(free_mem < mem_reclaim_low_wmark))
+      mem_pressure_wakeup();
+}
+
+/*
+ * Called by the page fault handlers when they cannot allocate `bytes`.
+ * Returns true if the fault has to be considered as handled, because either
+ * the faulting instruction can be retried or the current process has been
+ * killed. Returns false when the current task, running in kernel mode, has
+ * been chosen as the OOM victim: the fault has to fail.
+ */
+bool handle_fault_out_of_memory(size_t bytes);
+
+void mem_pressure_get_stats(struct mem_pressure_stats *stats);
@@ -24,6 +24,7 @@
 #define PAGING_FL_SHARED                                  (1 << 3)
 #define PAGING_FL_DO_ALLOC                                (1 << 4)
 #define PAGING_FL_ZERO_PG                                 (1 << 5)
+#define PAGING_FL_NO_CACHE                                (1 << 6)
 
 /* Combo values */
 #define PAGING_FL_RWUS               (PAGING_FL_RW | PAGING_FL_US)
@@ -104,8 +105,37 @@ pdir_t *pdir_deep_clone(pdir_t *pdir);
 void pdir_destroy(pdir_t *pdir);
 void invalidate_page(ulong vaddr);
 void set_page_rw(pdir_t *pdir, void *vaddr, bool rw);
+void set_pages_rw(pdir_t *pdir, void *vaddr, size_t page_count, bool rw);
 void retain_pageframes_mapped_at(pdir_t *pdir, void *vaddr, size_t len);
 void release_pageframes_mapped_at(pdir_t *pdir, void *vaddr, size_t len);
+u32 get_pageframe_ref_count(ulong paddr);
+
+/*
+ * Support for 4-MB (big) pages in user space. split_big_pages() splits into
+ * regular pages the big pages partially contained in [vaddr, vaddr + len),
+ * while unmap_big_pages() un-maps the ones fully contained in that range and
+ * returns the number of 4-KB pages un-mapped. collapse_big_page() replaces
+ * the 1024 private pages mapped at the 4-MB aligned `vaddr` with a big page.
+ */
+int split_big_pages(pdir_t *pdir, void *vaddr, size_t len);
+size_t unmap_big_pages(pdir_t *pdir, void *vaddr, size_t len, bool do_free);
+int collapse_big_page(pdir_t *pdir, void *vaddr);
+
+/*
+ * Resident user pages of a page directory, in 4-KB pages. The pages mapped
+ * only by `pdir` are private, unless they're copy-on-write pages still shared
+ * with another pdir (cow). File mappings and the pages mapped by more than one
+ * pdir are shared. The zero page is never counted.
+ */
+struct user_mem_usage {
+
+   ulong private_pages;
+   ulong shared_pages;
+   ulong cow_pages;
+   ulong pt_pages;            /* page tables */
+};
+
+void pdir_get_user_mem_usage(pdir_t *pdir, struct user_mem_usage *u);
 
 static ALWAYS_INLINE pdir_t *get_kernel_pdir(void)
 {
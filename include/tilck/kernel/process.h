@@ -19,6 +19,8 @@
 #include <tilck/kernel/fs/flock.h>
 #include <tilck/kernel/sys_types.h>
 
+struct proc_group;
+
 struct kernel_alloc {
 
    struct bintree_node node;
@@ -26,6 +28,37 @@ struct kernel_alloc {
    size_t size;
 };
 
+/*
+ * Memory accounting counters of a process, updated by the page fault handlers
+ * and by task_temp_kernel_alloc(). See process_get_mem_usage().
+ */
+struct proc_mem_counters {
+
+   ulong minflt;              /* page faults resolved without I/O */
+   ulong cow_faults;          /* CoW faults (counted in `minflt` too) */
+   ulong max_rss;             /* peak of resident pages, see below */
+   size_t temp_kallocs;       /* bytes of task_temp_kernel_alloc() */
+};
+
+/*
+ * Memory usage of a process. The resident pages are counted by walking its
+ * pdir (see pdir_get_user_mem_usage()), while `kernel_bytes` is the memory
+ * allocated by the kernel on behalf of the process: its task struct, stack and
+ * buffers, its mappings and the mmap heap metadata, its temp allocations.
+ *
+ * The peak RSS is sampled by process_update_max_rss() before the whole address
+ * space is torn down (execve(), exit) and every time process_get_mem_usage()
+ * is called. Because that requires walking all the page tables, it's NOT done
+ * on munmap() and brk(): a peak released by them before the next sample is
+ * not accounted.
+ */
+struct proc_mem_usage {
+
+   struct user_mem_usage pages;
+   size_t kernel_bytes;
+   struct proc_mem_counters counters;
+};
+
 struct mappings_info {
 
    struct kmalloc_heap *mmap_heap;
@@ -46,8 +79,14 @@ struct process {
    void *brk;
    void *initial_brk;
    struct mappings_info *mi;
+   struct proc_mem_counters mem_counters;
 
    struct list children;
+   struct list posix_timers;              /* created with timer_create() */
+   struct list_node pgrp_node;            /* node in pgrp->members */
+   struct list_node session_node;         /* node in session->members */
+   struct proc_group *pgrp;               /* set by add_task() */
+   struct proc_group *session;            /* set by add_task() */
 
    void *proc_tty;
    bool did_call_execve;
@@ -144,11 +183,15 @@ void arch_specific_new_proc_setup(struct process *pi, struct process *parent);
 void arch_specific_free_proc(struct process *pi);
 void wake_up_tasks_waiting_on(struct task *ti, enum wakeup_reason r);
 void init_process_lists(struct process *pi);
+size_t task_buf_pools_shrink(void);
+void process_get_mem_usage(struct process *pi, struct proc_mem_usage *u);
+void process_update_max_rss(struct process *pi);
 
 void process_set_cwd2_nolock(struct vfs_path *tp);
 void process_set_cwd2_nolock_raw(struct process *pi, struct vfs_path *tp);
 void terminate_process(int exit_code, int term_sig);
 void close_cloexec_handles(struct process *pi);
+void delete_all_posix_timers(struct process *pi);
 int setup_sig_handler(struct task *ti,
                       enum sig_state sig_state,
                       regs_t *r,
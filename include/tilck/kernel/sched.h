@@ -7,6 +7,7 @@
 #include <tilck/kernel/hal_types.h>
 #include <tilck/kernel/list.h>
 #include <tilck/kernel/bintree.h>
+#include <tilck/kernel/hrtimer.h>
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/signal.h>
@@ -15,6 +16,18 @@
 
 #define TIME_SLICE_TICKS (TIMER_HZ / 25)
 
+/* Real-time scheduling classes (SCHED_FIFO and SCHED_RR) */
+#define MAX_RT_PRIO                              99
+#define RR_TIME_SLICE_TICKS          (TIMER_HZ / 10)
+
+/*
+ * RT throttling: in every period of RT_PERIOD_TICKS, RT tasks can use at most
+ * RT_RUNTIME_TICKS while there are other runnable tasks. That's a safeguard
+ * against runaway RT tasks locking up the whole system.
+ */
+#define RT_PERIOD_TICKS                    TIMER_HZ
+#define RT_RUNTIME_TICKS          (TIMER_HZ * 95 / 100)
+
 enum task_state {
    TASK_STATE_INVALID   = 0,
    TASK_STATE_RUNNABLE  = 1,
@@ -78,13 +91,15 @@ struct task {
 
    struct bintree_node tree_by_tid_node;
    struct list_node runnable_node;
-   struct list_node wakeup_timer_node;
    struct list_node siblings_node;    /* nodes in parent's pi's children list */
 
    struct list tasks_waiting_list;    /* tasks waiting this task to end */
 
    s32 wstatus;                       /* waitpid's wstatus  */
    struct sched_ticks ticks;          /* scheduler counters */
+   u8 sched_policy;                   /* SCHED_OTHER, SCHED_FIFO or SCHED_RR */
+   u8 rt_prio;                        /* 1..MAX_RT_PRIO, 0 for SCHED_OTHER */
+   bool sched_reset_on_fork;
 
    void *kernel_stack;
    void *args_copybuf;
@@ -95,7 +110,12 @@ struct task {
    };
 
    struct wait_obj wobj;
-   u32 ticks_before_wake_up;
+   struct hrtimer wakeup_timer;
+
+   /* Priority inheritance: owned kmutexes having waiters, inherited values */
+   struct list pi_mutexes;
+   int pi_prio;
+   u64 pi_vruntime;
 
    /* List of callbacks to call on exit */
    struct list on_exit;
@@ -147,6 +167,15 @@ extern const char *const task_state_str[5];
 #define KTH_ALLOC_BUFS                       (1 << 0)
 #define KTH_WORKER_THREAD                    (1 << 1)
 
+/*
+ * Scheduling priorities: lower values mean higher priority. Worker threads have
+ * their own priority (WTH_PRIO_HIGHEST to WTH_PRIO_LOWEST), followed by the RT
+ * tasks (SCHED_PRIO_NORMAL - rt_prio), while all the other tasks have
+ * SCHED_PRIO_NORMAL and compete by vruntime. A task owning a kmutex inherits
+ * the priority and the vruntime of its waiters, when they're better.
+ */
+#define SCHED_PRIO_NORMAL   (WTH_PRIO_LOWEST + 1 + MAX_RT_PRIO)
+
 #define KERNEL_TID_START                        10000
 #define KERNEL_MAX_TID                           1024 /* + KERNEL_TID_START */
 
@@ -159,6 +188,12 @@ void task_change_state(struct task *ti, enum task_state new_state);
 void task_change_state_idempotent(struct task *ti, enum task_state new_state);
 bool save_regs_and_schedule(bool skip_disable_preempt);
 
+int task_get_base_prio(struct task *ti);
+int task_get_eff_prio(struct task *ti);
+u64 task_get_eff_vruntime(struct task *ti);
+void task_set_pi_boost(struct task *ti, int prio, u64 vruntime);
+void task_set_sched_policy(struct task *ti, int policy, int rt_prio);
+
 static ALWAYS_INLINE void sched_set_need_resched(void)
 {
    extern ATOMIC(int) __need_resched; /* see docs/atomics.md */
@@ -232,6 +267,11 @@ static ALWAYS_INLINE bool is_worker_thread(struct task *ti)
    return ti->worker_thread != NULL;
 }
 
+static ALWAYS_INLINE bool is_rt_task(struct task *ti)
+{
+   return ti->rt_prio != 0;
+}
+
 /*
  * Default yield function
  *
@@ -399,9 +439,12 @@ void kthread_exit(void);
 int kthread_join(int tid, bool ignore_signals);
 int kthread_join_all(const int *tids, size_t n, bool ignore_signals);
 
+void task_init_wakeup_timer(struct task *ti);
 void task_set_wakeup_timer(struct task *task, u32 ticks);
+void task_set_wakeup_timer_ns(struct task *ti, u64 ns);
 void task_update_wakeup_timer_if_any(struct task *ti, u32 new_ticks);
 u32 task_cancel_wakeup_timer(struct task *ti);
+u64 task_cancel_wakeup_timer_ns(struct task *ti);
 
 typedef void (*kthread_func_ptr)();
 
@@ -416,6 +459,7 @@ NODISCARD int kthread_create2(kthread_func_ptr func,
 int iterate_over_tasks(bintree_visit_cb func, void *arg);
 int sched_count_proc_in_group(int pgid);
 int sched_get_session_of_group(int pgid);
+int sched_set_proc_groups(struct process *pi, int pgid, int sid);
 
 struct process *task_get_pi_opaque(struct task *ti);
 void process_set_tty(struct process *pi, void *t);
@@ -146,19 +146,32 @@ struct kmutex {
    u32 flags;
    u32 lock_count; // Valid when the mutex is recursive
    struct list wait_list;
+   struct list_node pi_node;  // Node in owner's `pi_mutexes` when contended
 
 #if KMUTEX_STATS_ENABLED
    u32 num_waiters;
    u32 max_num_waiters;
+   u64 max_inversion_ns;
 #endif
 };
 
+/*
+ * Priority inversions observed on kmutexes: cases where a task blocked on a
+ * mutex owned by a task with lower priority, boosted because of that.
+ */
+struct kmutex_pi_stats {
+
+   u32 inversions;
+   u64 max_inversion_ns;      /* max time spent waiting in such cases */
+};
+
 #define STATIC_KMUTEX_INIT(m, fl)                 \
    {                                              \
       .owner_task = NULL,                         \
       .flags = 0,                                 \
       .lock_count = 0,                            \
       .wait_list = STATIC_LIST_INIT(m.wait_list), \
+      .pi_node = STATIC_LIST_INIT(m.pi_node),     \
    }
 
 #define KMUTEX_FL_RECURSIVE                                (1 << 0)
@@ -178,6 +191,8 @@ void kmutex_lock(struct kmutex *m);
 bool kmutex_trylock(struct kmutex *m);
 void kmutex_unlock(struct kmutex *m);
 void kmutex_destroy(struct kmutex *m);
+void kmutex_get_pi_stats(struct kmutex_pi_stats *s);
+void kmutex_reset_pi_stats(void);
 
 #if DEBUG_CHECKS
 bool kmutex_is_curr_task_holding_lock(struct kmutex *m);
@@ -25,6 +25,7 @@
 #include <sys/utsname.h>  // system header
 #include <sys/stat.h>     // system header
 #include <fcntl.h>        // system header
+#include <sched.h>        // system header
 
 /*
  * RUSAGE_THREAD is linux-specific, so it
@@ -34,6 +35,14 @@
 #define RUSAGE_THREAD 1
 #endif
 
+/*
+ * SCHED_RESET_ON_FORK is linux-specific, so it
+ * may not be defined by sched.h
+ */
+#ifndef SCHED_RESET_ON_FORK
+#define SCHED_RESET_ON_FORK 0x40000000
+#endif
+
 #define MAX_SYSCALLS 500
 
 typedef u64 tilck_ino_t;
@@ -125,6 +134,34 @@ struct k_timespec64 {
    long tv_nsec;
 };
 
+struct k_itimerspec32 {
+
+   struct k_timespec32 it_interval;
+   struct k_timespec32 it_value;
+};
+
+struct k_itimerspec64 {
+
+   struct k_timespec64 it_interval;
+   struct k_timespec64 it_value;
+};
+
+/*
+ * The leading part of the Linux `struct sigevent`, the only one we care about.
+ * The whole struct is always 64 bytes long.
+ */
+struct k_sigevent {
+
+   union {
+      int sival_int;
+      void *sival_ptr;
+   } sigev_value;
+
+   int sigev_signo;
+   int sigev_notify;
+   int sigev_notify_thread_id;
+};
+
 #ifdef BITS32
 
 /*
@@ -236,16 +236,18 @@ CREATE_STUB_SYSCALL_IMPL(sys_mlock)
 CREATE_STUB_SYSCALL_IMPL(sys_munlock)
 CREATE_STUB_SYSCALL_IMPL(sys_mlockall)
 CREATE_STUB_SYSCALL_IMPL(sys_munlockall)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_setparam)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_getparam)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_setscheduler)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_getscheduler)
+int sys_sched_setparam(int pid, const struct sched_param *u_param);
+int sys_sched_getparam(int pid, struct sched_param *u_param);
 
-int sys_sched_yield(void);
+int sys_sched_setscheduler(int pid,
+                           int policy,
+                           const struct sched_param *u_param);
 
-CREATE_STUB_SYSCALL_IMPL(sys_sched_get_priority_max)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_set_priority_min)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_rr_get_interval_time32)
+int sys_sched_getscheduler(int pid);
+int sys_sched_yield(void);
+int sys_sched_get_priority_max(int policy);
+int sys_sched_get_priority_min(int policy);
+int sys_sched_rr_get_interval_time32(int pid, struct k_timespec32 *u_tp);
 
 int sys_nanosleep_time32(const struct k_timespec32 *req,
                          struct k_timespec32 *rem);
@@ -291,7 +293,8 @@ int sys_getcwd(char *buf, size_t size);
 CREATE_STUB_SYSCALL_IMPL(sys_capget)
 CREATE_STUB_SYSCALL_IMPL(sys_capset)
 CREATE_STUB_SYSCALL_IMPL(sys_sigaltstack)
-CREATE_STUB_SYSCALL_IMPL(sys_sendfile)
+
+int sys_sendfile(int out_fd, int in_fd, long *u_off, size_t count);
 
 int sys_vfork(void);
 
@@ -354,7 +357,8 @@ CREATE_STUB_SYSCALL_IMPL(sys_fremovexattr)
 
 int sys_tkill(int tid, int sig);
 
-CREATE_STUB_SYSCALL_IMPL(sys_sendfile64)
+int sys_sendfile64(int out_fd, int in_fd, s64 *u_off, size_t count);
+
 CREATE_STUB_SYSCALL_IMPL(sys_futex_time32)
 CREATE_STUB_SYSCALL_IMPL(sys_sched_setaffinity)
 CREATE_STUB_SYSCALL_IMPL(sys_sched_getaffinity)
@@ -380,17 +384,29 @@ CREATE_STUB_SYSCALL_IMPL(sys_remap_file_pages)
 // TODO: complete the implementation when thread creation is implemented.
 int sys_set_tid_address(int *tidptr);
 
-CREATE_STUB_SYSCALL_IMPL(sys_timer_create)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_settime32)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_gettime32)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_getoverrun)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_delete)
+int sys_timer_create(clockid_t clk_id,
+                     const struct k_sigevent *u_sev,
+                     int *u_timer_id);
+
+int sys_timer_settime32(int timer_id,
+                        int flags,
+                        const struct k_itimerspec32 *u_new,
+                        struct k_itimerspec32 *u_old);
+
+int sys_timer_gettime32(int timer_id, struct k_itimerspec32 *u_curr);
+int sys_timer_getoverrun(int timer_id);
+int sys_timer_delete(int timer_id);
+
 CREATE_STUB_SYSCALL_IMPL(sys_clock_settime32)
 
 int sys_clock_gettime32(clockid_t clk_id, struct k_timespec32 *tp);
 int sys_clock_getres_time32(clockid_t clk_id, struct k_timespec32 *res);
 
-CREATE_STUB_SYSCALL_IMPL(sys_clock_nanosleep_time32)
+int sys_clock_nanosleep_time32(clockid_t clk_id,
+                               int flags,
+                               const struct k_timespec32 *req,
+                               struct k_timespec32 *rem);
+
 CREATE_STUB_SYSCALL_IMPL(sys_statfs64)
 CREATE_STUB_SYSCALL_IMPL(sys_fstatfs64)
 
@@ -451,13 +467,23 @@ int sys_utimensat_time32(int dirfd, const char *u_path,
                          const struct k_timespec32 times[2], int flags);
 
 CREATE_STUB_SYSCALL_IMPL(sys_signalfd)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_create)
-CREATE_STUB_SYSCALL_IMPL(sys_eventfd)
+
+int sys_timerfd_create(clockid_t clk_id, int flags);
+int sys_eventfd(unsigned int initval);
+
 CREATE_STUB_SYSCALL_IMPL(sys_fallocate)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_settime32)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_gettime32)
+
+int sys_timerfd_settime32(int fd,
+                          int flags,
+                          const struct k_itimerspec32 *u_new,
+                          struct k_itimerspec32 *u_old);
+
+int sys_timerfd_gettime32(int fd, struct k_itimerspec32 *u_curr);
+
 CREATE_STUB_SYSCALL_IMPL(sys_signalfd4)
-CREATE_STUB_SYSCALL_IMPL(sys_eventfd2)
+
+int sys_eventfd2(unsigned int initval, int flags);
+
 CREATE_STUB_SYSCALL_IMPL(sys_epoll_create1)
 CREATE_STUB_SYSCALL_IMPL(sys_dup3)
 
@@ -540,11 +566,25 @@ CREATE_STUB_SYSCALL_IMPL(sys_clock_adjtime)
 
 int sys_clock_getres(clockid_t clk_id, struct k_timespec64 *user_res);
 
-CREATE_STUB_SYSCALL_IMPL(sys_clock_nanosleep)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_gettime)
-CREATE_STUB_SYSCALL_IMPL(sys_timer_settime)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_gettime)
-CREATE_STUB_SYSCALL_IMPL(sys_timerfd_settime)
+int sys_clock_nanosleep(clockid_t clk_id,
+                        int flags,
+                        const struct k_timespec64 *req,
+                        struct k_timespec64 *rem);
+
+int sys_timer_gettime(int timer_id, struct k_itimerspec64 *u_curr);
+
+int sys_timer_settime(int timer_id,
+                      int flags,
+                      const struct k_itimerspec64 *u_new,
+                      struct k_itimerspec64 *u_old);
+
+int sys_timerfd_gettime(int fd, struct k_itimerspec64 *u_curr);
+
+int sys_timerfd_settime(int fd,
+                        int flags,
+                        const struct k_itimerspec64 *u_new,
+                        struct k_itimerspec64 *u_old);
+
 CREATE_STUB_SYSCALL_IMPL(sys_utimensat)
 CREATE_STUB_SYSCALL_IMPL(sys_pselect6_time32)
 CREATE_STUB_SYSCALL_IMPL(sys_ppoll_time32)
@@ -555,7 +595,7 @@ CREATE_STUB_SYSCALL_IMPL(sys_mq_timedreceive)
 CREATE_STUB_SYSCALL_IMPL(sys_semtimedop)
 CREATE_STUB_SYSCALL_IMPL(sys_rt_sigtimedwait)
 CREATE_STUB_SYSCALL_IMPL(sys_futex)
-CREATE_STUB_SYSCALL_IMPL(sys_sched_rr_get_interval)
+int sys_sched_rr_get_interval(int pid, struct k_timespec64 *u_tp);
 CREATE_STUB_SYSCALL_IMPL(sys_pidfd_send_signal)
 CREATE_STUB_SYSCALL_IMPL(sys_io_uring_setup)
 CREATE_STUB_SYSCALL_IMPL(sys_io_uring_enter)
@@ -29,6 +29,12 @@ struct video_interface {
    void (*redraw_static_elements)(void);
    void (*disable_static_elems_refresh)(void);
    void (*enable_static_elems_refresh)(void);
+
+   /*
+    * Push to the hardware all the changes made by the functions above. When
+    * implemented, the term calls it at the end of each action (e.g. write).
+    */
+   void (*flush)(void);
 };
 
 enum term_type {
@@ -68,6 +74,14 @@ struct term_interface {
    void (*restart_output)(term *t);
    void (*set_filter)(term *t, term_filter func, void *ctx);
 
+   /*
+    * Optional. Tells the term that, in the filter's current state, any byte `c`
+    * with table[c] >= 32 is just a printable char, written as table[c] with no
+    * side effects. That allows the term to write whole runs of such bytes
+    * without calling the filter for each one of them. NULL disables that.
+    */
+   void (*set_filter_trans_table)(term *t, const s16 *table);
+
    /*
     * The first term must be pre-allocated but _not_ pre-initialized.
     * It is expected to require init() to be called on it before use.
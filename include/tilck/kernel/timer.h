@@ -3,9 +3,11 @@
 #pragma once
 #include <tilck_gen_headers/config_sched.h>
 #include <tilck/common/basic_defs.h>
+#include <tilck/kernel/hrtimer.h>
 
 void kernel_sleep(u64 ticks);  /* sleep for `ticks` timer ticks (jiffies) */
 void kernel_sleep_ms(u64 ms);  /* sleep for `ms` milliseconds */
+u64 kernel_sleep_ns(u64 ns);   /* sleep for `ns` ns, returns the ns left */
 void delay_us(u32 us);         /* busy-wait for `us` microseconds */
 
 static ALWAYS_INLINE u64
@@ -14,5 +16,51 @@ ms_to_ticks(u64 ms)
    return ms / (1000 / TIMER_HZ);
 }
 
+struct clocksource_info {
+
+   const char *name;          /* "tsc" or the HW timer's name */
+   u32 freq_khz;
+   u32 res_ns;
+};
+
+/*
+ * Interval timers, backing timerfd and the POSIX per-process timers.
+ *
+ * The expirations are counted by an hrtimer callback, in IRQ context, while
+ * the `notify` callback runs later in a worker thread, where it's allowed to
+ * signal conditions or to send signals. Because of that deferred job, a ktimer
+ * cannot be freed directly by its owner: ktimer_release() calls `destroy` only
+ * once there's no pending job referring to the timer.
+ */
+
+#define KTIMER_MIN_INTERVAL_NS     (50 * 1000)
+
+struct ktimer {
+
+   struct hrtimer hrt;
+   u64 interval;                 /* in ns, 0 for one-shot timers */
+   u64 expirations;              /* not consumed yet */
+
+   void (*notify)(struct ktimer *);
+   void (*destroy)(struct ktimer *);
+
+   bool job_pending;
+   bool notify_pending;
+   bool notify_retry;            /* one-shot: hrt re-armed to retry notify */
+   bool dying;
+};
+
+void ktimer_init(struct ktimer *t,
+                 void (*notify)(struct ktimer *),
+                 void (*destroy)(struct ktimer *));
+
+/* Arm the timer to expire in `delta` ns (0 = disarm) and then every `interval` */
+void ktimer_set(struct ktimer *t, u64 delta, u64 interval);
+void ktimer_get(struct ktimer *t, u64 *rem, u64 *interval);
+u64 ktimer_consume(struct ktimer *t);
+void ktimer_release(struct ktimer *t);
+
 u64 get_ticks(void);
+u32 timer_get_subtick_ns(void);
+void timer_get_clocksource(struct clocksource_info *nfo);
 void init_timer(void);
@@ -0,0 +1,10 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#pragma once
+#include <tilck/kernel/sys_types.h>
+#include <tilck/kernel/fs/vfs_base.h>
+
+#define TFD_TIMER_ABSTIME          (1 << 0)
+#define TFD_TIMER_CANCEL_ON_SET    (1 << 1)
+
+fs_handle timerfd_create_handle(clockid_t clk_id, int fl_flags);
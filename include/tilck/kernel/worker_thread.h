@@ -8,6 +8,18 @@
 
 struct worker_thread;
 
+struct wth_stats {
+
+   u32 max_depth;             /* high-water mark of the queue depth */
+   u32 overflowed;            /* jobs that didn't fit in the ring buffer */
+   u32 dropped;               /* jobs that couldn't be enqueued at all */
+   u64 jobs;                  /* jobs completed */
+   u64 tot_latency_ns;        /* sum of the enqueue-to-start latencies */
+   u64 max_latency_ns;
+   u64 tot_run_ns;            /* sum of the job run times */
+   u64 max_run_ns;
+};
+
 void
 init_worker_threads();
 
@@ -26,6 +38,12 @@ wth_get_name(struct worker_thread *wth);
 struct task *
 wth_get_runnable_thread(void);
 
+struct worker_thread *
+wth_get_by_index(int idx);
+
+void
+wth_get_stats(struct worker_thread *wth, struct wth_stats *s);
+
 struct worker_thread *
 wth_create_thread(const char *name, int priority, u16 queue_size);
 
@@ -15,6 +15,34 @@ enum acpi_init_status {
    ais_fully_initialized   = 4,
 };
 
+#define ACPI_MADT_MAX_IOAPICS                          8
+#define ACPI_MADT_ISA_IRQS                            16
+#define ACPI_MADT_NO_GSI                      0xffffffff
+
+struct acpi_madt_ioapic {
+
+   ulong paddr;
+   u32 gsi_base;              /* first Global System Interrupt it handles */
+   u8 id;
+};
+
+struct acpi_madt_isa_irq {
+
+   u32 gsi;                   /* ACPI_MADT_NO_GSI if not connected */
+   bool active_low;
+   bool level_trig;
+};
+
+/* The interrupt controllers' info read from the MADT table */
+struct acpi_madt_info {
+
+   ulong lapic_paddr;
+   bool has_8259;
+   u32 ioapics_count;
+   struct acpi_madt_ioapic ioapics[ACPI_MADT_MAX_IOAPICS];
+   struct acpi_madt_isa_irq isa_irqs[ACPI_MADT_ISA_IRQS];
+};
+
 #if MOD_acpi
 
 static inline enum acpi_init_status
@@ -26,12 +54,14 @@ get_acpi_init_status(void)
 
 void acpi_mod_init_tables(void);
 void acpi_set_root_pointer(ulong);
+bool acpi_get_madt_info(struct acpi_madt_info *nfo);
 
 #else
 
 #define get_acpi_init_status()            ais_not_started
 #define acpi_mod_init_tables()
 #define acpi_set_root_pointer(...)
+#define acpi_get_madt_info(...)           false
 
 #endif
 
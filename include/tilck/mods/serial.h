@@ -6,6 +6,13 @@
 
 void init_serial_port(u16 port);
 
+/*
+ * Set the divisor latch for `baud`. The `base_baud` is the UART's clock divided
+ * by 16 (115200 on the classic PC UARTs).
+ */
+bool serial_set_baud_rate(u16 port, u32 base_baud, u32 baud);
+void serial_enable_rx_irq(u16 port, bool enable);
+
 bool serial_read_ready(u16 port);
 void serial_wait_for_read(u16 port);
 char serial_read(u16 port);
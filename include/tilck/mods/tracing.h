@@ -220,6 +220,9 @@ get_traced_syscalls_count(void);
 int
 get_traced_tasks_count(void);
 
+void
+set_task_traced(struct task *ti, bool traced);
+
 void
 get_traced_syscalls_str(char *buf, size_t len);
 
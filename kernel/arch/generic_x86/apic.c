@@ -0,0 +1,373 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/arch/generic_x86/cpu_features.h>
+
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/irq.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/hrtimer.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/mods/acpi.h>
+
+#include "apic.h"
+
+#define MSR_IA32_APIC_BASE                          0x01b
+#define APIC_BASE_MSR_ENABLE                    (1u << 11)
+
+/* Local APIC registers (offsets from its base address) */
+#define LAPIC_ID                                    0x020
+#define LAPIC_TPR                                   0x080
+#define LAPIC_EOI                                   0x0b0
+#define LAPIC_SVR                                   0x0f0
+#define LAPIC_LVT_TIMER                             0x320
+#define LAPIC_LVT_LINT0                             0x350
+#define LAPIC_TIMER_INIT_CNT                        0x380
+#define LAPIC_TIMER_CURR_CNT                        0x390
+#define LAPIC_TIMER_DIV                             0x3e0
+
+#define LAPIC_SVR_ENABLE                         (1u << 8)
+#define LAPIC_LVT_MASKED                        (1u << 16)
+#define LAPIC_TIMER_DIV_16                          0x003
+
+/* I/O APIC registers: indirectly accessed through REGSEL and WIN */
+#define IOAPIC_REGSEL                                0x00
+#define IOAPIC_WIN                                   0x10
+
+#define IOAPIC_REG_VER                               0x01
+#define IOAPIC_REG_REDTBL                            0x10
+
+/* Bits of the low dword of a redirection table entry */
+#define IOAPIC_RED_ACTIVE_LOW                   (1u << 13)
+#define IOAPIC_RED_LEVEL_TRIG                   (1u << 15)
+#define IOAPIC_RED_MASKED                       (1u << 16)
+
+struct ioapic {
+
+   volatile u32 *regs;
+   u32 gsi_base;
+   u32 pins_count;
+};
+
+struct apic_irq {
+
+   struct ioapic *ioapic;     /* NULL if the IRQ is not connected */
+   u32 pin;
+   u32 redtbl_lo;             /* cached low dword of the redirection entry */
+};
+
+bool apic_irqs_enabled;
+
+static volatile u32 *lapic;
+static struct ioapic ioapics[ACPI_MADT_MAX_IOAPICS];
+static u32 ioapics_count;
+static struct apic_irq apic_irqs[ACPI_MADT_ISA_IRQS];
+
+static u32 lapic_timer_lvt;   /* cached LVT timer entry (one-shot mode) */
+static u32 lapic_timer_mult;  /* timer counts per ns, 0.32 fixed-point */
+
+static ALWAYS_INLINE u32 lapic_read(u32 reg)
+{
+   return lapic[reg / sizeof(u32)];
+}
+
+static ALWAYS_INLINE void lapic_write(u32 reg, u32 val)
+{
+   lapic[reg / sizeof(u32)] = val;
+}
+
+static u32 ioapic_read(struct ioapic *io, u32 reg)
+{
+   io->regs[IOAPIC_REGSEL / sizeof(u32)] = reg;
+   return io->regs[IOAPIC_WIN / sizeof(u32)];
+}
+
+static void ioapic_write(struct ioapic *io, u32 reg, u32 val)
+{
+   io->regs[IOAPIC_REGSEL / sizeof(u32)] = reg;
+   io->regs[IOAPIC_WIN / sizeof(u32)] = val;
+}
+
+/*
+ * Sending an EOI is just a single MMIO write, while on the PIC it requires
+ * one or two `outb` instructions.
+ */
+void lapic_send_eoi(void)
+{
+   lapic_write(LAPIC_EOI, 0);
+}
+
+/*
+ * Thanks to the cached copy of the redirection entries, masking and unmasking
+ * an IRQ require just two MMIO writes and no reads at all.
+ */
+static void apic_irq_update_mask(int irq, bool masked)
+{
+   struct apic_irq *ai = &apic_irqs[irq];
+   ulong var;
+
+   ASSERT(IN_RANGE(irq, 0, ACPI_MADT_ISA_IRQS));
+
+   if (!ai->ioapic)
+      return;
+
+   disable_interrupts(&var);
+   {
+      if (masked)
+         ai->redtbl_lo |= IOAPIC_RED_MASKED;
+      else
+         ai->redtbl_lo &= ~IOAPIC_RED_MASKED;
+
+      ioapic_write(ai->ioapic, IOAPIC_REG_REDTBL + 2 * ai->pin, ai->redtbl_lo);
+   }
+   enable_interrupts(&var);
+}
+
+void ioapic_set_mask(int irq)
+{
+   apic_irq_update_mask(irq, true);
+}
+
+void ioapic_clear_mask(int irq)
+{
+   apic_irq_update_mask(irq, false);
+}
+
+bool ioapic_is_masked(int irq)
+{
+   struct apic_irq *ai = &apic_irqs[irq];
+   ASSERT(IN_RANGE(irq, 0, ACPI_MADT_ISA_IRQS));
+
+   return !ai->ioapic || (ai->redtbl_lo & IOAPIC_RED_MASKED);
+}
+
+void lapic_timer_set_mask(bool masked)
+{
+   ulong var;
+
+   if (!apic_irqs_enabled)
+      return;
+
+   disable_interrupts(&var);
+   {
+      if (masked)
+         lapic_timer_lvt |= LAPIC_LVT_MASKED;
+      else
+         lapic_timer_lvt &= ~LAPIC_LVT_MASKED;
+
+      lapic_write(LAPIC_LVT_TIMER, lapic_timer_lvt);
+   }
+   enable_interrupts(&var);
+}
+
+bool lapic_timer_is_masked(void)
+{
+   return !apic_irqs_enabled || (lapic_timer_lvt & LAPIC_LVT_MASKED);
+}
+
+static enum irq_action lapic_timer_irq_handler(void *ctx)
+{
+   hrtimer_run_expired();
+   return IRQ_HANDLED;
+}
+
+DEFINE_IRQ_HANDLER_NODE(lapic_timer, lapic_timer_irq_handler, NULL);
+
+/*
+ * The local APIC timer runs at the (unknown) bus frequency: calibrate it
+ * against the PIT, while the kernel measures its bogoMips. Between the two
+ * calls, the timer just counts down from its max value, with the LVT masked.
+ */
+void hw_hrtimer_calib_start(void)
+{
+   if (!apic_irqs_enabled)
+      return;
+
+   lapic_write(LAPIC_TIMER_INIT_CNT, 0xffffffff);
+}
+
+bool hw_hrtimer_calib_end(u64 elapsed_ns)
+{
+   u32 counted;
+
+   if (!apic_irqs_enabled)
+      return false;
+
+   counted = 0xffffffff - lapic_read(LAPIC_TIMER_CURR_CNT);
+   lapic_write(LAPIC_TIMER_INIT_CNT, 0);
+
+   if (!counted || counted >= elapsed_ns) {
+      printk("APIC: unable to calibrate the timer\n");
+      return false;
+   }
+
+   lapic_timer_mult = (u32)(((u64)counted << 32) / elapsed_ns);
+   irq_install_handler(X86_LAPIC_TIMER_IRQ, &lapic_timer);
+
+   printk("APIC: timer at %u kHz, used for the hrtimers\n",
+          (u32)((u64)counted * MILLION / elapsed_ns));
+   return true;
+}
+
+/* Fire the LAPIC timer IRQ (once) after `delta_ns` nanoseconds */
+void hw_hrtimer_program(u32 delta_ns)
+{
+   u32 cnt = (u32)(((u64)delta_ns * lapic_timer_mult) >> 32);
+   lapic_write(LAPIC_TIMER_INIT_CNT, MAX(cnt, 1u));
+}
+
+static void *apic_map_mmio(ulong paddr)
+{
+   void *va;
+
+   if (!(va = hi_vmem_reserve(PAGE_SIZE)))
+      return NULL;
+
+   if (map_kernel_page(va, paddr & PAGE_MASK, PAGING_FL_RW | PAGING_FL_NO_CACHE))
+   {
+      hi_vmem_release(va, PAGE_SIZE);
+      return NULL;
+   }
+
+   return (char *)va + (paddr & OFFSET_IN_PAGE_MASK);
+}
+
+static struct ioapic *ioapic_for_gsi(u32 gsi, u32 *pin)
+{
+   for (u32 i = 0; i < ioapics_count; i++) {
+
+      struct ioapic *io = &ioapics[i];
+
+      if (IN_RANGE(gsi, io->gsi_base, io->gsi_base + io->pins_count)) {
+         *pin = gsi - io->gsi_base;
+         return io;
+      }
+   }
+
+   return NULL;
+}
+
+static bool init_ioapics(struct acpi_madt_info *nfo)
+{
+   for (u32 i = 0; i < nfo->ioapics_count; i++) {
+
+      struct ioapic *io = &ioapics[ioapics_count];
+
+      if (!(io->regs = apic_map_mmio(nfo->ioapics[i].paddr))) {
+         printk("APIC: unable to map IOAPIC %u\n", nfo->ioapics[i].id);
+         continue;
+      }
+
+      io->gsi_base = nfo->ioapics[i].gsi_base;
+      io->pins_count = ((ioapic_read(io, IOAPIC_REG_VER) >> 16) & 0xff) + 1;
+
+      /* Leave everything masked, as init_pic_8259() does */
+      for (u32 pin = 0; pin < io->pins_count; pin++)
+         ioapic_write(io, IOAPIC_REG_REDTBL + 2 * pin, IOAPIC_RED_MASKED);
+
+      ioapics_count++;
+   }
+
+   return ioapics_count > 0;
+}
+
+static void
+route_isa_irq(struct acpi_madt_info *nfo, int irq, u8 vector, u32 dest)
+{
+   struct acpi_madt_isa_irq *e = &nfo->isa_irqs[irq];
+   struct apic_irq *ai = &apic_irqs[irq];
+   struct ioapic *io;
+   u32 pin;
+
+   if (e->gsi == ACPI_MADT_NO_GSI)
+      return;
+
+   if (!(io = ioapic_for_gsi(e->gsi, &pin))) {
+      printk("APIC: no IOAPIC for IRQ #%d (GSI %u)\n", irq, e->gsi);
+      return;
+   }
+
+   ai->ioapic = io;
+   ai->pin = pin;
+
+   /* Fixed delivery mode, physical destination mode */
+   ai->redtbl_lo = vector | IOAPIC_RED_MASKED;
+
+   if (e->active_low)
+      ai->redtbl_lo |= IOAPIC_RED_ACTIVE_LOW;
+
+   if (e->level_trig)
+      ai->redtbl_lo |= IOAPIC_RED_LEVEL_TRIG;
+
+   ioapic_write(io, IOAPIC_REG_REDTBL + 2 * pin + 1, dest << 24);
+   ioapic_write(io, IOAPIC_REG_REDTBL + 2 * pin, ai->redtbl_lo);
+}
+
+/*
+ * Switch the IRQ handling from the legacy PIC to the local APIC + I/O APIC(s)
+ * described by the ACPI MADT table, keeping the ISA IRQs mapped to the same
+ * vectors [irq_vec_base, irq_vec_base + 15]. The PIC is expected to be already
+ * initialized and fully masked. Returns false if that's not possible, in which
+ * case the PIC must still be used.
+ */
+bool init_apic(u8 irq_vec_base)
+{
+   struct acpi_madt_info nfo;
+   u32 dest;
+   u64 base;
+
+   ASSERT(!are_interrupts_enabled());
+
+   if (!x86_cpu_features.edx1.apic || !x86_cpu_features.edx1.msr)
+      return false;
+
+   if (!acpi_get_madt_info(&nfo)) {
+      printk("APIC: no MADT info available, using the 8259 PIC\n");
+      return false;
+   }
+
+   if (!(lapic = apic_map_mmio(nfo.lapic_paddr))) {
+      printk("APIC: unable to map the local APIC, using the 8259 PIC\n");
+      return false;
+   }
+
+   if (!init_ioapics(&nfo)) {
+      printk("APIC: no usable IOAPIC, using the 8259 PIC\n");
+      return false;
+   }
+
+   /* The firmware might have left the local APIC disabled */
+   base = rdmsr(MSR_IA32_APIC_BASE);
+
+   if (!(base & APIC_BASE_MSR_ENABLE))
+      wrmsr(MSR_IA32_APIC_BASE, base | APIC_BASE_MSR_ENABLE);
+
+   /*
+    * Accept all the priority classes. The ISA IRQs use the vectors [32, 47],
+    * that belong all to the same class: we rely on masking the single lines
+    * in the IOAPIC instead, in order to allow nested IRQs.
+    */
+   lapic_write(LAPIC_TPR, 0);
+
+   /* The PIC's ExtINT line is not used anymore */
+   lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+   lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | APIC_SPUR_VECTOR);
+
+   /* The timer, in one-shot mode, gets the vector right after the ISA IRQs */
+   lapic_timer_lvt = LAPIC_LVT_MASKED | (irq_vec_base + X86_LAPIC_TIMER_IRQ);
+   lapic_write(LAPIC_TIMER_DIV, LAPIC_TIMER_DIV_16);
+   lapic_write(LAPIC_TIMER_INIT_CNT, 0);
+   lapic_write(LAPIC_LVT_TIMER, lapic_timer_lvt);
+
+   dest = lapic_read(LAPIC_ID) >> 24;
+
+   for (int irq = 0; irq < ACPI_MADT_ISA_IRQS; irq++)
+      route_isa_irq(&nfo, irq, irq_vec_base + (u8)irq, dest);
+
+   apic_irqs_enabled = true;
+   printk("APIC: enabled, LAPIC at %p, %u IOAPIC(s)\n",
+          TO_PTR(nfo.lapic_paddr), ioapics_count);
+
+   return true;
+}
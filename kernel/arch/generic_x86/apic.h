@@ -0,0 +1,17 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#define APIC_SPUR_VECTOR                             0xff
+
+/* True when the IRQs are routed through the I/O APIC instead of the PIC */
+extern bool apic_irqs_enabled;
+
+bool init_apic(u8 irq_vec_base);
+void lapic_send_eoi(void);
+void ioapic_set_mask(int irq);
+void ioapic_clear_mask(int irq);
+bool ioapic_is_masked(int irq);
+
+void lapic_timer_set_mask(bool masked);
+bool lapic_timer_is_masked(void);
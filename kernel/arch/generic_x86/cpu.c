@@ -125,6 +125,12 @@ void init_pat(void)
    printk("CPU: PAT initialized\n");
 }
 
+bool hw_has_tsc(bool *invariant)
+{
+   *invariant = x86_cpu_features.invariant_TSC;
+   return x86_cpu_features.edx1.tsc;
+}
+
 void enable_cpu_features(void)
 {
    if (!x86_cpu_features.initialized)
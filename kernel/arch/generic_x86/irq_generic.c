@@ -11,10 +11,12 @@
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/hrtimer.h>
 
 #include "pic.h"
+#include "apic.h"
 
-struct list irq_handlers_lists[16] = {
+struct list irq_handlers_lists[17] = {
    STATIC_LIST_INIT(irq_handlers_lists[ 0]),
    STATIC_LIST_INIT(irq_handlers_lists[ 1]),
    STATIC_LIST_INIT(irq_handlers_lists[ 2]),
@@ -31,11 +33,16 @@ struct list irq_handlers_lists[16] = {
    STATIC_LIST_INIT(irq_handlers_lists[13]),
    STATIC_LIST_INIT(irq_handlers_lists[14]),
    STATIC_LIST_INIT(irq_handlers_lists[15]),
+   STATIC_LIST_INIT(irq_handlers_lists[16]),   /* X86_LAPIC_TIMER_IRQ */
 };
 
 u32 unhandled_irq_count[256];
 u32 spur_irq_count;
 
+/* Per-IRQ count of threaded handlers keeping the line masked */
+static u8 irq_threads_pending[ARRAY_SIZE(irq_handlers_lists)];
+static struct list threaded_irqs = STATIC_LIST_INIT(threaded_irqs);
+
 void idt_set_entry(u8 num, void *handler, u16 sel, u8 flags);
 
 /* This installs a custom IRQ handler for the given IRQ */
@@ -45,9 +52,11 @@ void irq_install_handler(u8 irq, struct irq_handler_node *n)
    disable_interrupts(&var);
    {
       list_add_tail(&irq_handlers_lists[irq], &n->node);
+
+      if (!irq_threads_pending[irq])
+         irq_clear_mask(irq);
    }
    enable_interrupts(&var);
-   irq_clear_mask(irq);
 }
 
 /* This clears the handler for a given IRQ */
@@ -64,8 +73,231 @@ void irq_uninstall_handler(u8 irq, struct irq_handler_node *n)
    enable_interrupts(&var);
 }
 
+static void irq_thread_run(void *arg)
+{
+   struct threaded_irq *ti = arg;
+   struct irq_thread_stats *s = &ti->stats;
+   const u64 latency = hrtimer_now() - ti->wake_time;
+   ulong var;
+
+   while (true) {
+
+      disable_interrupts(&var);
+      ti->rerun = false;
+      enable_interrupts(&var);
+
+      ti->thread_fn(ti->context);
+
+      disable_interrupts(&var);
+
+      if (!ti->rerun)
+         break; /* NOTE: interrupts are still disabled */
+
+      enable_interrupts(&var);
+   }
+
+   s->tot_latency_ns += latency;
+   s->max_latency_ns = MAX(s->max_latency_ns, latency);
+   ti->pending = false;
+
+   if (!(ti->flags & IRQ_THREAD_FL_NO_MASK)) {
+
+      ASSERT(irq_threads_pending[ti->irq] > 0);
+
+      if (!--irq_threads_pending[ti->irq]) {
+         if (!list_is_empty(&irq_handlers_lists[ti->irq]))
+            irq_clear_mask(ti->irq);
+      }
+   }
+
+   enable_interrupts(&var);
+}
+
+enum irq_action threaded_irq_handler(void *ctx)
+{
+   struct threaded_irq *ti = ctx;
+   enum irq_action ret;
+   ulong var;
+
+   ASSERT(!is_preemption_enabled());
+
+   if ((ret = ti->check(ti->context)) != IRQ_WAKE_THREAD)
+      return ret;
+
+   if (UNLIKELY(in_panic())) {
+
+      /*
+       * During panic() typically IRQs are completely disabled BUT, when the
+       * the -panic_kb is passed to the kernel cmdline, we allow just the PS/2
+       * KB IRQs (or the serial ones, with kopt_sercon) to run, so that we can
+       * scroll the term buffer. Because we don't have the timer IRQ and the
+       * worker threads won't run, call the thread function directly. For the
+       * panic case, that's totally fine.
+       */
+      disable_interrupts(&var);
+      {
+         ti->thread_fn(ti->context);
+      }
+      enable_interrupts(&var);
+      return IRQ_HANDLED;
+   }
+
+   disable_interrupts(&var);
+   {
+      if (ti->pending) {
+
+         ti->stats.coalesced++;
+         ti->rerun = true;
+
+      } else if (wth_enqueue_on(ti->wth, &irq_thread_run, ti)) {
+
+         ti->wake_time = hrtimer_now();
+         ti->pending = true;
+         ti->stats.wakeups++;
+
+         if (!(ti->flags & IRQ_THREAD_FL_NO_MASK))
+            irq_threads_pending[ti->irq]++;
+
+      } else {
+
+         ti->stats.dropped++;
+      }
+   }
+   enable_interrupts(&var);
+   return IRQ_HANDLED;
+}
+
+void irq_install_threaded_handler(u8 irq,
+                                  struct threaded_irq *ti,
+                                  struct worker_thread *wth)
+{
+   ulong var;
+
+   ASSERT(irq < ARRAY_SIZE(irq_handlers_lists));
+   ASSERT(irq != X86_PC_TIMER_IRQ && irq != X86_LAPIC_TIMER_IRQ);
+   ASSERT(ti->hn.handler == &threaded_irq_handler);
+
+   disable_interrupts(&var);
+   {
+      ti->irq = irq;
+      ti->wth = wth ? wth : wth_find_worker(WTH_PRIO_HIGHEST);
+      list_add_tail(&threaded_irqs, &ti->node);
+   }
+   enable_interrupts(&var);
+   irq_install_handler(irq, &ti->hn);
+}
+
+void irq_uninstall_threaded_handler(struct threaded_irq *ti)
+{
+   ulong var;
+
+   irq_uninstall_handler(ti->irq, &ti->hn);
+
+   if (ti->pending)
+      wth_wait_for_completion(ti->wth);
+
+   disable_interrupts(&var);
+   {
+      ASSERT(!ti->pending);
+      list_remove(&ti->node);
+   }
+   enable_interrupts(&var);
+}
+
+struct threaded_irq *irq_get_threaded_handler(int idx)
+{
+   struct threaded_irq *pos, *res = NULL;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      list_for_each_ro(pos, &threaded_irqs, node) {
+         if (!idx--) {
+            res = pos;
+            break;
+         }
+      }
+   }
+   enable_interrupts(&var);
+   return res;
+}
+
+void irq_get_thread_stats(struct threaded_irq *ti, struct irq_thread_stats *s)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      *s = ti->stats;
+   }
+   enable_interrupts(&var);
+}
+
+void irq_set_mask(int irq)
+{
+   if (irq == X86_LAPIC_TIMER_IRQ)
+      lapic_timer_set_mask(true);
+   else if (apic_irqs_enabled)
+      ioapic_set_mask(irq);
+   else
+      pic_set_mask(irq);
+}
+
+void irq_clear_mask(int irq)
+{
+   if (irq == X86_LAPIC_TIMER_IRQ)
+      lapic_timer_set_mask(false);
+   else if (apic_irqs_enabled)
+      ioapic_clear_mask(irq);
+   else
+      pic_clear_mask(irq);
+}
+
+bool irq_is_masked(int irq)
+{
+   if (irq == X86_LAPIC_TIMER_IRQ)
+      return lapic_timer_is_masked();
+
+   if (apic_irqs_enabled)
+      return ioapic_is_masked(irq);
+
+   return pic_is_masked(irq);
+}
+
+void irq_mask_and_send_eoi(int irq)
+{
+   if (apic_irqs_enabled) {
+      ioapic_set_mask(irq);
+      lapic_send_eoi();
+   } else {
+      pic_mask_and_send_eoi(irq);
+   }
+}
+
+const char *irq_get_controller_name(void)
+{
+   return apic_irqs_enabled ? "I/O APIC" : "8259 PIC";
+}
+
+static inline void irq_send_eoi(int irq)
+{
+   if (apic_irqs_enabled)
+      lapic_send_eoi();
+   else
+      pic_send_eoi(irq);
+}
+
 static inline void handle_irq_set_mask_and_eoi(int irq)
 {
+   if (irq == X86_LAPIC_TIMER_IRQ) {
+
+      /*
+       * The LAPIC timer is used in one-shot mode and its handler re-programs
+       * it: masking it would risk losing the next expiration.
+       */
+      lapic_send_eoi();
+      return;
+   }
+
    if (KRN_TRACK_NESTED_INTERR) {
 
       /*
@@ -75,17 +307,20 @@ static inline void handle_irq_set_mask_and_eoi(int irq)
        */
 
       if (irq != X86_PC_TIMER_IRQ)
-         pic_mask_and_send_eoi(irq);
+         irq_mask_and_send_eoi(irq);
       else
-         pic_send_eoi(irq);
+         irq_send_eoi(irq);
 
    } else {
-      pic_mask_and_send_eoi(irq);
+      irq_mask_and_send_eoi(irq);
    }
 }
 
 static inline void handle_irq_clear_mask(int irq)
 {
+   if (irq == X86_LAPIC_TIMER_IRQ)
+      return;
+
    if (KRN_TRACK_NESTED_INTERR) {
 
       if (irq != X86_PC_TIMER_IRQ)
@@ -105,7 +340,11 @@ void arch_irq_handling(regs_t *r)
    ASSERT(!are_interrupts_enabled());
    ASSERT(!is_preemption_enabled());
 
-   if (pic_is_spur_irq(irq)) {
+   /*
+    * The spurious IRQs of the local APIC have their own vector and never get
+    * here: see init_irq_handling().
+    */
+   if (!apic_irqs_enabled && pic_is_spur_irq(irq)) {
       spur_irq_count++;
       return;
    }
@@ -126,7 +365,11 @@ void arch_irq_handling(regs_t *r)
          unhandled_irq_count[irq]++;
    }
    disable_interrupts_forced();
-   handle_irq_clear_mask(irq);
+
+   /* Keep the line masked while any of its threaded handlers is pending */
+   if (!irq_threads_pending[irq])
+      handle_irq_clear_mask(irq);
+
    pop_nested_interrupt();
 }
 
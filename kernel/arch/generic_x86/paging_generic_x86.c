@@ -57,6 +57,11 @@ void release_pageframes_mapped_at(pdir_t *pdir, void *vaddrp, size_t len)
    }
 }
 
+u32 get_pageframe_ref_count(ulong paddr)
+{
+   return pf_ref_count_get(paddr);
+}
+
 void invalidate_page(ulong vaddr)
 {
    invalidate_page_hw(vaddr);
@@ -131,9 +136,15 @@ map_framebuffer(pdir_t *pdir,
 
    size_t count;
    const size_t page_count = pow2_round_up_at(size, PAGE_SIZE) / PAGE_SIZE;
+   /*
+    * In user space, use 4-MB pages when the vaddr and the paddr allow that:
+    * the kernel mapping lives in the hi vmem area, which has its own page
+    * tables, instead.
+    */
    const u32 pg_flags = PAGING_FL_RW                     |
                         PAGING_FL_SHARED                 |
-                        (user_mmap ? PAGING_FL_US : 0);
+                        (user_mmap ? PAGING_FL_US : 0)   |
+                        (user_mmap ? PAGING_FL_BIG_PAGES_ALLOWED : 0);
 
    if (!vaddr) {
 
@@ -31,6 +31,10 @@
 #define PIT_CH2         0b10000000   // select channel 2
 
 #define PIT_READ_BACK   0b11000000   // read-back command (8254 only)
+#define PIT_LATCH       0b00000000   // counter latch command
+
+static u32 pit_divisor;
+static u32 pit_interval;
 
 /*
  * Set the time between ticks to be `interval`, where 1 means 1/TS_SCALE sec.
@@ -82,5 +86,35 @@ u32 hw_timer_setup(u32 interval)
    outb(PIT_CH0_PORT, divisor & 0xff);            /* Set low byte of divisor */
    outb(PIT_CH0_PORT, (divisor >> 8) & 0xff);     /* Set high byte of divisor */
 
+   pit_divisor = divisor;
+   pit_interval = (u32)actual_interval;
    return (u32)actual_interval;
 }
+
+u32 hw_timer_get_freq_khz(void)
+{
+   return PIT_FREQ / 1000;
+}
+
+/*
+ * Returns the time elapsed since the beginning of the current tick, in the same
+ * units as hw_timer_setup()'s interval, by reading the PIT's channel 0 counter.
+ * In mode 2, the counter goes from `divisor` down to 1, and then it's reloaded.
+ * Expected to be called with interrupts disabled.
+ */
+u32 hw_timer_get_elapsed_ns(void)
+{
+   u32 count;
+
+   if (!pit_divisor)
+      return 0;
+
+   outb(PIT_CMD_PORT, PIT_LATCH | PIT_CH0);
+   count = inb(PIT_CH0_PORT);
+   count |= (u32)inb(PIT_CH0_PORT) << 8;
+
+   if (!count || count > pit_divisor)
+      return 0;
+
+   return (u32)((u64)(pit_divisor - count) * pit_interval / pit_divisor);
+}
@@ -227,7 +227,7 @@ static struct syscall syscalls[MAX_SYSCALLS] =
    [157] = DECL_SYS(sys_sched_getscheduler, 0),
    [158] = DECL_SYS(sys_sched_yield, 0),
    [159] = DECL_SYS(sys_sched_get_priority_max, 0),
-   [160] = DECL_SYS(sys_sched_set_priority_min, 0),
+   [160] = DECL_SYS(sys_sched_get_priority_min, 0),
    [161] = DECL_SYS(sys_sched_rr_get_interval_time32, 0),
    [162] = DECL_SYS(sys_nanosleep_time32, 0),
    [163] = DECL_SYS(sys_mremap, 0),
@@ -7,9 +7,13 @@
 
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/irq.h>
+#include <tilck/kernel/cmdline.h>
 
 #include "idt_int.h"
 #include "../generic_x86/pic.h"
+#include "../generic_x86/apic.h"
+
+void apic_spur_irq_entry(void);
 
 
 /*
@@ -32,4 +36,16 @@ void init_irq_handling(void)
 
       irq_set_mask(i);
    }
+
+   /*
+    * Keep the PIC fully masked and route the IRQs through the I/O APIC, when
+    * possible. The vectors used for the ISA IRQs remain the same.
+    */
+   idt_set_entry(APIC_SPUR_VECTOR,
+                 apic_spur_irq_entry,
+                 X86_KERNEL_CODE_SEL,
+                 IDT_FLAG_PRESENT | IDT_FLAG_INT_GATE | IDT_FLAG_DPL0);
+
+   if (!kopt_noapic)
+      init_apic(32);
 }
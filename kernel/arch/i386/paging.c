@@ -23,6 +23,7 @@
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/vdso.h>
 #include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/mem_pressure.h>
 
 #include <tilck/mods/tracing.h>
 
@@ -31,6 +32,12 @@
 
 #include <sys/mman.h>      // system header
 
+/*
+ * Max number of pages invalidated one by one with `invlpg` by a range
+ * operation. Above that, the whole TLB is flushed.
+ */
+#define TLB_GATHER_MAX_PAGES                       32
+
 pdir_t *__kernel_pdir;
 static char kpdir_buf[sizeof(pdir_t)] ALIGNED_AT(PAGE_SIZE);
 
@@ -40,16 +47,235 @@ pdir_get_page_table(pdir_t *pdir, u32 i)
    return PA_TO_LIN_VA(pdir->entries[i].ptaddr << PAGE_SHIFT);
 }
 
-bool handle_potential_cow(void *context)
+static ALWAYS_INLINE ulong
+big_page_get_paddr(page_dir_entry_t *e)
 {
-   regs_t *r = context;
-   u32 vaddr;
+   return (ulong)e->big_4mb_page.paddr << BIG_PAGE_SHIFT;
+}
 
-   if ((r->err_code & PAGE_FAULT_FL_COW) != PAGE_FAULT_FL_COW)
-      return false;
+/*
+ * Collects the vaddrs to invalidate during an operation on a range of pages,
+ * in order to flush the TLB just once, at the end. Above the threshold, a
+ * single CR3 reload is cheaper than many `invlpg` instructions.
+ */
+struct tlb_gather {
+   pdir_t *pdir;
+   ulong start;            /* lowest vaddr to invalidate */
+   ulong end;              /* highest vaddr to invalidate + PAGE_SIZE */
+   u32 count;
+   ulong vaddrs[TLB_GATHER_MAX_PAGES];
+};
+
+static ALWAYS_INLINE void
+tlb_gather_init(struct tlb_gather *tlb, pdir_t *pdir)
+{
+   tlb->pdir = pdir;
+   tlb->count = 0;
+}
 
-   asmVolatile("movl %%cr2, %0" : "=r"(vaddr));
+static ALWAYS_INLINE void
+tlb_gather_add(struct tlb_gather *tlb, ulong vaddr)
+{
+   if (tlb->count < TLB_GATHER_MAX_PAGES)
+      tlb->vaddrs[tlb->count] = vaddr;
+
+   if (!tlb->count) {
+      tlb->start = vaddr;
+      tlb->end = vaddr + PAGE_SIZE;
+   } else {
+      tlb->start = MIN(tlb->start, vaddr);
+      tlb->end = MAX(tlb->end, vaddr + PAGE_SIZE);
+   }
+
+   tlb->count++;
+}
+
+static void tlb_gather_flush(struct tlb_gather *tlb)
+{
+   if (!tlb->count)
+      return;
+
+   if (tlb->pdir == __kernel_pdir) {
+
+      /*
+       * Kernel pages are global: reloading CR3 would not flush them. Also, the
+       * kernel mappings are shared by all the page directories, so we have to
+       * invalidate them no matter which pdir is the current one.
+       */
+
+      if (tlb->count <= TLB_GATHER_MAX_PAGES) {
+
+         for (u32 i = 0; i < tlb->count; i++)
+            invalidate_page_hw(tlb->vaddrs[i]);
+
+      } else {
+
+         for (ulong va = tlb->start; va != tlb->end; va += PAGE_SIZE)
+            invalidate_page_hw(va);
+      }
+
+   } else if (tlb->pdir == get_curr_pdir()) {
+
+      if (tlb->count <= TLB_GATHER_MAX_PAGES) {
+
+         for (u32 i = 0; i < tlb->count; i++)
+            invalidate_page_hw(tlb->vaddrs[i]);
+
+      } else {
+
+         /* User pages are never global: just reload CR3 */
+         set_curr_pdir(tlb->pdir);
+      }
+   }
+
+   /*
+    * Otherwise, the TLB cannot contain any entries for the user part of
+    * `pdir`, because it's not the current one: there's nothing to flush.
+    */
+
+   tlb->count = 0;
+}
+
+/*
+ * Differently from the kernel ones, the 4-MB pages mapped in user space hold a
+ * reference on each one of their 1024 pageframes. In this way, they can be
+ * split into regular pages at any time, without touching any ref-count.
+ */
+static void big_page_retain_frames(ulong paddr)
+{
+   if (paddr >= phys_mem_lim)
+      return;
+
+   for (u32 j = 0; j < 1024; j++)
+      pf_ref_count_inc(paddr + (j << PAGE_SHIFT));
+}
+
+static void big_page_release_frames(ulong paddr, bool do_free)
+{
+   if (paddr >= phys_mem_lim)
+      return; /* Device memory (e.g. framebuffer): no ref-counts to update */
+
+   for (u32 j = 0; j < 1024; j++) {
+
+      const ulong pa = paddr + (j << PAGE_SHIFT);
+
+      if (!pf_ref_count_dec(pa) && do_free) {
+         ASSERT(pa != KERNEL_VA_TO_PA(zero_page));
+         kfree2(PA_TO_LIN_VA(pa), PAGE_SIZE);
+      }
+   }
+}
+
+/*
+ * Allocates 4 MB of physically contiguous memory aligned at 4 MB, in a way
+ * that allows its pageframes to be freed one by one with kfree2().
+ */
+static void *alloc_big_page_frames(void)
+{
+   const u32 fl = KMALLOC_FL_MULTI_STEP | PAGE_SIZE;
+   const u32 free_fl = KFREE_FL_ALLOW_SPLIT | KFREE_FL_MULTI_STEP;
+   size_t size = 4 * MB;
+   size_t head, tail;
+   void *va;
+
+   if (!(va = general_kmalloc(&size, fl)))
+      return NULL;
+
+   if (!(LIN_VA_TO_PA(va) & (4 * MB - 1)))
+      return va;
+
+   /*
+    * The heap containing the block is not aligned at 4 MB. Try allocating
+    * twice the memory and then free everything outside the aligned 4 MB.
+    */
+   general_kfree(va, &size, free_fl);
+   size = 8 * MB;
+
+   if (!(va = general_kmalloc(&size, fl)))
+      return NULL;
+
+   head = pow2_round_up_at((ulong)va, 4 * MB) - (ulong)va;
+   tail = 4 * MB - head;
+
+   if (head)
+      general_kfree(va, &head, free_fl);
+
+   if (tail)
+      general_kfree(va + head + 4 * MB, &tail, free_fl);
+
+   return va + head;
+}
+
+/* Flags for the 4-KB pages equivalent to the 4-MB page `e` */
+static u32 big_page_get_pt_flags(page_dir_entry_t *e)
+{
+   u32 flags = e->raw & (PG_RW_BIT | PG_US_BIT | PG_WT_BIT | PG_CD_BIT);
+   flags |= e->raw & PG_CUSTOM_BITS;
+
+   if (e->big_4mb_page.pat)
+      flags |= PG_PAGE_PAT_BIT;
+
+   return flags;
+}
+
+/*
+ * Replaces the user 4-MB page mapped at `pd_index` with a page table mapping
+ * the same pageframes, with the same flags, using regular 4-KB pages.
+ */
+static int split_big_page(pdir_t *pdir, u32 pd_index)
+{
+   page_dir_entry_t *e = &pdir->entries[pd_index];
+   const ulong paddr = big_page_get_paddr(e);
+   page_table_t *pt;
+   u32 flags;
+
+   ASSERT(e->present && e->psize);
+   ASSERT(e->us);
+
+   if (!(pt = kalloc_obj(page_table_t)))
+      return -ENOMEM;
+
+   ASSERT(IS_PAGE_ALIGNED(pt));
+
+   flags = big_page_get_pt_flags(e);
+
+   for (u32 j = 0; j < 1024; j++)
+      pt->pages[j].raw = PG_PRESENT_BIT | flags | (paddr + (j << PAGE_SHIFT));
+
+   e->raw = PG_PRESENT_BIT | PG_RW_BIT | PG_US_BIT | LIN_VA_TO_PA(pt);
+   invalidate_page_hw(pd_index << BIG_PAGE_SHIFT);
+   return 0;
+}
+
+static void
+unmap_big_page(pdir_t *pdir,
+               u32 pd_index,
+               bool do_free,
+               struct tlb_gather *tlb)
+{
+   page_dir_entry_t *e = &pdir->entries[pd_index];
+   const ulong paddr = big_page_get_paddr(e);
+
+   ASSERT(e->present && e->psize);
+   ASSERT(e->us);
+
+   e->raw = 0;
+
+   /* A single invlpg anywhere in a 4-MB page invalidates its whole entry */
+   tlb_gather_add(tlb, pd_index << BIG_PAGE_SHIFT);
+   big_page_release_frames(paddr, do_free);
+}
+
+static void account_cow_fault(void)
+{
+   struct proc_mem_counters *mc = &get_curr_proc()->mem_counters;
+
+   mc->minflt++;
+   mc->cow_faults++;
+}
 
+static bool handle_potential_cow_4kb(u32 vaddr)
+{
    const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
    const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
    const void *const page_vaddr = (void *)(vaddr & PAGE_MASK);
@@ -75,32 +301,15 @@ bool handle_potential_cow(void *context)
       pt->pages[pt_index].rw = true;
       pt->pages[pt_index].avail = 0;
       invalidate_page_hw(vaddr);
+      account_cow_fault();
       return true;
    }
 
    // Allocate a new page.
    void *new_page_vaddr = kmalloc(PAGE_SIZE);
 
-   if (!new_page_vaddr) {
-
-      // Out-of-memory case
-      struct task *curr = get_curr_task();
-
-      if (!curr->running_in_kernel) {
-
-         // The task was not running in kernel: we can safely kill it.
-         printk("Out-of-memory: killing pid %d\n", get_curr_pid());
-         send_signal(get_curr_pid(), SIGKILL, SIG_FL_PROCESS | SIG_FL_FAULT);
-         return true;
-
-      } else {
-
-         // We cannot kill a task running in kernel during a CoW page fault
-         // In this case (but in the one above too), Linux puts the process to
-         // sleep, while the OOM killer runs and frees some memory.
-         panic("Out-of-memory: can't copy a CoW page [pid %d]", get_curr_pid());
-      }
-   }
+   if (!new_page_vaddr)
+      return handle_fault_out_of_memory(PAGE_SIZE);
 
    ASSERT(IS_PAGE_ALIGNED(new_page_vaddr));
 
@@ -125,9 +334,84 @@ bool handle_potential_cow(void *context)
    pt->pages[pt_index].avail = 0;
 
    invalidate_page_hw(vaddr);
+   account_cow_fault();
    return true;
 }
 
+static bool handle_big_page_cow(u32 vaddr)
+{
+   const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+   page_dir_entry_t *e = &get_curr_pdir()->entries[pd_index];
+   const ulong orig_paddr = big_page_get_paddr(e);
+   void *new_frames;
+   ulong paddr;
+   u32 j;
+
+   for (j = 0; j < 1024; j++) {
+      if (pf_ref_count_get(orig_paddr + (j << PAGE_SHIFT)) != 1)
+         break;
+   }
+
+   if (j == 1024) {
+
+      /* This big page is not shared anymore. No need for copying it. */
+      e->rw = true;
+      e->avail = 0;
+      invalidate_page_hw(vaddr);
+      account_cow_fault();
+      return true;
+   }
+
+   if (!(new_frames = alloc_big_page_frames())) {
+
+      /*
+       * Not enough contiguous memory for a private copy of the whole 4 MB
+       * page: split it and copy just the 4-KB page that has been written.
+       */
+      if (split_big_page(get_curr_pdir(), pd_index) < 0)
+         return handle_fault_out_of_memory(PAGE_SIZE);
+
+      return handle_potential_cow_4kb(vaddr);
+   }
+
+   memcpy32(new_frames, (void *)(vaddr & ~(4 * MB - 1)), (4 * MB) / 4);
+   paddr = LIN_VA_TO_PA(new_frames);
+
+   big_page_retain_frames(paddr);
+   big_page_release_frames(orig_paddr, true);
+
+   e->big_4mb_page.paddr = SHR_BITS(paddr, BIG_PAGE_SHIFT, u32);
+   e->rw = true;
+   e->avail = 0;
+
+   invalidate_page_hw(vaddr);
+   account_cow_fault();
+   return true;
+}
+
+bool handle_potential_cow(void *context)
+{
+   regs_t *r = context;
+   page_dir_entry_t *e;
+   u32 vaddr;
+
+   if ((r->err_code & PAGE_FAULT_FL_COW) != PAGE_FAULT_FL_COW)
+      return false;
+
+   asmVolatile("movl %%cr2, %0" : "=r"(vaddr));
+   e = &get_curr_pdir()->entries[vaddr >> BIG_PAGE_SHIFT];
+
+   if (e->psize) {
+
+      if (!(e->avail & PAGE_COW_ORIG_RW))
+         return false; /* Not a COW page */
+
+      return handle_big_page_cow(vaddr);
+   }
+
+   return handle_potential_cow_4kb(vaddr);
+}
+
 static void kernel_page_fault_panic(regs_t *r, u32 vaddr, bool rw, bool p)
 {
    long off = 0;
@@ -171,8 +455,10 @@ void handle_page_fault_int(regs_t *r)
        */
       if (!!(um->prot & PROT_WRITE) || !rw) {
 
-         if (vfs_handle_fault(um, (void *)vaddr, p, rw))
+         if (vfs_handle_fault(um, (void *)vaddr, p, rw)) {
+            get_curr_proc()->mem_counters.minflt++;
             return;
+         }
 
          sig = SIGBUS;
       }
@@ -244,64 +530,135 @@ bool is_rw_mapped(pdir_t *pdir, void *vaddrp)
 
 void set_page_rw(pdir_t *pdir, void *vaddrp, bool rw)
 {
-   page_table_t *pt;
-   const ulong vaddr = (ulong) vaddrp;
-   const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
-   const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
-
-   pt = PA_TO_LIN_VA(pdir->entries[pd_index].ptaddr << PAGE_SHIFT);
-   ASSERT(LIN_VA_TO_PA(pt) != 0);
-   pt->pages[pt_index].rw = rw;
-   invalidate_page_hw(vaddr);
+   set_pages_rw(pdir, vaddrp, 1, rw);
 }
 
-static inline int
-__unmap_page(pdir_t *pdir, void *vaddrp, bool free_pageframe, bool permissive)
+void set_pages_rw(pdir_t *pdir, void *vaddrp, size_t page_count, bool rw)
 {
-   page_table_t *pt;
-   const ulong vaddr = (ulong) vaddrp;
-   const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
-   const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+   struct tlb_gather tlb;
+   ulong vaddr = (ulong) vaddrp & PAGE_MASK;
+   size_t rem = page_count;
 
-   pt = PA_TO_LIN_VA(pdir->entries[pd_index].ptaddr << PAGE_SHIFT);
+   tlb_gather_init(&tlb, pdir);
 
-   if (permissive) {
+   while (rem > 0) {
 
-      if (LIN_VA_TO_PA(pt) == 0)
-         return -EINVAL;
+      const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+      const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
+      const u32 n = (u32)MIN(1024 - pt_index, rem);
+      page_table_t *pt;
 
-      if (!pt->pages[pt_index].present)
-         return -EINVAL;
+      /* ELF segments and file mappings never use 4-MB pages */
+      ASSERT(!pdir->entries[pd_index].psize);
 
-   } else {
+      pt = pdir_get_page_table(pdir, pd_index);
       ASSERT(LIN_VA_TO_PA(pt) != 0);
-      ASSERT(pt->pages[pt_index].present);
+
+      for (u32 j = pt_index; j < pt_index + n; j++) {
+         pt->pages[j].rw = rw;
+         tlb_gather_add(&tlb, vaddr + ((j - pt_index) << PAGE_SHIFT));
+      }
+
+      vaddr += (ulong)n << PAGE_SHIFT;
+      rem -= n;
    }
 
-   const ulong paddr = (ulong)
-      pt->pages[pt_index].pageAddr << PAGE_SHIFT;
+   tlb_gather_flush(&tlb);
+}
 
-   pt->pages[pt_index].raw = 0;
-   invalidate_page_hw(vaddr);
+/*
+ * Un-maps `page_count` pages starting at `vaddr`, walking each page table just
+ * once and invalidating the TLB just once at the end. Whole 4-MB pages in the
+ * range are un-mapped at once, while the ones partially in the range are split
+ * first. Returns the number of 4-KB pages actually un-mapped.
+ */
+static size_t
+unmap_pages_int(pdir_t *pdir,
+                void *vaddrp,
+                size_t page_count,
+                bool do_free,
+                bool permissive)
+{
+   struct tlb_gather tlb;
+   ulong vaddr = (ulong) vaddrp;
+   size_t rem = page_count;
+   size_t unmapped = 0;
+   u32 n;
 
-   if (!pf_ref_count_dec(paddr) && free_pageframe) {
-      ASSERT(paddr != KERNEL_VA_TO_PA(zero_page));
-      kfree2(PA_TO_LIN_VA(paddr), PAGE_SIZE);
+   ASSERT(IS_PAGE_ALIGNED(vaddr));
+   tlb_gather_init(&tlb, pdir);
+
+   for (; rem > 0; vaddr += (ulong)n << PAGE_SHIFT, rem -= n) {
+
+      const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+      const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
+      page_dir_entry_t *e = &pdir->entries[pd_index];
+      page_table_t *pt;
+
+      n = (u32)MIN(1024 - pt_index, rem);
+
+      if (e->present && e->psize) {
+
+         if (n == 1024) {
+            unmap_big_page(pdir, pd_index, do_free, &tlb);
+            unmapped += 1024;
+            continue;
+         }
+
+         /* Un-mapping only a part of a 4-MB page: split it first */
+         if (split_big_page(pdir, pd_index) < 0) {
+
+            if (permissive)
+               continue;
+
+            panic("Out-of-memory: unable to split a 4-MB page at %p",
+                  TO_PTR(vaddr));
+         }
+      }
+
+      if (!e->present) {
+         ASSERT(permissive);
+         continue;
+      }
+
+      pt = pdir_get_page_table(pdir, pd_index);
+
+      for (u32 j = pt_index; j < pt_index + n; j++) {
+
+         page_t *p = &pt->pages[j];
+
+         if (!p->present) {
+            ASSERT(permissive);
+            continue;
+         }
+
+         const ulong paddr = (ulong)p->pageAddr << PAGE_SHIFT;
+
+         p->raw = 0;
+         tlb_gather_add(&tlb, vaddr + ((j - pt_index) << PAGE_SHIFT));
+         unmapped++;
+
+         if (!pf_ref_count_dec(paddr) && do_free) {
+            ASSERT(paddr != KERNEL_VA_TO_PA(zero_page));
+            kfree2(PA_TO_LIN_VA(paddr), PAGE_SIZE);
+         }
+      }
    }
 
-   return 0;
+   tlb_gather_flush(&tlb);
+   return unmapped;
 }
 
 void
 unmap_page(pdir_t *pdir, void *vaddrp, bool free_pageframe)
 {
-   __unmap_page(pdir, vaddrp, free_pageframe, false);
+   unmap_pages_int(pdir, vaddrp, 1, free_pageframe, false);
 }
 
 int
 unmap_page_permissive(pdir_t *pdir, void *vaddrp, bool free_pageframe)
 {
-   return __unmap_page(pdir, vaddrp, free_pageframe, true);
+   return unmap_pages_int(pdir, vaddrp, 1, free_pageframe, true) ? 0 : -EINVAL;
 }
 
 void
@@ -310,9 +667,7 @@ unmap_pages(pdir_t *pdir,
             size_t page_count,
             bool do_free)
 {
-   for (size_t i = 0; i < page_count; i++) {
-      unmap_page(pdir, (char *)vaddr + (i << PAGE_SHIFT), do_free);
-   }
+   unmap_pages_int(pdir, vaddr, page_count, do_free, false);
 }
 
 size_t
@@ -321,21 +676,174 @@ unmap_pages_permissive(pdir_t *pdir,
                        size_t page_count,
                        bool do_free)
 {
-   size_t unmapped_pages = 0;
+   return unmap_pages_int(pdir, vaddr, page_count, do_free, true);
+}
+
+int split_big_pages(pdir_t *pdir, void *vaddrp, size_t len)
+{
+   const ulong start = (ulong) vaddrp;
+   const ulong end = start + len;
+   const u32 pd_indexes[2] = {
+      start >> BIG_PAGE_SHIFT,
+      (end - 1) >> BIG_PAGE_SHIFT,
+   };
    int rc;
 
-   for (size_t i = 0; i < page_count; i++) {
-      rc = unmap_page_permissive(
-         pdir,
-         (char *)vaddr + (i << PAGE_SHIFT),
-         do_free
-      );
-      unmapped_pages += (rc == 0);
+   ASSERT(len > 0);
+
+   /* Only the first and the last 4-MB pages can be partially in the range */
+   for (u32 k = 0; k < ARRAY_SIZE(pd_indexes); k++) {
+
+      const u32 i = pd_indexes[k];
+      const ulong big_start = (ulong)i << BIG_PAGE_SHIFT;
+      page_dir_entry_t *e = &pdir->entries[i];
+
+      if (!e->present || !e->psize)
+         continue;
+
+      if (start <= big_start && big_start + 4 * MB <= end)
+         continue; /* The whole big page is in the range */
+
+      if ((rc = split_big_page(pdir, i)))
+         return rc;
    }
 
+   return 0;
+}
+
+size_t unmap_big_pages(pdir_t *pdir, void *vaddrp, size_t len, bool do_free)
+{
+   const ulong end = (ulong)vaddrp + len;
+   ulong va = pow2_round_up_at((ulong)vaddrp, 4 * MB);
+   size_t unmapped_pages = 0;
+   struct tlb_gather tlb;
+
+   tlb_gather_init(&tlb, pdir);
+
+   for (; va + 4 * MB <= end; va += 4 * MB) {
+
+      page_dir_entry_t *e = &pdir->entries[va >> BIG_PAGE_SHIFT];
+
+      if (e->present && e->psize) {
+         unmap_big_page(pdir, va >> BIG_PAGE_SHIFT, do_free, &tlb);
+         unmapped_pages += 1024;
+      }
+   }
+
+   tlb_gather_flush(&tlb);
    return unmapped_pages;
 }
 
+int collapse_big_page(pdir_t *pdir, void *vaddrp)
+{
+   const ulong vaddr = (ulong) vaddrp;
+   const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+   page_dir_entry_t *e = &pdir->entries[pd_index];
+   page_table_t *pt;
+   void *frames;
+   ulong paddr;
+
+   ASSERT(!(vaddr & (4 * MB - 1)));
+   ASSERT(vaddr < BASE_VA);
+
+   if (!e->present)
+      return -EFAULT;
+
+   if (e->psize)
+      return 0; /* Nothing to do */
+
+   pt = pdir_get_page_table(pdir, pd_index);
+
+   /* Only fully-mapped, private and writable ranges are supported */
+   for (u32 j = 0; j < 1024; j++) {
+
+      page_t p = pt->pages[j];
+
+      if (!p.present || !p.us || (p.avail & PAGE_SHARED))
+         return -EINVAL;
+
+      if (!p.rw && !(p.avail & PAGE_COW_ORIG_RW))
+         return -EINVAL;
+   }
+
+   if (!(frames = alloc_big_page_frames()))
+      return -ENOMEM;
+
+   paddr = LIN_VA_TO_PA(frames);
+
+   for (u32 j = 0; j < 1024; j++) {
+
+      const ulong pa = (ulong)pt->pages[j].pageAddr << PAGE_SHIFT;
+      void *dest = frames + (j << PAGE_SHIFT);
+
+      if (pa == KERNEL_VA_TO_PA(zero_page))
+         bzero(dest, PAGE_SIZE);
+      else
+         memcpy32(dest, PA_TO_LIN_VA(pa), PAGE_SIZE / 4);
+
+      if (!pf_ref_count_dec(pa))
+         kfree2(PA_TO_LIN_VA(pa), PAGE_SIZE);
+   }
+
+   big_page_retain_frames(paddr);
+   kfree_obj(pt, page_table_t);
+
+   e->raw = PG_PRESENT_BIT | PG_RW_BIT | PG_US_BIT | PG_4MB_BIT | paddr;
+
+   /* There might be up to 1024 stale TLB entries: flush them all */
+   if (pdir == get_curr_pdir())
+      set_curr_pdir(pdir);
+
+   return 0;
+}
+
+static void
+account_user_pages(struct user_mem_usage *u, ulong pa, u32 avail, ulong n)
+{
+   const u32 ref_count = pf_ref_count_get(pa);
+
+   if ((avail & PAGE_COW_ORIG_RW) && ref_count > 1)
+      u->cow_pages += n;
+   else if ((avail & PAGE_SHARED) || ref_count > 1)
+      u->shared_pages += n;
+   else
+      u->private_pages += n;
+}
+
+void pdir_get_user_mem_usage(pdir_t *pdir, struct user_mem_usage *u)
+{
+   const ulong zero_page_pa = KERNEL_VA_TO_PA(zero_page);
+   page_table_t *pt;
+
+   ASSERT(!is_preemption_enabled());
+   bzero(u, sizeof(*u));
+
+   for (u32 i = 0; i < (BASE_VA >> BIG_PAGE_SHIFT); i++) {
+
+      page_dir_entry_t *e = &pdir->entries[i];
+
+      if (!e->present)
+         continue;
+
+      if (e->psize) {
+         account_user_pages(u, big_page_get_paddr(e), e->avail, 1024);
+         continue;
+      }
+
+      pt = pdir_get_page_table(pdir, i);
+      u->pt_pages++;
+
+      for (u32 j = 0; j < 1024; j++) {
+
+         const page_t p = pt->pages[j];
+         const ulong pa = (ulong)p.pageAddr << PAGE_SHIFT;
+
+         if (p.present && pa != zero_page_pa)
+            account_user_pages(u, pa, p.avail, 1);
+      }
+   }
+}
+
 ulong get_mapping(pdir_t *pdir, void *vaddrp)
 {
    page_table_t *pt;
@@ -353,6 +861,12 @@ ulong get_mapping(pdir_t *pdir, void *vaddrp)
 
    e.raw = pdir->entries[pd_index].raw;
    ASSERT(e.present);
+
+   if (e.psize) {
+      return ((ulong) e.big_4mb_page.paddr << BIG_PAGE_SHIFT) |
+             (vaddr & (4 * MB - 1));
+   }
+
    ASSERT(e.ptaddr != 0);
 
    pt = PA_TO_LIN_VA(e.ptaddr << PAGE_SHIFT);
@@ -446,6 +960,97 @@ map_page_int(pdir_t *pdir, void *vaddrp, ulong paddr, u32 hw_flags)
    return 0;
 }
 
+/*
+ * Returns true if the page directory entry for `vaddr` can be used for a 4-MB
+ * page. User page tables left empty by previous un-mappings are freed.
+ */
+static bool big_page_slot_avail(pdir_t *pdir, void *vaddrp)
+{
+   const u32 pd_index = ((ulong)vaddrp >> BIG_PAGE_SHIFT);
+   page_dir_entry_t *e = &pdir->entries[pd_index];
+   page_table_t *pt;
+
+   if (!e->present)
+      return true;
+
+   if (e->psize || !e->us)
+      return false;
+
+   pt = pdir_get_page_table(pdir, pd_index);
+
+   for (u32 j = 0; j < 1024; j++) {
+      if (pt->pages[j].present)
+         return false;
+   }
+
+   e->raw = 0;
+   kfree_obj(pt, page_table_t);
+   return true;
+}
+
+/*
+ * Maps `page_count` regular pages, resolving (or creating) each page table
+ * just once. No TLB invalidation is necessary because all the entries were
+ * non-present. Returns the number of pages mapped before the first failure.
+ */
+static size_t
+map_4kb_pages_int(pdir_t *pdir,
+                  ulong vaddr,
+                  ulong paddr,
+                  size_t page_count,
+                  u32 hw_flags)
+{
+   size_t mapped = 0;
+
+   while (mapped < page_count) {
+
+      const u32 pd_index = (vaddr >> BIG_PAGE_SHIFT);
+      const u32 pt_index = (vaddr >> PAGE_SHIFT) & 1023;
+      const u32 n = (u32)MIN(1024 - pt_index, page_count - mapped);
+      page_dir_entry_t *e = &pdir->entries[pd_index];
+      page_table_t *pt;
+
+      if (UNLIKELY(e->psize))
+         break; /* The range overlaps with a 4-MB page */
+
+      if (UNLIKELY(!e->present)) {
+
+         // we have to create a page table for mapping 'vaddr'.
+         pt = kzalloc_obj(page_table_t);
+
+         if (UNLIKELY(!pt))
+            break;
+
+         ASSERT(IS_PAGE_ALIGNED(pt));
+
+         e->raw =
+            PG_PRESENT_BIT |
+            PG_RW_BIT |
+            (hw_flags & PG_US_BIT) |
+            LIN_VA_TO_PA(pt);
+
+      } else {
+
+         pt = pdir_get_page_table(pdir, pd_index);
+      }
+
+      for (u32 j = pt_index; j < pt_index + n; j++) {
+
+         if (pt->pages[j].present)
+            return mapped;
+
+         pt->pages[j].raw = PG_PRESENT_BIT | hw_flags | paddr;
+         pf_ref_count_inc(paddr);
+
+         vaddr += PAGE_SIZE;
+         paddr += PAGE_SIZE;
+         mapped++;
+      }
+   }
+
+   return mapped;
+}
+
 NODISCARD size_t
 map_pages_int(pdir_t *pdir,
               void *vaddr,
@@ -454,10 +1059,10 @@ map_pages_int(pdir_t *pdir,
               bool big_pages_allowed,
               u32 hw_flags)
 {
-   int rc;
    size_t pages = 0;
    size_t big_pages = 0;
    size_t rem_pages = page_count;
+   size_t lead_pages;
    u32 big_page_flags;
 
    ASSERT(!((ulong)vaddr & OFFSET_IN_PAGE_MASK));
@@ -465,26 +1070,40 @@ map_pages_int(pdir_t *pdir,
 
    if (big_pages_allowed && rem_pages >= 1024) {
 
-      for (; pages < rem_pages; pages++) {
-
-         if (!((ulong)vaddr & (4*MB - 1)) && !(paddr & (4*MB - 1)))
-            break;
-
-         rc = map_page_int(pdir, vaddr, paddr, hw_flags);
+      /*
+       * Map regular pages until both the vaddr and the paddr are aligned at
+       * 4 MB. If their offsets in a 4 MB block differ, that never happens and
+       * we'll end up mapping the whole range with regular pages.
+       */
+      if ((((ulong)vaddr ^ paddr) & (4 * MB - 1)) == 0)
+         lead_pages = ((0 - (ulong)vaddr) & (4 * MB - 1)) >> PAGE_SHIFT;
+      else
+         lead_pages = rem_pages;
 
-         if (UNLIKELY(rc < 0))
-            goto out;
+      lead_pages = MIN(lead_pages, rem_pages);
+      pages = map_4kb_pages_int(pdir, (ulong)vaddr, paddr, lead_pages, hw_flags);
 
-         vaddr += PAGE_SIZE;
-         paddr += PAGE_SIZE;
-      }
+      if (UNLIKELY(pages < lead_pages))
+         goto out;
 
+      vaddr += pages << PAGE_SHIFT;
+      paddr += pages << PAGE_SHIFT;
       rem_pages -= pages;
       big_page_flags = hw_flags | PG_4MB_BIT | PG_PRESENT_BIT;
       big_page_flags &= ~PG_GLOBAL_BIT;
 
       for (; big_pages < (rem_pages >> 10); big_pages++) {
+
+         if (!big_page_slot_avail(pdir, vaddr))
+            break; /* Fall back to 4-KB pages for the rest */
+
          map_4mb_page_int(pdir, vaddr, paddr, big_page_flags);
+
+         if (hw_flags & PG_US_BIT) {
+            big_page_retain_frames(paddr);
+            invalidate_page_hw((ulong)vaddr);
+         }
+
          vaddr += (4 * MB);
          paddr += (4 * MB);
       }
@@ -492,16 +1111,7 @@ map_pages_int(pdir_t *pdir,
       rem_pages -= (big_pages << 10);
    }
 
-   for (size_t i = 0; i < rem_pages; i++, pages++) {
-
-      rc = map_page_int(pdir, vaddr, paddr, hw_flags);
-
-      if (UNLIKELY(rc < 0))
-         goto out;
-
-      vaddr += PAGE_SIZE;
-      paddr += PAGE_SIZE;
-   }
+   pages += map_4kb_pages_int(pdir, (ulong)vaddr, paddr, rem_pages, hw_flags);
 
 out:
    return (big_pages << 10) + pages;
@@ -512,6 +1122,7 @@ map_page(pdir_t *pdir, void *vaddrp, ulong paddr, u32 pg_flags)
 {
    const bool rw = !!(pg_flags & PAGING_FL_RW);
    const bool us = !!(pg_flags & PAGING_FL_US);
+   const bool cd = !!(pg_flags & PAGING_FL_NO_CACHE);
    u32 avail_bits = 0;
    int rc;
 
@@ -544,6 +1155,8 @@ map_page(pdir_t *pdir, void *vaddrp, ulong paddr, u32 pg_flags)
                    (u32)(avail_bits << PG_CUSTOM_B0_POS) |
                    (u32)(us << PG_US_BIT_POS)            |
                    (u32)(rw << PG_RW_BIT_POS)            |
+                   (u32)(cd << PG_CD_BIT_POS)            |
+                   (u32)(cd << PG_WT_BIT_POS)            |
                    (u32)((!us) << PG_GLOBAL_BIT_POS));
                    /* Kernel pages are global */
 
@@ -586,6 +1199,7 @@ map_pages(pdir_t *pdir,
    const bool us = !!(pg_flags & PAGING_FL_US);
    const bool rw = !!(pg_flags & PAGING_FL_RW);
    const bool big_pages = !!(pg_flags & PAGING_FL_BIG_PAGES_ALLOWED);
+   const bool cd = !!(pg_flags & PAGING_FL_NO_CACHE);
    u32 avail_bits = 0;
 
    if (pg_flags & PAGING_FL_SHARED)
@@ -603,6 +1217,8 @@ map_pages(pdir_t *pdir,
                     (u32)(avail_bits << PG_CUSTOM_B0_POS) |
                     (u32)(us << PG_US_BIT_POS)            |
                     (u32)(rw << PG_RW_BIT_POS)            |
+                    (u32)(cd << PG_CD_BIT_POS)            |
+                    (u32)(cd << PG_WT_BIT_POS)            |
                     (u32)((!us) << PG_GLOBAL_BIT_POS));
 }
 
@@ -618,10 +1234,7 @@ pdir_t *pdir_clone(pdir_t *pdir)
 
    for (u32 i = 0; i < BASE_VADDR_PD_IDX; i++) {
 
-      /* User-space cannot use 4-MB pages */
-      ASSERT(!pdir->entries[i].psize);
-
-      if (!pdir->entries[i].present)
+      if (!pdir->entries[i].present || pdir->entries[i].psize)
          continue;
 
       page_table_t *pt = kalloc_obj(page_table_t);
@@ -629,8 +1242,11 @@ pdir_t *pdir_clone(pdir_t *pdir)
       if (UNLIKELY(!pt)) {
 
          for (; i > 0; i--) {
-            if (pdir->entries[i - 1].present)
-               kfree_obj(pdir_get_page_table(pdir, i - 1), page_table_t);
+
+            page_dir_entry_t *e = &new_pdir->entries[i - 1];
+
+            if (e->present && !e->psize)
+               kfree_obj(pdir_get_page_table(new_pdir, i - 1), page_table_t);
          }
 
          kfree_obj(new_pdir, pdir_t);
@@ -643,8 +1259,26 @@ pdir_t *pdir_clone(pdir_t *pdir)
 
    for (u32 i = 0; i < BASE_VADDR_PD_IDX; i++) {
 
-      if (!pdir->entries[i].present)
+      page_dir_entry_t *e = &pdir->entries[i];
+
+      if (!e->present)
+         continue;
+
+      if (e->psize) {
+
+         /* 4-MB page: mark the whole page as COW, unless it's shared */
+         if (!(e->avail & PAGE_SHARED)) {
+
+            if (e->rw)
+               e->avail |= PAGE_COW_ORIG_RW;
+
+            e->rw = false;
+         }
+
+         big_page_retain_frames(big_page_get_paddr(e));
+         new_pdir->entries[i].raw = e->raw;
          continue;
+      }
 
       page_table_t *orig_pt = pdir_get_page_table(pdir, i);
       page_table_t *new_pt = pdir_get_page_table(new_pdir, i);
@@ -680,6 +1314,54 @@ pdir_t *pdir_clone(pdir_t *pdir)
    return new_pdir;
 }
 
+/*
+ * Copies the 4-MB page at `pd_index` into 1024 newly-allocated regular pages,
+ * because there's no guarantee to find 4 MB of contiguous memory, here.
+ */
+static bool
+deep_clone_big_page(struct kmalloc_acc *acc,
+                    pdir_t *pdir,
+                    pdir_t *new_pdir,
+                    u32 pd_index)
+{
+   page_dir_entry_t *e = &pdir->entries[pd_index];
+   const ulong orig_paddr = big_page_get_paddr(e);
+   const u32 flags = big_page_get_pt_flags(e);
+   page_table_t *new_pt;
+
+   /* Clear the entry, in case we have to destroy `new_pdir` */
+   new_pdir->entries[pd_index].raw = 0;
+
+   if (!(new_pt = kmalloc_accelerator_get_elem(acc)))
+      return false;
+
+   ASSERT(IS_PAGE_ALIGNED(new_pt));
+   bzero(new_pt, sizeof(page_table_t));
+
+   new_pdir->entries[pd_index].raw =
+      PG_PRESENT_BIT | PG_RW_BIT | PG_US_BIT | LIN_VA_TO_PA(new_pt);
+
+   for (u32 j = 0; j < 1024; j++) {
+
+      void *new_page = kmalloc_accelerator_get_elem(acc);
+      void *orig_page = PA_TO_LIN_VA(orig_paddr + (j << PAGE_SHIFT));
+
+      if (!new_page)
+         return false;
+
+      ASSERT(IS_PAGE_ALIGNED(new_page));
+
+      u32 new_page_paddr = LIN_VA_TO_PA(new_page);
+      ASSERT(pf_ref_count_get(new_page_paddr) == 0);
+      pf_ref_count_inc(new_page_paddr);
+
+      memcpy32(new_page, orig_page, PAGE_SIZE / 4);
+      new_pt->pages[j].raw = PG_PRESENT_BIT | flags | new_page_paddr;
+   }
+
+   return true;
+}
+
 pdir_t *
 pdir_deep_clone(pdir_t *pdir)
 {
@@ -700,12 +1382,17 @@ pdir_deep_clone(pdir_t *pdir)
 
       new_pdir->entries[i].raw = pdir->entries[i].raw;
 
-      /* User-space cannot use 4-MB pages */
-      ASSERT(!pdir->entries[i].psize);
-
       if (!pdir->entries[i].present)
          continue;
 
+      if (pdir->entries[i].psize) {
+
+         if (!deep_clone_big_page(&acc, pdir, new_pdir, i))
+            goto oom_exit;
+
+         continue;
+      }
+
       page_table_t *orig_pt = pdir_get_page_table(pdir, i);
       page_table_t *new_pt = kmalloc_accelerator_get_elem(&acc);
 
@@ -769,9 +1456,16 @@ void pdir_destroy(pdir_t *pdir)
 
    for (u32 i = 0; i < BASE_VADDR_PD_IDX; i++) {
 
-      if (!pdir->entries[i].present)
+      page_dir_entry_t *e = &pdir->entries[i];
+
+      if (!e->present)
          continue;
 
+      if (e->psize) {
+         big_page_release_frames(big_page_get_paddr(e), true);
+         continue;
+      }
+
       page_table_t *pt = pdir_get_page_table(pdir, i);
 
       for (u32 j = 0; j < 1024; j++) {
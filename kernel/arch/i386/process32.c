@@ -517,6 +517,7 @@ int setup_process(struct elf_program_info *pinfo,
       pi = ti->pi;
 
       if (!pi->vforked) {
+         process_update_max_rss(pi);
          remove_all_user_zero_mem_mappings(pi);
          remove_all_file_mappings(pi);
          process_free_mappings_info(pi);
@@ -72,6 +72,11 @@ void set_page_rw(pdir_t *pdir, void *vaddrp, bool rw)
    NOT_IMPLEMENTED();
 }
 
+void set_pages_rw(pdir_t *pdir, void *vaddrp, size_t page_count, bool rw)
+{
+   NOT_IMPLEMENTED();
+}
+
 NODISCARD int
 map_page(pdir_t *pdir, void *vaddrp, ulong paddr, u32 pg_flags)
 {
@@ -132,6 +137,26 @@ unmap_pages_permissive(pdir_t *pdir,
    NOT_IMPLEMENTED();
 }
 
+int split_big_pages(pdir_t *pdir, void *vaddr, size_t len)
+{
+   NOT_IMPLEMENTED();
+}
+
+size_t unmap_big_pages(pdir_t *pdir, void *vaddr, size_t len, bool do_free)
+{
+   NOT_IMPLEMENTED();
+}
+
+int collapse_big_page(pdir_t *pdir, void *vaddr)
+{
+   NOT_IMPLEMENTED();
+}
+
+void pdir_get_user_mem_usage(pdir_t *pdir, struct user_mem_usage *u)
+{
+   NOT_IMPLEMENTED();
+}
+
 pdir_t *pdir_clone(pdir_t *pdir)
 {
    NOT_IMPLEMENTED();
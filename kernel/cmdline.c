@@ -144,6 +144,7 @@ ALL_KOPTS_BEGIN
    DEFINE_KOPT(sched_alive_thread, sat , bool, false)
    DEFINE_KOPT(sercon            ,     , bool, !MOD_console)
    DEFINE_KOPT(noacpi            ,     , bool, false)
+   DEFINE_KOPT(noapic            ,     , bool, false)
    DEFINE_KOPT(fb_no_opt         ,     , bool, false)
    DEFINE_KOPT(fb_no_wc          ,     , bool, false)
    DEFINE_KOPT(no_fpu_memcpy     ,     , bool, false)
@@ -152,8 +153,13 @@ ALL_KOPTS_BEGIN
    DEFINE_KOPT(panic_regs        , pr  , bool, PANIC_SHOW_REGS)
    DEFINE_KOPT(panic_mmap        , pm  , bool, false)
    DEFINE_KOPT(big_scroll_buf    , bb  , bool, TERM_BIG_SCROLL_BUF)
+   DEFINE_KOPT(scrollback        , sbl , long, 0)
    DEFINE_KOPT(ps2_log           , plg , bool, PS2_VERBOSE_DEBUG_LOG)
    DEFINE_KOPT(ps2_selftest      , pse , bool, PS2_DO_SELFTEST)
+   DEFINE_KOPT(printk_async      , pka , bool, KRN_PRINTK_ASYNC)
+   DEFINE_KOPT(printk_sync_lvl   , psl , long, PRINTK_LVL_ERR)
+   DEFINE_KOPT(serial_baud       , sbd , long, SERIAL_DEFAULT_BAUD)
+   DEFINE_KOPT(serial_base_baud  , sbb , long, SERIAL_BASE_BAUD)
 
 ALL_KOPTS_END
 
@@ -49,6 +49,7 @@ u32 clock_drift_adj_loop_delay = 600 * TIMER_HZ;
 
 extern u64 __time_ns;
 extern u32 __tick_duration;
+static u64 last_sys_time;
 extern int __tick_adj_val;
 extern int __tick_adj_ticks_rem;
 
@@ -408,15 +409,34 @@ void init_system_time(void)
       panic("Invalid boot-time UNIX timestamp: %d\n", boot_timestamp);
 
    __time_ns = 0;
+   last_sys_time = 0;
 }
 
 u64 get_sys_time(void)
 {
+   u32 sub, next_delta;
    u64 ts;
    ulong var;
    disable_interrupts(&var);
    {
-      ts = __time_ns;
+      /*
+       * Interpolate between the ticks using the clocksource, but never go past
+       * the value `__time_ns` will have after the next tick: while the drift
+       * is being compensated, that's not `__tick_duration` ns ahead.
+       */
+      next_delta = __tick_duration;
+
+      if (__tick_adj_ticks_rem)
+         next_delta = (u32)((s32)__tick_duration + __tick_adj_val);
+
+      sub = timer_get_subtick_ns();
+      ts = __time_ns + MIN(sub, next_delta - 1);
+
+      /* Never let the time go backwards */
+      if (ts < last_sys_time)
+         ts = last_sys_time;
+      else
+         last_sys_time = ts;
    }
    enable_interrupts(&var);
    return ts;
@@ -472,6 +492,76 @@ u64 timespec_to_ticks(const struct k_timespec64 *tp)
    return ticks;
 }
 
+u64 timespec_to_ns(const struct k_timespec64 *tp)
+{
+   return (u64)tp->tv_sec * BILLION + (u64)tp->tv_nsec;
+}
+
+void ns_to_timespec(u64 ns, struct k_timespec64 *tp)
+{
+   tp->tv_sec = (s64)(ns / BILLION);
+   tp->tv_nsec = (long)(ns % BILLION);
+}
+
+static bool
+is_valid_timer_timespec(const struct k_timespec64 *tp)
+{
+   return tp->tv_sec >= 0 && IN_RANGE(tp->tv_nsec, 0, BILLION);
+}
+
+u64
+timer_timespec_to_ns(const struct k_timespec64 *tp)
+{
+   if ((u64)tp->tv_sec >= UINT64_MAX / BILLION - 1)
+      return UINT64_MAX;
+
+   return timespec_to_ns(tp);
+}
+
+/*
+ * Convert the `it_value` of a timer, relative or absolute on `clk_id`, to a
+ * delay from now and its `it_interval` to ns. A zero `delta` means that the
+ * timer has to be disarmed.
+ */
+int itimerspec_to_ns(clockid_t clk_id,
+                     bool abs,
+                     const struct k_itimerspec64 *its,
+                     u64 *delta,
+                     u64 *interval)
+{
+   struct k_timespec64 now;
+   u64 val, now_ns;
+
+   if (!is_valid_timer_timespec(&its->it_value) ||
+       !is_valid_timer_timespec(&its->it_interval))
+   {
+      return -EINVAL;
+   }
+
+   val = timer_timespec_to_ns(&its->it_value);
+   *interval = timer_timespec_to_ns(&its->it_interval);
+
+   if (val && abs) {
+
+      if (do_clock_gettime(clk_id, &now))
+         return -EINVAL;
+
+      now_ns = timespec_to_ns(&now);
+
+      /* An absolute time in the past means: expire as soon as possible */
+      val = val > now_ns ? val - now_ns : 1;
+   }
+
+   *delta = val;
+   return 0;
+}
+
+void ns_to_itimerspec(u64 rem, u64 interval, struct k_itimerspec64 *its)
+{
+   ns_to_timespec(rem, &its->it_value);
+   ns_to_timespec(interval, &its->it_interval);
+}
+
 void real_time_get_timespec(struct k_timespec64 *tp)
 {
    const u64 t = get_sys_time();
@@ -562,13 +652,25 @@ do_clock_gettime(clockid_t clk_id, struct k_timespec64 *tp)
 int
 do_clock_getres(clockid_t clk_id, struct k_timespec64 *res)
 {
+   struct clocksource_info cs;
+
    switch (clk_id) {
 
       case CLOCK_REALTIME:
-      case CLOCK_REALTIME_COARSE:
       case CLOCK_MONOTONIC:
-      case CLOCK_MONOTONIC_COARSE:
       case CLOCK_MONOTONIC_RAW:
+
+         timer_get_clocksource(&cs);
+
+         *res = (struct k_timespec64) {
+            .tv_sec = 0,
+            .tv_nsec = (long)cs.res_ns,
+         };
+
+         break;
+
+      case CLOCK_REALTIME_COARSE:
+      case CLOCK_MONOTONIC_COARSE:
       case CLOCK_PROCESS_CPUTIME_ID:
       case CLOCK_THREAD_CPUTIME_ID:
 
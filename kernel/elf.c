@@ -106,9 +106,7 @@ load_segment_by_copy(fs_handle *elf_h,
 
       /* Make the read-only pages to be read-only */
       vaddr = (char *) (phdr->p_vaddr & PAGE_MASK);
-
-      for (size_t j = 0; j < page_count; j++, vaddr += PAGE_SIZE)
-         set_page_rw(pdir, vaddr, false);
+      set_pages_rw(pdir, vaddr, page_count, false);
    }
 
    return 0;
@@ -290,6 +288,8 @@ errend:
    return (int) rc;
 }
 
+#include "elf_cache.c.h"
+
 static int
 alloc_and_map_stack_page(pdir_t *pdir, void *stack_top, u32 i)
 {
@@ -308,31 +308,32 @@ alloc_and_map_stack_page(pdir_t *pdir, void *stack_top, u32 i)
 }
 
 static int
-open_elf_file(const char *filepath, fs_handle *elf_file_ref)
+open_elf_file(const char *filepath,
+              fs_handle *elf_file_ref,
+              struct k_stat64 *statbuf)
 {
-   struct k_stat64 statbuf;
    fs_handle h;
    int rc;
 
    if ((rc = vfs_open(filepath, &h, O_RDONLY, 0)))
       return rc;           /* The file does not exist (typical case) */
 
-   if ((rc = vfs_fstat64(h, &statbuf))) {
+   if ((rc = vfs_fstat64(h, statbuf))) {
       vfs_close(h);
       return rc;           /* Cannot stat() the file */
    }
 
-   if ((statbuf.st_mode & S_IFREG) != S_IFREG) {
+   if ((statbuf->st_mode & S_IFREG) != S_IFREG) {
 
       vfs_close(h);
 
-      if ((statbuf.st_mode & S_IFDIR) == S_IFDIR)
+      if ((statbuf->st_mode & S_IFDIR) == S_IFDIR)
          return -EISDIR;   /* Cannot execute a directory! */
 
       return -EACCES;      /* Not a regular file */
    }
 
-   if ((statbuf.st_mode & S_IXUSR) != S_IXUSR) {
+   if ((statbuf->st_mode & S_IXUSR) != S_IXUSR) {
       vfs_close(h);
       return -EACCES;      /* Doesn't have exec permission */
    }
@@ -357,14 +358,86 @@ is_dyn_exec(struct elf_headers *eh)
    return false;
 }
 
+/*
+ * Slow path of load_elf_program(): read and validate the headers and, on
+ * success, return a new (retained) exec cache entry.
+ */
+static int
+load_elf_image(fs_handle elf_h,
+               char *header_buf,
+               struct k_stat64 *statbuf,
+               struct elf_program_info *pinfo,
+               struct exec_cache_entry **ce_ref)
+{
+   struct exec_cache_entry *ce;
+   struct elf_headers eh;
+   int load_count = 0;
+   int rc;
+
+   if ((rc = load_elf_headers(elf_h, header_buf, &eh, &pinfo->wrong_arch))) {
+
+      if (rc == -ENOEXEC && header_buf[0] == '#' && header_buf[1] == '!') {
+
+         /* Cache the header of the script: it contains the interpreter */
+         if ((ce = exec_cache_new_entry(elf_h, statbuf, 0))) {
+            ce->script = true;
+            memcpy(ce->hdr, header_buf, ELF_RAW_HEADER_SIZE);
+            exec_cache_add(ce);
+            exec_cache_release(ce);
+         }
+      }
+
+      return rc;
+   }
+
+   if (is_dyn_exec(&eh)) {
+      pinfo->dyn_exec = true;
+      rc = -ENOEXEC;
+      goto out;
+   }
+
+   for (int i = 0; i < eh.header->e_phnum; i++) {
+
+      Elf_Phdr *phdr = eh.phdrs + i;
+
+      if (phdr->p_type != PT_LOAD)
+         continue;
+
+      if ((rc = check_segment_alignment(phdr)))
+         goto out;
+
+      load_count++;
+   }
+
+   if (!(ce = exec_cache_new_entry(elf_h, statbuf, load_count))) {
+      rc = -ENOMEM;
+      goto out;
+   }
+
+   for (int i = 0, j = 0; i < eh.header->e_phnum; i++) {
+      if (eh.phdrs[i].p_type == PT_LOAD)
+         ce->loads[j++] = eh.phdrs[i];
+   }
+
+   ce->entry = eh.header->e_entry;
+   memcpy(ce->hdr, header_buf, ELF_RAW_HEADER_SIZE);
+   exec_cache_add(ce);
+   *ce_ref = ce;
+
+out:
+   free_elf_headers(&eh);
+   return rc;
+}
+
 int
 load_elf_program(const char *filepath,
                  char *header_buf,
                  struct elf_program_info *pinfo)
 {
+   struct exec_cache_entry *ce = NULL;
    load_segment_func load_seg = NULL;
+   struct k_stat64 statbuf;
    fs_handle elf_h = NULL;
-   struct elf_headers eh;
    ulong brk = 0;
    size_t count;
    int rc;
@@ -372,7 +445,7 @@ load_elf_program(const char *filepath,
    pinfo->wrong_arch = false;
    pinfo->dyn_exec = false;
 
-   if ((rc = open_elf_file(filepath, &elf_h)))
+   if ((rc = open_elf_file(filepath, &elf_h, &statbuf)))
       return rc;
 
    if ((rc = acquire_subsys_flock_h(elf_h, SUBSYS_PROCMGNT, &pinfo->lf))) {
@@ -380,13 +453,18 @@ load_elf_program(const char *filepath,
       return rc == -EBADF ? -ENOEXEC : rc;
    }
 
-   if ((rc = load_elf_headers(elf_h, header_buf, &eh, &pinfo->wrong_arch))) {
-      vfs_close(elf_h);
-      return rc;
+   ce = exec_cache_get(get_fs(elf_h),
+                       get_fs(elf_h)->fsops->get_inode(elf_h),
+                       &statbuf);
+
+   if (!ce) {
+      if ((rc = load_elf_image(elf_h, header_buf, &statbuf, pinfo, &ce)))
+         goto out;
    }
 
-   if (is_dyn_exec(&eh)) {
-      pinfo->dyn_exec = true;
+   memcpy(header_buf, ce->hdr, ELF_RAW_HEADER_SIZE);
+
+   if (ce->script) {
       rc = -ENOEXEC;
       goto out;
    }
@@ -402,22 +480,11 @@ load_elf_program(const char *filepath,
       goto out;
    }
 
-   for (int i = 0; i < eh.header->e_phnum; i++) {
+   for (int i = 0; i < ce->load_count; i++) {
 
       ulong end_vaddr = 0;
-      Elf_Phdr *phdr = eh.phdrs + i;
 
-      if (phdr->p_type != PT_LOAD)
-         continue;
-
-      rc = check_segment_alignment(phdr);
-
-      if (rc < 0)
-         goto out;
-
-      rc = load_seg(elf_h, pinfo->pdir, phdr, &end_vaddr);
-
-      if (rc < 0)
+      if ((rc = load_seg(elf_h, pinfo->pdir, &ce->loads[i], &end_vaddr)) < 0)
          goto out;
 
       if (end_vaddr > brk)
@@ -459,12 +526,14 @@ load_elf_program(const char *filepath,
    // Finally setting the output-params.
 
    pinfo->stack = (void *) USERMODE_STACK_MAX;
-   pinfo->entry = (void *) eh.header->e_entry;
+   pinfo->entry = (void *) ce->entry;
    pinfo->brk = (void *) brk;
 
 out:
    vfs_close(elf_h);
-   free_elf_headers(&eh);
+
+   if (ce)
+      exec_cache_release(ce);
 
    if (UNLIKELY(rc != 0)) {
 
@@ -473,8 +542,10 @@ out:
          pinfo->pdir = NULL;
       }
 
-      if (pinfo->lf)
+      if (pinfo->lf) {
          release_subsys_flock(pinfo->lf);
+         pinfo->lf = NULL;
+      }
    }
 
    return rc;
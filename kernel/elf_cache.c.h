@@ -0,0 +1,256 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Exec image cache: a small LRU cache of the ELF images already parsed and
+ * validated by load_elf_program(). Each entry contains the raw header, the
+ * entry point and the list of the PT_LOAD segments to map. For "#!" scripts,
+ * only the raw header (containing the interpreter's path) is stored.
+ *
+ * The file still has to be opened and stat()-ed at every execve(), but all
+ * the header reads and the validation are skipped in case of a hit.
+ *
+ * NOTE: this file is included by elf.c.
+ */
+
+struct exec_cache_entry {
+
+   REF_COUNTED_OBJECT;
+
+   struct mnt_fs *fs;
+   vfs_inode_ptr_t inode;
+   tilck_ino_t ino;
+   s64 mtime_sec;
+   long mtime_nsec;
+   s64 size;
+   u32 last_use;
+
+   bool script;                  /* "#!" script: only `hdr` is meaningful */
+   int load_count;               /* number of elements in `loads` */
+   Elf_Phdr *loads;              /* PT_LOAD segments, already validated */
+   ulong entry;
+   char hdr[ELF_RAW_HEADER_SIZE];
+};
+
+static struct exec_cache_entry *exec_cache[EXEC_CACHE_MAX_ENTRIES];
+static struct exec_cache_stats exec_cache_stats;
+static u32 exec_cache_clock;
+
+static void exec_cache_release(struct exec_cache_entry *e)
+{
+   if (release_obj(e) > 0)
+      return;
+
+   if (e->loads)
+      kfree2(e->loads, sizeof(Elf_Phdr) * (size_t)e->load_count);
+
+   kfree_obj(e, struct exec_cache_entry);
+}
+
+static void exec_cache_remove_at(int i)
+{
+   struct exec_cache_entry *e = exec_cache[i];
+   ASSERT(!is_preemption_enabled());
+   ASSERT(e != NULL);
+
+   exec_cache[i] = NULL;
+   exec_cache_stats.entries--;
+   exec_cache_release(e);
+}
+
+static bool
+exec_cache_is_fresh(struct exec_cache_entry *e, struct k_stat64 *st)
+{
+   return e->ino == st->st_ino &&
+          e->mtime_sec == (s64)st->st_mtim.tv_sec &&
+          e->mtime_nsec == (long)st->st_mtim.tv_nsec &&
+          e->size == (s64)st->st_size;
+}
+
+/* Returns a retained entry or NULL */
+static struct exec_cache_entry *
+exec_cache_get(struct mnt_fs *fs, vfs_inode_ptr_t inode, struct k_stat64 *st)
+{
+   struct exec_cache_entry *e, *res = NULL;
+
+   disable_preemption();
+
+   for (int i = 0; i < ARRAY_SIZE(exec_cache); i++) {
+
+      if (!(e = exec_cache[i]) || e->fs != fs || e->inode != inode)
+         continue;
+
+      if (exec_cache_is_fresh(e, st)) {
+         retain_obj(e);
+         e->last_use = ++exec_cache_clock;
+         res = e;
+      } else {
+         exec_cache_remove_at(i);   /* the file changed behind our back */
+      }
+
+      break;
+   }
+
+   if (res)
+      exec_cache_stats.hits++;
+   else
+      exec_cache_stats.misses++;
+
+   enable_preemption();
+   return res;
+}
+
+static struct exec_cache_entry *
+exec_cache_new_entry(fs_handle h, struct k_stat64 *st, int load_count)
+{
+   struct mnt_fs *fs = get_fs(h);
+   struct exec_cache_entry *e;
+
+   if (!(e = kzalloc_obj(struct exec_cache_entry)))
+      return NULL;
+
+   if (load_count) {
+
+      e->loads = kmalloc(sizeof(Elf_Phdr) * (size_t)load_count);
+
+      if (!e->loads) {
+         kfree_obj(e, struct exec_cache_entry);
+         return NULL;
+      }
+   }
+
+   e->ref_count = 1;
+   e->fs = fs;
+   e->inode = fs->fsops->get_inode(h);
+   e->ino = st->st_ino;
+   e->mtime_sec = (s64)st->st_mtim.tv_sec;
+   e->mtime_nsec = (long)st->st_mtim.tv_nsec;
+   e->size = (s64)st->st_size;
+   e->load_count = load_count;
+   return e;
+}
+
+static int exec_cache_find_slot(struct exec_cache_entry *e)
+{
+   int slot = 0;
+
+   /* Another task might have loaded the same file in the meanwhile */
+   for (int i = 0; i < ARRAY_SIZE(exec_cache); i++) {
+
+      struct exec_cache_entry *pos = exec_cache[i];
+
+      if (pos && pos->fs == e->fs && pos->inode == e->inode)
+         return i;
+   }
+
+   for (int i = 0; i < ARRAY_SIZE(exec_cache); i++) {
+      if (!exec_cache[i])
+         return i;
+   }
+
+   /* The cache is full: evict the least recently used entry */
+   for (int i = 1; i < ARRAY_SIZE(exec_cache); i++) {
+      if (exec_cache[i]->last_use < exec_cache[slot]->last_use)
+         slot = i;
+   }
+
+   return slot;
+}
+
+static void exec_cache_add(struct exec_cache_entry *e)
+{
+   int slot;
+
+   disable_preemption();
+   {
+      slot = exec_cache_find_slot(e);
+
+      if (exec_cache[slot])
+         exec_cache_remove_at(slot);
+
+      retain_obj(e);
+      e->last_use = ++exec_cache_clock;
+      exec_cache[slot] = e;
+      exec_cache_stats.entries++;
+   }
+   enable_preemption();
+}
+
+void exec_cache_invalidate(struct mnt_fs *fs, vfs_inode_ptr_t inode)
+{
+   struct exec_cache_entry *e;
+
+   if (!exec_cache_stats.entries)
+      return;
+
+   disable_preemption();
+
+   for (int i = 0; i < ARRAY_SIZE(exec_cache); i++) {
+
+      if ((e = exec_cache[i]) && e->fs == fs && e->inode == inode) {
+         exec_cache_remove_at(i);
+         exec_cache_stats.invalidations++;
+      }
+   }
+
+   enable_preemption();
+}
+
+void exec_cache_invalidate_h(fs_handle h)
+{
+   struct mnt_fs *fs = get_fs(h);
+
+   if (!exec_cache_stats.entries)
+      return;
+
+   disable_preemption();
+
+   /* Don't call get_inode() for handles of other file systems (ttys etc.) */
+   for (int i = 0; i < ARRAY_SIZE(exec_cache); i++) {
+
+      struct exec_cache_entry *e = exec_cache[i];
+
+      if (e && e->fs == fs) {
+         exec_cache_invalidate(fs, fs->fsops->get_inode(h));
+         break;
+      }
+   }
+
+   enable_preemption();
+}
+
+size_t exec_cache_shrink(void)
+{
+   struct exec_cache_entry *e;
+   size_t freed = 0;
+
+   if (!exec_cache_stats.entries)
+      return 0;
+
+   disable_preemption();
+
+   for (int i = 0; i < ARRAY_SIZE(exec_cache); i++) {
+
+      if (!(e = exec_cache[i]))
+         continue;
+
+      /* Entries used by a running execve() will be freed by it, later */
+      if (get_ref_count(e) == 1) {
+         freed += sizeof(struct exec_cache_entry);
+         freed += sizeof(Elf_Phdr) * (size_t)e->load_count;
+      }
+
+      exec_cache_remove_at(i);
+   }
+
+   enable_preemption();
+   return freed;
+}
+
+void exec_cache_get_stats(struct exec_cache_stats *stats)
+{
+   disable_preemption();
+   {
+      *stats = exec_cache_stats;
+   }
+   enable_preemption();
+}
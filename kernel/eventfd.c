@@ -0,0 +1,205 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/eventfd.h>
+
+struct eventfd {
+
+   KOBJ_BASE_FIELDS
+
+   u64 counter;
+   bool semaphore;
+   struct kmutex mutex;
+   struct kcond rready_cond;
+   struct kcond wready_cond;
+};
+
+static ssize_t eventfd_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   bool sig_pending = false;
+   ssize_t rc = 0;
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   kmutex_lock(&e->mutex);
+
+   while (true) {
+
+      if (e->counter) {
+         val = e->semaphore ? 1 : e->counter;
+         e->counter -= val;
+         memcpy(buf, &val, sizeof(val));
+         rc = sizeof(val);
+         break;
+      }
+
+      if (kh->fl_flags & O_NONBLOCK) {
+         rc = -EAGAIN;
+         break;
+      }
+
+      /* Wait for a writer to increment the counter */
+      kcond_wait(&e->rready_cond, &e->mutex, KCOND_WAIT_FOREVER);
+
+      /* After wake up */
+      if (pending_signals()) {
+         sig_pending = true;
+         break;
+      }
+   }
+
+   if (rc > 0) {
+
+      kcond_signal_all(&e->wready_cond);
+
+      /* In semaphore mode, other readers might be able to proceed as well */
+      if (e->counter)
+         kcond_signal_one(&e->rready_cond);
+   }
+
+   kmutex_unlock(&e->mutex);
+   return !sig_pending ? rc : -EINTR;
+}
+
+static ssize_t eventfd_write(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   bool sig_pending = false;
+   ssize_t rc = 0;
+   u64 val;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   memcpy(&val, buf, sizeof(val));
+
+   if (val > EFD_MAX_COUNTER)
+      return -EINVAL;
+
+   kmutex_lock(&e->mutex);
+
+   while (true) {
+
+      if (val <= EFD_MAX_COUNTER - e->counter) {
+         e->counter += val;
+         rc = sizeof(val);
+         break;
+      }
+
+      if (kh->fl_flags & O_NONBLOCK) {
+         rc = -EAGAIN;
+         break;
+      }
+
+      /* Wait for a reader to decrement the counter */
+      kcond_wait(&e->wready_cond, &e->mutex, KCOND_WAIT_FOREVER);
+
+      /* After wake up */
+      if (pending_signals()) {
+         sig_pending = true;
+         break;
+      }
+   }
+
+   if (rc > 0 && e->counter)
+      kcond_signal_all(&e->rready_cond);
+
+   kmutex_unlock(&e->mutex);
+   return !sig_pending ? rc : -EINTR;
+}
+
+static int eventfd_read_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   bool ret;
+
+   kmutex_lock(&e->mutex);
+   {
+      ret = e->counter > 0;
+   }
+   kmutex_unlock(&e->mutex);
+   return ret;
+}
+
+static int eventfd_write_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   bool ret;
+
+   kmutex_lock(&e->mutex);
+   {
+      ret = e->counter < EFD_MAX_COUNTER;
+   }
+   kmutex_unlock(&e->mutex);
+   return ret;
+}
+
+static struct kcond *eventfd_get_rready_cond(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   return &e->rready_cond;
+}
+
+static struct kcond *eventfd_get_wready_cond(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct eventfd *e = (void *)kh->kobj;
+   return &e->wready_cond;
+}
+
+static const struct file_ops static_ops_eventfd =
+{
+   .read = eventfd_read,
+   .write = eventfd_write,
+   .read_ready = eventfd_read_ready,
+   .write_ready = eventfd_write_ready,
+   .get_rready_cond = eventfd_get_rready_cond,
+   .get_wready_cond = eventfd_get_wready_cond,
+};
+
+static void destroy_eventfd(struct eventfd *e)
+{
+   kcond_destory(&e->wready_cond);
+   kcond_destory(&e->rready_cond);
+   kmutex_destroy(&e->mutex);
+   kfree_obj(e, struct eventfd);
+}
+
+fs_handle eventfd_create_handle(u32 initval, bool semaphore, int fl_flags)
+{
+   struct eventfd *e;
+   fs_handle res;
+
+   if (!(e = (void *)kzalloc_obj(struct eventfd)))
+      return NULL;
+
+   e->destory_obj = (void *)&destroy_eventfd;
+   e->counter = initval;
+   e->semaphore = semaphore;
+   kmutex_init(&e->mutex, 0);
+   kcond_init(&e->rready_cond);
+   kcond_init(&e->wready_cond);
+
+   res = kfs_create_new_handle(&static_ops_eventfd, (void *)e, fl_flags);
+
+   if (!res)
+      destroy_eventfd(e);
+
+   return res;
+}
@@ -359,6 +359,7 @@ do_execve_int(struct execve_ctx *ctx, const char *path, const char *const *argv)
 
    /* From now on, we cannot fail */
    close_cloexec_handles(ti->pi);
+   delete_all_posix_timers(ti->pi);
    disable_preemption();
    {
       execve_final_steps(ti, pinfo.brk, argv, &user_regs);
@@ -28,6 +28,7 @@ task_free_all_kernel_allocs(struct task *ti)
 
       /* Free the allocated chunk */
       kfree2(alloc->vaddr, alloc->size);
+      ti->pi->mem_counters.temp_kallocs -= alloc->size;
 
       /* Remove the kernel_alloc elem from the tree */
       bintree_remove_ptr(&ti->kallocs_tree_root,
@@ -250,12 +251,17 @@ void terminate_process(int exit_code, int term_sig)
    drop_all_pending_signals(ti);
    ti->nested_sig_handlers = -1;
 
+   /* Sample the peak RSS before un-mapping anything */
+   process_update_max_rss(pi);
+
    /*
-    * Close all the handles, keeping the preemption enabled while doing so.
+    * Close all the handles and delete the POSIX timers, keeping the preemption
+    * enabled while doing so.
     */
    enable_preemption();
    {
       close_all_handles();
+      delete_all_posix_timers(pi);
    }
    disable_preemption();
 
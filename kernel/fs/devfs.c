@@ -555,4 +555,6 @@ init_devfs(void)
 
    if ((rc = mp_add(devfs, "/dev/")))
       panic("mp_add() failed with error: %d", rc);
+
+   init_memdevs();
 }
@@ -5,6 +5,7 @@
 
 #include <tilck/kernel/fs/fat32.h>
 #include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/pagecache.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/datetime.h>
@@ -40,15 +41,6 @@ fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
    offt fsize = (offt)h->e->DIR_FileSize;
    offt written_to_buf = 0;
 
-   if (pos != &h->h_fpos) {
-
-      /*
-       * We don't support pread() for this filesystem, at the moment.
-       * TODO: make fat32 support pread64().
-       */
-      return -EPERM;
-   }
-
    if (h->e->directory)
       return -EISDIR;
 
@@ -61,6 +53,15 @@ fat_read(fs_handle handle, char *buf, size_t bufsize, offt *pos)
       return 0;
    }
 
+   if (pos != &h->h_fpos) {
+
+      /*
+       * pread(): our cluster cursor is only meaningful for the file position,
+       * so go through the page cache, which can read at any offset.
+       */
+      return pagecache_read(handle, buf, bufsize, pos, fsize);
+   }
+
    do {
 
       char *data = fat_get_pointer_to_cluster_data(d->hdr, h->curr_cluster);
@@ -475,7 +476,6 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
    struct mnt_fs *fs = p->fs;
    struct fat_fs_path *fp = (struct fat_fs_path *)&p->fs_path;
    struct fat_entry *e = fp->entry;
-   struct fat_fs_device_data *d = fs->device_data;
 
    if (!e) {
 
@@ -500,8 +500,8 @@ fat_open(struct vfs_path *p, fs_handle *out, int fl, mode_t mode)
    h->h_fpos = 0;
    h->curr_cluster = fat_get_first_cluster(e);
 
-   if (d->mmap_support)
-      h->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
+   /* Without direct mmap support, fat_mmap() uses the page cache */
+   h->spec_flags = VFS_SPFL_MMAP_SUPPORTED;
 
    *out = h;
    return 0;
@@ -573,6 +573,59 @@ fat_get_entry(struct mnt_fs *fs,
    };
 }
 
+/*
+ * Page cache hook: copy the page `pgnum` of the file in `buf`. The page cache
+ * is used only where the ramdisk cannot be used directly: pread() and mmap()
+ * when the clusters are not page-aligned.
+ */
+static int
+fat_get_page(struct mnt_fs *fs, vfs_inode_ptr_t inode, ulong pgnum, void *buf)
+{
+   struct fat_fs_device_data *d = fs->device_data;
+   struct fat_entry *e = inode;
+   const ulong fsize = e->DIR_FileSize;
+   const ulong clu_size = d->cluster_size;
+   ulong off = pgnum << PAGE_SHIFT;
+   ulong clu_off = 0;
+   char *dest = buf;
+   u32 clu;
+
+   if (e->directory)
+      return -EISDIR;
+
+   if (off >= fsize)
+      return 0; /* past EOF: just a zero page */
+
+   const ulong end = MIN(off + PAGE_SIZE, fsize);
+   clu = fat_get_first_cluster(e);
+
+   while (true) {
+
+      if (clu_off + clu_size > off) {
+
+         /* The cluster contains data of our page */
+         char *data = fat_get_pointer_to_cluster_data(d->hdr, clu);
+         const ulong n = MIN(end - off, clu_off + clu_size - off);
+
+         memcpy(dest, data + (off - clu_off), n);
+         dest += n;
+         off += n;
+
+         if (off == end)
+            break;
+      }
+
+      clu = fat_read_fat_entry(d->hdr, d->type, 0, clu);
+      clu_off += clu_size;
+
+      // We do not expect BAD CLUSTERS or the chain to end before EOF
+      ASSERT(!fat_is_bad_cluster(d->type, clu));
+      ASSERT(!fat_is_end_of_clusterchain(d->type, clu));
+   }
+
+   return 0;
+}
+
 static vfs_inode_ptr_t fat_get_inode(fs_handle h)
 {
    return ((struct fatfs_handle *)h)->e;
@@ -615,6 +668,8 @@ static const struct fs_ops static_fsops_fat =
    .fs_exunlock = fat_exclusive_unlock,
    .fs_shlock = fat_shared_lock,
    .fs_shunlock = fat_shared_unlock,
+
+   .get_page = fat_get_page,
 };
 
 struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
@@ -653,6 +708,7 @@ struct mnt_fs *fat_mount_ramdisk(void *vaddr, size_t rd_size, u32 flags)
 
 void fat_umount_ramdisk(struct mnt_fs *fs)
 {
+   pagecache_invalidate(fs, NULL);
    kfree_obj(fs->device_data, struct fat_fs_device_data);
    destory_fs_obj(fs);
 }
@@ -2,6 +2,7 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
+#include <tilck/common/utils.h>
 
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/paging.h>
@@ -10,6 +11,7 @@
 #include <tilck/kernel/system_mmap.h>
 #include <tilck/kernel/fs/vfs_base.h>
 #include <tilck/kernel/fs/fat32.h>
+#include <tilck/kernel/fs/pagecache.h>
 
 int fat_ramdisk_prepare_for_mmap(struct fat_fs_device_data *d, size_t rd_size)
 {
@@ -74,6 +76,10 @@ int fat_ramdisk_prepare_for_mmap(struct fat_fs_device_data *d, size_t rd_size)
    pdir_t *const pdir = get_kernel_pdir();
    char *const va_begin = (char *)hdr;
    char *const va_end = va_begin + rd_size;
+   const size_t page_count =
+      (pow2_round_up_at((ulong)va_end, PAGE_SIZE) -
+       ((ulong)va_begin & PAGE_MASK)) >> PAGE_SHIFT;
+
    VERIFY(rd_size >= used);
 
    if (rd_size - used < PAGE_SIZE) {
@@ -81,13 +87,9 @@ int fat_ramdisk_prepare_for_mmap(struct fat_fs_device_data *d, size_t rd_size)
       return -1;
    }
 
-   for (char *va = va_begin; va < va_end; va += PAGE_SIZE)
-      set_page_rw(pdir, va, true);
-
+   set_pages_rw(pdir, va_begin, page_count, true);
    fat_align_first_data_sector(hdr, PAGE_SIZE);
-
-   for (char *va = va_begin; va < va_end; va += PAGE_SIZE)
-      set_page_rw(pdir, va, false);
+   set_pages_rw(pdir, va_begin, page_count, false);
 
    printk("fat ramdisk: align of ramdisk was necessary\n");
    return 0;
@@ -103,12 +105,18 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
    size_t mapped_cnt, tot_mapped_cnt = 0;
    u32 clu;
 
-   if (!d->mmap_support)
-      return -ENODEV; /* We do NOT support mmap for this "superblock" */
-
    if (fh->e->directory)
       return -EACCES;
 
+   if (!d->mmap_support) {
+
+      /*
+       * The clusters are not page-aligned (or smaller than a page), so we
+       * cannot map the ramdisk directly: map copies of its pages instead.
+       */
+      return pagecache_mmap(um, pdir, flags, (offt)fh->e->DIR_FileSize);
+   }
+
    if (flags & VFS_MM_DONT_MMAP)
       return 0;
 
@@ -184,11 +192,5 @@ int fat_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
 
 int fat_munmap(struct user_mapping *um, void *vaddrp, size_t len)
 {
-   struct fatfs_handle *fh = um->h;
-   struct fat_fs_device_data *d = fh->fs->device_data;
-
-   if (!d->mmap_support)
-      return -ENODEV; /* We do NOT support mmap for this "superblock" */
-
    return generic_fs_munmap(um, vaddrp, len);
 }
@@ -11,6 +11,8 @@
 #include <tilck/kernel/fault_resumable.h>
 #include <tilck/kernel/syscalls.h>
 #include <tilck/kernel/pipe.h>
+#include <tilck/kernel/timerfd.h>
+#include <tilck/kernel/eventfd.h>
 
 #include <fcntl.h>      // system header
 
@@ -309,6 +311,113 @@ int sys_pwrite64(int fd, const void *u_buf, size_t count, s64 off)
    return ret;
 }
 
+/*
+ * Copies data from `in` to `out` through the task's io_copybuf, reading with
+ * vfs_read() or, when `off` is not NULL, with vfs_pread(). Therefore, it's
+ * the same code path used by read() and pread() on every file system.
+ */
+static int do_sendfile(int out_fd, int in_fd, s64 *off, size_t count)
+{
+   struct task *curr = get_curr_task();
+   struct fs_handle_base *in, *out;
+   ssize_t rc = 0, wrc;
+   size_t tot = 0;
+
+   if (!(in = get_fs_handle(in_fd)) || !(out = get_fs_handle(out_fd)))
+      return -EBADF;
+
+   if ((in->spec_flags | out->spec_flags) & VFS_SPFL_NO_USER_COPY)
+      return -EINVAL;
+
+   if (!in->fops->seek)
+      return -EINVAL; /* like on Linux, `in` must be a regular file */
+
+   count = MIN(count, (size_t)INT32_MAX);
+
+   while (tot < count) {
+
+      const size_t n = MIN(count - tot, IO_COPYBUF_SIZE);
+
+      if (off)
+         rc = vfs_pread(in, curr->io_copybuf, n, (offt)*off + (offt)tot);
+      else
+         rc = vfs_read(in, curr->io_copybuf, n);
+
+      if (rc <= 0)
+         break;
+
+      wrc = vfs_write(out, curr->io_copybuf, (size_t)rc);
+
+      if (wrc < rc) {
+
+         /* Don't lose the data we read, but we couldn't write */
+         if (!off)
+            vfs_seek(in, (offt)(MAX(wrc, 0) - rc), SEEK_CUR);
+
+         if (wrc > 0)
+            tot += (size_t)wrc;
+         else
+            rc = wrc;
+
+         break;
+      }
+
+      tot += (size_t)rc;
+   }
+
+   if (off)
+      *off += (s64)tot;
+
+   return tot > 0 ? (int)tot : (int)rc;
+}
+
+int sys_sendfile(int out_fd, int in_fd, long *u_off, size_t count)
+{
+   long off32;
+   s64 off;
+   int rc;
+
+   if (!u_off)
+      return do_sendfile(out_fd, in_fd, NULL, count);
+
+   if (copy_from_user(&off32, u_off, sizeof(off32)))
+      return -EFAULT;
+
+   if (off32 < 0)
+      return -EINVAL;
+
+   off = off32;
+   rc = do_sendfile(out_fd, in_fd, &off, count);
+   off32 = (long)off;
+
+   if (copy_to_user(u_off, &off32, sizeof(off32)))
+      return -EFAULT;
+
+   return rc;
+}
+
+int sys_sendfile64(int out_fd, int in_fd, s64 *u_off, size_t count)
+{
+   s64 off;
+   int rc;
+
+   if (!u_off)
+      return do_sendfile(out_fd, in_fd, NULL, count);
+
+   if (copy_from_user(&off, u_off, sizeof(off)))
+      return -EFAULT;
+
+   if (off < 0 || off > OFFT_MAX)
+      return -EINVAL;
+
+   rc = do_sendfile(out_fd, in_fd, &off, count);
+
+   if (copy_to_user(u_off, &off, sizeof(off)))
+      return -EFAULT;
+
+   return rc;
+}
+
 int sys_ioctl(int fd, ulong request, void *argp)
 {
    fs_handle handle = get_fs_handle(fd);
@@ -1047,3 +1156,69 @@ no_fds:
    ret = -EMFILE;
    goto err_end;
 }
+
+/*
+ * Install a newly created kernelfs handle in the lowest free slot of the current
+ * process. On failure, the handle is closed, destroying its object as well.
+ */
+static int install_new_kfs_handle(fs_handle h, bool cloexec)
+{
+   struct process *pi = get_curr_proc();
+   struct fs_handle_base *hb = h;
+   int fd;
+
+   if (!h)
+      return -ENOMEM;
+
+   kmutex_lock(&pi->fslock);
+   {
+      if ((fd = get_free_handle_num(pi)) >= 0) {
+
+         pi->handles[fd] = h;
+
+         if (cloexec)
+            hb->fd_flags |= FD_CLOEXEC;
+      }
+   }
+   kmutex_unlock(&pi->fslock);
+
+   if (fd < 0) {
+      vfs_close(h);
+      return -EMFILE;
+   }
+
+   return fd;
+}
+
+int sys_timerfd_create(clockid_t clk_id, int flags)
+{
+   fs_handle h;
+
+   if (clk_id != CLOCK_REALTIME && clk_id != CLOCK_MONOTONIC)
+      return -EINVAL;
+
+   if (flags & ~(O_CLOEXEC | O_NONBLOCK))
+      return -EINVAL;
+
+   h = timerfd_create_handle(clk_id, O_RDONLY | (flags & O_NONBLOCK));
+   return install_new_kfs_handle(h, !!(flags & O_CLOEXEC));
+}
+
+int sys_eventfd2(unsigned int initval, int flags)
+{
+   fs_handle h;
+
+   if (flags & ~(O_CLOEXEC | O_NONBLOCK | EFD_SEMAPHORE))
+      return -EINVAL;
+
+   h = eventfd_create_handle(initval,
+                             !!(flags & EFD_SEMAPHORE),
+                             O_RDWR | (flags & O_NONBLOCK));
+
+   return install_new_kfs_handle(h, !!(flags & O_CLOEXEC));
+}
+
+int sys_eventfd(unsigned int initval)
+{
+   return sys_eventfd2(initval, 0);
+}
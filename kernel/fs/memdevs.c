@@ -0,0 +1,101 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/devfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/kmsg.h>
+
+#include <linux/major.h> // system header
+
+/*
+ * Memory character devices (major 1), like on Linux. Only the minors that
+ * user space commonly relies on are implemented.
+ */
+
+#define MEMDEV_NULL_MINOR          3
+#define MEMDEV_ZERO_MINOR          5
+#define MEMDEV_KMSG_MINOR         11
+
+static ssize_t null_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   return 0;
+}
+
+static ssize_t null_write(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   return (ssize_t)size;
+}
+
+static ssize_t zero_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   /* NOTE: VFS_SPFL_NO_USER_COPY is not set: `buf` is a kernel buffer */
+   bzero(buf, size);
+   return (ssize_t)size;
+}
+
+static int
+memdev_create_device_file(int minor,
+                          enum vfs_entry_type *type,
+                          struct devfs_file_info *nfo)
+{
+   static const struct file_ops static_ops_null = {
+      .read = null_read,
+      .write = null_write,
+   };
+
+   static const struct file_ops static_ops_zero = {
+      .read = zero_read,
+      .write = null_write,
+   };
+
+   switch (minor) {
+
+      case MEMDEV_NULL_MINOR:
+         nfo->fops = &static_ops_null;
+         break;
+
+      case MEMDEV_ZERO_MINOR:
+         nfo->fops = &static_ops_zero;
+         break;
+
+      case MEMDEV_KMSG_MINOR:
+         kmsg_set_dev_file_info(nfo);
+         break;
+
+      default:
+         return -EINVAL;
+   }
+
+   *type = VFS_CHAR_DEV;
+   return 0;
+}
+
+static void memdev_create_devfile_or_panic(const char *name, u16 minor)
+{
+   int rc;
+
+   if ((rc = create_dev_file(name, MEM_MAJOR, minor, NULL)) < 0)
+      panic("MEMDEVS: unable to create devfile /dev/%s (error: %d)", name, rc);
+}
+
+void init_memdevs(void)
+{
+   struct driver_info *di = kzalloc_obj(struct driver_info);
+
+   if (!di)
+      panic("MEMDEVS: no enough memory for struct driver_info");
+
+   di->name = "mem";
+   di->create_dev_file = memdev_create_device_file;
+   register_driver(di, MEM_MAJOR);
+
+   memdev_create_devfile_or_panic("null", MEMDEV_NULL_MINOR);
+   memdev_create_devfile_or_panic("zero", MEMDEV_ZERO_MINOR);
+
+   init_kmsg_dev();
+   memdev_create_devfile_or_panic("kmsg", MEMDEV_KMSG_MINOR);
+}
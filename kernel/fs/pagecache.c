@@ -0,0 +1,462 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/fs/pagecache.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/paging.h>
+#include <tilck/kernel/process_mm.h>
+
+#include <sys/mman.h> // system header
+
+/*
+ * The per-inode part of the page cache. The inode pointers are unique across
+ * all the mounted file systems (they point to objects in memory), therefore
+ * the caches are indexed just by inode.
+ */
+struct page_cache {
+
+   struct bintree_node node;
+   vfs_inode_ptr_t inode;        /* tree key */
+   struct mnt_fs *fs;
+   struct pc_page *pages;        /* root of the pages tree */
+   ulong pages_count;
+};
+
+static struct page_cache *caches_root;
+static struct list lru_list = STATIC_LIST_INIT(lru_list);
+static struct pagecache_stats pc_stats;
+static u32 pc_sync_seq;
+
+static struct pc_page *pc_alloc_page(void)
+{
+   struct pc_page *pg;
+
+   if (!(pg = kzalloc_obj(struct pc_page)))
+      return NULL;
+
+   if (!(pg->vaddr = kzmalloc(PAGE_SIZE))) {
+      kfree_obj(pg, struct pc_page);
+      return NULL;
+   }
+
+   /* The page cache holds a reference to each one of its pageframes */
+   retain_pageframes_mapped_at(get_kernel_pdir(), pg->vaddr, PAGE_SIZE);
+
+   bintree_node_init(&pg->node);
+   list_node_init(&pg->lru_node);
+   return pg;
+}
+
+static void pc_free_page(struct pc_page *pg)
+{
+   release_pageframes_mapped_at(get_kernel_pdir(), pg->vaddr, PAGE_SIZE);
+   kfree2(pg->vaddr, PAGE_SIZE);
+   kfree_obj(pg, struct pc_page);
+}
+
+static bool pc_is_page_mapped(struct pc_page *pg)
+{
+   /* Each user mapping holds a reference on the pageframe, as well as us */
+   return get_pageframe_ref_count(LIN_VA_TO_PA(pg->vaddr)) > 1;
+}
+
+static struct page_cache *pc_get_cache(vfs_inode_ptr_t inode)
+{
+   ASSERT(!is_preemption_enabled());
+
+   return bintree_find_ptr(caches_root,
+                           inode,
+                           struct page_cache,
+                           node,
+                           inode);
+}
+
+static struct page_cache *
+pc_get_or_create_cache(struct mnt_fs *fs, vfs_inode_ptr_t inode)
+{
+   struct page_cache *pc;
+   ASSERT(!is_preemption_enabled());
+
+   if ((pc = pc_get_cache(inode)))
+      return pc;
+
+   if (!(pc = kzalloc_obj(struct page_cache)))
+      return NULL;
+
+   bintree_node_init(&pc->node);
+   pc->inode = inode;
+   pc->fs = fs;
+
+   DEBUG_ONLY_UNSAFE(bool success =)
+      bintree_insert_ptr(&caches_root,
+                         pc,
+                         struct page_cache,
+                         node,
+                         inode);
+
+   ASSERT(success);
+   return pc;
+}
+
+static struct pc_page *pc_lookup(vfs_inode_ptr_t inode, ulong pgnum)
+{
+   struct page_cache *pc = pc_get_cache(inode);
+
+   if (!pc)
+      return NULL;
+
+   return bintree_find_ptr(pc->pages, pgnum, struct pc_page, node, pgnum);
+}
+
+static void pc_use_page(struct pc_page *pg)
+{
+   ASSERT(!is_preemption_enabled());
+
+   pg->users++;
+
+   /* Move the page at the end of the LRU list: it's the most recently used */
+   list_remove(&pg->lru_node);
+   list_add_tail(&lru_list, &pg->lru_node);
+}
+
+static void pc_remove_page(struct pc_page *pg)
+{
+   struct page_cache *pc = pg->pc;
+   ASSERT(!is_preemption_enabled());
+   ASSERT(pg->users == 0);
+
+   bintree_remove_ptr(&pc->pages, pg, struct pc_page, node, pgnum);
+   list_remove(&pg->lru_node);
+   pc_stats.pages--;
+
+   if (pg->dirty)
+      pc_stats.dirty--;
+
+   if (!--pc->pages_count) {
+      bintree_remove_ptr(&caches_root, pc, struct page_cache, node, inode);
+      kfree_obj(pc, struct page_cache);
+   }
+
+   pc_free_page(pg);
+}
+
+static size_t pc_evict_lru(size_t count)
+{
+   struct pc_page *pg, *tmp;
+   size_t evicted = 0;
+
+   ASSERT(!is_preemption_enabled());
+
+   list_for_each(pg, tmp, &lru_list, lru_node) {
+
+      if (evicted == count)
+         break;
+
+      if (pg->users || pg->dirty || pc_is_page_mapped(pg))
+         continue;
+
+      pc_remove_page(pg);
+      evicted++;
+   }
+
+   pc_stats.evictions += evicted;
+   return evicted;
+}
+
+int
+pagecache_get_page(struct mnt_fs *fs,
+                   vfs_inode_ptr_t inode,
+                   ulong pgnum,
+                   struct pc_page **out)
+{
+   struct page_cache *pc;
+   struct pc_page *pg, *new_pg;
+   int rc;
+
+   ASSERT(fs->fsops->get_page != NULL);
+
+   disable_preemption();
+   {
+      if ((pg = pc_lookup(inode, pgnum))) {
+         pc_use_page(pg);
+         pc_stats.hits++;
+      }
+   }
+   enable_preemption();
+
+   if (pg) {
+      *out = pg;
+      return 0;
+   }
+
+   /*
+    * Cache miss: read the page without disabling the preemption, because
+    * the get_page() hook of a block-device file system might need to sleep.
+    */
+   if (!(new_pg = pc_alloc_page()))
+      return -ENOMEM;
+
+   if ((rc = fs->fsops->get_page(fs, inode, pgnum, new_pg->vaddr))) {
+      pc_free_page(new_pg);
+      return rc;
+   }
+
+   disable_preemption();
+   {
+      if ((pg = pc_lookup(inode, pgnum))) {
+
+         /* Another task loaded the same page in the meanwhile */
+         pc_use_page(pg);
+         pc_stats.hits++;
+
+      } else if ((pc = pc_get_or_create_cache(fs, inode))) {
+
+         new_pg->pgnum = pgnum;
+         new_pg->pc = pc;
+
+         DEBUG_ONLY_UNSAFE(bool success =)
+            bintree_insert_ptr(&pc->pages,
+                               new_pg,
+                               struct pc_page,
+                               node,
+                               pgnum);
+
+         ASSERT(success);
+         list_add_tail(&lru_list, &new_pg->lru_node);
+         pc->pages_count++;
+         pc_stats.pages++;
+         pc_stats.misses++;
+
+         pg = new_pg;
+         new_pg = NULL;
+         pg->users++;
+
+         if (pc_stats.pages > PAGECACHE_MAX_PAGES)
+            pc_evict_lru(pc_stats.pages - PAGECACHE_MAX_PAGES);
+      }
+   }
+   enable_preemption();
+
+   if (new_pg)
+      pc_free_page(new_pg);
+
+   if (!pg)
+      return -ENOMEM;
+
+   *out = pg;
+   return 0;
+}
+
+void pagecache_put_page(struct pc_page *pg, bool dirty)
+{
+   disable_preemption();
+   {
+      ASSERT(pg->users > 0);
+
+      if (dirty && !pg->dirty) {
+         ASSERT(pg->pc->fs->fsops->release_page != NULL);
+         pg->dirty = true;
+         pc_stats.dirty++;
+      }
+
+      pg->users--;
+   }
+   enable_preemption();
+}
+
+ssize_t pagecache_read(fs_handle h, char *buf, size_t len, offt *pos, offt sz)
+{
+   struct fs_handle_base *hb = h;
+   struct mnt_fs *fs = hb->fs;
+   vfs_inode_ptr_t inode = fs->fsops->get_inode(h);
+   struct pc_page *pg;
+   size_t done = 0;
+   int rc = 0;
+
+   if (*pos >= sz)
+      return 0;
+
+   len = (size_t)MIN((offt)len, sz - *pos);
+
+   while (done < len) {
+
+      const ulong pgnum = (ulong)(*pos >> PAGE_SHIFT);
+      const size_t pg_off = (size_t)(*pos & (PAGE_SIZE - 1));
+      const size_t n = MIN(PAGE_SIZE - pg_off, len - done);
+
+      if ((rc = pagecache_get_page(fs, inode, pgnum, &pg)))
+         break;
+
+      memcpy(buf + done, (char *)pg->vaddr + pg_off, n);
+      pagecache_put_page(pg, false);
+
+      done += n;
+      *pos += (offt)n;
+   }
+
+   return done > 0 ? (ssize_t)done : rc;
+}
+
+int pagecache_mmap(struct user_mapping *um, pdir_t *pdir, int flags, offt sz)
+{
+   struct fs_handle_base *hb = um->h;
+   struct mnt_fs *fs = hb->fs;
+   vfs_inode_ptr_t inode = fs->fsops->get_inode(um->h);
+   const bool rw = (um->prot & PROT_WRITE) && fs->fsops->release_page;
+   const ulong pg_begin = um->off >> PAGE_SHIFT;
+   const ulong file_pages = (ulong)((sz + PAGE_SIZE - 1) >> PAGE_SHIFT);
+   const ulong pg_end = MIN((um->off + um->len) >> PAGE_SHIFT, file_pages);
+   u32 pg_flags = PAGING_FL_US | PAGING_FL_SHARED;
+   size_t mapped = 0;
+   struct pc_page *pg;
+   int rc = 0;
+
+   ASSERT(IS_PAGE_ALIGNED(um->off));
+   ASSERT(IS_PAGE_ALIGNED(um->len));
+
+   if (flags & VFS_MM_DONT_MMAP)
+      return 0;
+
+   if (rw)
+      pg_flags |= PAGING_FL_RW;
+
+   /*
+    * Map all the pages at once, because the ELF loader maps the segments of
+    * executables without registering any user mapping for the fault handler.
+    * Pages past EOF are not mapped, like in the other file systems. Pages
+    * mapped as writable are considered dirty, as we cannot track the writes.
+    */
+   for (ulong pgnum = pg_begin; pgnum < pg_end; pgnum++, mapped++) {
+
+      if ((rc = pagecache_get_page(fs, inode, pgnum, &pg)))
+         break;
+
+      rc = map_page(pdir,
+                    (void *)(um->vaddr + (mapped << PAGE_SHIFT)),
+                    LIN_VA_TO_PA(pg->vaddr),
+                    pg_flags);
+
+      pagecache_put_page(pg, rw);
+
+      if (rc)
+         break;
+   }
+
+   if (rc)
+      unmap_pages_permissive(pdir, um->vaddrp, mapped, false);
+
+   return rc;
+}
+
+static struct pc_page *
+pc_find_dirty_page(struct mnt_fs *fs, vfs_inode_ptr_t inode, u32 seq)
+{
+   struct pc_page *pg;
+   ASSERT(!is_preemption_enabled());
+
+   list_for_each_ro(pg, &lru_list, lru_node) {
+
+      if (!pg->dirty || pg->sync_seq == seq || pg->pc->fs != fs)
+         continue;
+
+      if (!inode || pg->pc->inode == inode)
+         return pg;
+   }
+
+   return NULL;
+}
+
+int pagecache_sync(struct mnt_fs *fs, vfs_inode_ptr_t inode)
+{
+   const func_page_io release_page = fs->fsops->release_page;
+   struct pc_page *pg;
+   u32 seq;
+   int rc = 0;
+
+   ASSERT(is_preemption_enabled());
+
+   if (!release_page || !pc_stats.dirty)
+      return 0;
+
+   disable_preemption();
+   {
+      seq = ++pc_sync_seq;
+   }
+   enable_preemption();
+
+   while (!rc) {
+
+      disable_preemption();
+      {
+         if ((pg = pc_find_dirty_page(fs, inode, seq))) {
+
+            /*
+             * Mark the page as clean before writing it back: if it gets
+             * dirty again in the meanwhile, it will be written back again.
+             * The pages mapped in user space remain dirty instead, as they
+             * can be modified at any time.
+             */
+            pc_use_page(pg);
+            pg->sync_seq = seq;
+
+            if (!pc_is_page_mapped(pg)) {
+               pg->dirty = false;
+               pc_stats.dirty--;
+            }
+         }
+      }
+      enable_preemption();
+
+      if (!pg)
+         break;
+
+      rc = release_page(fs, pg->pc->inode, pg->pgnum, pg->vaddr);
+      pagecache_put_page(pg, rc != 0);
+   }
+
+   return rc;
+}
+
+void pagecache_invalidate(struct mnt_fs *fs, vfs_inode_ptr_t inode)
+{
+   struct pc_page *pg, *tmp;
+
+   disable_preemption();
+   {
+      list_for_each(pg, tmp, &lru_list, lru_node) {
+
+         if (pg->pc->fs != fs || (inode && pg->pc->inode != inode))
+            continue;
+
+         ASSERT(!pc_is_page_mapped(pg));
+         pc_remove_page(pg);
+      }
+   }
+   enable_preemption();
+}
+
+size_t pagecache_shrink(size_t count)
+{
+   size_t evicted;
+
+   disable_preemption();
+   {
+      evicted = pc_evict_lru(count);
+   }
+   enable_preemption();
+   return evicted;
+}
+
+void pagecache_get_stats(struct pagecache_stats *stats)
+{
+   disable_preemption();
+   {
+      *stats = pc_stats;
+   }
+   enable_preemption();
+}
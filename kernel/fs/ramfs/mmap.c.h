@@ -54,11 +54,10 @@ ramfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
       if (rc) {
 
          /* mmap failed, we have to unmap the pages already mapped */
-         vaddr -= PAGE_SIZE;
-
-         for (; vaddr >= um->vaddr; vaddr -= PAGE_SIZE) {
-            unmap_page_permissive(pdir, (void *)vaddr, false);
-         }
+         unmap_pages_permissive(pdir,
+                                um->vaddrp,
+                                (vaddr - um->vaddr) >> PAGE_SHIFT,
+                                false);
 
          return rc;
       }
@@ -74,7 +73,11 @@ register_mapping:
    return 0;
 }
 
-static bool
+/*
+ * Returns 1 if the fault has been handled, 0 if it has not (SIGBUS) and
+ * -ENOMEM if we ran out of memory.
+ */
+static int
 ramfs_handle_fault_int(struct process *pi,
                        struct user_mapping *um,
                        void *vaddrp,
@@ -98,21 +101,19 @@ ramfs_handle_fault_int(struct process *pi,
 
       ASSERT(rw);
       ASSERT((um->prot & PROT_WRITE) == 0);
-      return false;
+      return 0;
    }
 
    /* The page is *not* present */
    abs_off = um->off + (vaddr - um->vaddr);
 
    if (abs_off >= (ulong)rh->inode->fsize)
-      return false; /* Read/write past EOF */
+      return 0; /* Read/write past EOF */
 
    if (rw) {
       /* Create and map on-the-fly a struct ramfs_block */
       if (!(block = ramfs_new_block((offt)(abs_off & PAGE_MASK))))
-         panic("Out-of-memory: unable to alloc a ramfs_block. No OOM killer");
-
-      ramfs_append_new_block(rh->inode, block);
+         return -ENOMEM;
    }
 
    rc = map_page(pi->pdir,
@@ -120,24 +121,36 @@ ramfs_handle_fault_int(struct process *pi,
                  rw ? LIN_VA_TO_PA(block->vaddr) : KERNEL_VA_TO_PA(&zero_page),
                  PAGING_FL_US | PAGING_FL_RW | PAGING_FL_SHARED);
 
-   if (rc)
-      panic("Out-of-memory: unable to map a ramfs_block. No OOM killer");
+   if (rc) {
+
+      if (rw)
+         ramfs_destroy_block(block);
+
+      return -ENOMEM;
+   }
+
+   if (rw)
+      ramfs_append_new_block(rh->inode, block);
 
    invalidate_page(vaddr);
-   return true;
+   return 1;
 }
 
 
 static bool
 ramfs_handle_fault(struct user_mapping *um, void *vaddrp, bool p, bool rw)
 {
-   bool ret;
+   int rc;
    struct process *pi = get_curr_proc();
 
    disable_preemption();
    {
-      ret = ramfs_handle_fault_int(pi, um, vaddrp, p, rw);
+      rc = ramfs_handle_fault_int(pi, um, vaddrp, p, rw);
    }
    enable_preemption();
-   return ret;
+
+   if (rc == -ENOMEM)
+      return handle_fault_out_of_memory(PAGE_SIZE);
+
+   return rc > 0;
 }
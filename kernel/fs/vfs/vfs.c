@@ -5,14 +5,17 @@
 
 #include <tilck/kernel/fs/vfs.h>
 #include <tilck/kernel/fs/flock.h>
+#include <tilck/kernel/fs/pagecache.h>
 #include <tilck/kernel/kmalloc.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/process_mm.h>
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/debug_utils.h>
+#include <tilck/kernel/elf_loader.h>
 
-#include <dirent.h> // system header
+#include <dirent.h>   // system header
+#include <sys/mman.h> // system header
 
 #include "../fs_int.h"
 #include "vfs_mp.c.h"
@@ -130,6 +133,7 @@ ssize_t vfs_write(fs_handle h, void *buf, size_t buf_size)
    ASSERT(h != NULL);
 
    struct fs_handle_base *hb = (struct fs_handle_base *) h;
+   ssize_t rc;
 
    if (!hb->fops->write)
       return -EBADF;
@@ -137,7 +141,12 @@ ssize_t vfs_write(fs_handle h, void *buf, size_t buf_size)
    if (!(hb->fl_flags & (O_WRONLY | O_RDWR)))
       return -EBADF; /* file not opened for writing */
 
-   return hb->fops->write(h, buf, buf_size, &hb->h_fpos);
+   rc = hb->fops->write(h, buf, buf_size, &hb->h_fpos);
+
+   if (rc > 0)
+      exec_cache_invalidate_h(h);
+
+   return rc;
 }
 ssize_t vfs_pread(fs_handle h, void *buf, size_t buf_size, offt off)
 {
@@ -161,6 +170,7 @@ ssize_t vfs_pwrite(fs_handle h, void *buf, size_t buf_size, offt off)
    ASSERT(h != NULL);
 
    struct fs_handle_base *hb = (struct fs_handle_base *) h;
+   ssize_t rc;
 
    if (!hb->fops->write)
       return -EBADF;
@@ -168,7 +178,12 @@ ssize_t vfs_pwrite(fs_handle h, void *buf, size_t buf_size, offt off)
    if (!(hb->fl_flags & (O_WRONLY | O_RDWR)))
       return -EBADF; /* file not opened for writing */
 
-   return hb->fops->write(h, buf, buf_size, &off);
+   rc = hb->fops->write(h, buf, buf_size, &off);
+
+   if (rc > 0)
+      exec_cache_invalidate_h(h);
+
+   return rc;
 }
 
 offt vfs_seek(fs_handle h, offt off, int whence)
@@ -208,6 +223,7 @@ int vfs_ftruncate(fs_handle h, offt length)
    if (!fsops->truncate)
       return -EROFS;
 
+   exec_cache_invalidate_h(h);
    return fsops->truncate(hb->fs, fsops->get_inode(h), length);
 }
 
@@ -232,6 +248,9 @@ int vfs_fsync(fs_handle h)
    if (~hb->fs->flags & VFS_FS_RW)
       return -EROFS;
 
+   if ((rc = pagecache_sync(hb->fs, hb->fs->fsops->get_inode(h))))
+      return rc;
+
    if (hb->fops->sync)
       rc = hb->fops->sync(h);
 
@@ -247,6 +266,9 @@ int vfs_fdatasync(fs_handle h)
    if (~hb->fs->flags & VFS_FS_RW)
       return -EROFS;
 
+   if ((rc = pagecache_sync(hb->fs, hb->fs->fsops->get_inode(h))))
+      return rc;
+
    if (hb->fops->datasync)
 
       rc = hb->fops->datasync(h);
@@ -443,6 +465,7 @@ vfs_unlink_impl(struct mnt_fs *fs,
    if (!p->fs_path.inode)
       return -ENOENT;
 
+   exec_cache_invalidate(fs, p->fs_path.inode);
    return fs->fsops->unlink(p);
 }
 
@@ -483,6 +506,7 @@ vfs_truncate_impl(struct mnt_fs *fs,
       return rc; /* We couldn't acquire the lock */
 
    /* Got the lock, great. Now do truncate the file */
+   exec_cache_invalidate(fs, p->fs_path.inode);
    rc = fs->fsops->truncate(fs, p->fs_path.inode, len);
 
    /* Release the lock */
@@ -766,6 +790,10 @@ int vfs_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
       return -ENODEV;
 
    ASSERT(fops->munmap != NULL);
+
+   if (um->prot & PROT_WRITE)
+      exec_cache_invalidate_h(um->h);   /* the file might change via mmap */
+
    return fops->mmap(um, pdir, flags);
 }
 
@@ -857,8 +885,15 @@ ssize_t vfs_writev(fs_handle h, const struct iovec *iov, int iovcnt)
    ssize_t rc;
    size_t len;
 
-   if (hb->fops->writev)
-      return hb->fops->writev(h, iov, iovcnt);
+   if (hb->fops->writev) {
+
+      ret = hb->fops->writev(h, iov, iovcnt);
+
+      if (ret > 0)
+         exec_cache_invalidate_h(h);
+
+      return ret;
+   }
 
    /*
     * writev() is not implemented in the file system: implement here it in a
@@ -157,6 +157,8 @@ void vfs_syncfs(struct mnt_fs *fs)
    if (~fs->flags & VFS_FS_RW)
       return;  /* the filesystem is mounted as read-only: nothing to sync */
 
+   pagecache_sync(fs, NULL);
+
    if (fs->fsops->syncfs)
       fs->fsops->syncfs(fs);
 }
@@ -0,0 +1,174 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#include <tilck/kernel/hrtimer.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/datetime.h>
+
+/* hrtimer_now() relies on `__tick_duration` being in nanoseconds */
+STATIC_ASSERT(TS_SCALE == BILLION);
+
+extern u32 __tick_duration;
+
+static struct list hrtimer_queue = STATIC_LIST_INIT(hrtimer_queue);
+static bool event_dev;
+static u64 last_now;
+
+void hrtimer_init(struct hrtimer *t, hrtimer_func func, void *arg)
+{
+   list_node_init(&t->node);
+   t->expires = 0;
+   t->func = func;
+   t->arg = arg;
+   t->active = false;
+}
+
+bool hrtimer_has_event_dev(void)
+{
+   return event_dev;
+}
+
+void hrtimer_set_event_dev(bool available)
+{
+   event_dev = available;
+}
+
+u64 hrtimer_now(void)
+{
+   ulong var;
+   u64 now;
+
+   disable_interrupts(&var);
+   {
+      now = get_ticks() * __tick_duration + timer_get_subtick_ns();
+
+      /*
+       * The PIT's counter might have already wrapped around, while the tick
+       * IRQ is still pending: never let the time go backwards.
+       */
+      if (now < last_now)
+         now = last_now;
+      else
+         last_now = now;
+   }
+   enable_interrupts(&var);
+   return now;
+}
+
+/*
+ * Program the event device to fire at the expiration of the first timer in the
+ * queue, but only if that's going to happen before the next tick. In all the
+ * other cases, the tick handler will take care of it. Called with interrupts
+ * disabled.
+ */
+static void hrtimer_program_next(void)
+{
+   struct hrtimer *first;
+   u64 now, delta = 0;
+
+   ASSERT(!are_interrupts_enabled());
+
+   if (!event_dev || list_is_empty(&hrtimer_queue))
+      return;
+
+   first = list_first_obj(&hrtimer_queue, struct hrtimer, node);
+   now = hrtimer_now();
+
+   if (first->expires > now)
+      delta = first->expires - now;
+
+   if (delta < __tick_duration)
+      hw_hrtimer_program((u32)delta);
+}
+
+static void hrtimer_enqueue(struct hrtimer *t)
+{
+   struct list_node *pos = hrtimer_queue.last;
+
+   /*
+    * Walk the queue backwards, as new timers tend to expire later than the
+    * already queued ones. Timers with the same expiration time fire in FIFO
+    * order.
+    */
+   while (pos != (struct list_node *)&hrtimer_queue) {
+
+      if (list_to_obj(pos, struct hrtimer, node)->expires <= t->expires)
+         break;
+
+      pos = pos->prev;
+   }
+
+   list_add_after(pos, &t->node);
+}
+
+void hrtimer_start(struct hrtimer *t, u64 expires)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      if (t->active)
+         list_remove(&t->node);
+
+      t->expires = expires;
+      t->active = true;
+      hrtimer_enqueue(t);
+
+      if (hrtimer_queue.first == &t->node)
+         hrtimer_program_next();
+   }
+   enable_interrupts(&var);
+}
+
+void hrtimer_start_rel(struct hrtimer *t, u64 delta)
+{
+   hrtimer_start(t, hrtimer_now() + delta);
+}
+
+u64 hrtimer_cancel(struct hrtimer *t)
+{
+   u64 now, rem = 0;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      if (t->active) {
+
+         now = hrtimer_now();
+         rem = t->expires > now ? t->expires - now : 1;
+
+         list_remove(&t->node);
+         t->active = false;
+      }
+   }
+   enable_interrupts(&var);
+   return rem;
+}
+
+void hrtimer_run_expired(void)
+{
+   struct hrtimer *t;
+   ulong var;
+   u64 now;
+
+   disable_interrupts(&var);
+   {
+      now = hrtimer_now();
+
+      while (!list_is_empty(&hrtimer_queue)) {
+
+         t = list_first_obj(&hrtimer_queue, struct hrtimer, node);
+
+         if (t->expires > now)
+            break;
+
+         list_remove(&t->node);
+         t->active = false;
+         t->func(t->arg);
+      }
+
+      hrtimer_program_next();
+   }
+   enable_interrupts(&var);
+}
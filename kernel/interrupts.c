@@ -133,6 +133,16 @@ static void DEBUG_check_not_same_interrupt_nested(int int_num)
             return;
          }
 
+         if (int_num == 32 + X86_LAPIC_TIMER_IRQ) {
+
+            /*
+             * The one-shot LAPIC timer is re-programmed by its own handler and
+             * it's never masked: it might fire again before the handler
+             * returns, when the next hrtimer is very close.
+             */
+            return;
+         }
+
          panic("Same interrupt (%i) twice in nested_interrupts[]", int_num);
       }
 }
@@ -25,7 +25,8 @@ main_heaps_kmalloc(size_t *size, u32 flags)
 
       void *vaddr;
       const size_t heap_size = heaps[i]->size;
-      const size_t heap_free = heap_size - heaps[i]->mem_allocated;
+      const size_t mem_allocated = heaps[i]->mem_allocated;
+      const size_t heap_free = heap_size - mem_allocated;
 
       /*
        * The heap is too small (unlikely but possible) or the heap has not been
@@ -40,6 +41,8 @@ main_heaps_kmalloc(size_t *size, u32 flags)
 
       if ((vaddr = per_heap_kmalloc(heaps[i], size, flags))) {
 
+         tot_heap_mem_free -= heaps[i]->mem_allocated - mem_allocated;
+
          if (KMALLOC_SUPPORT_LEAK_DETECTOR && leak_detector_enabled) {
             debug_kmalloc_register_alloc(vaddr, *size);
          }
@@ -56,6 +59,7 @@ main_heaps_kfree(void *ptr, size_t *size, u32 flags)
 {
    struct kmalloc_heap *h = NULL;
    const ulong vaddr = (ulong) ptr;
+   size_t mem_allocated;
    ASSERT(kmalloc_initialized);
 
    for (int i = used_heaps - 1; i >= 0; i--) {
@@ -78,10 +82,15 @@ main_heaps_kfree(void *ptr, size_t *size, u32 flags)
     */
    ASSERT((vaddr & (h->min_block_size - 1)) == 0);
 
+   mem_allocated = h->mem_allocated;
    per_heap_kfree(h, ptr, size, flags);
+   tot_heap_mem_free += mem_allocated - h->mem_allocated;
 
    if (KMALLOC_FREE_MEM_POISONING) {
-      memset32(ptr, FREE_MEM_POISON_VAL, *size / 4);
+
+      /* With free lists, the block might begin with a list node: skip it */
+      const size_t skip = h->free_lists_on ? sizeof(struct list_node) : 0;
+      memset32(ptr + skip, FREE_MEM_POISON_VAL, (*size - skip) / 4);
    }
 
    if (KMALLOC_SUPPORT_LEAK_DETECTOR && leak_detector_enabled) {
@@ -91,13 +100,10 @@ main_heaps_kfree(void *ptr, size_t *size, u32 flags)
    return 0;
 }
 
-void *general_kmalloc(size_t *size, u32 flags)
+static void *general_kmalloc_int(size_t *size, u32 flags)
 {
    void *res;
    const u32 sub_block_sz = flags & KMALLOC_FL_SUB_BLOCK_MIN_SIZE_MASK;
-   ASSERT(kmalloc_initialized);
-   ASSERT(size != NULL);
-   ASSERT(*size);
 
    disable_preemption();
    {
@@ -126,6 +132,35 @@ void *general_kmalloc(size_t *size, u32 flags)
    return res;
 }
 
+void *general_kmalloc(size_t *size, u32 flags)
+{
+   size_t orig_size;
+   void *res;
+
+   ASSERT(kmalloc_initialized);
+   ASSERT(size != NULL);
+   ASSERT(*size);
+
+   orig_size = *size;
+
+   if (LIKELY((res = general_kmalloc_int(size, flags)) != NULL)) {
+      mem_pressure_check(tot_heap_mem_free);
+      return res;
+   }
+
+   /*
+    * The allocation failed. If we're not in a critical section, it's safe to
+    * call the shrinkers and try again. Otherwise, the caller has to deal with
+    * the failure.
+    */
+   if (is_preemption_enabled() && mem_reclaim(orig_size)) {
+      *size = orig_size;
+      res = general_kmalloc_int(size, flags);
+   }
+
+   return res;
+}
+
 void general_kfree(void *ptr, size_t *size, u32 flags)
 {
    int rc;
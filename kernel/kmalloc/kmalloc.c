@@ -15,6 +15,7 @@
 #include <tilck/kernel/sort.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/mem_pressure.h>
 
 #include <tilck_gen_headers/config_kmalloc.h>
 
@@ -27,6 +28,11 @@ size_t kmalloc_get_heap_struct_size(void)
    return sizeof(struct kmalloc_heap);
 }
 
+size_t kmalloc_get_heap_metadata_size(struct kmalloc_heap *h)
+{
+   return h->metadata_size;
+}
+
 STATIC_ASSERT(sizeof(struct block_node) == KMALLOC_METADATA_BLOCK_NODE_SIZE);
 
 STATIC bool kmalloc_initialized;
@@ -72,11 +78,21 @@ CONSTEXPR static ALWAYS_INLINE bool is_block_node_free(struct block_node n)
    return !(n.raw & (FL_NODE_FULL | FL_NODE_SPLIT));
 }
 
+static bool
+actual_allocate_node(struct kmalloc_heap *h,
+                     size_t node_size,
+                     int node,
+                     void **vaddr_ref,
+                     bool do_actual_alloc);
+
+#include "kmalloc_free_lists.c.h"
+
 static size_t set_free_uplevels(struct kmalloc_heap *h, int *node, size_t size)
 {
    struct block_node *nodes = h->metadata_nodes;
 
    size_t curr_size = size << 1;
+   size_t free_size = size;
    int n = *node;
 
    ASSERT(!nodes[n].split);
@@ -98,7 +114,15 @@ static size_t set_free_uplevels(struct kmalloc_heap *h, int *node, size_t size)
          break;
       }
 
+      if (h->free_lists_on) {
+
+         /* The buddy of *node is a maximal free block: remove it */
+         const int buddy = NODE_IS_LEFT(*node) ? *node + 1 : *node - 1;
+         fl_remove(h, node_to_ptr(h, buddy, free_size), free_size);
+      }
+
       *node = n; // last successful coaleshe.
+      free_size <<= 1;
 
       DEBUG_coaleshe;
       nodes[n].raw &= ~(FL_NODE_SPLIT | FL_NODE_FULL);
@@ -121,6 +145,9 @@ static size_t set_free_uplevels(struct kmalloc_heap *h, int *node, size_t size)
       n = NODE_PARENT(n);
    }
 
+   if (h->free_lists_on)
+      fl_add(h, node_to_ptr(h, *node, free_size), free_size);
+
    return curr_size;
 }
 
@@ -268,6 +295,11 @@ internal_kmalloc_coalesce_block(struct kmalloc_heap *h,
 
    ASSERT(nodes[n].full || nodes[n].split);
 
+   if (h->free_lists_on) {
+      /* All the free blocks inside our block are going to disappear */
+      fl_handle_subtree(h, block_node_num, block_size, false);
+   }
+
    for (s = block_size; s >= h->min_block_size; s >>= 1) {
 
       if (s > h->min_block_size) {
@@ -349,6 +381,10 @@ internal_kmalloc(struct kmalloc_heap *h,
          bool success;
 
          if (mark_node_as_allocated) {
+
+            if (h->free_lists_on)
+               fl_remove(h, node_to_ptr(h, node, node_size), node_size);
+
             success = actual_allocate_node(h, node_size,
                                            node, &vaddr, do_actual_alloc);
             ASSERT(vaddr != NULL); // 'vaddr' is not NULL even when !success
@@ -396,7 +432,12 @@ internal_kmalloc(struct kmalloc_heap *h,
       }
 
       if (!n.split) {
+
          DEBUG_kmalloc_split;
+
+         if (h->free_lists_on)
+            fl_split_node(h, node, node_size);
+
          nodes[node].split = true;
       }
 
@@ -456,12 +497,19 @@ per_heap_kmalloc_unsafe(struct kmalloc_heap *h, size_t *size, u32 flags)
 
       *size = rounded_up_size;
 
-      addr = internal_kmalloc(h,          /* heap */
-                              *size,      /* block size */
-                              0,          /* start node */
-                              h->size,    /* start node size */
-                              true,       /* mark node as allocated */
-                              do_actual_alloc);
+      if (h->free_lists_on) {
+
+         addr = fl_kmalloc(h, *size, do_actual_alloc);
+
+      } else {
+
+         addr = internal_kmalloc(h,          /* heap */
+                                 *size,      /* block size */
+                                 0,          /* start node */
+                                 h->size,    /* start node size */
+                                 true,       /* mark node as allocated */
+                                 do_actual_alloc);
+      }
 
       if (sub_blocks_min_size && addr) {
          internal_kmalloc_split_block(h, addr, *size, sub_blocks_min_size);
@@ -587,6 +635,15 @@ internal_kfree(struct kmalloc_heap *h,
 
    DEBUG_free_alloc_block_count;
 
+   /*
+    * Consecutive allocated blocks are released with a single vfree_and_unmap()
+    * call, in order to allow the callback to walk the page tables once and to
+    * batch the TLB invalidations for the whole range.
+    */
+   const size_t pages_per_block = h->alloc_block_size / PAGE_SIZE;
+   ulong run_vaddr = alloc_block_vaddr;
+   size_t run_pages = 0;
+
    for (u32 i = 0; i < alloc_block_count; i++) {
 
       const int alloc_node =
@@ -607,16 +664,33 @@ internal_kfree(struct kmalloc_heap *h,
       }
 
       if (nodes[alloc_node].allocated) {
+
          DEBUG_free_freeing_block;
-         h->vfree_and_unmap(alloc_block_vaddr, h->alloc_block_size / PAGE_SIZE);
+
+         if (!run_pages)
+            run_vaddr = alloc_block_vaddr;
+
+         run_pages += pages_per_block;
          nodes[alloc_node] = s_new_node;
-      } else if (nodes[alloc_node].alloc_failed) {
-         DEBUG_free_skip_alloc_failed_block;
-         nodes[alloc_node].alloc_failed = false;
+
+      } else {
+
+         if (run_pages) {
+            h->vfree_and_unmap(run_vaddr, run_pages);
+            run_pages = 0;
+         }
+
+         if (nodes[alloc_node].alloc_failed) {
+            DEBUG_free_skip_alloc_failed_block;
+            nodes[alloc_node].alloc_failed = false;
+         }
       }
 
       alloc_block_vaddr += h->alloc_block_size;
    }
+
+   if (run_pages)
+      h->vfree_and_unmap(run_vaddr, run_pages);
 }
 
 static size_t calculate_block_size(struct kmalloc_heap *h, ulong vaddr)
@@ -0,0 +1,186 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#ifndef _KMALLOC_C_
+
+   #error This is NOT a header file and it is not meant to be included
+
+   /*
+    * The only purpose of this file is to keep kmalloc.c shorter.
+    * Yes, this file could be turned into a regular C source file, but at the
+    * price of making several static functions and variables in kmalloc.c to be
+    * just non-static. We don't want that. Code isolation is a GOOD thing.
+    */
+
+#endif
+
+/*
+ * Per-order free lists
+ * ---------------------
+ *
+ * Finding a free block by descending the metadata tree costs at least
+ * O(log(heap_size / block_size)) node visits, plus backtracking when the heap
+ * is fragmented. In order to avoid that for regular allocations, heaps having
+ * `free_lists_on` keep an index of all the maximal free blocks, grouped by
+ * their size (order). The list nodes are stored in the free blocks themselves,
+ * therefore this feature is available only for linearly-mapped heaps.
+ *
+ * Invariant: a block of size 2^i is in free_lists[i] if and only if its node
+ * is free (not split, not full) and its parent is split (or it's the root).
+ *
+ * All the code paths changing the metadata nodes maintain that invariant, so
+ * the tree-based code (multi-step allocs, split/coalesce of blocks) keeps
+ * working unchanged on heaps with free lists.
+ */
+
+static ALWAYS_INLINE u32 fl_order(size_t size)
+{
+   return (u32)log2_for_power_of_2(size);
+}
+
+static void
+fl_add(struct kmalloc_heap *h, void *vaddr, size_t size)
+{
+   const u32 order = fl_order(size);
+
+   ASSERT(order < KMALLOC_FREE_LISTS_COUNT);
+   list_add_head(&h->free_lists[order], vaddr);
+   h->free_lists_mask |= (1u << order);
+}
+
+static void
+fl_remove(struct kmalloc_heap *h, void *vaddr, size_t size)
+{
+   const u32 order = fl_order(size);
+
+   ASSERT(list_is_node_in_list(vaddr));
+   list_remove(vaddr);
+
+   if (list_is_empty(&h->free_lists[order]))
+      h->free_lists_mask &= ~(1u << order);
+}
+
+/*
+ * Called when the free node `node`, which MUST be in a free list, is going to
+ * be split: the node itself is not a maximal free block anymore, while both
+ * its children become maximal free blocks.
+ */
+static void
+fl_split_node(struct kmalloc_heap *h, int node, size_t node_size)
+{
+   void *vaddr = node_to_ptr(h, node, node_size);
+
+   fl_remove(h, vaddr, node_size);
+   fl_add(h, vaddr + HALF(node_size), HALF(node_size));
+   fl_add(h, vaddr, HALF(node_size));
+}
+
+/*
+ * Add (or remove) to the free lists all the maximal free blocks in the subtree
+ * of `node`, excluding `node` itself.
+ */
+static void
+fl_handle_subtree(struct kmalloc_heap *h, int node, size_t size, bool add)
+{
+   struct block_node *nodes = h->metadata_nodes;
+   int node_count = 1;
+   int n = node;
+
+   for (size_t s = size; s > h->min_block_size; s >>= 1) {
+
+      const size_t cs = HALF(s);
+
+      for (int j = n; j < n + node_count; j++) {
+
+         if (!nodes[j].split)
+            continue;
+
+         for (int c = NODE_LEFT(j); c <= NODE_RIGHT(j); c++) {
+
+            if (!is_block_node_free(nodes[c]))
+               continue;
+
+            if (add)
+               fl_add(h, node_to_ptr(h, c, cs), cs);
+            else
+               fl_remove(h, node_to_ptr(h, c, cs), cs);
+         }
+      }
+
+      node_count <<= 1;
+      n = NODE_LEFT(n);
+   }
+}
+
+static void
+kmalloc_heap_init_free_lists(struct kmalloc_heap *h)
+{
+   struct block_node *nodes = h->metadata_nodes;
+
+   ASSERT(h->linear_mapping);
+   ASSERT(h->min_block_size >= sizeof(struct list_node));
+
+   for (int i = 0; i < KMALLOC_FREE_LISTS_COUNT; i++)
+      list_init(&h->free_lists[i]);
+
+   h->free_lists_mask = 0;
+
+   if (is_block_node_free(nodes[0]))
+      fl_add(h, TO_PTR(h->vaddr), h->size);
+
+   fl_handle_subtree(h, 0, h->size, true);
+   h->free_lists_on = true;
+}
+
+/*
+ * Fast-path alternative to internal_kmalloc() starting from the root node:
+ * pop the smallest maximal free block big enough for `size` and split it
+ * down, putting the right halves in the free lists.
+ */
+static void *
+fl_kmalloc(struct kmalloc_heap *h, size_t size, bool do_actual_alloc)
+{
+   struct block_node *nodes = h->metadata_nodes;
+   const u32 order = fl_order(size);
+   const u32 mask = h->free_lists_mask >> order;
+   void *vaddr;
+   size_t s;
+   int n;
+
+   ASSERT(h->free_lists_on);
+
+   if (!mask)
+      return NULL;
+
+   s = (size_t)1 << (order + get_first_set_bit_index32(mask));
+   vaddr = h->free_lists[fl_order(s)].first;
+   n = ptr_to_node(h, vaddr, s);
+
+   ASSERT(is_block_node_free(nodes[n]));
+   fl_remove(h, vaddr, s);
+
+   for (; s > size; s = HALF(s)) {
+      nodes[n].split = true;
+      fl_add(h, vaddr + HALF(s), HALF(s));
+      n = NODE_LEFT(n);
+   }
+
+   /* Linear mapping: actual_allocate_node() cannot fail */
+   actual_allocate_node(h, size, n, &vaddr, do_actual_alloc);
+
+   /* Mark the parent nodes as 'full', when necessary. */
+   while (n != 0) {
+
+      n = NODE_PARENT(n);
+
+      if (!nodes[NODE_LEFT(n)].full || !nodes[NODE_RIGHT(n)].full)
+         break;
+
+      ASSERT(!nodes[n].full);
+      nodes[n].full = true;
+   }
+
+   if (do_actual_alloc)
+      h->mem_allocated += size;
+
+   return vaddr;
+}
@@ -4,9 +4,11 @@
 
 #define STACK_VAR (h->alloc_stack)
 #define KMALLOC_ALLOC_STACK_SIZE 32
+#define KMALLOC_FREE_LISTS_COUNT 32
 
 #include <tilck/common/norec.h>
 #include <tilck/common/atomics.h>
+#include <tilck/kernel/list.h>
 
 struct kmalloc_heap {
 
@@ -32,6 +34,21 @@ struct kmalloc_heap {
 
    bool linear_mapping;
    bool dma;
+   bool free_lists_on;
+
+   /*
+    * Optional per-order free lists (see kmalloc_free_lists.c.h).
+    *
+    * When `free_lists_on` is true, free_lists[i] contains all the *maximal*
+    * free blocks of size 2^i (free nodes having a split parent, or the root),
+    * linked through a list_node stored at the beginning of the block itself.
+    * Bit `i` of `free_lists_mask` is set when free_lists[i] is not empty.
+    *
+    * NOTE: the metadata nodes remain the only source of truth: the free lists
+    * are just an index on top of them, used to speed-up regular allocations.
+    */
+   u32 free_lists_mask;
+   struct list free_lists[KMALLOC_FREE_LISTS_COUNT];
 
    /*
     * Explicit stack used by per_heap_kmalloc()
@@ -21,6 +21,7 @@ STATIC struct kmalloc_heap first_heap_struct;
 STATIC struct kmalloc_heap *heaps[KMALLOC_HEAPS_COUNT];
 STATIC int used_heaps;
 STATIC size_t max_tot_heap_mem_free;
+static size_t tot_heap_mem_free;         /* updated by main_heaps_k*() */
 
 void *kmalloc_get_first_heap(size_t *size)
 {
@@ -166,6 +167,11 @@ kmalloc_heap_dup_expanded(struct kmalloc_heap *h, size_t new_size)
 
    memcpy(new_heap, h, sizeof(struct kmalloc_heap));
 
+   /*
+    * The free lists are stored in the heap's data itself, which is shared with
+    * the original heap: the duplicate must rely on the metadata only.
+    */
+   new_heap->free_lists_on = false;
    new_heap->size = new_size;
    new_heap->metadata_size =
       calculate_heap_metadata_size(new_size, new_heap->min_block_size);
@@ -289,6 +295,15 @@ static int kmalloc_internal_add_heap(void *vaddr, size_t heap_size)
     */
 
    VERIFY(md_allocated == vaddr);
+
+   /*
+    * Only now we can build the free lists: before allocating the metadata,
+    * the first bytes of the heap (where the list node of the root block would
+    * be stored) were the metadata itself.
+    */
+   if (KMALLOC_FREE_LISTS)
+      kmalloc_heap_init_free_lists(heaps[used_heaps]);
+
    return used_heaps++;
 }
 
@@ -413,6 +428,8 @@ void init_kmalloc(void)
 
       max_tot_heap_mem_free += (h->size - h->mem_allocated);
    }
+
+   tot_heap_mem_free = max_tot_heap_mem_free;
 }
 
 size_t kmalloc_get_max_tot_heap_free(void)
@@ -420,6 +437,11 @@ size_t kmalloc_get_max_tot_heap_free(void)
    return max_tot_heap_mem_free;
 }
 
+size_t kmalloc_get_tot_heap_free(void)
+{
+   return tot_heap_mem_free;
+}
+
 void
 debug_kmalloc_get_heap_info_by_ptr(struct kmalloc_heap *h,
                                    struct debug_kmalloc_heap_info *i)
@@ -446,6 +468,82 @@ debug_kmalloc_get_heap_info(int heap_num, struct debug_kmalloc_heap_info *i)
    return true;
 }
 
+/*
+ * Return the size of the biggest free block in the given heap, by visiting the
+ * metadata tree level by level, starting from the root. Used to measure the
+ * external fragmentation of the heaps.
+ */
+size_t
+debug_kmalloc_get_heap_largest_free_block(int heap_num)
+{
+   struct kmalloc_heap *h = heaps[heap_num];
+   struct block_node *nodes;
+   int node_count = 1;
+   int n = 0;
+
+   if (!h)
+      return 0;
+
+   nodes = h->metadata_nodes;
+
+   if (is_block_node_free(nodes[0]))
+      return h->size;
+
+   for (size_t s = h->size; s > h->min_block_size; s >>= 1) {
+
+      for (int j = n; j < n + node_count; j++) {
+
+         if (!nodes[j].split)
+            continue;
+
+         if (is_block_node_free(nodes[NODE_LEFT(j)]) ||
+             is_block_node_free(nodes[NODE_RIGHT(j)]))
+         {
+            return HALF(s);
+         }
+      }
+
+      node_count <<= 1;
+      n = NODE_LEFT(n);
+   }
+
+   return 0;
+}
+
+/*
+ * Turn on/off at runtime the free lists of the main heaps. Useful to compare
+ * the performance of the two allocation strategies.
+ */
+void
+debug_kmalloc_set_free_lists(bool enabled)
+{
+   if (enabled && !KMALLOC_FREE_LISTS)
+      panic("kmalloc free lists are NOT compiled in");
+
+   disable_preemption();
+
+   for (int i = 0; i < used_heaps; i++) {
+
+      struct kmalloc_heap *h = heaps[i];
+      bool expected = false;
+
+      if (!atomic_cas_strong(&h->in_use, &expected, true,
+                             mo_relaxed, mo_relaxed))
+      {
+         panic("kmalloc: heap %d in use while toggling free lists", i);
+      }
+
+      if (enabled && !h->free_lists_on)
+         kmalloc_heap_init_free_lists(h);
+      else if (!enabled)
+         h->free_lists_on = false;
+
+      atomic_store_explicit(&h->in_use, false, mo_relaxed);
+   }
+
+   enable_preemption();
+}
+
 void
 debug_kmalloc_get_stats(struct debug_kmalloc_stats *stats)
 {
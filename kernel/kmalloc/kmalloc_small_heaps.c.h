@@ -296,3 +296,27 @@ small_heaps_kfree(void *ptr, size_t *size, u32 flags)
 
    return 0;
 }
+
+/* Destroys the empty small heaps kept for later use. Returns the freed bytes */
+size_t kmalloc_trim_small_heaps(void)
+{
+   struct small_heap_node *pos, *tmp;
+   size_t freed = 0;
+
+   disable_preemption();
+   {
+      list_for_each(pos, tmp, &avail_small_heaps_list, avail_node) {
+
+         if (pos->heap.mem_allocated != SMALL_HEAP_MD_SIZE)
+            continue;
+
+         shs.empty_count--;
+         ASSERT(shs.empty_count >= 0);
+
+         destroy_small_heap(pos);
+         freed += SMALL_HEAP_SIZE;
+      }
+   }
+   enable_preemption();
+   return freed;
+}
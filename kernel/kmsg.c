@@ -0,0 +1,257 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+#include <tilck/common/atomics.h>
+
+#include <tilck/kernel/kmsg.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/devfs.h>
+
+STATIC_ASSERT((KMSG_BUF_SIZE & (KMSG_BUF_SIZE - 1)) == 0);
+
+static char kmsg_buf[KMSG_BUF_SIZE];
+
+static ATOMIC(u32) kmsg_wpos;          /* end of the reserved space */
+static ATOMIC(u32) kmsg_end;           /* end of the committed data */
+static ATOMIC(u32) kmsg_writers;       /* nesting level of kmsg_append() */
+static ATOMIC(bool) kmsg_lapped;       /* the log has wrapped at least once */
+
+static ATOMIC(int) kmsg_readers;
+static struct kmutex kmsg_mutex;
+static struct kcond kmsg_cond;
+
+static void
+kmsg_copy_in(u32 pos, const char *s, u32 len)
+{
+   const u32 off = pos % KMSG_BUF_SIZE;
+   const u32 n1 = MIN(len, KMSG_BUF_SIZE - off);
+
+   memcpy(kmsg_buf + off, s, n1);
+   memcpy(kmsg_buf, s + n1, len - n1);
+}
+
+static void
+kmsg_copy_out(u32 pos, char *buf, u32 len)
+{
+   const u32 off = pos % KMSG_BUF_SIZE;
+   const u32 n1 = MIN(len, KMSG_BUF_SIZE - off);
+
+   memcpy(buf, kmsg_buf + off, n1);
+   memcpy(buf + n1, kmsg_buf, len - n1);
+}
+
+/*
+ * Appends atomically the concatenation of `s1` and `s2` to the log.
+ *
+ * Writers reserve their space with a single atomic add on `kmsg_wpos` and then
+ * copy their data without holding any lock. Because Tilck runs on a single CPU
+ * and preemption is disabled here, the only writers that can interleave with
+ * us are the ones in nested IRQ handlers, which always complete before we
+ * resume. Therefore, it's safe for the outermost writer to publish everything
+ * reserved so far, by moving `kmsg_end` forward.
+ */
+void
+kmsg_append(const char *s1, u32 len1, const char *s2, u32 len2)
+{
+   const u32 len = len1 + len2;
+   u32 start, end, cur;
+
+   if (!len)
+      return;
+
+   ASSERT(len < KMSG_BUF_SIZE);
+   disable_preemption();
+   atomic_fetch_add_explicit(&kmsg_writers, 1, mo_relaxed);
+
+   start = atomic_fetch_add_explicit(&kmsg_wpos, len, mo_relaxed);
+
+   if (start + len >= KMSG_BUF_SIZE)
+      atomic_store_explicit(&kmsg_lapped, true, mo_relaxed);
+
+   kmsg_copy_in(start, s1, len1);
+   kmsg_copy_in(start + len1, s2, len2);
+
+   if (atomic_fetch_sub_explicit(&kmsg_writers, 1, mo_release) == 1) {
+
+      end = atomic_load_explicit(&kmsg_wpos, mo_relaxed);
+      cur = atomic_load_explicit(&kmsg_end, mo_relaxed);
+
+      while ((s32)(end - cur) > 0) {
+         if (atomic_cas_weak(&kmsg_end, &cur, end, mo_release, mo_relaxed))
+            break;
+      }
+   }
+
+   enable_preemption();
+}
+
+u32
+kmsg_get_end_pos(void)
+{
+   return atomic_load_explicit(&kmsg_end, mo_acquire);
+}
+
+u32
+kmsg_get_first_pos(void)
+{
+   if (!atomic_load_explicit(&kmsg_lapped, mo_relaxed))
+      return 0;
+
+   /*
+    * Everything before `kmsg_wpos - KMSG_BUF_SIZE` might be in the process of
+    * being overwritten by a writer that has already reserved its space.
+    */
+   return atomic_load_explicit(&kmsg_wpos, mo_relaxed) - KMSG_BUF_SIZE;
+}
+
+u32
+kmsg_read(u32 *pos, char *buf, u32 size, bool *lost)
+{
+   u32 end, first, n;
+   *lost = false;
+
+   while (true) {
+
+      end = kmsg_get_end_pos();
+      first = kmsg_get_first_pos();
+
+      if ((s32)(*pos - first) < 0) {
+         *pos = first;
+         *lost = true;
+      }
+
+      if ((s32)(end - *pos) <= 0)
+         return 0;
+
+      n = MIN(size, end - *pos);
+      kmsg_copy_out(*pos, buf, n);
+
+      /* Check that no writer overwrote the data while we were copying it */
+      if ((s32)(*pos - kmsg_get_first_pos()) >= 0)
+         break;
+   }
+
+   *pos += n;
+   return n;
+}
+
+bool
+kmsg_has_readers(void)
+{
+   return atomic_load_explicit(&kmsg_readers, mo_relaxed) > 0;
+}
+
+void
+kmsg_wakeup_readers(void)
+{
+   kmutex_lock(&kmsg_mutex);
+   {
+      kcond_signal_all(&kmsg_cond);
+   }
+   kmutex_unlock(&kmsg_mutex);
+}
+
+static inline u32 *
+kmsg_handle_pos(fs_handle h)
+{
+   struct devfs_handle *dh = h;
+   return (u32 *)dh->extra;
+}
+
+static ssize_t
+kmsg_dev_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct devfs_handle *dh = h;
+   u32 *rpos = kmsg_handle_pos(h);
+   bool sig_pending = false;
+   bool lost;
+   ssize_t rc;
+
+   if (!size)
+      return 0;
+
+   kmutex_lock(&kmsg_mutex);
+
+   while (true) {
+
+      rc = (ssize_t)kmsg_read(rpos, buf, (u32)MIN(size, KMSG_BUF_SIZE), &lost);
+
+      if (rc)
+         break; /* We read something */
+
+      if (dh->fl_flags & O_NONBLOCK) {
+         rc = -EAGAIN;
+         break;
+      }
+
+      /* Wait for printk() to add more data to the log */
+      kcond_wait(&kmsg_cond, &kmsg_mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         sig_pending = true;
+         break;
+      }
+   }
+
+   kmutex_unlock(&kmsg_mutex);
+   return !sig_pending ? rc : -EINTR;
+}
+
+static int
+kmsg_dev_read_ready(fs_handle h)
+{
+   return kmsg_has_data(*kmsg_handle_pos(h));
+}
+
+static struct kcond *
+kmsg_dev_get_rready_cond(fs_handle h)
+{
+   return &kmsg_cond;
+}
+
+static int
+kmsg_create_extra(int minor, void *extra)
+{
+   *(u32 *)extra = kmsg_get_first_pos();
+   atomic_fetch_add_explicit(&kmsg_readers, 1, mo_relaxed);
+   return 0;
+}
+
+static int
+kmsg_on_dup_extra(int minor, void *extra)
+{
+   atomic_fetch_add_explicit(&kmsg_readers, 1, mo_relaxed);
+   return 0;
+}
+
+static void
+kmsg_destroy_extra(int minor, void *extra)
+{
+   atomic_fetch_sub_explicit(&kmsg_readers, 1, mo_relaxed);
+}
+
+void
+kmsg_set_dev_file_info(struct devfs_file_info *nfo)
+{
+   static const struct file_ops static_ops_kmsg = {
+      .read = kmsg_dev_read,
+      .read_ready = kmsg_dev_read_ready,
+      .get_rready_cond = kmsg_dev_get_rready_cond,
+   };
+
+   nfo->fops = &static_ops_kmsg;
+   nfo->create_extra = &kmsg_create_extra;
+   nfo->on_dup_extra = &kmsg_on_dup_extra;
+   nfo->destroy_extra = &kmsg_destroy_extra;
+}
+
+void
+init_kmsg_dev(void)
+{
+   kmutex_init(&kmsg_mutex, 0);
+   kcond_init(&kmsg_cond);
+}
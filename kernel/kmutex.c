@@ -6,6 +6,26 @@
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/irq.h>
+#include <tilck/kernel/hrtimer.h>
+
+/*
+ * Priority inheritance
+ * ----------------------
+ *
+ * When a task blocks on a mutex, the owner inherits the highest priority and
+ * the lowest vruntime among the waiters of all the contended mutexes it owns.
+ * Because the owner itself might be waiting on another mutex, the boost is
+ * propagated along the chain of owners (up to KMUTEX_PI_MAX_CHAIN levels).
+ * Contended mutexes are kept in their owner's `pi_mutexes` list, which allows
+ * us to recompute its inherited priority after each unlock.
+ *
+ * On unlock, the mutex is handed to the waiter with the highest priority,
+ * in FIFO order among the waiters having the same priority.
+ */
+
+#define KMUTEX_PI_MAX_CHAIN                   8
+
+static struct kmutex_pi_stats pi_stats;
 
 bool kmutex_is_curr_task_holding_lock(struct kmutex *m)
 {
@@ -18,6 +38,7 @@ void kmutex_init(struct kmutex *m, u32 flags)
    bzero(m, sizeof(struct kmutex));
    m->flags = flags;
    list_init(&m->wait_list);
+   list_node_init(&m->pi_node);
 }
 
 void kmutex_destroy(struct kmutex *m)
@@ -25,6 +46,99 @@ void kmutex_destroy(struct kmutex *m)
    bzero(m, sizeof(struct kmutex));
 }
 
+void kmutex_get_pi_stats(struct kmutex_pi_stats *s)
+{
+   disable_preemption();
+   {
+      *s = pi_stats;
+   }
+   enable_preemption();
+}
+
+void kmutex_reset_pi_stats(void)
+{
+   disable_preemption();
+   {
+      bzero(&pi_stats, sizeof(pi_stats));
+   }
+   enable_preemption();
+}
+
+static inline struct task *wait_obj_to_task(struct wait_obj *wo)
+{
+   return CONTAINER_OF(wo, struct task, wobj);
+}
+
+/* Recompute the priority `ti` inherits from the waiters of its mutexes */
+static void kmutex_pi_update(struct task *ti)
+{
+   int prio = SCHED_PRIO_NORMAL;
+   u64 vruntime = UINT64_MAX;
+   struct wait_obj *wo;
+   struct kmutex *m;
+
+   list_for_each_ro(m, &ti->pi_mutexes, pi_node) {
+      list_for_each_ro(wo, &m->wait_list, wait_list_node) {
+         struct task *w = wait_obj_to_task(wo);
+         prio = MIN(prio, task_get_eff_prio(w));
+         vruntime = MIN(vruntime, task_get_eff_vruntime(w));
+      }
+   }
+
+   task_set_pi_boost(ti, prio, vruntime);
+}
+
+static void kmutex_pi_propagate(struct kmutex *m)
+{
+   struct task *owner;
+
+   for (int i = 0; i < KMUTEX_PI_MAX_CHAIN; i++) {
+
+      owner = m->owner_task;
+      kmutex_pi_update(owner);
+
+      if (owner->wobj.type != WOBJ_KMUTEX)
+         break;
+
+      /* The owner is waiting on another mutex: boost its owner as well */
+      m = wait_obj_get_ptr(&owner->wobj);
+
+      if (!m || !m->owner_task)
+         break;
+   }
+}
+
+/* The waiter with the highest priority, the first one among equals */
+static struct task *kmutex_pi_pick_waiter(struct kmutex *m)
+{
+   struct task *selected = NULL;
+   int selected_prio = SCHED_PRIO_NORMAL + 1;
+   struct wait_obj *wo;
+
+   list_for_each_ro(wo, &m->wait_list, wait_list_node) {
+
+      struct task *ti = wait_obj_to_task(wo);
+      const int prio = task_get_eff_prio(ti);
+
+      if (prio < selected_prio) {
+         selected = ti;
+         selected_prio = prio;
+      }
+   }
+
+   return selected;
+}
+
+static void kmutex_pi_account_inversion(struct kmutex *m, u64 duration)
+{
+   pi_stats.inversions++;
+   pi_stats.max_inversion_ns = MAX(pi_stats.max_inversion_ns, duration);
+
+#if KMUTEX_STATS_ENABLED
+   m->max_inversion_ns = MAX(m->max_inversion_ns, duration);
+#endif
+}
+
 static ALWAYS_INLINE void
 kmutex_lock_enable_preemption_wrapper(struct kmutex *m)
 {
@@ -38,6 +152,10 @@ kmutex_lock_enable_preemption_wrapper(struct kmutex *m)
 
 void kmutex_lock(struct kmutex *m)
 {
+   struct task *curr;
+   bool inversion;
+   u64 start = 0;
+
    disable_preemption();
    DEBUG_ONLY(check_not_in_irq_handler());
 
@@ -75,7 +193,17 @@ void kmutex_lock(struct kmutex *m)
    m->max_num_waiters = MAX(m->num_waiters, m->max_num_waiters);
 #endif
 
+   curr = get_curr_task();
+   inversion = task_get_eff_prio(curr) < task_get_eff_prio(m->owner_task);
+
+   if (inversion)
+      start = hrtimer_now();
+
+   if (list_is_empty(&m->wait_list))
+      list_add_tail(&m->owner_task->pi_mutexes, &m->pi_node);
+
    prepare_to_wait_on(WOBJ_KMUTEX, m, NO_EXTRA, &m->wait_list);
+   kmutex_pi_propagate(m);
    kmutex_lock_enable_preemption_wrapper(m);
 
    /*
@@ -93,6 +221,14 @@ void kmutex_lock(struct kmutex *m)
    /* Now for sure this task should hold the mutex */
    ASSERT(kmutex_is_curr_task_holding_lock(m));
 
+   if (inversion) {
+      disable_preemption();
+      {
+         kmutex_pi_account_inversion(m, hrtimer_now() - start);
+      }
+      enable_preemption();
+   }
+
    /*
     * DEBUG check: in case we went to sleep with a recursive mutex, then the
     * lock_count must be just 1 now.
@@ -159,13 +295,20 @@ void kmutex_unlock(struct kmutex *m)
 
    m->owner_task = NULL;
 
+   /*
+    * NOTE: the mutex might be in our `pi_mutexes` list even without waiters,
+    * in case its only waiter got killed.
+    */
+   if (list_is_node_in_list(&m->pi_node)) {
+      list_remove(&m->pi_node);
+      list_node_init(&m->pi_node);
+      kmutex_pi_update(get_curr_task());
+   }
+
    /* Unlock one task waiting to acquire the mutex 'm' (if any) */
    if (!list_is_empty(&m->wait_list)) {
 
-      struct wait_obj *task_wo =
-         list_first_obj(&m->wait_list, struct wait_obj, wait_list_node);
-
-      struct task *ti = CONTAINER_OF(task_wo, struct task, wobj);
+      struct task *ti = kmutex_pi_pick_waiter(m);
 
       m->owner_task = ti;
 
@@ -175,6 +318,12 @@ void kmutex_unlock(struct kmutex *m)
       ASSERT_TASK_STATE(ti->state, TASK_STATE_SLEEPING);
       wake_up(ti);
 
+      /* The new owner inherits the priority of the remaining waiters */
+      if (!list_is_empty(&m->wait_list))
+         list_add_tail(&ti->pi_mutexes, &m->pi_node);
+
+      kmutex_pi_update(ti);
+
    } // if (!list_is_empty(&m->wait_list))
 
    enable_preemption();
@@ -0,0 +1,335 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/mem_pressure.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/signal.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/worker_thread.h>
+#include <tilck/kernel/fs/pagecache.h>
+
+size_t mem_reclaim_low_wmark;
+static size_t mem_reclaim_high_wmark;
+
+static struct list shrinkers_list = STATIC_LIST_INIT(shrinkers_list);
+static struct mem_pressure_stats mp_stats;
+static u64 reclaimed_bytes;
+static bool reclaim_in_progress;
+static ATOMIC(bool) bg_reclaim_pending;
+static u64 bg_reclaim_last_fail;          /* ticks */
+static int oom_victim_pid;
+
+void register_shrinker(struct shrinker *s)
+{
+   disable_preemption();
+   {
+      list_add_tail(&shrinkers_list, &s->node);
+   }
+   enable_preemption();
+}
+
+void unregister_shrinker(struct shrinker *s)
+{
+   disable_preemption();
+   {
+      ASSERT(!reclaim_in_progress);
+      list_remove(&s->node);
+   }
+   enable_preemption();
+}
+
+static size_t mem_reclaim_int(size_t bytes)
+{
+   struct shrinker *s;
+   size_t freed = 0;
+   bool busy;
+
+   disable_preemption();
+   {
+      busy = reclaim_in_progress;
+      reclaim_in_progress = true;
+   }
+   enable_preemption();
+
+   if (busy)
+      return 0; /* Somebody else is already reclaiming memory */
+
+   list_for_each_ro(s, &shrinkers_list, node) {
+
+      freed += s->shrink(bytes - freed);
+
+      if (freed >= bytes)
+         break;
+   }
+
+   disable_preemption();
+   {
+      reclaimed_bytes += freed;
+      reclaim_in_progress = false;
+   }
+   enable_preemption();
+   return freed;
+}
+
+size_t mem_reclaim(size_t bytes)
+{
+   disable_preemption();
+   {
+      mp_stats.direct_reclaims++;
+   }
+   enable_preemption();
+   return mem_reclaim_int(bytes);
+}
+
+static void bg_reclaim_job(void *arg)
+{
+   size_t free_mem;
+   bool fail = false;
+
+   while ((free_mem = kmalloc_get_tot_heap_free()) < mem_reclaim_high_wmark) {
+
+      if (!mem_reclaim_int(mem_reclaim_high_wmark - free_mem)) {
+         fail = true;
+         break;
+      }
+   }
+
+   disable_preemption();
+   {
+      mp_stats.bg_reclaims++;
+
+      if (fail)
+         bg_reclaim_last_fail = get_ticks();
+   }
+   enable_preemption();
+   atomic_store_explicit(&bg_reclaim_pending, false, mo_relaxed);
+}
+
+void mem_pressure_wakeup(void)
+{
+   /*
+    * Don't keep enqueueing jobs when there's nothing left to reclaim: wait
+    * at least one second after a background reclaim that didn't reach the
+    * high watermark.
+    */
+   if (bg_reclaim_last_fail && get_ticks() < bg_reclaim_last_fail + TIMER_HZ)
+      return;
+
+   if (atomic_exchange_explicit(&bg_reclaim_pending, true, mo_relaxed))
+      return; /* there's already a job in the queue */
+
+   if (!wth_enqueue_anywhere(WTH_PRIO_LOWEST, &bg_reclaim_job, NULL))
+      atomic_store_explicit(&bg_reclaim_pending, false, mo_relaxed);
+}
+
+/*
+ * OOM killer's score of a user process: the number of pages it has mapped,
+ * including its heap (brk). It's an upper bound of its actual memory usage,
+ * since a part of those pages might be still unmapped or shared.
+ */
+static ulong oom_score(struct process *pi)
+{
+   struct user_mapping *um;
+   ulong pages = 0;
+
+   if (pi->brk > pi->initial_brk)
+      pages += (ulong)(pi->brk - pi->initial_brk) >> PAGE_SHIFT;
+
+   if (pi->mi) {
+      list_for_each_ro(um, &pi->mi->mappings, pi_node) {
+         pages += um->len >> PAGE_SHIFT;
+      }
+   }
+
+   return pages;
+}
+
+struct oom_victim {
+   int pid;
+   ulong score;
+};
+
+static int oom_score_cb(void *obj, void *arg)
+{
+   struct task *ti = obj;
+   struct oom_victim *v = arg;
+   ulong score;
+
+   if (is_kernel_thread(ti) || !is_main_thread(ti))
+      return 0;
+
+   if (ti->pi->pid == 1 || ti->state == TASK_STATE_ZOMBIE)
+      return 0; /* never kill init */
+
+   /* In case of a tie, prefer the youngest process */
+   if ((score = oom_score(ti->pi)) >= v->score) {
+      v->pid = ti->pi->pid;
+      v->score = score;
+   }
+
+   return 0;
+}
+
+/*
+ * Sends SIGKILL to the user process with the highest score, unless a previous
+ * victim has not died yet. Returns the pid of the victim or 0 if there are no
+ * candidates.
+ */
+static int oom_kill(void)
+{
+   struct oom_victim v = {0};
+   struct task *ti;
+
+   ASSERT(!is_preemption_enabled());
+
+   if (oom_victim_pid) {
+
+      ti = get_task(oom_victim_pid);
+
+      if (ti && ti->state != TASK_STATE_ZOMBIE)
+         return oom_victim_pid; /* still dying */
+
+      oom_victim_pid = 0;
+   }
+
+   iterate_over_tasks(&oom_score_cb, &v);
+
+   if (!v.pid)
+      return 0;
+
+   printk("Out-of-memory: killing pid %d (score: %lu)\n", v.pid, v.score);
+   send_signal(v.pid, SIGKILL, SIG_FL_PROCESS);
+   oom_victim_pid = v.pid;
+   mp_stats.oom_kills++;
+   return v.pid;
+}
+
+bool handle_fault_out_of_memory(size_t bytes)
+{
+   struct task *curr = get_curr_task();
+   const int curr_pid = get_curr_pid();
+   int victim = 0;
+
+   /*
+    * The fault handler disabled the preemption once: if that's the only
+    * level, the fault interrupted code running with preemption enabled and,
+    * therefore, not in the middle of a critical section. In that case, it's
+    * safe to call the shrinkers and to yield at the end of the fault.
+    */
+   const bool can_wait = get_preempt_disable_count() == 1;
+
+   if (is_kernel_thread(curr))
+      return false;
+
+   if (can_wait) {
+
+      if (mem_reclaim(bytes) >= bytes)
+         return true; /* retry */
+
+      disable_preemption();
+      {
+         victim = oom_kill();
+      }
+      enable_preemption();
+
+      if (victim && victim != curr_pid) {
+
+         /*
+          * Wait for the victim to die and free its memory: yield at the end
+          * of the fault handler and, after that, the faulting instruction
+          * will be retried. Sleeping here is not possible.
+          */
+         disable_preemption();
+         {
+            mp_stats.fault_waits++;
+         }
+         enable_preemption();
+         sched_set_need_resched();
+         return true;
+      }
+   }
+
+   if (victim != curr_pid) {
+
+      printk("Out-of-memory: killing pid %d\n", curr_pid);
+
+      disable_preemption();
+      {
+         mp_stats.oom_kills++;
+      }
+      enable_preemption();
+   }
+
+   if (!curr->running_in_kernel) {
+
+      /* The task was not running in kernel: we can safely kill it */
+      send_signal(curr_pid, SIGKILL, SIG_FL_PROCESS | SIG_FL_FAULT);
+      return true;
+   }
+
+   /*
+    * The task was running in kernel (e.g. copy_to_user() on a CoW page): it
+    * will die on the way back to user space, but the fault has to fail.
+    */
+   send_signal(curr_pid, SIGKILL, SIG_FL_PROCESS);
+   return false;
+}
+
+void mem_pressure_get_stats(struct mem_pressure_stats *stats)
+{
+   disable_preemption();
+   {
+      *stats = mp_stats;
+      stats->free_kb = kmalloc_get_tot_heap_free() / KB;
+      stats->low_wmark_kb = mem_reclaim_low_wmark / KB;
+      stats->high_wmark_kb = mem_reclaim_high_wmark / KB;
+      stats->reclaimed_kb = (ulong)(reclaimed_bytes / KB);
+   }
+   enable_preemption();
+}
+
+static size_t shrink_small_heaps(size_t bytes)
+{
+   return kmalloc_trim_small_heaps();
+}
+
+static size_t shrink_task_bufs(size_t bytes)
+{
+   return task_buf_pools_shrink();
+}
+
+static size_t shrink_exec_cache(size_t bytes)
+{
+   return exec_cache_shrink();
+}
+
+static size_t shrink_pagecache(size_t bytes)
+{
+   return pagecache_shrink((bytes + PAGE_SIZE - 1) >> PAGE_SHIFT) * PAGE_SIZE;
+}
+
+/* Built-in shrinkers, from the cheapest to the most expensive to lose */
+static struct shrinker builtin_shrinkers[] = {
+   { .name = "small_heaps", .shrink = &shrink_small_heaps },
+   { .name = "task_bufs", .shrink = &shrink_task_bufs },
+   { .name = "exec_cache", .shrink = &shrink_exec_cache },
+   { .name = "pagecache", .shrink = &shrink_pagecache },
+};
+
+void init_mem_pressure(void)
+{
+   const size_t tot = kmalloc_get_max_tot_heap_free();
+
+   for (int i = 0; i < ARRAY_SIZE(builtin_shrinkers); i++)
+      register_shrinker(&builtin_shrinkers[i]);
+
+   mem_reclaim_high_wmark = tot / 100 * MEM_RECLAIM_HIGH_WMARK_PCT;
+
+   /* Setting the low watermark enables the checks in kmalloc() */
+   mem_reclaim_low_wmark = tot / 100 * MEM_RECLAIM_LOW_WMARK_PCT;
+}
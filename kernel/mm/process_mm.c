@@ -25,10 +25,10 @@ brk_syscall_int(struct process *pi, void *new_brk)
    if (new_brk < pi->brk) {
 
       /* we have to free pages */
-
-      for (void *vaddr = new_brk; vaddr < pi->brk; vaddr += PAGE_SIZE) {
-         unmap_page(pi->pdir, vaddr, true);
-      }
+      unmap_pages(pi->pdir,
+                  new_brk,
+                  (size_t)(pi->brk - new_brk) >> PAGE_SHIFT,
+                  true);
 
       pi->brk = new_brk;
       return;
@@ -349,6 +349,13 @@ static int munmap_int(struct process *pi, void *vaddrp, size_t len)
 
    const ulong um_vend = um->vaddr + um->len;
 
+   /*
+    * The 4-MB pages only partially in the range have to be split before doing
+    * anything else, because that's the only step in un-mapping that can fail.
+    */
+   if ((rc = split_big_pages(pi->pdir, vaddrp, actual_len)))
+      return rc;
+
    if (actual_len == um->len) {
 
       process_remove_user_mapping(um);
@@ -413,6 +420,11 @@ static int munmap_int(struct process *pi, void *vaddrp, size_t len)
 
       if (um2)
          vfs_mmap(um2, pi->pdir, VFS_MM_DONT_MMAP);
+
+   } else {
+
+      /* Un-map the whole 4-MB pages at once, not a 4-KB page at a time */
+      unmap_big_pages(pi->pdir, vaddrp, actual_len, true);
    }
 
    per_heap_kfree(pi->mi->mmap_heap,
@@ -448,3 +460,41 @@ int sys_munmap(void *vaddrp, size_t len)
    enable_preemption();
    return rc;
 }
+
+int sys_madvise(void *addr, size_t len, int advice)
+{
+   struct process *pi = get_curr_proc();
+   struct user_mapping *um;
+   const ulong vaddr = (ulong) addr;
+   const ulong vend = vaddr + len;
+   ulong va;
+
+   if (!IS_PAGE_ALIGNED(vaddr) || vend < vaddr)
+      return -EINVAL;
+
+   if (advice != MADV_HUGEPAGE)
+      return 0; /* The other advices are just ignored, at the moment */
+
+   /*
+    * Replace with 4-MB pages all the 4-MB aligned chunks of anonymous mappings
+    * contained in the range. Like on Linux, that's just a best-effort: in case
+    * of failure, the memory stays mapped with regular pages.
+    */
+   disable_preemption();
+   {
+      va = pow2_round_up_at(vaddr, 4 * MB);
+
+      for (; va + 4 * MB <= vend && va + 4 * MB > va; va += 4 * MB) {
+
+         um = process_get_user_mapping((void *)va);
+
+         if (!um || um->h || va + 4 * MB > um->vaddr + um->len)
+            continue;
+
+         if (collapse_big_page(pi->pdir, (void *)va) == -ENOMEM)
+            break;
+      }
+   }
+   enable_preemption();
+   return 0;
+}
@@ -216,16 +216,10 @@ oom_case:
 
 void user_vfree_and_unmap(ulong user_vaddr, size_t page_count)
 {
-   pdir_t *pdir = get_curr_pdir();
-   ulong va = user_vaddr;
-
-   for (size_t i = 0; i < page_count; i++, va += PAGE_SIZE) {
-
-      if (!is_mapped(pdir, (void *)va))
-         continue;
-
-      unmap_page(pdir, (void *)va, true);
-   }
+   unmap_pages_permissive(get_curr_pdir(),
+                          (void *)user_vaddr,
+                          page_count,
+                          true);
 }
 
 bool user_valloc_and_map_slow(ulong user_vaddr, size_t page_count)
@@ -292,7 +286,9 @@ bool user_valloc_and_map(ulong user_vaddr, size_t page_count)
 void user_unmap_zero_page(ulong user_vaddr, size_t page_count)
 {
    pdir_t *pdir = get_curr_pdir();
-   unmap_pages(pdir, (void *)user_vaddr, page_count, true);
+
+   /* The range might have been already un-mapped by unmap_big_pages() */
+   unmap_pages_permissive(pdir, (void *)user_vaddr, page_count, true);
 }
 
 bool user_map_zero_page(ulong user_vaddr, size_t page_count)
@@ -314,13 +310,69 @@ int generic_fs_munmap(struct user_mapping *um, void *vaddrp, size_t len)
 {
    struct fs_handle_base *hb = um->h;
    struct process *pi = hb->pi;
-   ulong vaddr = (ulong)vaddrp;
-   ulong vend = vaddr + len;
    ASSERT(IS_PAGE_ALIGNED(len));
 
-   for (; vaddr < vend; vaddr += PAGE_SIZE) {
-      unmap_page_permissive(pi->pdir, (void *)vaddr, false);
+   unmap_pages_permissive(pi->pdir, vaddrp, len >> PAGE_SHIFT, false);
+   return 0;
+}
+
+static size_t process_kernel_bytes(struct process *pi)
+{
+   struct user_mapping *um;
+   size_t tot = TOT_PROC_AND_TASK_SIZE + KERNEL_STACK_SIZE;
+
+   tot += IO_COPYBUF_SIZE + ARGS_COPYBUF_SIZE;
+   tot += pi->mem_counters.temp_kallocs;
+
+   if (pi->debug_cmdline)
+      tot += PROCESS_CMDLINE_BUF_SIZE;
+
+   if (pi->mi) {
+
+      tot += sizeof(struct mappings_info);
+
+      if (pi->mi->mmap_heap) {
+         tot += kmalloc_get_heap_struct_size();
+         tot += kmalloc_get_heap_metadata_size(pi->mi->mmap_heap);
+      }
+
+      list_for_each_ro(um, &pi->mi->mappings, pi_node) {
+         tot += sizeof(struct user_mapping);
+      }
    }
 
-   return 0;
+   return tot;
+}
+
+static ulong user_mem_usage_rss(struct user_mem_usage *u)
+{
+   return u->private_pages + u->shared_pages + u->cow_pages;
+}
+
+void process_get_mem_usage(struct process *pi, struct proc_mem_usage *u)
+{
+   ulong rss;
+   ASSERT(!is_preemption_enabled());
+
+   pdir_get_user_mem_usage(pi->pdir, &u->pages);
+   rss = user_mem_usage_rss(&u->pages);
+
+   if (rss > pi->mem_counters.max_rss)
+      pi->mem_counters.max_rss = rss;
+
+   u->kernel_bytes = process_kernel_bytes(pi);
+   u->counters = pi->mem_counters;
+}
+
+void process_update_max_rss(struct process *pi)
+{
+   struct user_mem_usage u;
+   ulong rss;
+   ASSERT(!is_preemption_enabled());
+
+   pdir_get_user_mem_usage(pi->pdir, &u);
+   rss = user_mem_usage_rss(&u);
+
+   if (rss > pi->mem_counters.max_rss)
+      pi->mem_counters.max_rss = rss;
 }
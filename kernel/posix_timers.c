@@ -0,0 +1,304 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/signal.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/syscalls.h>
+
+/*
+ * POSIX per-process timers (timer_create() and friends).
+ *
+ * NOTE: the list of timers is accessed only by the process itself (syscalls,
+ * execve() and exit) and, because there are no user threads yet, it doesn't
+ * need any locking.
+ */
+
+#ifndef SIGEV_THREAD_ID
+   #define SIGEV_THREAD_ID 4
+#endif
+
+struct posix_timer {
+
+   struct ktimer kt;
+   struct list_node node;
+   clockid_t clk_id;
+   int id;
+   int pid;
+   int signo;                    /* 0 in case of SIGEV_NONE */
+   int overrun;
+};
+
+/* Called by a worker thread, after each expiration of the timer */
+static void posix_timer_notify(struct ktimer *kt)
+{
+   struct posix_timer *pt = CONTAINER_OF(kt, struct posix_timer, kt);
+   const u64 n = ktimer_consume(kt);
+
+   if (!n)
+      return;
+
+   pt->overrun = (int)MIN(n - 1, (u64)INT32_MAX);
+
+   if (pt->signo)
+      send_signal(pt->pid, pt->signo, SIG_FL_PROCESS);
+}
+
+static void posix_timer_free(struct ktimer *kt)
+{
+   kfree_obj(CONTAINER_OF(kt, struct posix_timer, kt), struct posix_timer);
+}
+
+static struct posix_timer *get_posix_timer(struct process *pi, int id)
+{
+   struct posix_timer *pos;
+
+   list_for_each_ro(pos, &pi->posix_timers, node) {
+      if (pos->id == id)
+         return pos;
+   }
+
+   return NULL;
+}
+
+static int get_free_posix_timer_id(struct process *pi)
+{
+   for (int id = 0; id < MAX_POSIX_TIMERS; id++)
+      if (!get_posix_timer(pi, id))
+         return id;
+
+   return -1;
+}
+
+static void delete_posix_timer(struct posix_timer *pt)
+{
+   list_remove(&pt->node);
+   ktimer_release(&pt->kt);
+}
+
+void delete_all_posix_timers(struct process *pi)
+{
+   struct posix_timer *pos, *temp;
+
+   list_for_each(pos, temp, &pi->posix_timers, node) {
+      delete_posix_timer(pos);
+   }
+}
+
+int sys_timer_create(clockid_t clk_id,
+                     const struct k_sigevent *u_sev,
+                     int *u_timer_id)
+{
+   struct process *pi = get_curr_proc();
+   struct posix_timer *pt;
+   struct k_sigevent sev;
+   int id;
+
+   if (clk_id != CLOCK_REALTIME && clk_id != CLOCK_MONOTONIC)
+      return -EINVAL;
+
+   if (u_sev) {
+
+      if (copy_from_user(&sev, u_sev, sizeof(sev)))
+         return -EFAULT;
+
+   } else {
+
+      sev = (struct k_sigevent) {
+         .sigev_signo = SIGALRM,
+         .sigev_notify = SIGEV_SIGNAL,
+      };
+   }
+
+   switch (sev.sigev_notify) {
+
+      case SIGEV_NONE:
+         sev.sigev_signo = 0;
+         break;
+
+      case SIGEV_THREAD_ID:
+
+         /* There are no user threads, yet: only the main one is valid */
+         if (sev.sigev_notify_thread_id != pi->pid)
+            return -EINVAL;
+
+         /* fall-through */
+
+      case SIGEV_SIGNAL:
+
+         if (!IN_RANGE(sev.sigev_signo, 1, _NSIG))
+            return -EINVAL;
+
+         break;
+
+      default:
+         return -EINVAL;
+   }
+
+   if ((id = get_free_posix_timer_id(pi)) < 0)
+      return -EAGAIN;
+
+   if (!(pt = kzalloc_obj(struct posix_timer)))
+      return -ENOMEM;
+
+   ktimer_init(&pt->kt, &posix_timer_notify, &posix_timer_free);
+   list_node_init(&pt->node);
+   pt->clk_id = clk_id;
+   pt->id = id;
+   pt->pid = pi->pid;
+   pt->signo = sev.sigev_signo;
+
+   if (copy_to_user(u_timer_id, &id, sizeof(id))) {
+      posix_timer_free(&pt->kt);
+      return -EFAULT;
+   }
+
+   list_add_tail(&pi->posix_timers, &pt->node);
+   return 0;
+}
+
+static int
+do_timer_settime(int timer_id,
+                 int flags,
+                 const struct k_itimerspec64 *new_val,
+                 struct k_itimerspec64 *old_val)
+{
+   struct posix_timer *pt;
+   u64 delta, interval, old_rem, old_interval;
+   int rc;
+
+   if (!(pt = get_posix_timer(get_curr_proc(), timer_id)))
+      return -EINVAL;
+
+   if (flags & ~TIMER_ABSTIME)
+      return -EINVAL;
+
+   rc = itimerspec_to_ns(pt->clk_id,
+                         !!(flags & TIMER_ABSTIME),
+                         new_val,
+                         &delta,
+                         &interval);
+
+   if (rc)
+      return rc;
+
+   ktimer_get(&pt->kt, &old_rem, &old_interval);
+   ktimer_set(&pt->kt, delta, interval);
+   ns_to_itimerspec(old_rem, old_interval, old_val);
+   return 0;
+}
+
+static int do_timer_gettime(int timer_id, struct k_itimerspec64 *curr)
+{
+   struct posix_timer *pt;
+   u64 rem, interval;
+
+   if (!(pt = get_posix_timer(get_curr_proc(), timer_id)))
+      return -EINVAL;
+
+   ktimer_get(&pt->kt, &rem, &interval);
+   ns_to_itimerspec(rem, interval, curr);
+   return 0;
+}
+
+int sys_timer_settime(int timer_id,
+                      int flags,
+                      const struct k_itimerspec64 *u_new,
+                      struct k_itimerspec64 *u_old)
+{
+   struct k_itimerspec64 new_val, old_val;
+   int rc;
+
+   if (copy_from_user(&new_val, u_new, sizeof(new_val)))
+      return -EFAULT;
+
+   if ((rc = do_timer_settime(timer_id, flags, &new_val, &old_val)))
+      return rc;
+
+   if (u_old && copy_to_user(u_old, &old_val, sizeof(old_val)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timer_settime32(int timer_id,
+                        int flags,
+                        const struct k_itimerspec32 *u_new,
+                        struct k_itimerspec32 *u_old)
+{
+   struct k_itimerspec32 new32, old32;
+   struct k_itimerspec64 new_val, old_val;
+   int rc;
+
+   if (copy_from_user(&new32, u_new, sizeof(new32)))
+      return -EFAULT;
+
+   new_val = from_k_itimerspec32(new32);
+
+   if ((rc = do_timer_settime(timer_id, flags, &new_val, &old_val)))
+      return rc;
+
+   old32 = to_k_itimerspec32(old_val);
+
+   if (u_old && copy_to_user(u_old, &old32, sizeof(old32)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timer_gettime(int timer_id, struct k_itimerspec64 *u_curr)
+{
+   struct k_itimerspec64 curr;
+   int rc;
+
+   if ((rc = do_timer_gettime(timer_id, &curr)))
+      return rc;
+
+   if (copy_to_user(u_curr, &curr, sizeof(curr)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timer_gettime32(int timer_id, struct k_itimerspec32 *u_curr)
+{
+   struct k_itimerspec32 curr32;
+   struct k_itimerspec64 curr;
+   int rc;
+
+   if ((rc = do_timer_gettime(timer_id, &curr)))
+      return rc;
+
+   curr32 = to_k_itimerspec32(curr);
+
+   if (copy_to_user(u_curr, &curr32, sizeof(curr32)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timer_getoverrun(int timer_id)
+{
+   struct posix_timer *pt;
+
+   if (!(pt = get_posix_timer(get_curr_proc(), timer_id)))
+      return -EINVAL;
+
+   return pt->overrun;
+}
+
+int sys_timer_delete(int timer_id)
+{
+   struct posix_timer *pt;
+
+   if (!(pt = get_posix_timer(get_curr_proc(), timer_id)))
+      return -EINVAL;
+
+   delete_posix_timer(pt);
+   return 0;
+}
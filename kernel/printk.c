@@ -13,11 +13,16 @@
 #include <tilck/kernel/term.h>
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/datetime.h>
+#include <tilck/kernel/cmdline.h>
+#include <tilck/kernel/kmsg.h>
+#include <tilck/kernel/worker_thread.h>
 
 #include <tilck/mods/tracing.h>
 
 #define PRINTK_BUF_SZ                         224
 #define PRINTK_PREFIXBUF_SZ                   32
+#define PRINTK_ASYNC_BATCH_SZ                256
+#define PRINTK_WTH_PRIO            (WTH_PRIO_LOWEST - 1)
 
 #ifdef BITS32
    #define PRINTK_SAFE_STACK_SPACE         1536
@@ -252,6 +257,168 @@ printk_flush_ringbuf(void)
    __printk_flush_ringbuf(minibuf, sizeof(minibuf));
 }
 
+/*
+ * Asynchronous printk
+ * ---------------------
+ *
+ * When `kopt_printk_async` is set, printk() just appends the message to the
+ * kernel log (see kmsg.c) and wakes up a dedicated low-priority worker thread
+ * that drains the log to the consoles in batches of PRINTK_ASYNC_BATCH_SZ
+ * bytes. Messages with a level <= `kopt_printk_sync_lvl` still drain the log
+ * synchronously, before printk() returns. In panic, everything that has not
+ * been flushed yet, gets flushed synchronously before the panic messages.
+ *
+ * The worker thread exists also when printk is synchronous, in order to wake
+ * up the /dev/kmsg readers outside of printk()'s context.
+ *
+ * printk() wakes up the worker from any context, IRQ handlers and sections
+ * with preemption disabled included: wth_enqueue_on() is IRQ-safe. Recursion
+ * (e.g. a printk() called by the scheduler while waking up the worker) stops
+ * at `printk_wth_job_pending`, set before enqueueing the job.
+ */
+
+static struct worker_thread *printk_wth;
+static ATOMIC(bool) printk_wth_job_pending;
+static ATOMIC(bool) printk_async_drain_busy;
+static u32 printk_async_pos;         /* consoles' position in the kernel log */
+
+static ALWAYS_INLINE bool
+printk_async_active(void)
+{
+   return kopt_printk_async && printk_wth != NULL;
+}
+
+static int
+printk_get_level(const char *fmt)
+{
+   if (!strncmp(fmt, "ERROR", 5))
+      return PRINTK_LVL_ERR;
+
+   if (!strncmp(fmt, "WARNING", 7) || !strncmp(fmt, "[WARNING]", 9))
+      return PRINTK_LVL_WARNING;
+
+   return PRINTK_LVL_DEFAULT;
+}
+
+/*
+ * Flushes to the consoles up to `max_bytes` of the data in the kernel log after
+ * `printk_async_pos`. Only one context at a time can do that: a printk() in an
+ * IRQ handler which interrupted the draining just returns false, leaving its
+ * data to the interrupted context, which re-checks the log before returning.
+ */
+static bool
+printk_async_drain(char *tmpbuf, u32 buf_size, u32 max_bytes, bool force)
+{
+   static const char dropped_msg[] = "{_DROPPED_}\n";
+   u32 n, tot = 0;
+   bool exp, lost;
+
+   do {
+
+      exp = false;
+
+      if (!atomic_cas_strong(&printk_async_drain_busy,
+                             &exp, true, mo_acquire, mo_relaxed) && !force)
+      {
+         return false;
+      }
+
+      while (tot < max_bytes) {
+
+         n = kmsg_read(&printk_async_pos,
+                       tmpbuf,
+                       MIN(buf_size, max_bytes - tot),
+                       &lost);
+
+         if (!n)
+            break;
+
+         if (UNLIKELY(lost)) {
+            printk_direct_flush(dropped_msg,
+                                sizeof(dropped_msg) - 1,
+                                PRINTK_NOSPACE_IN_RBUF_FLUSH_COLOR);
+         }
+
+         printk_direct_flush(tmpbuf, n, PRINTK_COLOR);
+         tot += n;
+      }
+
+      atomic_store_explicit(&printk_async_drain_busy, false, mo_release);
+
+   } while (!force && tot < max_bytes && kmsg_has_data(printk_async_pos));
+
+   return true;
+}
+
+static void
+printk_wth_job(void *arg)
+{
+   char buf[PRINTK_ASYNC_BATCH_SZ];
+   bool ok = true;
+
+   atomic_store_explicit(&printk_wth_job_pending, false, mo_relaxed);
+
+   /*
+    * Drain the log one batch at a time, keeping the preemption disabled only
+    * while writing a single batch to the consoles.
+    */
+   while (kopt_printk_async && ok && kmsg_has_data(printk_async_pos)) {
+      disable_preemption();
+      {
+         ok = printk_async_drain(buf, sizeof(buf), sizeof(buf), false);
+      }
+      enable_preemption();
+   }
+
+   if (kmsg_has_readers())
+      kmsg_wakeup_readers();
+}
+
+static void
+printk_wakeup_worker(void)
+{
+   if (!printk_wth)
+      return;
+
+   /*
+    * The worker thread itself cannot enqueue jobs on its own queue, unless
+    * we're in an IRQ handler. That's not a problem: the worker re-checks the
+    * log before completing its job.
+    */
+   if (get_curr_task() == wth_get_task(printk_wth) && !in_irq())
+      return;
+
+   if (atomic_exchange_explicit(&printk_wth_job_pending, true, mo_relaxed))
+      return; /* there's already a job in the queue */
+
+   if (!wth_enqueue_on(printk_wth, &printk_wth_job, NULL))
+      atomic_store_explicit(&printk_wth_job_pending, false, mo_relaxed);
+}
+
+static void
+printk_async_emergency_flush(void)
+{
+   static char panic_tmpbuf[80];
+
+   if (printk_async_active())
+      printk_async_drain(panic_tmpbuf, sizeof(panic_tmpbuf), UINT32_MAX, true);
+}
+
+void
+init_printk_worker(void)
+{
+   struct worker_thread *wth;
+
+   wth = wth_create_thread("printk", PRINTK_WTH_PRIO, WTH_PRINTK_QUEUE_SIZE);
+
+   if (!wth)
+      panic("Unable to create the printk worker thread");
+
+   /* Everything in the log until now has been flushed synchronously */
+   printk_async_pos = kmsg_get_end_pos();
+   printk_wth = wth;
+}
+
 static void printk_append_to_ringbuf(const char *buf, size_t size)
 {
    static const char err_msg[] = "{_DROPPED_}\n";
@@ -375,6 +542,7 @@ __tilck_vprintk(char *prefixbuf,
    bool has_newline = false;
    struct ringbuf_stat old;
    int written, prefix_sz = 0;
+   int lvl = PRINTK_LVL_DEFAULT;
 
    if (fmt[0] == PRINTK_CTRL_CHAR) {
 
@@ -387,7 +555,13 @@ __tilck_vprintk(char *prefixbuf,
 
          if (cmd == NO_PREFIX[1])
             prefix = false;
+         else if (IN_RANGE_INC(cmd, '0', '7'))
+            lvl = cmd - '0';
       }
+
+   } else {
+
+      lvl = printk_get_level(fmt);
    }
 
    if (flags & PRINTK_FL_NO_PREFIX)
@@ -420,6 +594,8 @@ __tilck_vprintk(char *prefixbuf,
       prefix = false;
    }
 
+   if (!panic)
+      kmsg_append(prefixbuf, (u32)prefix_sz, buf, (u32)written);
 
    if (!term_is_initialized()) {
       printk_append_to_ringbuf(prefixbuf, (size_t) prefix_sz);
@@ -430,12 +606,39 @@ __tilck_vprintk(char *prefixbuf,
 
    if (panic) {
       u8 color = in_panic_debugger() ? DEFAULT_FG_COLOR : PRINTK_PANIC_COLOR;
+      printk_async_emergency_flush();
       printk_direct_flush(buf, (size_t) written, color);
       restore_first_printk_value();
       return;
    }
 
    trace_printk_raw(1, buf, (size_t) written);
+
+   if (printk_async_active()) {
+
+      if (!old.first_printk)
+         restore_first_printk_value();
+
+      if (lvl <= kopt_printk_sync_lvl) {
+
+         /* The message (already in the log) is urgent: drain the log now */
+         disable_preemption();
+         {
+            printk_async_drain(buf, bufsz, UINT32_MAX, false);
+         }
+         enable_preemption();
+
+         if (kmsg_has_readers())
+            printk_wakeup_worker();
+
+      } else {
+
+         printk_wakeup_worker();
+      }
+
+      return;
+   }
+
    disable_preemption();
    {
       if (!old.first_printk) {
@@ -469,6 +672,9 @@ __tilck_vprintk(char *prefixbuf,
       }
    }
    enable_preemption();
+
+   if (kmsg_has_readers())
+      printk_wakeup_worker();
 }
 
 static void
@@ -25,6 +25,118 @@ STATIC_ASSERT(IS_PAGE_ALIGNED(ARGS_COPYBUF_SIZE));
 
 #define ISOLATED_STACK_HI_VMEM_SPACE   (KERNEL_STACK_SIZE + (2 * PAGE_SIZE))
 
+/*
+ * Pools of recently freed per-task allocations, one per size.
+ *
+ * Creating and destroying a task (fork, vfork, exit) requires several big
+ * allocations: the kernel stack, the I/O + args copy buffer and the task +
+ * process struct. A few of them are kept after the task dies and handed to
+ * the next tasks created, instead of going back to the kernel heap. Each pool
+ * keeps at most TASK_BUF_POOL_MAX_BYTES of memory and it's drained by the
+ * task_bufs shrinker under memory pressure.
+ */
+struct task_buf_pool {
+
+   size_t size;
+   u16 max_count;
+   u16 count;
+   void *elems[TASK_BUF_POOL_MAX_ELEMS];
+};
+
+#define POOL_MAX_COUNT(sz)                                     \
+   ((TASK_BUF_POOL_MAX_BYTES / (sz)) < TASK_BUF_POOL_MAX_ELEMS  \
+      ? (u16)(TASK_BUF_POOL_MAX_BYTES / (sz))                   \
+      : (u16)TASK_BUF_POOL_MAX_ELEMS)
+
+#define DEFINE_TASK_BUF_POOL(name, sz)                         \
+   static struct task_buf_pool name = {                        \
+      .size = (sz),                                            \
+      .max_count = POOL_MAX_COUNT(sz),                         \
+   }
+
+DEFINE_TASK_BUF_POOL(stacks_pool, KERNEL_STACK_SIZE);
+DEFINE_TASK_BUF_POOL(copybufs_pool, IO_COPYBUF_SIZE + ARGS_COPYBUF_SIZE);
+DEFINE_TASK_BUF_POOL(proc_structs_pool, TOT_PROC_AND_TASK_SIZE);
+
+static void *task_buf_pool_alloc(struct task_buf_pool *p)
+{
+   void *ptr = NULL;
+
+   disable_preemption();
+   {
+      if (p->count)
+         ptr = p->elems[--p->count];
+   }
+   enable_preemption();
+
+   return ptr ? ptr : kmalloc(p->size);
+}
+
+static void task_buf_pool_free(struct task_buf_pool *p, void *ptr)
+{
+   bool cached = false;
+
+   if (!ptr)
+      return;
+
+   disable_preemption();
+   {
+      if (p->count < p->max_count) {
+         p->elems[p->count++] = ptr;
+         cached = true;
+      }
+   }
+   enable_preemption();
+
+   if (!cached)
+      kfree2(ptr, p->size);
+}
+
+/* Frees all the buffers kept in the pools. Returns the freed bytes. */
+size_t task_buf_pools_shrink(void)
+{
+   static struct task_buf_pool *const pools[] = {
+      &stacks_pool, &copybufs_pool, &proc_structs_pool,
+   };
+
+   size_t freed = 0;
+   void *ptr;
+
+   for (int i = 0; i < ARRAY_SIZE(pools); i++) {
+
+      struct task_buf_pool *p = pools[i];
+
+      while (true) {
+
+         ptr = NULL;
+         disable_preemption();
+         {
+            if (p->count)
+               ptr = p->elems[--p->count];
+         }
+         enable_preemption();
+
+         if (!ptr)
+            break;
+
+         kfree2(ptr, p->size);
+         freed += p->size;
+      }
+   }
+
+   return freed;
+}
+
+static void *alloc_zeroed_stack(void)
+{
+   void *stack = task_buf_pool_alloc(&stacks_pool);
+
+   if (stack)
+      bzero(stack, KERNEL_STACK_SIZE);
+
+   return stack;
+}
+
 static void *alloc_kernel_isolated_stack(struct process *pi)
 {
    void *vaddr_in_block;
@@ -35,7 +147,7 @@ static void *alloc_kernel_isolated_stack(struct process *pi)
 
    ASSERT(pi->pdir != NULL);
 
-   direct_va = kzmalloc(KERNEL_STACK_SIZE);
+   direct_va = alloc_zeroed_stack();
 
    if (!direct_va)
       return NULL;
@@ -44,7 +156,7 @@ static void *alloc_kernel_isolated_stack(struct process *pi)
    block_vaddr = hi_vmem_reserve(ISOLATED_STACK_HI_VMEM_SPACE);
 
    if (!block_vaddr) {
-      kfree2(direct_va, KERNEL_STACK_SIZE);
+      task_buf_pool_free(&stacks_pool, direct_va);
       return NULL;
    }
 
@@ -59,7 +171,7 @@ static void *alloc_kernel_isolated_stack(struct process *pi)
    if (count != KERNEL_STACK_PAGES) {
       unmap_pages(get_kernel_pdir(), vaddr_in_block, count, false);
       hi_vmem_release(block_vaddr, ISOLATED_STACK_HI_VMEM_SPACE);
-      kfree2(direct_va, KERNEL_STACK_SIZE);
+      task_buf_pool_free(&stacks_pool, direct_va);
       return NULL;
    }
 
@@ -75,7 +187,7 @@ free_kernel_isolated_stack(struct process *pi, void *vaddr_in_block)
 
    unmap_pages(get_kernel_pdir(), vaddr_in_block, KERNEL_STACK_PAGES, false);
    hi_vmem_release(block_vaddr, ISOLATED_STACK_HI_VMEM_SPACE);
-   kfree2(direct_va, KERNEL_STACK_SIZE);
+   task_buf_pool_free(&stacks_pool, direct_va);
 }
 
 
@@ -97,7 +209,7 @@ static void alloc_kernel_stack(struct task *ti)
    if (KERNEL_STACK_ISOLATION) {
       ti->kernel_stack = alloc_kernel_isolated_stack(ti->pi);
    } else {
-      ti->kernel_stack = kzmalloc(KERNEL_STACK_SIZE);
+      ti->kernel_stack = alloc_zeroed_stack();
    }
 }
 
@@ -106,7 +218,7 @@ static void free_kernel_stack(struct task *ti)
    if (KERNEL_STACK_ISOLATION) {
       free_kernel_isolated_stack(ti->pi, ti->kernel_stack);
    } else {
-      kfree2(ti->kernel_stack, KERNEL_STACK_SIZE);
+      task_buf_pool_free(&stacks_pool, ti->kernel_stack);
    }
 }
 
@@ -119,7 +231,7 @@ static bool do_common_task_allocs(struct task *ti, bool alloc_bufs)
 
    if (alloc_bufs) {
 
-      ti->io_copybuf = kmalloc(IO_COPYBUF_SIZE + ARGS_COPYBUF_SIZE);
+      ti->io_copybuf = task_buf_pool_alloc(&copybufs_pool);
 
       if (!ti->io_copybuf) {
          free_kernel_stack(ti);
@@ -150,7 +262,7 @@ void free_common_task_allocs(struct task *ti)
    process_free_mappings_info(pi);
 
    free_kernel_stack(ti);
-   kfree2(ti->io_copybuf, IO_COPYBUF_SIZE + ARGS_COPYBUF_SIZE);
+   task_buf_pool_free(&copybufs_pool, ti->io_copybuf);
 
    ti->io_copybuf = NULL;
    ti->args_copybuf = NULL;
@@ -181,17 +293,26 @@ void init_task_lists(struct task *ti)
 {
    bintree_node_init(&ti->tree_by_tid_node);
    list_node_init(&ti->runnable_node);
-   list_node_init(&ti->wakeup_timer_node);
+   task_init_wakeup_timer(ti);
    list_node_init(&ti->siblings_node);
 
    list_init(&ti->tasks_waiting_list);
    list_init(&ti->on_exit);
    bzero(&ti->wobj, sizeof(struct wait_obj));
+
+   list_init(&ti->pi_mutexes);
+   ti->pi_prio = SCHED_PRIO_NORMAL;
+   ti->pi_vruntime = UINT64_MAX;
 }
 
 void init_process_lists(struct process *pi)
 {
    list_init(&pi->children);
+   list_init(&pi->posix_timers);
+   list_node_init(&pi->pgrp_node);
+   list_node_init(&pi->session_node);
+   pi->pgrp = NULL;
+   pi->session = NULL;
    kmutex_init(&pi->fslock, KMUTEX_FL_RECURSIVE);
 }
 
@@ -203,7 +324,7 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
    bool common_allocs = false;
    bool arch_fields = false;
 
-   if (UNLIKELY(!(ti = kmalloc(TOT_PROC_AND_TASK_SIZE))))
+   if (UNLIKELY(!(ti = task_buf_pool_alloc(&proc_structs_pool))))
       goto oom_case;
 
    pi = (struct process *)(ti + 1);
@@ -265,8 +386,16 @@ allocate_new_process(struct task *parent, int pid, pdir_t *new_pdir)
     */
    drop_all_pending_signals(ti);
 
-   /* Reset sched ticks in the new process */
+   /* Reset sched ticks and memory counters in the new process */
    bzero(&ti->ticks, sizeof(ti->ticks));
+   bzero(&pi->mem_counters, sizeof(pi->mem_counters));
+
+   /* The scheduling policy is inherited, unless SCHED_RESET_ON_FORK is set */
+   if (ti->sched_reset_on_fork) {
+      ti->sched_policy = SCHED_OTHER;
+      ti->rt_prio = 0;
+      ti->sched_reset_on_fork = false;
+   }
 
    /* Copy parent's `cwd` while retaining the `fs` and the inode obj */
    process_set_cwd2_nolock_raw(pi, &parent_pi->cwd);
@@ -305,7 +434,7 @@ oom_case:
       if (MOD_debugpanel && pi->debug_cmdline)
          kfree2(pi->debug_cmdline, PROCESS_CMDLINE_BUF_SIZE);
 
-      kfree2(ti, TOT_PROC_AND_TASK_SIZE);
+      task_buf_pool_free(&proc_structs_pool, ti);
    }
 
    return NULL;
@@ -354,10 +483,11 @@ static void free_process_int(struct process *pi)
    if (release_obj(pi) == 0) {
 
       arch_specific_free_proc(pi);
-      kfree2(get_process_task(pi), TOT_PROC_AND_TASK_SIZE);
 
       if (MOD_debugpanel)
          kfree2(pi->debug_cmdline, PROCESS_CMDLINE_BUF_SIZE);
+
+      task_buf_pool_free(&proc_structs_pool, get_process_task(pi));
    }
 }
 
@@ -403,6 +533,8 @@ void *task_temp_kernel_alloc(size_t size)
                                node,
                                vaddr);
 
+            curr->pi->mem_counters.temp_kallocs += size;
+
          } else {
 
             kfree2(ptr, size);
@@ -433,6 +565,7 @@ void task_temp_kernel_free(void *ptr)
       ASSERT(alloc != NULL);
 
       kfree2(alloc->vaddr, alloc->size);
+      curr->pi->mem_counters.temp_kallocs -= alloc->size;
 
       bintree_remove_ptr(&curr->kallocs_tree_root,
                          alloc,
@@ -560,10 +693,11 @@ int sys_setsid(void)
    disable_preemption();
 
    if (!sched_count_proc_in_group(pi->pid)) {
-      pi->pgid = pi->pid;
-      pi->sid = pi->pid;
-      pi->proc_tty = NULL;
-      rc = pi->sid;
+
+      if (!(rc = sched_set_proc_groups(pi, pi->pid, pi->pid))) {
+         pi->proc_tty = NULL;
+         rc = pi->sid;
+      }
    }
 
    enable_preemption();
@@ -582,7 +716,7 @@ int sys_setpgid(int pid, int pgid)
    int sid;
    int rc = 0;
 
-   if (pgid < 0)
+   if (pgid < 0 || pgid > MAX_PID)
       return -EINVAL;
 
    disable_preemption();
@@ -627,12 +761,12 @@ int sys_setpgid(int pid, int pgid)
       }
 
       /* Set process' pgid to `pgid` */
-      pi->pgid = pgid;
+      rc = sched_set_proc_groups(pi, pgid, pi->sid);
 
    } else {
 
       /* pgid is 0: make the process a group leader */
-      pi->pgid = pi->pid;
+      rc = sched_set_proc_groups(pi, pi->pid, pi->sid);
    }
 
 out:
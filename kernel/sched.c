@@ -12,6 +12,8 @@
 #include <tilck/kernel/timer.h>
 #include <tilck/kernel/errno.h>
 
+#include <tilck/mods/tracing.h>
+
 /* Shared global variables */
 struct task *__current;
 ATOMIC(int) __disable_preempt = 1;        /* see docs/atomics.md */
@@ -23,12 +25,59 @@ struct process *kernel_process_pi;
 /* Task lists */
 struct list runnable_tasks_list;
 
+/*
+ * Runqueues of the RT tasks (SCHED_FIFO and SCHED_RR), one per priority, plus
+ * a bitmap of the non-empty ones, in order to find the highest priority
+ * runnable RT task in O(1).
+ */
+static struct list rt_runqueues[MAX_RT_PRIO + 1];
+static u32 rt_runqueues_bitmap[(MAX_RT_PRIO + 32) / 32];
+static int rt_runnable_count;
+
+/* RT throttling, see RT_RUNTIME_TICKS */
+static u32 rt_period_ticks;
+static u32 rt_used_ticks;
+static bool rt_throttled;
+
+/*
+ * A process group or a session. Each one lives as long as it has at least one
+ * member process (zombies included) and, until then, its id cannot be re-used
+ * as pid for a new process.
+ */
+struct proc_group {
+
+   struct bintree_node node;
+   struct list members;       /* processes, through pgrp_node/session_node */
+   long id;                   /* pgid or sid, pointer-sized: the tree's key */
+   int sid;                   /* session of the process group */
+   int count;                 /* number of members */
+};
+
 /* Static variables */
 static struct task *tree_by_tid_root;
+static struct proc_group *pgrps_root;
+static struct proc_group *sessions_root;
 static u64 idle_ticks;
 static volatile int runnable_tasks_count;
-static int current_max_pid = -1;
-static int current_max_kernel_tid = -1;
+static int traced_tasks_count;
+static int pi_boosted_tasks;
+
+/*
+ * Bitmaps of the ids in use: a pid is busy when there's a process with that
+ * pid, or a process group or a session with that id.
+ */
+struct id_bitmap {
+   u32 *bits;
+   int max_id;       /* the highest valid id */
+   int last_id;      /* the last allocated id */
+};
+
+static u32 pids_bits[(MAX_PID + 32) / 32];
+static u32 kernel_tids_bits[(KERNEL_MAX_TID + 32) / 32];
+static struct id_bitmap pids_bitmap = { pids_bits, MAX_PID, -1 };
+static struct id_bitmap kernel_tids_bitmap = {
+   kernel_tids_bits, KERNEL_MAX_TID, -1
+};
 struct task *idle_task;
 
 const char *const task_state_str[5] = {
@@ -76,78 +125,19 @@ bool save_regs_and_schedule(bool skip_disable_preempt)
    return context_switch;
 }
 
-int
-get_traced_tasks_count(void)
+int get_traced_tasks_count(void)
 {
-   struct bintree_walk_ctx ctx;
-   struct task *ti;
-   int count = 0;
-
-   disable_preemption();
-   {
-      bintree_in_order_visit_start(&ctx,
-                                   tree_by_tid_root,
-                                   struct task,
-                                   tree_by_tid_node,
-                                   false);
-
-      while ((ti = bintree_in_order_visit_next(&ctx))) {
-         if (ti->traced)
-            count++;
-      }
-   }
-   enable_preemption();
-   return count;
+   return traced_tasks_count;
 }
 
-int sched_count_proc_in_group(int pgid)
+void set_task_traced(struct task *ti, bool traced)
 {
-   struct bintree_walk_ctx ctx;
-   struct task *ti;
-   int count = 0;
-
-   disable_preemption();
-   {
-      bintree_in_order_visit_start(&ctx,
-                                   tree_by_tid_root,
-                                   struct task,
-                                   tree_by_tid_node,
-                                   false);
-
-      while ((ti = bintree_in_order_visit_next(&ctx))) {
-
-         if (ti->pi->pgid == pgid)
-            count++;
-      }
-   }
-   enable_preemption();
-   return count;
-}
-
-int sched_get_session_of_group(int pgid)
-{
-   struct bintree_walk_ctx ctx;
-   struct task *ti;
-   int sid = -ESRCH;
-
-   disable_preemption();
-   {
-      bintree_in_order_visit_start(&ctx,
-                                   tree_by_tid_root,
-                                   struct task,
-                                   tree_by_tid_node,
-                                   false);
-
-      while ((ti = bintree_in_order_visit_next(&ctx))) {
+   ASSERT(!is_preemption_enabled());
 
-         if (ti->pi->pgid == pgid) {
-            sid = ti->pi->sid;
-            break;
-         }
-      }
+   if (ti->traced != traced) {
+      ti->traced = traced;
+      traced_tasks_count += traced ? 1 : -1;
    }
-   enable_preemption();
-   return sid;
 }
 
 int get_curr_tid(void)
@@ -162,202 +152,237 @@ int get_curr_pid(void)
    return c ? c->pi->pid : 0;
 }
 
-struct create_pid_visit_ctx {
+static inline bool id_bitmap_test(struct id_bitmap *b, int id)
+{
+   ASSERT(IN_RANGE_INC(id, 0, b->max_id));
+   return !!(b->bits[id / 32] & (1u << (id % 32)));
+}
 
-   bool kernel_tid;
-   bool lowest_avail_invalid;
-   int id_off;
-   int lowest_available;
-   int lowest_after_current_max;
-};
+static inline void id_bitmap_set(struct id_bitmap *b, int id)
+{
+   ASSERT(IN_RANGE_INC(id, 0, b->max_id));
+   b->bits[id / 32] |= (1u << (id % 32));
+}
+
+static inline void id_bitmap_clear(struct id_bitmap *b, int id)
+{
+   ASSERT(IN_RANGE_INC(id, 0, b->max_id));
+   b->bits[id / 32] &= ~(1u << (id % 32));
+}
 
-static inline int inc_candicate_if_matches(int *cand, int id, int val)
+/* Returns the first free id in [start, end) or -1 */
+static int id_bitmap_find_free(struct id_bitmap *b, int start, int end)
 {
-   if (*cand != val)
-      return 0; /* Everything is OK */
+   ASSERT(end <= b->max_id + 1);
 
-   /* The lowest_<something> candicate cannot be > id */
-   ASSERT(*cand <= val);
+   for (int i = start; i < end; i = (i & ~31) + 32) {
 
-   /*
-    * We've found a case where the candicate is equal to current task's pgid/sid
-    * and that might be a problem.
-    *
-    * Two cases:
-    *
-    *    1) Candidate == id. This means: candidate == pgid/sid == id.
-    *       That's fine: we just hit a group/session leader. By default we'll
-    *       skip this candiate (see the impl. below).
-    *
-    *    2) Candidate < id. This means that the pgid/sid is < id and we didn't
-    *       hit it before (note: we're doing an in-order visit). For example:
-    *
-    *    pid | sid | what
-    *    ----+-----+-----------
-    *     1  |  1  | init
-    *     2  |  1  | ash
-    *     8  |  3  | prog1
-    *
-    *    lowest_available = 3   [our candidate]
-    *
-    *    We don't want this to happen because 3 is the ID of a session, with
-    *    a dead leader. In order to handle this case, we have to increment
-    *    lowest_available and restart the whole iteration. We must end up with
-    *    lowest_available = 4. Actually, if lowest_after_current_max is a good
-    *    value, we're going to use it without restarting the iteration.
-    */
+      const u32 free_bits = ~b->bits[i / 32] & (~0u << (i % 32));
 
-   if (*cand == id)
-      return 0; /* We just hit a group/session leader. That's fine */
+      if (free_bits) {
+         const int id = (i & ~31) + __builtin_ctz(free_bits);
+         return id < end ? id : -1;
+      }
+   }
 
-   (*cand)++;
-   return 1;
+   return -1;
 }
 
-static int create_new_pid_visit_cb(void *obj, void *arg)
+/*
+ * Cyclic allocation: the first free id after the last allocated one is
+ * preferred, in order to avoid re-using the same ids over and over again.
+ */
+static int id_bitmap_alloc(struct id_bitmap *b)
 {
-   struct task *ti = obj;
-   struct create_pid_visit_ctx *ctx = arg;
-   const int tid = ti->tid - ctx->id_off;
+   int r = id_bitmap_find_free(b, b->last_id + 1, b->max_id + 1);
 
-   if (ctx->kernel_tid) {
+   if (r < 0)
+      r = id_bitmap_find_free(b, 0, b->last_id + 1);
 
-      if (!is_kernel_thread(ti))
-         return 0; /* skip non-kernel tasks */
+   if (r >= 0)
+      b->last_id = r;
 
-      ASSERT(tid >= 0);
+   return r;
+}
 
+static inline struct proc_group *
+find_proc_group(struct proc_group *root, int id)
+{
+   long lid = id;
+   return bintree_find_ptr(root, lid, struct proc_group, node, id);
+}
 
-   } else {
+/*
+ * An id cannot be re-used as a pid as long as there's a process group or a
+ * session with that id, even if its leader is dead: otherwise, the new process
+ * would accidentally become the leader of that group/session.
+ */
+static void release_pid(int id)
+{
+   if (find_proc_group(pgrps_root, id) || find_proc_group(sessions_root, id))
+      return;
 
-      if (!is_main_thread(ti))
-         return 0; /* skip threads */
+   if (get_task(id))
+      return;
 
-      ASSERT(tid >= 0);
+   id_bitmap_clear(&pids_bitmap, id);
+}
 
-      if (tid < ctx->lowest_available)
-         return 0;
+static struct proc_group *
+create_proc_group(struct proc_group **root_ref, int id, int sid)
+{
+   struct proc_group *g;
 
-      /*
-       * Both ctx->lowest_available and ctx->lowest_after_current_max are
-       * candidates for the next tid. If one of them gets equal to a sid
-       * without a session leader process or to a pgid without a group leader,
-       * the new process could accidentally become leader of a group/session:
-       * we have to ensure that could never happen.
-       */
+   if (!(g = kzalloc_obj(struct proc_group)))
+      return NULL;
 
-      const int pgid = ti->pi->pgid;
-      const int sid = ti->pi->sid;
-      const int should_restart =
-         inc_candicate_if_matches(&ctx->lowest_available, tid, pgid) +
-         inc_candicate_if_matches(&ctx->lowest_available, tid, sid) +
-         inc_candicate_if_matches(&ctx->lowest_after_current_max, tid, pgid) +
-         inc_candicate_if_matches(&ctx->lowest_after_current_max, tid, sid);
+   bintree_node_init(&g->node);
+   list_init(&g->members);
+   g->id = id;
+   g->sid = sid;
 
-      if (should_restart) {
-         ctx->lowest_avail_invalid = true;
-      }
-   }
+   bintree_insert_ptr(root_ref, g, struct proc_group, node, id);
+   id_bitmap_set(&pids_bitmap, id);
+   return g;
+}
 
+static void put_proc_group(struct proc_group **root_ref, struct proc_group *g)
+{
+   const int id = (int)g->id;
 
-   /*
-    * Algorithm: we start with lowest_available (L) == 0. When we hit
-    * tid == L, that means L is not really the lowest, therefore, we guess
-    * the right value of L is L + 1. The first time tid skips one, for example
-    * jumping from 3 to 5, the value of L set by the iteration with tid == 3,
-    * will stuck. That value will be clearly 4.
-    */
+   if (g->count)
+      return;
+
+   bintree_remove_ptr(root_ref, g, struct proc_group, node, id);
+   kfree_obj(g, struct proc_group);
+   release_pid(id);
+}
+
+static void
+proc_group_add(struct proc_group *g, struct list_node *node)
+{
+   list_add_tail(&g->members, node);
+   g->count++;
+}
 
-   if (ctx->lowest_available == tid)
-      ctx->lowest_available++;
+static void
+proc_group_remove(struct proc_group **root_ref,
+                  struct proc_group *g,
+                  struct list_node *node)
+{
+   ASSERT(g->count > 0);
+   list_remove(node);
+   g->count--;
+   put_proc_group(root_ref, g);
+}
+
+static void proc_join_groups(struct process *pi)
+{
+   struct proc_group *g = find_proc_group(pgrps_root, pi->pgid);
+   struct proc_group *s = find_proc_group(sessions_root, pi->sid);
 
    /*
-    * For lowest_after_current_max (A) the logic is similar.
-    * We start with A = current_max_pid + 1. The first time A is == tid, will
-    * be when tid is current_max_pid + 1. We continue to update A, until the
-    * first hole is found. In case tid never reaches current_max_pid + 1, `A`
-    * will be just be current_max_pid + 1, as expected.
+    * Forked processes always join their parent's group and session: only
+    * the first process (init) creates them here, during boot.
     */
 
-   if (ctx->lowest_after_current_max == tid)
-      ctx->lowest_after_current_max++;
+   if (!s && !(s = create_proc_group(&sessions_root, pi->sid, pi->sid)))
+      panic("Unable to create session %d: out of memory", pi->sid);
 
-   return 0;
+   if (!g && !(g = create_proc_group(&pgrps_root, pi->pgid, pi->sid)))
+      panic("Unable to create process group %d: out of memory", pi->pgid);
+
+   proc_group_add(g, &pi->pgrp_node);
+   proc_group_add(s, &pi->session_node);
+   pi->pgrp = g;
+   pi->session = s;
 }
 
-static int
-create_id_common(struct create_pid_visit_ctx *ctx, int max_id)
+static void proc_leave_groups(struct process *pi)
 {
-   int r;
+   proc_group_remove(&pgrps_root, pi->pgrp, &pi->pgrp_node);
+   proc_group_remove(&sessions_root, pi->session, &pi->session_node);
+   pi->pgrp = NULL;
+   pi->session = NULL;
+}
 
-   do {
+int sched_set_proc_groups(struct process *pi, int pgid, int sid)
+{
+   struct proc_group *g, *s;
+   ASSERT(!is_preemption_enabled());
+   ASSERT(pi->pgrp != NULL);
 
-      ctx->lowest_avail_invalid = false;
-      iterate_over_tasks(&create_new_pid_visit_cb, ctx);
+   s = find_proc_group(sessions_root, sid);
+   g = find_proc_group(pgrps_root, pgid);
 
-      r = ctx->lowest_after_current_max <= max_id
-            ? ctx->lowest_after_current_max
-            : ctx->lowest_available <= max_id
-               ? ctx->lowest_available
-               : -1;
+   if (!s && !(s = create_proc_group(&sessions_root, sid, sid)))
+      return -ENOMEM;
 
-      /*
-       * Typically, ctx->lowest_avail_invalid is not a problem because the new
-       * id will be ctx->lowest_after_current_max. But, in the case we've
-       * finished the IDs, we have to pick the absolutely lowest ID available,
-       * which might be invalid we it matched with a process' pgid/sid. This
-       * can happen only in case of orphaned sessions/process groups.
-       *
-       * NOTE: in case we're going to repeat the loop, lowest_avail_invalid is
-       * reset, but all the rest of the context is unchanged: that's because
-       * ctx->lowest_available has actually a meaningful value: the lowest ID
-       * after pgid/sid we hit. It doesn't mean we can use this value, but it
-       * means we cannot pick consider IDs smaller than it.
-       */
+   if (!g && !(g = create_proc_group(&pgrps_root, pgid, sid))) {
+      put_proc_group(&sessions_root, s); /* in case it's a new session */
+      return -ENOMEM;
+   }
 
-   } while (r == ctx->lowest_available && ctx->lowest_avail_invalid);
+   ASSERT(g->sid == sid);
 
-   return r;
+   if (g != pi->pgrp) {
+      proc_group_remove(&pgrps_root, pi->pgrp, &pi->pgrp_node);
+      proc_group_add(g, &pi->pgrp_node);
+      pi->pgrp = g;
+   }
+
+   if (s != pi->session) {
+      proc_group_remove(&sessions_root, pi->session, &pi->session_node);
+      proc_group_add(s, &pi->session_node);
+      pi->session = s;
+   }
+
+   pi->pgid = pgid;
+   pi->sid = sid;
+   return 0;
 }
 
-int create_new_pid(void)
+int sched_count_proc_in_group(int pgid)
 {
-   ASSERT(!is_preemption_enabled());
+   struct proc_group *g;
+   int count;
 
-   struct create_pid_visit_ctx ctx = {
-      .kernel_tid = false,
-      .id_off = 0,
-      .lowest_available = 0,
-      .lowest_after_current_max = current_max_pid + 1,
-   };
+   disable_preemption();
+   {
+      g = find_proc_group(pgrps_root, pgid);
+      count = g ? g->count : 0;
+   }
+   enable_preemption();
+   return count;
+}
 
-   int r = create_id_common(&ctx, MAX_PID);
+int sched_get_session_of_group(int pgid)
+{
+   struct proc_group *g;
+   int sid;
 
-   if (r >= 0)
-      current_max_pid = r;
+   disable_preemption();
+   {
+      g = find_proc_group(pgrps_root, pgid);
+      sid = g ? g->sid : -ESRCH;
+   }
+   enable_preemption();
+   return sid;
+}
 
-   return r;
+int create_new_pid(void)
+{
+   ASSERT(!is_preemption_enabled());
+   return id_bitmap_alloc(&pids_bitmap);
 }
 
 int create_new_kernel_tid(void)
 {
    ASSERT(!is_preemption_enabled());
 
-   struct create_pid_visit_ctx ctx = {
-      .kernel_tid = true,
-      .id_off = KERNEL_TID_START,
-      .lowest_available = 0,
-      .lowest_after_current_max = current_max_kernel_tid + 1,
-   };
+   const int r = id_bitmap_alloc(&kernel_tids_bitmap);
 
-   int r = create_id_common(&ctx, KERNEL_MAX_TID);
-
-   if (r >= 0) {
-      current_max_kernel_tid = r;
-      return r + KERNEL_TID_START;
-   }
-
-   return -1;
+   return r >= 0 ? r + KERNEL_TID_START : -1;
 }
 
 int iterate_over_tasks(bintree_visit_cb func, void *arg)
@@ -404,6 +429,10 @@ static void create_kernel_process(void)
    struct process *s_kernel_pi = (struct process *)(s_kernel_ti + 1);
 
    list_init(&runnable_tasks_list);
+
+   for (int i = 0; i < ARRAY_SIZE(rt_runqueues); i++)
+      list_init(&rt_runqueues[i]);
+
    s_kernel_pi->pid = create_new_pid();
    s_kernel_ti->tid = create_new_kernel_tid();
    s_kernel_pi->ref_count = 1;
@@ -466,6 +495,69 @@ void set_current_task_in_kernel(void)
    get_curr_task()->running_in_kernel = true;
 }
 
+static void rt_runqueue_add(struct task *ti)
+{
+   const int prio = ti->rt_prio;
+
+   list_add_tail(&rt_runqueues[prio], &ti->runnable_node);
+   rt_runqueues_bitmap[prio / 32] |= (1u << (prio % 32));
+   rt_runnable_count++;
+}
+
+static void rt_runqueue_remove(struct task *ti)
+{
+   const int prio = ti->rt_prio;
+
+   list_remove(&ti->runnable_node);
+
+   if (list_is_empty(&rt_runqueues[prio]))
+      rt_runqueues_bitmap[prio / 32] &= ~(1u << (prio % 32));
+
+   rt_runnable_count--;
+   ASSERT(rt_runnable_count >= 0);
+}
+
+/* Get the first (non-stopped) RT task with the highest priority, if any */
+static struct task *rt_runqueue_get_first(void)
+{
+   struct task *pos;
+
+   for (int w = ARRAY_SIZE(rt_runqueues_bitmap) - 1; w >= 0; w--) {
+
+      for (u32 bits = rt_runqueues_bitmap[w]; bits; ) {
+
+         const int bit = 31 - __builtin_clz(bits);
+
+         list_for_each_ro(pos, &rt_runqueues[w * 32 + bit], runnable_node) {
+            if (!pos->stopped)
+               return pos;
+         }
+
+         bits &= ~(1u << bit);
+      }
+   }
+
+   return NULL;
+}
+
+/*
+ * Preempt the current task as soon as possible when a task with a higher
+ * priority becomes runnable. Worker threads can be preempted only by other
+ * worker threads, see wth_wakeup().
+ */
+static void sched_check_preempt_curr(struct task *ti)
+{
+   struct task *curr = get_curr_task();
+
+   if (!curr || ti == curr || is_worker_thread(curr))
+      return;
+
+   if (task_get_eff_prio(ti) < task_get_eff_prio(curr))
+      sched_set_need_resched();
+   else if (rt_throttled && is_rt_task(curr) && !is_rt_task(ti))
+      sched_set_need_resched();
+}
+
 static void task_add_to_state_list(struct task *ti)
 {
    if (is_worker_thread(ti))
@@ -474,8 +566,15 @@ static void task_add_to_state_list(struct task *ti)
    switch (atomic_load_explicit(&ti->state, mo_relaxed)) {
 
       case TASK_STATE_RUNNABLE:
-         list_add_tail(&runnable_tasks_list, &ti->runnable_node);
-         runnable_tasks_count++;
+
+         if (is_rt_task(ti))
+            rt_runqueue_add(ti);
+         else {
+            list_add_tail(&runnable_tasks_list, &ti->runnable_node);
+            runnable_tasks_count++;
+         }
+
+         sched_check_preempt_curr(ti);
          break;
 
       case TASK_STATE_SLEEPING:
@@ -503,6 +602,12 @@ static void task_remove_from_state_list(struct task *ti)
    switch (atomic_load_explicit(&ti->state, mo_relaxed)) {
 
       case TASK_STATE_RUNNABLE:
+
+         if (is_rt_task(ti)) {
+            rt_runqueue_remove(ti);
+            break;
+         }
+
          list_remove(&ti->runnable_node);
          runnable_tasks_count--;
          ASSERT(runnable_tasks_count >= 0);
@@ -552,17 +657,53 @@ void task_change_state_idempotent(struct task *ti, enum task_state new_state)
    enable_interrupts(&var);
 }
 
+void task_set_sched_policy(struct task *ti, int policy, int rt_prio)
+{
+   ulong var;
+   ASSERT(!is_worker_thread(ti));
+   ASSERT(policy == SCHED_OTHER || IN_RANGE_INC(rt_prio, 1, MAX_RT_PRIO));
+
+   disable_interrupts(&var);
+   {
+      task_remove_from_state_list(ti);
+      ti->sched_policy = (u8)policy;
+      ti->rt_prio = policy != SCHED_OTHER ? (u8)rt_prio : 0;
+      task_add_to_state_list(ti);
+   }
+   enable_interrupts(&var);
+
+   /* The current task might not be the one with the highest priority anymore */
+   sched_set_need_resched();
+}
+
 void add_task(struct task *ti)
 {
    disable_preemption();
    {
       task_add_to_state_list(ti);
 
+      if (is_kernel_thread(ti)) {
+         ASSERT(!id_bitmap_test(&kernel_tids_bitmap,
+                                ti->tid - KERNEL_TID_START));
+         id_bitmap_set(&kernel_tids_bitmap, ti->tid - KERNEL_TID_START);
+      }
+
+      if (is_main_thread(ti)) {
+         ASSERT(!id_bitmap_test(&pids_bitmap, ti->pi->pid));
+         id_bitmap_set(&pids_bitmap, ti->pi->pid);
+      }
+
+      if (ti->traced)
+         traced_tasks_count++;
+
       bintree_insert_ptr(&tree_by_tid_root,
                          ti,
                          struct task,
                          tree_by_tid_node,
                          tid);
+
+      if (is_main_thread(ti) && !is_kernel_thread(ti))
+         proc_join_groups(ti->pi);
    }
    enable_preemption();
 }
@@ -574,6 +715,7 @@ void remove_task(struct task *ti)
       ASSERT_TASK_STATE(ti->state, TASK_STATE_ZOMBIE);
 
       task_remove_from_state_list(ti);
+      task_set_pi_boost(ti, SCHED_PRIO_NORMAL, UINT64_MAX);
 
       bintree_remove_ptr(&tree_by_tid_root,
                          ti,
@@ -581,11 +723,52 @@ void remove_task(struct task *ti)
                          tree_by_tid_node,
                          tid);
 
+      if (ti->traced)
+         traced_tasks_count--;
+
+      if (is_kernel_thread(ti)) {
+
+         id_bitmap_clear(&kernel_tids_bitmap, ti->tid - KERNEL_TID_START);
+
+      } else if (is_main_thread(ti)) {
+
+         proc_leave_groups(ti->pi);
+         release_pid(ti->pi->pid);
+      }
+
       free_task(ti);
    }
    enable_preemption();
 }
 
+static void sched_account_rt_ticks(struct task *curr)
+{
+   if (is_rt_task(curr))
+      rt_used_ticks++;
+
+   if (++rt_period_ticks >= RT_PERIOD_TICKS) {
+
+      /* New period: the RT tasks can run again */
+      rt_period_ticks = 0;
+      rt_used_ticks = 0;
+
+      if (rt_throttled) {
+         rt_throttled = false;
+         sched_set_need_resched();
+      }
+
+      return;
+   }
+
+   if (!rt_throttled && rt_used_ticks >= RT_RUNTIME_TICKS) {
+
+      rt_throttled = true;
+
+      if (is_rt_task(curr))
+         sched_set_need_resched();
+   }
+}
+
 void sched_account_ticks(void)
 {
    struct task *curr = get_curr_task();
@@ -626,12 +809,53 @@ void sched_account_ticks(void)
    /*
     * need_resched is never set for worker threads when they used too much
     * CPU time: their timeslice is unlimited and can preempted only be another
-    * worker thread.
+    * worker thread. The same applies to SCHED_FIFO tasks, while SCHED_RR tasks
+    * have their own (longer) timeslice.
     */
-   const bool timeout = !is_worker && t->timeslice >= TIME_SLICE_TICKS;
+   bool timeout = false;
+
+   if (curr->sched_policy == SCHED_RR)
+      timeout = t->timeslice >= RR_TIME_SLICE_TICKS;
+   else if (!is_worker && curr->sched_policy != SCHED_FIFO)
+      timeout = t->timeslice >= TIME_SLICE_TICKS;
 
    if (curr->stopped || !is_running || timeout)
       sched_set_need_resched();
+
+   sched_account_rt_ticks(curr);
+}
+
+int task_get_base_prio(struct task *ti)
+{
+   if (is_worker_thread(ti))
+      return wth_get_priority(ti->worker_thread);
+
+   if (is_rt_task(ti))
+      return SCHED_PRIO_NORMAL - ti->rt_prio;
+
+   return SCHED_PRIO_NORMAL;
+}
+
+int task_get_eff_prio(struct task *ti)
+{
+   return MIN(task_get_base_prio(ti), ti->pi_prio);
+}
+
+u64 task_get_eff_vruntime(struct task *ti)
+{
+   return MIN(ti->ticks.vruntime, ti->pi_vruntime);
+}
+
+void task_set_pi_boost(struct task *ti, int prio, u64 vruntime)
+{
+   const bool was_boosted = ti->pi_prio < SCHED_PRIO_NORMAL;
+   const bool boosted = prio < SCHED_PRIO_NORMAL;
+
+   ASSERT(!is_preemption_enabled());
+
+   ti->pi_prio = prio;
+   ti->pi_vruntime = vruntime;
+   pi_boosted_tasks += (int)boosted - (int)was_boosted;
 }
 
 static bool
@@ -685,15 +909,19 @@ sched_do_select_runnable_task(enum task_state curr_state, bool resched)
          break;
       }
 
-      if (!selected || pos->ticks.vruntime < selected->ticks.vruntime)
+      if (!selected ||
+          task_get_eff_vruntime(pos) < task_get_eff_vruntime(selected))
+      {
          selected = pos;
+      }
    }
 
    /* If there is still no selected task, check for current task */
    if (!selected) {
 
       if (curr_state == TASK_STATE_RUNNING && !curr->stopped)
-         selected = curr;
+         if (!is_rt_task(curr))
+            selected = curr;
    }
 
    if (!resched && selected) {
@@ -706,8 +934,89 @@ sched_do_select_runnable_task(enum task_state curr_state, bool resched)
        */
 
       if (curr_state == TASK_STATE_RUNNING && !curr->stopped)
-         if (curr->ticks.vruntime < selected->ticks.vruntime)
-            selected = curr;
+         if (!is_rt_task(curr))
+            if (task_get_eff_vruntime(curr) < task_get_eff_vruntime(selected))
+               selected = curr;
+   }
+
+   return selected;
+}
+
+/*
+ * Pick the RT task with the highest priority, if it's higher than `selected`'s.
+ * The running RT task keeps the CPU when there are no RT tasks with a higher
+ * priority, unless it yielded or its SCHED_RR timeslice is over: in that case,
+ * the next task with its same priority (if any) will run.
+ */
+static struct task *
+sched_select_rt_task(enum task_state curr_state,
+                     bool resched,
+                     struct task *selected)
+{
+   struct task *curr = get_curr_task();
+   struct task *rt = NULL;
+
+   if (rt_runnable_count > 0)
+      rt = rt_runqueue_get_first();
+
+   if (is_rt_task(curr) && curr_state == TASK_STATE_RUNNING && !curr->stopped)
+   {
+      if (!rt || curr->rt_prio > rt->rt_prio)
+         rt = curr;
+      else if (curr->rt_prio == rt->rt_prio && !resched)
+         rt = curr;
+   }
+
+   if (!rt)
+      return selected;
+
+   if (selected && task_get_eff_prio(selected) <= task_get_eff_prio(rt))
+      return selected;
+
+   return rt;
+}
+
+/*
+ * Regular and RT tasks holding a kmutex wanted by a task with a higher priority
+ * inherit its priority: pick the one with the highest, if it's higher than
+ * `selected`'s.
+ */
+static struct task *
+sched_select_pi_boosted_task(enum task_state curr_state, struct task *selected)
+{
+   struct task *curr = get_curr_task();
+   int best = selected ? task_get_eff_prio(selected) : SCHED_PRIO_NORMAL;
+   struct task *pos;
+
+   if (curr_state == TASK_STATE_RUNNING && !curr->stopped) {
+      if (!is_worker_thread(curr) && curr->pi_prio < best) {
+         selected = curr;
+         best = curr->pi_prio;
+      }
+   }
+
+   list_for_each_ro(pos, &runnable_tasks_list, runnable_node) {
+
+      if (pos->stopped || pos == idle_task)
+         continue;
+
+      if (pos->pi_prio < best) {
+         selected = pos;
+         best = pos->pi_prio;
+      }
+   }
+
+   for (int i = 1; i < ARRAY_SIZE(rt_runqueues) && rt_runnable_count; i++) {
+      list_for_each_ro(pos, &rt_runqueues[i], runnable_node) {
+
+         if (pos->stopped)
+            continue;
+
+         if (pos->pi_prio < best) {
+            selected = pos;
+            best = pos->pi_prio;
+         }
+      }
    }
 
    return selected;
@@ -732,11 +1041,23 @@ void do_schedule(void)
    /* Check for worker threads ready to run */
    selected = wth_get_runnable_thread();
 
+   /* Check for RT tasks, unless they're throttled */
+   if (!rt_throttled)
+      selected = sched_select_rt_task(curr_state, resched, selected);
+
+   /* Check for tasks boosted by priority inheritance */
+   if (UNLIKELY(pi_boosted_tasks > 0))
+      selected = sched_select_pi_boosted_task(curr_state, selected);
+
    /* Check for regular runnable tasks */
    if (!selected) {
 
       selected = sched_do_select_runnable_task(curr_state, resched);
 
+      /* Throttled RT tasks can still run, when there's nothing else to run */
+      if (!selected && rt_throttled)
+         selected = sched_select_rt_task(curr_state, resched, NULL);
+
       if (!selected)
          selected = idle_task; /* fall-back to the idle task */
    }
@@ -804,29 +1125,23 @@ bool in_currently_dying_task(void)
 int send_signal_to_group(int pgid, int sig)
 {
    struct process *curr_pi = get_curr_proc();
-   struct process *leader = NULL;
-   struct bintree_walk_ctx ctx;
-   struct task *ti;
+   struct process *pos, *leader = NULL;
+   struct proc_group *g;
    int count = 0;
 
    disable_preemption();
 
-   bintree_in_order_visit_start(&ctx,
-                                tree_by_tid_root,
-                                struct task,
-                                tree_by_tid_node,
-                                false);
-
-   while ((ti = bintree_in_order_visit_next(&ctx))) {
+   if ((g = find_proc_group(pgrps_root, pgid))) {
 
-      struct process *pi = ti->pi;
+      list_for_each_ro(pos, &g->members, pgrp_node) {
 
-      if (pi->pgid == pgid && pi != curr_pi && pi->pid != 1) {
+         if (pos == curr_pi || pos->pid == 1)
+            continue;
 
-         if (pi->pid != pgid)
-            send_signal(pi->pid, sig, true);
+         if (pos->pid != pgid)
+            send_signal(pos->pid, sig, true);
          else
-            leader = pi;
+            leader = pos;
 
          count++;
       }
@@ -850,29 +1165,23 @@ int send_signal_to_group(int pgid, int sig)
 int send_signal_to_session(int sid, int sig)
 {
    struct process *curr_pi = get_curr_proc();
-   struct process *leader = NULL;
-   struct bintree_walk_ctx ctx;
-   struct task *ti;
+   struct process *pos, *leader = NULL;
+   struct proc_group *s;
    int count = 0;
 
    disable_preemption();
 
-   bintree_in_order_visit_start(&ctx,
-                                tree_by_tid_root,
-                                struct task,
-                                tree_by_tid_node,
-                                false);
-
-   while ((ti = bintree_in_order_visit_next(&ctx))) {
+   if ((s = find_proc_group(sessions_root, sid))) {
 
-      struct process *pi = ti->pi;
+      list_for_each_ro(pos, &s->members, session_node) {
 
-      if (pi->pgid == sid && pi != curr_pi && pi->pid != 1) {
+         if (pos == curr_pi || pos->pid == 1)
+            continue;
 
-         if (pi->pid != sid)
-            send_signal(pi->pid, sig, true);
+         if (pos->pid != sid)
+            send_signal(pos->pid, sig, true);
          else
-            leader = pi;
+            leader = pos;
 
          count++;
       }
@@ -884,7 +1193,7 @@ int send_signal_to_session(int sid, int sig)
    enable_preemption();
 
    /* kill the current process, as _very_ last */
-   if (curr_pi->pgid == sid) {
+   if (curr_pi->sid == sid) {
       send_signal(curr_pi->pid, sig, true);
       count++;
    }
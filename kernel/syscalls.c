@@ -26,39 +26,65 @@
 #define LINUX_REBOOT_CMD_HALT       0xcdef0123
 #define LINUX_REBOOT_CMD_POWER_OFF  0x4321fedc
 
-int sys_madvise(void *addr, size_t len, int advice)
+static bool
+is_valid_sleep_timespec(const struct k_timespec64 *ts)
 {
-   // TODO (future): consider implementing at least part of sys_madvice().
-   return 0;
+   return ts->tv_sec >= 0 && IN_RANGE(ts->tv_nsec, 0, BILLION);
 }
 
 int
 do_nanosleep(const struct k_timespec64 *req, struct k_timespec64 *rem)
 {
-   u64 ticks_to_sleep;
-   u64 exp_wake_up_ticks;
+   u64 rem_ns;
+
+   if (!is_valid_sleep_timespec(req))
+      return -EINVAL;
 
-   ticks_to_sleep = timespec_to_ticks(req);
-   exp_wake_up_ticks = get_ticks() + ticks_to_sleep;
-   kernel_sleep(ticks_to_sleep);
+   /* Huge requests saturate instead of wrapping into short sleeps */
+   rem_ns = kernel_sleep_ns(timer_timespec_to_ns(req));
 
    /* After wake-up */
    rem->tv_sec = 0;
    rem->tv_nsec = 0;
 
    if (pending_signals()) {
-
-      u64 ticks = get_ticks();
-
-      if (ticks < exp_wake_up_ticks)
-         ticks_to_timespec(exp_wake_up_ticks - ticks, rem);
-
+      ns_to_timespec(rem_ns, rem);
       return -EINTR;
    }
 
    return 0;
 }
 
+static int
+do_clock_nanosleep(clockid_t clk_id,
+                   int flags,
+                   const struct k_timespec64 *req,
+                   struct k_timespec64 *rem)
+{
+   struct k_timespec64 now;
+   u64 req_ns, now_ns;
+
+   if (clk_id != CLOCK_REALTIME && clk_id != CLOCK_MONOTONIC)
+      return -EINVAL;
+
+   if (!(flags & TIMER_ABSTIME))
+      return do_nanosleep(req, rem);
+
+   if (!is_valid_sleep_timespec(req))
+      return -EINVAL;
+
+   /* Absolute sleep: `rem` is never touched */
+   do_clock_gettime(clk_id, &now);
+   req_ns = timer_timespec_to_ns(req);
+   now_ns = timespec_to_ns(&now);
+
+   if (req_ns <= now_ns)
+      return 0;
+
+   kernel_sleep_ns(req_ns - now_ns);
+   return pending_signals() ? -EINTR : 0;
+}
+
 int
 sys_nanosleep_time32(const struct k_timespec32 *user_req,
                      struct k_timespec32 *user_rem)
@@ -93,6 +119,65 @@ sys_nanosleep_time32(const struct k_timespec32 *user_req,
    return rc;
 }
 
+int
+sys_clock_nanosleep_time32(clockid_t clk_id,
+                           int flags,
+                           const struct k_timespec32 *user_req,
+                           struct k_timespec32 *user_rem)
+{
+   struct k_timespec32 req32;
+   struct k_timespec64 req;
+   struct k_timespec32 rem32;
+   struct k_timespec64 rem = {0};
+   int rc;
+
+   if (copy_from_user(&req32, user_req, sizeof(req32)))
+      return -EFAULT;
+
+   req = (struct k_timespec64) {
+      .tv_sec = req32.tv_sec,
+      .tv_nsec = req32.tv_nsec,
+   };
+
+   rc = do_clock_nanosleep(clk_id, flags, &req, &rem);
+
+   if (rc == -EINTR && user_rem && !(flags & TIMER_ABSTIME)) {
+
+      rem32 = (struct k_timespec32) {
+         .tv_sec = (s32) rem.tv_sec,
+         .tv_nsec = rem.tv_nsec,
+      };
+
+      if (copy_to_user(user_rem, &rem32, sizeof(rem32)))
+         return -EFAULT;
+   }
+
+   return rc;
+}
+
+int
+sys_clock_nanosleep(clockid_t clk_id,
+                    int flags,
+                    const struct k_timespec64 *user_req,
+                    struct k_timespec64 *user_rem)
+{
+   struct k_timespec64 req;
+   struct k_timespec64 rem = {0};
+   int rc;
+
+   if (copy_from_user(&req, user_req, sizeof(req)))
+      return -EFAULT;
+
+   rc = do_clock_nanosleep(clk_id, flags, &req, &rem);
+
+   if (rc == -EINTR && user_rem && !(flags & TIMER_ABSTIME)) {
+      if (copy_to_user(user_rem, &rem, sizeof(rem)))
+         return -EFAULT;
+   }
+
+   return rc;
+}
+
 int sys_newuname(struct utsname *user_buf)
 {
    struct commit_hash_and_date comm;
@@ -161,6 +246,7 @@ int sys_getrusage(int who, struct k_rusage *user_buf)
    u64 stime_ticks;
    struct k_timespec64 utime;
    struct k_timespec64 stime;
+   struct proc_mem_usage mu;
 
    /*
     * Of course in the syscall entry point
@@ -189,6 +275,12 @@ int sys_getrusage(int who, struct k_rusage *user_buf)
    }
    enable_interrupts_forced();
 
+   disable_preemption();
+   {
+      process_get_mem_usage(curr->pi, &mu);
+   }
+   enable_preemption();
+
    ticks_to_timespec(utime_ticks, &utime);
    ticks_to_timespec(stime_ticks, &stime);
 
@@ -198,11 +290,11 @@ int sys_getrusage(int who, struct k_rusage *user_buf)
       .ru_stime = k_ts64_to_k_timeval(stime),
 
       /* linux extentions */
-      .ru_maxrss = 0,
+      .ru_maxrss = (long)(mu.counters.max_rss * (PAGE_SIZE / KB)),
       .ru_ixrss  = 0,
       .ru_idrss  = 0,
       .ru_isrss  = 0,
-      .ru_minflt = 0,
+      .ru_minflt = (long)mu.counters.minflt,
       .ru_majflt = 0,
       .ru_nswap  = 0,
       .ru_inblock = 0,
@@ -310,6 +402,216 @@ int sys_sched_yield(void)
    return 0;
 }
 
+static int sched_check_policy_prio(int policy, int prio)
+{
+   switch (policy) {
+
+      case SCHED_OTHER:
+         return prio == 0 ? 0 : -EINVAL;
+
+      case SCHED_FIFO:
+      case SCHED_RR:
+         return IN_RANGE_INC(prio, 1, MAX_RT_PRIO) ? 0 : -EINVAL;
+
+      default:
+         return -EINVAL;
+   }
+}
+
+/* NOTE: expects the preemption to be disabled */
+static int sched_get_target_task(int pid, struct task **ti_ref)
+{
+   struct task *ti;
+
+   if (pid < 0)
+      return -EINVAL;
+
+   ti = pid ? get_task(pid) : get_curr_task();
+
+   if (!ti || ti->state == TASK_STATE_ZOMBIE)
+      return -ESRCH;
+
+   *ti_ref = ti;
+   return 0;
+}
+
+static int
+do_sched_setscheduler(int pid,
+                      int policy,
+                      const struct sched_param *u_param,
+                      bool keep_policy)
+{
+   struct sched_param param;
+   struct task *ti;
+   bool reset_on_fork;
+   int rc;
+
+   if (pid < 0 || !u_param)
+      return -EINVAL;
+
+   if (copy_from_user(&param, u_param, sizeof(param)))
+      return -EFAULT;
+
+   disable_preemption();
+
+   if ((rc = sched_get_target_task(pid, &ti)))
+      goto out;
+
+   /*
+    * Kernel threads have a fixed scheduling class: in particular, the idle
+    * task, always runnable, must never end up in the RT runqueue.
+    */
+   if (is_kernel_thread(ti)) {
+      rc = -EPERM;
+      goto out;
+   }
+
+   if (keep_policy) {
+      policy = ti->sched_policy;
+      reset_on_fork = ti->sched_reset_on_fork;
+   } else {
+      reset_on_fork = !!(policy & SCHED_RESET_ON_FORK);
+      policy &= ~SCHED_RESET_ON_FORK;
+   }
+
+   if ((rc = sched_check_policy_prio(policy, param.sched_priority)))
+      goto out;
+
+   ti->sched_reset_on_fork = reset_on_fork;
+   task_set_sched_policy(ti, policy, param.sched_priority);
+
+out:
+   enable_preemption();
+   return rc;
+}
+
+int sys_sched_setscheduler(int pid,
+                           int policy,
+                           const struct sched_param *u_param)
+{
+   return do_sched_setscheduler(pid, policy, u_param, false);
+}
+
+int sys_sched_setparam(int pid, const struct sched_param *u_param)
+{
+   return do_sched_setscheduler(pid, 0, u_param, true);
+}
+
+int sys_sched_getscheduler(int pid)
+{
+   struct task *ti;
+   int rc;
+
+   disable_preemption();
+
+   if (!(rc = sched_get_target_task(pid, &ti))) {
+
+      rc = ti->sched_policy;
+
+      if (ti->sched_reset_on_fork)
+         rc |= SCHED_RESET_ON_FORK;
+   }
+
+   enable_preemption();
+   return rc;
+}
+
+int sys_sched_getparam(int pid, struct sched_param *u_param)
+{
+   struct sched_param param = {0};
+   struct task *ti;
+   int rc;
+
+   if (!u_param)
+      return -EINVAL;
+
+   disable_preemption();
+
+   if (!(rc = sched_get_target_task(pid, &ti)))
+      param.sched_priority = ti->rt_prio;
+
+   enable_preemption();
+
+   if (rc)
+      return rc;
+
+   if (copy_to_user(u_param, &param, sizeof(param)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_sched_get_priority_max(int policy)
+{
+   if (policy == SCHED_FIFO || policy == SCHED_RR)
+      return MAX_RT_PRIO;
+
+   return policy == SCHED_OTHER ? 0 : -EINVAL;
+}
+
+int sys_sched_get_priority_min(int policy)
+{
+   if (policy == SCHED_FIFO || policy == SCHED_RR)
+      return 1;
+
+   return policy == SCHED_OTHER ? 0 : -EINVAL;
+}
+
+static int do_sched_rr_get_interval(int pid, struct k_timespec64 *tp)
+{
+   struct task *ti;
+   u64 ticks = 0;
+   int rc;
+
+   disable_preemption();
+
+   if (!(rc = sched_get_target_task(pid, &ti))) {
+
+      if (ti->sched_policy == SCHED_RR)
+         ticks = RR_TIME_SLICE_TICKS;
+      else if (ti->sched_policy == SCHED_OTHER)
+         ticks = TIME_SLICE_TICKS;
+   }
+
+   enable_preemption();
+
+   if (!rc)
+      ticks_to_timespec(ticks, tp);
+
+   return rc;
+}
+
+int sys_sched_rr_get_interval(int pid, struct k_timespec64 *u_tp)
+{
+   struct k_timespec64 tp;
+   int rc;
+
+   if ((rc = do_sched_rr_get_interval(pid, &tp)))
+      return rc;
+
+   if (copy_to_user(u_tp, &tp, sizeof(tp)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_sched_rr_get_interval_time32(int pid, struct k_timespec32 *u_tp)
+{
+   struct k_timespec64 tp;
+   struct k_timespec32 tp32;
+   int rc;
+
+   if ((rc = do_sched_rr_get_interval(pid, &tp)))
+      return rc;
+
+   tp32 = to_k_timespec32(tp);
+
+   if (copy_to_user(u_tp, &tp32, sizeof(tp32)))
+      return -EFAULT;
+
+   return 0;
+}
+
 int sys_utimes(const char *u_path, const struct k_timeval u_times[2])
 {
    struct k_timeval ts[2];
@@ -5,11 +5,14 @@
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
 #include <tilck/common/atomics.h>
+#include <tilck/common/utils.h>
+#include <tilck/common/string_util.h>
 
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/irq.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/hrtimer.h>
 #include <tilck/kernel/elf_utils.h>
 #include <tilck/kernel/worker_thread.h>
 #include <tilck/kernel/datetime.h>
@@ -31,8 +34,21 @@ u32 slow_timer_irq_handler_count;
 /* Temporary global used by asm_do_bogomips_loop() */
 volatile ATOMIC(u32) __bogo_loops;
 
+/*
+ * Clocksource, used to interpolate the time between two ticks. When the TSC
+ * has been calibrated, it's used instead of the PIT's counter, because reading
+ * it is way cheaper than doing port I/O.
+ */
+#define TSC_SHIFT                                    24
+
+static bool tsc_clocksource;       /* the TSC is the current clocksource  */
+static bool tsc_invariant;         /* CPUID says the TSC is invariant     */
+static u64 tick_tsc;               /* TSC value at the last tick          */
+static u64 tsc_cycles_per_tick;
+static u32 tsc_mult;               /* ns per TSC cycle, fixed-point       */
+static u32 tsc_khz;
+
 /* Static variables */
-static struct list timer_wakeup_list = STATIC_LIST_INIT(timer_wakeup_list);
 static u32 loops_per_tick;         /* Tilck bogoMips as loops/tick    */
 static u32 loops_per_ms = 5000000; /* loops/millisecond (initial val)  */
 static u32 loops_per_us = 5000;    /* loops/microsecond (initial val) */
@@ -50,142 +66,174 @@ u64 get_ticks(void)
    return curr_ticks;
 }
 
-void task_set_wakeup_timer(struct task *ti, u32 ticks)
+/*
+ * Returns the ns elapsed since the last tick, always < __tick_duration.
+ * Must be called with interrupts disabled.
+ */
+u32 timer_get_subtick_ns(void)
 {
-   ulong var;
-   ASSERT(ticks > 0);
+   u64 cyc;
 
-   disable_interrupts(&var);
-   {
-      if (ti->ticks_before_wake_up == 0) {
-         ASSERT(!list_is_node_in_list(&ti->wakeup_timer_node));
-         list_add_tail(&timer_wakeup_list, &ti->wakeup_timer_node);
-      } else {
-         ASSERT(list_is_node_in_list(&ti->wakeup_timer_node));
-      }
+   NO_TEST_ASSERT(!are_interrupts_enabled());
 
-      ti->ticks_before_wake_up = ticks;
-   }
-   enable_interrupts(&var);
+   if (!tsc_clocksource)
+      return hw_timer_get_elapsed_ns();
+
+   cyc = RDTSC() - tick_tsc;
+
+   /* The tick IRQ might be pending: stop at the border */
+   if (cyc >= tsc_cycles_per_tick)
+      return __tick_duration - 1;
+
+   return MIN((u32)((cyc * tsc_mult) >> TSC_SHIFT), __tick_duration - 1);
 }
 
-void task_update_wakeup_timer_if_any(struct task *ti, u32 new_ticks)
+void timer_get_clocksource(struct clocksource_info *nfo)
 {
-   ulong var;
-   ASSERT(new_ticks > 0);
+   if (tsc_clocksource) {
 
-   disable_interrupts(&var);
-   {
-      if (ti->ticks_before_wake_up > 0) {
-         ASSERT(list_is_node_in_list(&ti->wakeup_timer_node));
-         ti->ticks_before_wake_up = new_ticks;
-      }
+      nfo->name = "tsc";
+      nfo->freq_khz = tsc_khz;
+
+   } else {
+
+      nfo->name = "pit";
+      nfo->freq_khz = hw_timer_get_freq_khz();
    }
-   enable_interrupts(&var);
+
+   nfo->res_ns = (u32)MAX(1u, div_round_up64(MILLION, nfo->freq_khz));
 }
 
-u32 task_cancel_wakeup_timer(struct task *ti)
+/*
+ * Called on every tick, with interrupts disabled. Unless the CPU says the TSC
+ * is invariant, check once per second that it didn't slow down (e.g. because
+ * of frequency scaling or deep C-states) and fall back to the PIT in that case.
+ * Using a whole second makes the check immune to the delays of the tick IRQ.
+ */
+static void tsc_clocksource_tick(void)
 {
-   ulong var;
-   u32 old;
-   disable_interrupts(&var);
-   {
-      old = ti->ticks_before_wake_up;
+   static u64 wd_tsc;
+   static u32 wd_ticks;
+   const u64 now = RDTSC();
 
-      if (old > 0) {
-         ti->timer_ready = false;
-         ti->ticks_before_wake_up = 0;
-         list_remove(&ti->wakeup_timer_node);
+   tick_tsc = now;
+
+   if (tsc_invariant || ++wd_ticks < TIMER_HZ)
+      return;
+
+   if (wd_tsc) {
+
+      if (now < wd_tsc || now - wd_tsc < tsc_cycles_per_tick * TIMER_HZ / 2) {
+         tsc_clocksource = false;
+         printk("WARNING: the TSC is unstable, using the PIT as clocksource\n");
       }
    }
-   enable_interrupts(&var);
-   return old;
+
+   wd_tsc = now;
+   wd_ticks = 0;
 }
 
-static void tick_all_timers(void)
+static void tsc_calibrate(u64 cycles, u64 elapsed_ns)
 {
-   struct task *pos, *temp;
-   bool any_woken_up_task = false;
-   ulong var;
+   bool invariant;
+   u64 mult;
 
-   /*
-    * This is *NOT* the best we can do. In particular, it's terrible to keep
-    * the interrupts disabled while iterating the _whole_ timer_wakeup_list.
-    *
-    * Possible better solutions
-    * -----------------------------
-    * 1. Keep the tasks to wake-up in a sort of ordered list and then use
-    * relative timers. This way, at each tick we'll have to decrement just one
-    * single counter. We'll start decrement the next counter only when the first
-    * counter reaches 0 and its list node is removed. Of course, if we cannot
-    * use kmalloc() in case of sleep, it gets much harder to create such an
-    * ordered list and make it live inside a member of struct task. Maybe a BST
-    * will do the job, but that would require paying O(logN) per tick for
-    * finding the earliest timer. Not sure how better would be now for N < 50
-    * (typical), given the huge added constant for the BST functions. Also, the
-    * cancellation of a timer would require some extra effort in order to
-    * re-calculate the relative timer values, while we want the cancellation to
-    * be light-fast because it's run by IRQ handlers.
-    *
-    * 2. Use a fixed number of wakeup lists like: short-term, mid-term and
-    * long-term. Current task's wakeup list node will be placed in one those
-    * lists, depending on far in the future the task is supposted to be woke up.
-    * On every tick, here in tick_all_timers(), ONLY the short-term list will be
-    * iterated. That's a considerable improvement. In a system, there might be
-    * even 1,000 active timers, but how many of them will expire in the next
-    * second? Only a small percentage of them. To further improve the
-    * scalability, it's possible to have even more than 3 lists, or to further
-    * reduce the time-horizon of the short-term list. Periodically, but NOT on
-    * every tick, the `ticks_before_wake_up` field belonging to tasks in the
-    * other wakeup lists will adjusted with bigger decrements and tasks will be
-    * moved from one list to another. That will also happen in case the wakeup
-    * timer is changed for task with an already active timer. This solution
-    * looks much better than solution 1.
-    *
-    * Conclusion
-    * ---------------------
-    * For the moment, given the very limited scale of Tilck (tens of tasks at
-    * most running on the whole system), the current solution is safe and
-    * good-enough but, at some point, a smarter ad-hoc solution should be
-    * devised. Probably solution 2 is the right candidate.
-    */
-   disable_interrupts(&var);
+   if (!hw_has_tsc(&invariant) || !cycles)
+      return;
 
-   list_for_each(pos, temp, &timer_wakeup_list, wakeup_timer_node) {
+   mult = (elapsed_ns << TSC_SHIFT) / cycles;
 
-      /* If task is part of this list, it's counter must be > 0 */
-      ASSERT(pos->ticks_before_wake_up > 0);
+   if (!mult || mult > UINT32_MAX)
+      return;   /* TSC too fast or too slow to be useful */
 
-      if (UNLIKELY(--pos->ticks_before_wake_up == 0)) {
+   tsc_mult = (u32)mult;
+   tsc_khz = (u32)(cycles * MILLION / elapsed_ns);
+   tsc_cycles_per_tick = cycles / MEASURE_BOGOMIPS_TICKS;
+   tsc_invariant = invariant;
+   tick_tsc = 0;        /* the next tick will set it */
+   tsc_clocksource = true;
+}
 
-         pos->timer_ready = true;
-         list_remove(&pos->wakeup_timer_node);
+static void task_wakeup_timer_func(void *arg)
+{
+   struct task *ti = arg;
+   ASSERT(!are_interrupts_enabled());
 
-         if (pos->state == TASK_STATE_SLEEPING) {
-            task_change_state(pos, TASK_STATE_RUNNABLE);
-            any_woken_up_task = true;
-         }
-      }
+   ti->timer_ready = true;
+
+   if (ti->state == TASK_STATE_SLEEPING) {
+      task_change_state(ti, TASK_STATE_RUNNABLE);
+      sched_set_need_resched();
    }
+}
 
-   enable_interrupts(&var);
+void task_init_wakeup_timer(struct task *ti)
+{
+   hrtimer_init(&ti->wakeup_timer, &task_wakeup_timer_func, ti);
+}
 
-   if (any_woken_up_task)
-      sched_set_need_resched();
+static u64 ticks_to_ns(u64 ticks)
+{
+   if (ticks > UINT64_MAX / __tick_duration)
+      return UINT64_MAX;
+
+   return ticks * __tick_duration;
 }
 
-static void do_sleep_internal(u32 ticks)
+void task_set_wakeup_timer_ns(struct task *ti, u64 ns)
 {
-   ASSERT(are_interrupts_enabled());
+   ASSERT(ns > 0);
+   hrtimer_start(&ti->wakeup_timer, hrtimer_now() + MIN(ns, UINT64_MAX / 2));
+}
 
-   disable_preemption();
-   task_change_state(get_curr_task(), TASK_STATE_SLEEPING);
-   task_set_wakeup_timer(get_curr_task(), ticks);
-   kernel_yield_preempt_disabled();
+void task_set_wakeup_timer(struct task *ti, u32 ticks)
+{
+   ASSERT(ticks > 0);
+   task_set_wakeup_timer_ns(ti, ticks_to_ns(ticks));
 }
 
-void kernel_sleep(u64 ticks)
+void task_update_wakeup_timer_if_any(struct task *ti, u32 new_ticks)
+{
+   ulong var;
+   ASSERT(new_ticks > 0);
+
+   disable_interrupts(&var);
+   {
+      if (ti->wakeup_timer.active)
+         task_set_wakeup_timer(ti, new_ticks);
+   }
+   enable_interrupts(&var);
+}
+
+/*
+ * Cancel the wakeup timer of `ti`, returning the ns left before its expiration
+ * or 0 if the timer was not active. A timer that expired, but whose callback
+ * has not run yet, is still considered active (1 ns left).
+ */
+u64 task_cancel_wakeup_timer_ns(struct task *ti)
 {
+   ulong var;
+   u64 rem;
+
+   disable_interrupts(&var);
+   {
+      if ((rem = hrtimer_cancel(&ti->wakeup_timer)))
+         ti->timer_ready = false;
+   }
+   enable_interrupts(&var);
+   return rem;
+}
+
+u32 task_cancel_wakeup_timer(struct task *ti)
+{
+   const u64 rem = task_cancel_wakeup_timer_ns(ti);
+   return rem ? (u32)MIN(div_round_up64(rem, __tick_duration), UINT32_MAX) : 0;
+}
+
+u64 kernel_sleep_ns(u64 ns)
+{
+   struct task *curr = get_curr_task();
+
    if (in_panic()) {
 
       /*
@@ -196,82 +244,193 @@ void kernel_sleep(u64 ticks)
        * immediately. All the code after panic(), run under special conditions
        * where every hack is allowed :-)
        */
-      return;
+      return 0;
    }
 
    DEBUG_ONLY(check_not_in_irq_handler());
 
+   if (!ns) {
+      kernel_yield();
+      return 0;
+   }
+
+   ASSERT(are_interrupts_enabled());
+
+   disable_preemption();
+   task_change_state(curr, TASK_STATE_SLEEPING);
+   task_set_wakeup_timer_ns(curr, ns);
+   kernel_yield_preempt_disabled();
+
    /*
-    * Implementation: why
-    * ---------------------
-    *
-    * In theory, the function could be implemented just as:
-    *
-    *    if (ticks) {
-    *       task_set_wakeup_timer(get_curr_task(), ticks);
-    *       task_change_state(get_curr_task(), TASK_STATE_SLEEPING);
-    *    }
-    *    kernel_yield();
-    *
-    * But that would require task->ticks_before_wake_up to be actually 64-bit,
-    * wide and that's bad on 32-bit systems because:
-    *
-    *    - it would require using the soft 64-bit integers (slow)
-    *    - it would make impossible, in the case we wanted that, the counter
-    *      to be atomic.
-    *
-    * Therefore, in order to use a 32-bit value for 'ticks_before_wake_up' and,
-    * at the same time being able to sleep for more than 2^32-1 ticks, we need
-    * a more tricky implementation (below), and the little extra runtime price
-    * for it is totally fine, since we're going to sleep anyways!
-    *
-    * Implementation: how
-    * ----------------------
-    *
-    * The simpler way to explain the algorithm is to just assume everything
-    * is in base 10 and that ticks_before_wake_up has 2 digits, while we want
-    * to support 4 digits sleep time. For example, we want to sleep for 234
-    * ticks. The algorithm first computes 534 % 100 = 34 and then 534 / 100 = 5.
-    * After that, it sleeps q (= 5) times for 99 ticks (max allowed). Clearly,
-    * we missed 5 ticks (5 * 99 < 500) this way, but we'll going to fix that
-    * buy just sleeping 'q' ticks. Thus, by now, we've slept for 500 ticks.
-    * Now we have to sleep for 34 ticks more are we're done.
-    *
-    * The same logic applies to base-2 case with 32-bit and 64-bit integers,
-    * just the numbers are much bigger. The remainder can be computed using
-    * a bitmask, while the division by using just a right shift.
+    * We might have been woken up by a signal, before the timer expired: in that
+    * case, the timer has to be cancelled, in order to not wake us up later.
     */
+   return task_cancel_wakeup_timer_ns(curr);
+}
+
+void kernel_sleep(u64 ticks)
+{
+   kernel_sleep_ns(ticks_to_ns(ticks));
+}
 
-   const u32 rem = ticks & 0xffffffff;
-   const u32 q = ticks >> 32;
+void kernel_sleep_ms(u64 ms)
+{
+   kernel_sleep_ns(MAX(1u, ms) * MILLION);
+}
+
+static void ktimer_notify_job(void *arg)
+{
+   struct ktimer *t = arg;
+   bool dying;
+   ulong var;
 
-   if (q) {
+   while (true) {
 
-      for (u32 i = 0; i < q; i++) {
+      disable_interrupts(&var);
+
+      if (t->dying || !t->notify_pending)
+         break;
+
+      t->notify_pending = false;
+      enable_interrupts(&var);
+      t->notify(t);
+   }
+
+   /* Interrupts are still disabled here */
+   dying = t->dying;
+   t->job_pending = false;
+   enable_interrupts(&var);
+
+   if (dying)
+      t->destroy(t);
+}
+
+static void ktimer_func(void *arg)
+{
+   struct ktimer *t = arg;
+   u64 now, missed = 0;
+
+   ASSERT(!are_interrupts_enabled());
+
+   if (t->notify_retry) {
+
+      /* Not a real expiration: just retry to enqueue the notify job */
+      t->notify_retry = false;
+
+   } else {
+
+      t->expirations++;
+   }
+
+   if (t->interval) {
+
+      now = hrtimer_now();
+
+      /* We might have been late by more than one period: count the overruns */
+      if (now >= t->hrt.expires + t->interval)
+         missed = (now - t->hrt.expires) / t->interval;
+
+      t->expirations += missed;
+      hrtimer_start(&t->hrt, t->hrt.expires + (missed + 1) * t->interval);
+   }
 
-         do_sleep_internal(0xffffffff);
+   t->notify_pending = true;
 
-         if (pending_signals())
-            return;
+   if (!t->job_pending) {
+
+      t->job_pending =
+         wth_enqueue_anywhere(WTH_PRIO_HIGHEST, &ktimer_notify_job, t);
+
+      /*
+       * In the unlikely case the worker queue is full, periodic timers retry
+       * on their next expiration. One-shot timers don't have one: re-arm them
+       * just to retry the notification, otherwise it would be lost.
+       */
+      if (!t->job_pending && !t->interval) {
+         t->notify_retry = true;
+         hrtimer_start_rel(&t->hrt, KTIMER_MIN_INTERVAL_NS);
       }
+   }
+}
+
+void ktimer_init(struct ktimer *t,
+                 void (*notify)(struct ktimer *),
+                 void (*destroy)(struct ktimer *))
+{
+   bzero(t, sizeof(*t));
+   hrtimer_init(&t->hrt, &ktimer_func, t);
+   t->notify = notify;
+   t->destroy = destroy;
+}
+
+void ktimer_set(struct ktimer *t, u64 delta, u64 interval)
+{
+   ulong var;
 
-      do_sleep_internal(q);
+   if (interval)
+      interval = MAX(interval, (u64)KTIMER_MIN_INTERVAL_NS);
 
-      if (pending_signals())
-         return;
+   disable_interrupts(&var);
+   {
+      hrtimer_cancel(&t->hrt);
+      t->interval = interval;
+      t->expirations = 0;
+      t->notify_retry = false;
+
+      if (delta)
+         hrtimer_start_rel(&t->hrt, MIN(delta, UINT64_MAX / 2));
    }
+   enable_interrupts(&var);
+}
+
+void ktimer_get(struct ktimer *t, u64 *rem, u64 *interval)
+{
+   ulong var;
+   u64 now;
+
+   disable_interrupts(&var);
+   {
+      *rem = 0;
+      *interval = t->interval;
 
-   if (rem) {
-      do_sleep_internal(rem);
+      if (t->hrt.active && !t->notify_retry) {
+         now = hrtimer_now();
+         *rem = t->hrt.expires > now ? t->hrt.expires - now : 1;
+      }
    }
+   enable_interrupts(&var);
+}
 
-   if (!q && !rem)
-      kernel_yield();
+u64 ktimer_consume(struct ktimer *t)
+{
+   ulong var;
+   u64 ret;
+
+   disable_interrupts(&var);
+   {
+      ret = t->expirations;
+      t->expirations = 0;
+   }
+   enable_interrupts(&var);
+   return ret;
 }
 
-void kernel_sleep_ms(u64 ms)
+void ktimer_release(struct ktimer *t)
 {
-   kernel_sleep(MAX(1u, ms_to_ticks(ms)));
+   bool job_pending;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      hrtimer_cancel(&t->hrt);
+      t->dying = true;
+      job_pending = t->job_pending;
+   }
+   enable_interrupts(&var);
+
+   /* Otherwise, the pending job will destroy the timer */
+   if (!job_pending)
+      t->destroy(t);
 }
 
 static ALWAYS_INLINE bool timer_nested_irq(void)
@@ -331,11 +490,14 @@ static enum irq_action timer_irq_handler(void *ctx)
        */
       __ticks++;
       __time_ns += ns_delta;
+
+      if (tsc_clocksource)
+         tsc_clocksource_tick();
    }
    enable_interrupts_forced();
 
    sched_account_ticks();
-   tick_all_timers();
+   hrtimer_run_expired();
    return IRQ_HANDLED;
 }
 
@@ -348,6 +510,7 @@ struct bogo_measure_ctx {
    bool started;
    bool pass_start;
    u32 ticks;
+   u64 start_tsc;
 };
 
 static enum irq_action measure_bogomips_irq_handler(void *arg)
@@ -370,6 +533,8 @@ static enum irq_action measure_bogomips_irq_handler(void *arg)
        */
       __bogo_loops = 0;
       ctx->pass_start = true;
+      ctx->start_tsc = RDTSC();
+      hw_hrtimer_calib_start();
       return IRQ_NOT_HANDLED;
    }
 
@@ -379,12 +544,18 @@ static enum irq_action measure_bogomips_irq_handler(void *arg)
       /* We're done */
       irq_uninstall_handler(X86_PC_TIMER_IRQ, &measure_bogomips);
 
+      const u64 elapsed_ns = (u64)MEASURE_BOGOMIPS_TICKS * __tick_duration;
+      const u64 tsc_cycles = RDTSC() - ctx->start_tsc;
+
+      hrtimer_set_event_dev(hw_hrtimer_calib_end(elapsed_ns));
+
       disable_interrupts_forced();
       {
          loops_per_tick = __bogo_loops * BOGOMIPS_CONST/MEASURE_BOGOMIPS_TICKS;
          loops_per_ms = loops_per_tick / (1000 / TIMER_HZ);
          loops_per_us = loops_per_ms / 1000;
          __bogo_loops = -1;
+         tsc_calibrate(tsc_cycles, elapsed_ns);
       }
       enable_interrupts_forced();
    }
@@ -405,6 +576,10 @@ static void do_bogomips_loop(void *arg)
    }
    enable_preemption();
    printk("Tilck bogoMips: %u.%03u\n", loops_per_us, loops_per_ms % 1000);
+
+   if (tsc_clocksource)
+      printk("Clocksource: tsc at %u kHz%s\n",
+             tsc_khz, tsc_invariant ? " (invariant)" : "");
 }
 
 void delay_us(u32 us)
@@ -0,0 +1,294 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/fs/vfs.h>
+#include <tilck/kernel/fs/kernelfs.h>
+#include <tilck/kernel/errno.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/user.h>
+#include <tilck/kernel/timer.h>
+#include <tilck/kernel/timerfd.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/syscalls.h>
+
+struct timerfd {
+
+   KOBJ_BASE_FIELDS
+
+   struct ktimer kt;
+   struct kmutex mutex;
+   struct kcond cond;
+   clockid_t clk_id;
+};
+
+static ssize_t timerfd_read(fs_handle h, char *buf, size_t size, offt *pos)
+{
+   struct kfs_handle *kh = h;
+   struct timerfd *tfd = (void *)kh->kobj;
+   bool sig_pending = false;
+   ssize_t rc = 0;
+   u64 cnt;
+
+   if (size < sizeof(u64))
+      return -EINVAL;
+
+   kmutex_lock(&tfd->mutex);
+
+   while (true) {
+
+      if ((cnt = ktimer_consume(&tfd->kt))) {
+         memcpy(buf, &cnt, sizeof(cnt));
+         rc = sizeof(cnt);
+         break;
+      }
+
+      if (kh->fl_flags & O_NONBLOCK) {
+         rc = -EAGAIN;
+         break;
+      }
+
+      /* Wait for the timer to expire */
+      kcond_wait(&tfd->cond, &tfd->mutex, KCOND_WAIT_FOREVER);
+
+      /* After wake up */
+      if (pending_signals()) {
+         sig_pending = true;
+         break;
+      }
+   }
+
+   kmutex_unlock(&tfd->mutex);
+   return !sig_pending ? rc : -EINTR;
+}
+
+static int timerfd_read_ready(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct timerfd *tfd = (void *)kh->kobj;
+   ulong var;
+   bool ret;
+
+   disable_interrupts(&var);
+   {
+      ret = tfd->kt.expirations != 0;
+   }
+   enable_interrupts(&var);
+   return ret;
+}
+
+static struct kcond *timerfd_get_rready_cond(fs_handle h)
+{
+   struct kfs_handle *kh = h;
+   struct timerfd *tfd = (void *)kh->kobj;
+   return &tfd->cond;
+}
+
+static const struct file_ops static_ops_timerfd =
+{
+   .read = timerfd_read,
+   .read_ready = timerfd_read_ready,
+   .get_rready_cond = timerfd_get_rready_cond,
+};
+
+/* Called by a worker thread, after each expiration of the timer */
+static void timerfd_notify(struct ktimer *kt)
+{
+   struct timerfd *tfd = CONTAINER_OF(kt, struct timerfd, kt);
+
+   kmutex_lock(&tfd->mutex);
+   {
+      kcond_signal_all(&tfd->cond);
+   }
+   kmutex_unlock(&tfd->mutex);
+}
+
+static void timerfd_free(struct ktimer *kt)
+{
+   struct timerfd *tfd = CONTAINER_OF(kt, struct timerfd, kt);
+
+   kcond_destory(&tfd->cond);
+   kmutex_destroy(&tfd->mutex);
+   kfree_obj(tfd, struct timerfd);
+}
+
+static void destroy_timerfd(struct timerfd *tfd)
+{
+   /* The object will be freed by timerfd_free(), maybe later */
+   ktimer_release(&tfd->kt);
+}
+
+fs_handle timerfd_create_handle(clockid_t clk_id, int fl_flags)
+{
+   struct timerfd *tfd;
+   fs_handle res;
+
+   if (!(tfd = (void *)kzalloc_obj(struct timerfd)))
+      return NULL;
+
+   tfd->destory_obj = (void *)&destroy_timerfd;
+   tfd->clk_id = clk_id;
+   ktimer_init(&tfd->kt, &timerfd_notify, &timerfd_free);
+   kmutex_init(&tfd->mutex, 0);
+   kcond_init(&tfd->cond);
+
+   res = kfs_create_new_handle(&static_ops_timerfd, (void *)tfd, fl_flags);
+
+   if (!res)
+      timerfd_free(&tfd->kt);
+
+   return res;
+}
+
+static struct timerfd *get_timerfd(int fd, int *rc)
+{
+   struct kfs_handle *kh = get_fs_handle(fd);
+
+   if (!kh) {
+      *rc = -EBADF;
+      return NULL;
+   }
+
+   if (kh->fops != &static_ops_timerfd) {
+      *rc = -EINVAL;
+      return NULL;
+   }
+
+   *rc = 0;
+   return (void *)kh->kobj;
+}
+
+static int
+do_timerfd_settime(int fd,
+                   int flags,
+                   const struct k_itimerspec64 *new_val,
+                   struct k_itimerspec64 *old_val)
+{
+   struct timerfd *tfd;
+   u64 delta, interval, old_rem, old_interval;
+   int rc;
+
+   if (!(tfd = get_timerfd(fd, &rc)))
+      return rc;
+
+   /*
+    * TFD_TIMER_CANCEL_ON_SET is not supported: Tilck has no clock_settime()
+    * and the real time clock never jumps, but silently ignoring the flag would
+    * make callers believe that they'll get -ECANCELED on clock changes.
+    */
+   if (flags & ~TFD_TIMER_ABSTIME)
+      return -EINVAL;
+
+   rc = itimerspec_to_ns(tfd->clk_id,
+                         !!(flags & TFD_TIMER_ABSTIME),
+                         new_val,
+                         &delta,
+                         &interval);
+
+   if (rc)
+      return rc;
+
+   kmutex_lock(&tfd->mutex);
+   {
+      ktimer_get(&tfd->kt, &old_rem, &old_interval);
+      ktimer_set(&tfd->kt, delta, interval);
+   }
+   kmutex_unlock(&tfd->mutex);
+
+   ns_to_itimerspec(old_rem, old_interval, old_val);
+   return 0;
+}
+
+static int do_timerfd_gettime(int fd, struct k_itimerspec64 *curr)
+{
+   struct timerfd *tfd;
+   u64 rem, interval;
+   int rc;
+
+   if (!(tfd = get_timerfd(fd, &rc)))
+      return rc;
+
+   ktimer_get(&tfd->kt, &rem, &interval);
+   ns_to_itimerspec(rem, interval, curr);
+   return 0;
+}
+
+int sys_timerfd_settime(int fd,
+                        int flags,
+                        const struct k_itimerspec64 *u_new,
+                        struct k_itimerspec64 *u_old)
+{
+   struct k_itimerspec64 new_val, old_val;
+   int rc;
+
+   if (copy_from_user(&new_val, u_new, sizeof(new_val)))
+      return -EFAULT;
+
+   if ((rc = do_timerfd_settime(fd, flags, &new_val, &old_val)))
+      return rc;
+
+   if (u_old && copy_to_user(u_old, &old_val, sizeof(old_val)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timerfd_settime32(int fd,
+                          int flags,
+                          const struct k_itimerspec32 *u_new,
+                          struct k_itimerspec32 *u_old)
+{
+   struct k_itimerspec32 new32, old32;
+   struct k_itimerspec64 new_val, old_val;
+   int rc;
+
+   if (copy_from_user(&new32, u_new, sizeof(new32)))
+      return -EFAULT;
+
+   new_val = from_k_itimerspec32(new32);
+
+   if ((rc = do_timerfd_settime(fd, flags, &new_val, &old_val)))
+      return rc;
+
+   old32 = to_k_itimerspec32(old_val);
+
+   if (u_old && copy_to_user(u_old, &old32, sizeof(old32)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timerfd_gettime(int fd, struct k_itimerspec64 *u_curr)
+{
+   struct k_itimerspec64 curr;
+   int rc;
+
+   if ((rc = do_timerfd_gettime(fd, &curr)))
+      return rc;
+
+   if (copy_to_user(u_curr, &curr, sizeof(curr)))
+      return -EFAULT;
+
+   return 0;
+}
+
+int sys_timerfd_gettime32(int fd, struct k_itimerspec32 *u_curr)
+{
+   struct k_itimerspec32 curr32;
+   struct k_itimerspec64 curr;
+   int rc;
+
+   if ((rc = do_timerfd_gettime(fd, &curr)))
+      return rc;
+
+   curr32 = to_k_itimerspec32(curr);
+
+   if (copy_to_user(u_curr, &curr32, sizeof(curr32)))
+      return -EFAULT;
+
+   return 0;
+}
@@ -278,6 +278,68 @@ void tty_send_keyevent(struct tty *t, struct key_event ke, bool block)
    return;
 }
 
+/*
+ * True when no input byte can have any special meaning: no line discipline,
+ * no signal or flow-control chars, no input translation and no echo.
+ */
+static bool tty_input_is_transparent(struct tty *t)
+{
+   const struct termios *const c_term = &t->c_term;
+   const tcflag_t echo_fl = t->serial_port_fwd ? 0 : (ECHO | ECHONL);
+
+   if (c_term->c_lflag & (ICANON | ISIG | IEXTEN | echo_fl))
+      return false;
+
+   if (c_term->c_iflag & (IGNCR | ICRNL | INLCR | IXON))
+      return false;
+
+   return true;
+}
+
+static void
+tty_inbuf_write_bulk(struct tty *t, const char *buf, size_t len, bool block)
+{
+   ASSERT(in_panic() || !block || is_preemption_enabled());
+   size_t n;
+
+   while (true) {
+
+      disable_preemption();
+      {
+         n = ringbuf_write_bytes(&t->input_ringbuf, (u8 *)buf, len);
+      }
+      enable_preemption();
+
+      buf += n;
+      len -= n;
+
+      if (!len || !block)
+         break; /* Done or, if we cannot block, discard the rest */
+
+      /* Our buffer is full: wake up the readers and wait for them */
+      kcond_signal_all(&t->input_cond);
+      kcond_wait(&t->output_cond, NULL, TIME_SLICE_TICKS);
+   }
+
+   kcond_signal_one(&t->input_cond);
+}
+
+/*
+ * Send a whole buffer of input bytes to the tty, as if they were typed. When
+ * the tty is in raw mode without echo (e.g. a serial line used for a file
+ * transfer), the bytes are copied in bulk to the input buffer.
+ */
+void tty_send_input(struct tty *t, const char *buf, size_t len, bool block)
+{
+   if (tty_input_is_transparent(t)) {
+      tty_inbuf_write_bulk(t, buf, len, block);
+      return;
+   }
+
+   for (size_t i = 0; i < len; i++)
+      tty_send_keyevent(t, make_key_event(0, buf[i], true), block);
+}
+
 static int
 tty_keypress_handler_int(struct tty *t,
                          struct kb_dev *kb,
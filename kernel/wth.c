@@ -9,6 +9,7 @@
 #include <tilck/kernel/sync.h>
 #include <tilck/kernel/sched.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/hrtimer.h>
 #include <tilck/kernel/errno.h>
 #include <tilck/kernel/interrupts.h>
 #include <tilck/kernel/debug_utils.h>
@@ -40,6 +41,170 @@ wth_get_name(struct worker_thread *wth)
    return wth->name;
 }
 
+struct worker_thread *
+wth_get_by_index(int idx)
+{
+   if (idx < 0 || idx >= worker_threads_cnt)
+      return NULL;
+
+   return worker_threads[idx];
+}
+
+void
+wth_get_stats(struct worker_thread *wth, struct wth_stats *s)
+{
+   ulong var;
+   disable_interrupts(&var);
+   {
+      *s = wth->stats;
+   }
+   enable_interrupts(&var);
+}
+
+static void wth_refill_spare_nodes(struct worker_thread *t)
+{
+   struct wjob_node *n;
+   ulong var;
+
+   while (t->spare_cnt < t->spare_target) {
+
+      if (!(n = kalloc_obj(struct wjob_node)))
+         break;
+
+      list_node_init(&n->node);
+
+      disable_interrupts(&var);
+      {
+         list_add_tail(&t->spare_nodes, &n->node);
+         t->spare_cnt++;
+      }
+      enable_interrupts(&var);
+   }
+}
+
+void wth_free_spare_nodes(struct worker_thread *t)
+{
+   struct wjob_node *pos, *temp;
+
+   list_for_each(pos, temp, &t->spare_nodes, node) {
+      list_remove(&pos->node);
+      kfree_obj(pos, struct wjob_node);
+   }
+
+   t->spare_cnt = 0;
+}
+
+static void wth_release_node(struct worker_thread *t, struct wjob_node *n)
+{
+   bool keep;
+   ulong var;
+
+   disable_interrupts(&var);
+   {
+      if ((keep = t->spare_cnt < t->spare_target)) {
+         list_add_tail(&t->spare_nodes, &n->node);
+         t->spare_cnt++;
+      }
+   }
+   enable_interrupts(&var);
+
+   if (!keep)
+      kfree_obj(n, struct wjob_node);
+}
+
+/*
+ * Slow path of wth_enqueue_on(): the ring buffer is full or there are already
+ * jobs in the overflow list (which must be consumed first, in order to keep
+ * the FIFO order).
+ */
+static bool wth_enqueue_overflow(struct worker_thread *t, struct wjob *job)
+{
+   struct wjob_node *n = NULL;
+   bool full;
+   ulong var;
+
+   if (t->overflow_cnt >= WTH_MAX_OVERFLOW_JOBS)
+      return false;
+
+   if (!in_irq())
+      n = kalloc_obj(struct wjob_node);
+
+   disable_interrupts(&var);
+   {
+      /* Re-check: an IRQ might have added jobs in the meanwhile */
+      if ((full = t->overflow_cnt >= WTH_MAX_OVERFLOW_JOBS))
+         goto out;
+
+      if (!n && !list_is_empty(&t->spare_nodes)) {
+         n = list_first_obj(&t->spare_nodes, struct wjob_node, node);
+         list_remove(&n->node);
+         t->spare_cnt--;
+      }
+
+      if (n) {
+
+         n->job = *job;
+         list_add_tail(&t->overflow, &n->node);
+         t->overflow_cnt++;
+         t->stats.overflowed++;
+
+      } else {
+
+         /* Not enough spare nodes: have more of them, next time */
+         t->spare_target = MIN(2 * t->spare_target, (u32)WTH_MAX_SPARE_NODES);
+      }
+   }
+out:
+   enable_interrupts(&var);
+
+   if (full) {
+
+      if (n)
+         kfree_obj(n, struct wjob_node);
+
+      return false;
+   }
+
+   return n != NULL;
+}
+
+static bool wth_dequeue_job(struct worker_thread *t, struct wjob *job)
+{
+   struct wjob_node *n = NULL;
+   ulong var;
+
+   /*
+    * The jobs in the ring buffer always come before the ones in the overflow
+    * list, because new jobs go to the overflow list until it's empty.
+    */
+   if (!safe_ringbuf_read_elem(&t->rb, job)) {
+
+      disable_interrupts(&var);
+      {
+         if (!list_is_empty(&t->overflow)) {
+            n = list_first_obj(&t->overflow, struct wjob_node, node);
+            list_remove(&n->node);
+            t->overflow_cnt--;
+         }
+      }
+      enable_interrupts(&var);
+
+      if (!n)
+         return false;
+
+      *job = n->job;
+      wth_release_node(t, n);
+   }
+
+   atomic_fetch_sub_explicit(&t->depth, 1, mo_relaxed);
+   return true;
+}
+
+static bool wth_has_jobs(struct worker_thread *t)
+{
+   return atomic_load_explicit(&t->depth, mo_relaxed) > 0;
+}
+
 static long wth_cmp_func(const void *a, const void *b)
 {
    const struct worker_thread *const *wa = a;
@@ -56,7 +221,9 @@ wth_enqueue_on(struct worker_thread *t, void (*func)(void *), void *arg)
    struct wjob new_job = {
       .func = func,
       .arg = arg,
+      .enqueue_time = hrtimer_now(),
    };
+   u32 depth;
 
    disable_preemption();
 
@@ -79,10 +246,25 @@ wth_enqueue_on(struct worker_thread *t, void (*func)(void *), void *arg)
 
 #endif
 
-   success = safe_ringbuf_write_elem(&t->rb, &new_job, &was_empty);
+   success = false;
+
+   if (LIKELY(list_is_empty(&t->overflow)))
+      success = safe_ringbuf_write_elem(&t->rb, &new_job, &was_empty);
+
+   if (!success)
+      success = wth_enqueue_overflow(t, &new_job);
+
+   if (success) {
+
+      depth = atomic_fetch_add_explicit(&t->depth, 1, mo_relaxed) + 1;
+      t->stats.max_depth = MAX(t->stats.max_depth, depth);
+
+      if (t->waiting_for_jobs)
+         wth_wakeup(t);
 
-   if (success && was_empty && t->waiting_for_jobs) {
-      wth_wakeup(t);
+   } else {
+
+      t->stats.dropped++;
    }
 
    enable_preemption();
@@ -136,25 +318,63 @@ wth_find_worker(int lowest_prio)
    return worker_threads[0];
 }
 
+static void wth_run_job(struct worker_thread *t, struct wjob *job)
+{
+   struct wth_stats *s = &t->stats;
+   const u64 start = hrtimer_now();
+   u64 end, latency, run;
+
+   /* Run the job with preemption enabled */
+   job->func(job->arg);
+
+   end = hrtimer_now();
+   latency = start - job->enqueue_time;
+   run = end - start;
+
+   disable_preemption();
+   {
+      s->jobs++;
+      s->tot_latency_ns += latency;
+      s->max_latency_ns = MAX(s->max_latency_ns, latency);
+      s->tot_run_ns += run;
+      s->max_run_ns = MAX(s->max_run_ns, run);
+   }
+   enable_preemption();
+}
+
 bool wth_process_single_job(struct worker_thread *t)
 {
-   bool success;
    struct wjob job_to_run;
 
-   success = safe_ringbuf_read_elem(&t->rb, &job_to_run);
+   if (!wth_dequeue_job(t, &job_to_run))
+      return false;
 
-   if (success) {
-      /* Run the job with preemption enabled */
-      job_to_run.func(job_to_run.arg);
-   }
+   wth_run_job(t, &job_to_run);
+   return true;
+}
 
-   return success;
+/*
+ * Dequeue up to WTH_JOBS_BATCH jobs at once and then run them: this frees the
+ * slots in the ring buffer as soon as possible, making room for bursts.
+ */
+int wth_process_jobs_batch(struct worker_thread *t)
+{
+   struct wjob batch[WTH_JOBS_BATCH];
+   int n = 0;
+
+   while (n < WTH_JOBS_BATCH && wth_dequeue_job(t, &batch[n]))
+      n++;
+
+   for (int i = 0; i < n; i++)
+      wth_run_job(t, &batch[i]);
+
+   return n;
 }
 
 void wth_run(void *arg)
 {
    struct worker_thread *t = arg;
-   bool job_run;
+   int jobs_run;
 
    ASSERT(t != NULL);
    DEBUG_SAVE_ESP()                    /* see debug_utils.h */
@@ -166,13 +386,16 @@ void wth_run(void *arg)
 
       do {
 
-         job_run = wth_process_single_job(t);
+         jobs_run = wth_process_jobs_batch(t);
 
-      } while (job_run);
+      } while (jobs_run > 0);
+
+      /* Prepare for the next burst, while we're idle */
+      wth_refill_spare_nodes(t);
 
       disable_interrupts_forced();
       {
-         if (safe_ringbuf_is_empty(&t->rb)) {
+         if (!wth_has_jobs(t)) {
             t->task->state = TASK_STATE_SLEEPING;
             t->waiting_for_jobs = true;
          }
@@ -195,9 +418,15 @@ struct task *wth_get_runnable_thread(void)
 
       struct worker_thread *t = worker_threads[i];
 
-      if (t->task->state == TASK_STATE_RUNNABLE)
-         if (!selected || t->priority < selected->priority)
-            selected = t;
+      if (t->task->state != TASK_STATE_RUNNABLE)
+         continue;
+
+      /* NOTE: the effective priority might be boosted by a kmutex waiter */
+      if (!selected ||
+          task_get_eff_prio(t->task) < task_get_eff_prio(selected->task))
+      {
+         selected = t;
+      }
    }
 
    return selected ? selected->task : NULL;
@@ -231,6 +460,10 @@ wth_create_thread(const char *name, int priority, u16 queue_size)
    }
 
    kcond_init(&t->completion);
+   list_init(&t->overflow);
+   list_init(&t->spare_nodes);
+   t->spare_target = queue_size;
+   wth_refill_spare_nodes(t);
 
    safe_ringbuf_init(&t->rb,
                      queue_size,
@@ -238,6 +471,7 @@ wth_create_thread(const char *name, int priority, u16 queue_size)
                      t->jobs);
 
    if ((rc = wth_create_thread_for(t))) {
+      wth_free_spare_nodes(t);
       kfree_array_obj(t->jobs, struct wjob, queue_size);
       kfree_obj(t, struct worker_thread);
       return NULL;
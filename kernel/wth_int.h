@@ -3,10 +3,20 @@
 #pragma once
 #include <tilck/kernel/safe_ringbuf.h>
 #include <tilck/kernel/sync.h>
+#include <tilck/kernel/list.h>
+#include <tilck/kernel/worker_thread.h>
+#include <tilck/common/atomics.h>
 
 struct wjob {
    void (*func)(void *);
    void *arg;
+   u64 enqueue_time;
+};
+
+/* Job that didn't fit in the ring buffer */
+struct wjob_node {
+   struct list_node node;
+   struct wjob job;
 };
 
 struct worker_thread {
@@ -18,6 +28,22 @@ struct worker_thread {
    struct kcond completion;
    int priority;              /* 0 is the max priority */
    volatile bool waiting_for_jobs;
+
+   /*
+    * Overflow list, used when the ring buffer is full. In IRQ context we cannot
+    * call kmalloc(), so we use the pre-allocated spare nodes: their number
+    * doubles (up to WTH_MAX_SPARE_NODES) each time they're not enough. The
+    * overflow list is limited to WTH_MAX_OVERFLOW_JOBS: beyond that, the jobs
+    * are dropped. Both the lists are protected by disabling the interrupts.
+    */
+   struct list overflow;
+   struct list spare_nodes;
+   u32 overflow_cnt;
+   u32 spare_cnt;
+   u32 spare_target;
+
+   ATOMIC(u32) depth;         /* jobs in the ring buffer + overflow list */
+   struct wth_stats stats;
 };
 
 extern struct worker_thread *worker_threads[WTH_MAX_THREADS];
@@ -26,4 +52,6 @@ extern int worker_threads_cnt;
 void wth_run(void *arg);
 void wth_wakeup(struct worker_thread *t);
 bool wth_process_single_job(struct worker_thread *t);
+int wth_process_jobs_batch(struct worker_thread *t);
+void wth_free_spare_nodes(struct worker_thread *t);
 int wth_create_thread_for(struct worker_thread *t);
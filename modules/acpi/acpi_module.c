@@ -128,6 +128,134 @@ acpi_is_vga_text_mode_avail(void)
    return tri_unknown;
 }
 
+static void
+madt_handle_int_override(struct acpi_madt_info *nfo,
+                         ACPI_MADT_INTERRUPT_OVERRIDE *ovr)
+{
+   struct acpi_madt_isa_irq *e;
+   const u32 pol = ovr->IntiFlags & ACPI_MADT_POLARITY_MASK;
+   const u32 trig = ovr->IntiFlags & ACPI_MADT_TRIGGER_MASK;
+
+   if (ovr->Bus != 0 || ovr->SourceIrq >= ACPI_MADT_ISA_IRQS)
+      return; /* Not an ISA IRQ */
+
+   e = &nfo->isa_irqs[ovr->SourceIrq];
+   e->gsi = ovr->GlobalIrq;
+   e->active_low = pol == ACPI_MADT_POLARITY_ACTIVE_LOW;
+   e->level_trig = trig == ACPI_MADT_TRIGGER_LEVEL;
+
+   /*
+    * Special case: the SCI is level-triggered and active-low, unless the
+    * override explicitly says something different.
+    */
+   if (ovr->SourceIrq == AcpiGbl_FADT.SciInterrupt) {
+
+      if (pol == ACPI_MADT_POLARITY_CONFORMS)
+         e->active_low = true;
+
+      if (trig == ACPI_MADT_TRIGGER_CONFORMS)
+         e->level_trig = true;
+   }
+}
+
+bool
+acpi_get_madt_info(struct acpi_madt_info *nfo)
+{
+   struct acpi_table_madt *madt;
+   ACPI_SUBTABLE_HEADER *sub;
+   ulong end;
+   ACPI_STATUS rc;
+   u32 gsi;
+
+   if (acpi_init_status < ais_tables_initialized)
+      return false;
+
+   rc = AcpiGetTable(ACPI_SIG_MADT, 1, (struct acpi_table_header **)&madt);
+
+   if (rc == AE_NOT_FOUND)
+      return false;
+
+   if (ACPI_FAILURE(rc)) {
+      print_acpi_failure("AcpiGetTable", "MADT", rc);
+      return false;
+   }
+
+   bzero(nfo, sizeof(*nfo));
+   nfo->lapic_paddr = madt->Address;
+   nfo->has_8259 = !!(madt->Flags & ACPI_MADT_PCAT_COMPAT);
+
+   /* By default, the ISA IRQs are identity-mapped to GSIs */
+   for (u32 i = 0; i < ACPI_MADT_ISA_IRQS; i++)
+      nfo->isa_irqs[i].gsi = i;
+
+   /* The SCI, if it's an ISA IRQ, is by default level-triggered, active-low */
+   if (AcpiGbl_FADT.SciInterrupt < ACPI_MADT_ISA_IRQS) {
+      nfo->isa_irqs[AcpiGbl_FADT.SciInterrupt].active_low = true;
+      nfo->isa_irqs[AcpiGbl_FADT.SciInterrupt].level_trig = true;
+   }
+
+   sub = (void *)(madt + 1);
+   end = (ulong)madt + madt->Header.Length;
+
+   while ((ulong)sub + sizeof(*sub) <= end && sub->Length > 0) {
+
+      switch (sub->Type) {
+
+         case ACPI_MADT_TYPE_IO_APIC: {
+
+            ACPI_MADT_IO_APIC *io = (void *)sub;
+
+            if (nfo->ioapics_count == ACPI_MADT_MAX_IOAPICS) {
+               printk("ACPI: ignoring IOAPIC %u (too many)\n", io->Id);
+               break;
+            }
+
+            nfo->ioapics[nfo->ioapics_count++] = (struct acpi_madt_ioapic) {
+               .paddr = io->Address,
+               .gsi_base = io->GlobalIrqBase,
+               .id = io->Id,
+            };
+            break;
+         }
+
+         case ACPI_MADT_TYPE_INTERRUPT_OVERRIDE:
+            madt_handle_int_override(nfo, (void *)sub);
+            break;
+
+         case ACPI_MADT_TYPE_LOCAL_APIC_OVERRIDE: {
+
+            ACPI_MADT_LOCAL_APIC_OVERRIDE *lo = (void *)sub;
+
+            if (lo->Address == (ulong)lo->Address)
+               nfo->lapic_paddr = (ulong)lo->Address;
+
+            break;
+         }
+
+         default:
+            break;
+      }
+
+      sub = (void *)((ulong)sub + sub->Length);
+   }
+
+   AcpiPutTable((struct acpi_table_header *)madt);
+
+   /*
+    * An ISA IRQ whose GSI has been taken by another ISA IRQ through an override
+    * (typically: IRQ 0 -> GSI 2) is not connected to anything.
+    */
+   for (u32 i = 0; i < ACPI_MADT_ISA_IRQS; i++) {
+
+      gsi = nfo->isa_irqs[i].gsi;
+
+      if (gsi != i && gsi < ACPI_MADT_ISA_IRQS && nfo->isa_irqs[gsi].gsi == gsi)
+         nfo->isa_irqs[gsi].gsi = ACPI_MADT_NO_GSI;
+   }
+
+   return nfo->ioapics_count > 0 && nfo->lapic_paddr != 0;
+}
+
 static void
 acpi_read_acpi_hw_flags(void)
 {
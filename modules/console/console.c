@@ -850,6 +850,25 @@ static void tty_set_state(struct twfilter_ctx *ctx, term_filter new_state)
    struct tty *const t = ctx->t;
    ctx->non_default_state = new_state != &tty_state_default;
    t->tintf->set_filter(t->tstate, new_state, ctx);
+   tty_update_filter_trans_table(ctx);
+}
+
+/*
+ * In the default state, the bytes translated by the current charset are always
+ * written as plain chars: let the term write them without calling the filter.
+ */
+static void tty_update_filter_trans_table(struct twfilter_ctx *ctx)
+{
+   struct tty *const t = ctx->t;
+   struct console_data *const cd = ctx->cd;
+
+   if (!t->tintf->set_filter_trans_table)
+      return;
+
+   t->tintf->set_filter_trans_table(
+      t->tstate,
+      ctx->non_default_state ? NULL : cd->c_sets_tables[cd->c_set]
+   );
 }
 
 static int tty_pre_filter(struct twfilter_ctx *ctx, u8 *c)
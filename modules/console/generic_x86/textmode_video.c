@@ -12,13 +12,60 @@
 #define VIDEO_COLS 80
 #define VIDEO_ROWS 25
 
+/*
+ * Shadow copy of the screen, in regular (cached) memory.
+ *
+ * All the video interface functions work on the shadow buffer, while the
+ * textmode_flush() function copies to the uncached VGA memory only the runs of
+ * changed cells of each row and moves the hardware cursor, at most once.
+ * Cells are compared on write, so `shadow` always contains what will be on the
+ * screen after the next flush and the dirty ranges contain only the cells that
+ * really changed since the last one.
+ */
+static u16 shadow[VIDEO_ROWS * VIDEO_COLS];
+static u8 dirty_start[VIDEO_ROWS];    /* first dirty col */
+static u8 dirty_end[VIDEO_ROWS];      /* last dirty col + 1, 0 if clean */
+static u16 cursor_pos;                /* the cursor position to flush */
+static u16 hw_cursor_pos;             /* the cursor position on the hardware */
+
+STATIC_ASSERT(VIDEO_COLS <= 255);
+
+static ALWAYS_INLINE void
+textmode_mark_dirty(u16 row, u16 s, u16 e)
+{
+   if (dirty_end[row]) {
+      dirty_start[row] = (u8)MIN((u16)dirty_start[row], s);
+      dirty_end[row] = (u8)MAX((u16)dirty_end[row], e);
+   } else {
+      dirty_start[row] = (u8)s;
+      dirty_end[row] = (u8)e;
+   }
+}
+
+static void textmode_update_row(u16 row, u16 col, const u16 *data, u16 len)
+{
+   u16 *dest = shadow + row * VIDEO_COLS;
+   u16 s, e;
+
+   /* Skip the cells which did not change */
+   for (s = col; s < col + len && dest[s] == data[s - col]; s++) { }
+
+   if (s == col + len)
+      return;
+
+   for (e = col + len; dest[e - 1] == data[e - 1 - col]; e--) { }
+
+   memcpy(dest + s, data + s - col, (e - s) * 2u);
+   textmode_mark_dirty(row, s, e);
+}
+
 static void textmode_clear_row(u16 row_num, u8 color)
 {
+   u16 row[VIDEO_COLS];
    ASSERT(row_num < VIDEO_ROWS);
 
-   memset16(VIDEO_ADDR + VIDEO_COLS * row_num,
-            make_vgaentry(' ', color),
-            VIDEO_COLS);
+   memset16(row, make_vgaentry(' ', color), VIDEO_COLS);
+   textmode_update_row(row_num, 0, row, VIDEO_COLS);
 }
 
 static void textmode_set_char_at(u16 row, u16 col, u16 entry)
@@ -26,29 +73,59 @@ static void textmode_set_char_at(u16 row, u16 col, u16 entry)
    ASSERT(row < VIDEO_ROWS);
    ASSERT(col < VIDEO_COLS);
 
-   volatile u16 *video = (volatile u16 *)VIDEO_ADDR;
-   video[row * VIDEO_COLS + col] = entry;
+   if (shadow[row * VIDEO_COLS + col] != entry) {
+      shadow[row * VIDEO_COLS + col] = entry;
+      textmode_mark_dirty(row, col, col + 1);
+   }
 }
 
 static void textmode_set_row(u16 row, u16 *data, bool fpu_allowed)
 {
    ASSERT(row < VIDEO_ROWS);
-
-   void *dest_addr = VIDEO_ADDR + row * VIDEO_COLS;
-   void *src_addr = data;
-
-   memcpy32(dest_addr, src_addr, VIDEO_COLS >> 1);
+   textmode_update_row(row, 0, data, VIDEO_COLS);
 }
 
 /*
- * This function works, but in practice is 2x slower than just using term's
- * generic scroll and re-draw the whole screen.
+ * Scrolling the shadow buffer is cheaper than having the term re-drawing each
+ * row with set_row(): anyway, the whole screen will be flushed.
  */
 static void textmode_scroll_one_line_up(void)
 {
-   memcpy32(VIDEO_ADDR,
-            VIDEO_ADDR + VIDEO_COLS,
-            ((VIDEO_ROWS - 1) * VIDEO_COLS) >> 1);
+   memmove(shadow,
+           shadow + VIDEO_COLS,
+           (VIDEO_ROWS - 1) * VIDEO_COLS * 2);
+
+   for (u16 row = 0; row < VIDEO_ROWS; row++)
+      textmode_mark_dirty(row, 0, VIDEO_COLS);
+}
+
+static void textmode_flush(void)
+{
+   for (u16 row = 0; row < VIDEO_ROWS; row++) {
+
+      if (!dirty_end[row])
+         continue;
+
+      /* Copy whole 32-bit words: VIDEO_COLS is even */
+      const u16 s = dirty_start[row] & ~1u;
+      const u16 e = (u16)((dirty_end[row] + 1u) & ~1u);
+      const u32 off = row * VIDEO_COLS + s;
+
+      memcpy32(VIDEO_ADDR + off, shadow + off, (e - s) >> 1);
+      dirty_end[row] = 0;
+   }
+
+   if (cursor_pos != hw_cursor_pos) {
+
+      // cursor LOW port to vga INDEX register
+      outb(0x3D4, 0x0F);
+      outb(0x3D5, LO_BITS(cursor_pos, 8, u8));
+      // cursor HIGH port to vga INDEX register
+      outb(0x3D4, 0x0E);
+      outb(0x3D5, LO_BITS(cursor_pos >> 8, 8, u8));
+
+      hw_cursor_pos = cursor_pos;
+   }
 }
 
 /*
@@ -58,23 +135,24 @@ static void textmode_scroll_one_line_up(void)
  * There is a lot of precious information about how to work with the cursor.
  */
 
+/* The hardware cursor is moved by textmode_flush() */
 static void textmode_move_cursor(u16 row, u16 col, int color /* ignored */)
 {
-   u16 position = (row * VIDEO_COLS) + col;
-
-   // cursor LOW port to vga INDEX register
-   outb(0x3D4, 0x0F);
-   outb(0x3D5, LO_BITS(position, 8, u8));
-   // cursor HIGH port to vga INDEX register
-   outb(0x3D4, 0x0E);
-   outb(0x3D5, LO_BITS(position >> 8, 8, u8));
+   cursor_pos = (row * VIDEO_COLS) + col;
 }
 
 static void textmode_enable_cursor(void)
 {
+   static bool shape_set;
    const u8 s_start = 0; /* scanline start */
    const u8 s_end = 15;  /* scanline end */
 
+   /* The term calls this on every write: the shape never changes */
+   if (shape_set)
+      return;
+
+   shape_set = true;
+
    outb(0x3D4, 0x0A);
    outb(0x3D5, (inb(0x3D5) & 0xC0) | s_start);  // Note: mask with 0xC0
                                                 // which keeps only the
@@ -111,10 +189,11 @@ static const struct video_interface ega_text_mode_i =
    textmode_move_cursor,
    textmode_enable_cursor,
    textmode_disable_cursor,
-   NULL, /* textmode_scroll_one_line_up (see the comment) */
+   textmode_scroll_one_line_up,
    NULL, /* redraw_static_elements */
    NULL, /* disable_static_elems_refresh */
    NULL, /* enable_static_elems_refresh */
+   textmode_flush,
 };
 
 void init_textmode_console(void)
@@ -131,5 +210,10 @@ void init_textmode_console(void)
          panic("textmode_console: unable to map VIDEO_ADDR in the virt space");
    }
 
+   /* The VGA memory and the cursor are in an unknown state: flush all */
+   for (u16 row = 0; row < VIDEO_ROWS; row++)
+      textmode_mark_dirty(row, 0, VIDEO_COLS);
+
+   hw_cursor_pos = (u16)~cursor_pos;
    init_first_video_term(&ega_text_mode_i, VIDEO_ROWS, VIDEO_COLS, -1);
 }
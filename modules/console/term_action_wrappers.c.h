@@ -62,13 +62,29 @@ static void term_execute_action(struct vterm *t, struct term_action *a)
    }
 }
 
+/*
+ * Execute a top-level action and flush its effects on the screen, unless more
+ * actions are queued: in that case, the whole batch is flushed once, after the
+ * last one. The actions run by the filter function during a write never flush.
+ */
+static void
+term_execute_action_and_flush(struct vterm *t, struct term_action *a)
+{
+   term_execute_action(t, a);
+
+   if (safe_ringbuf_is_empty(&t->rb_data.rb))
+      term_flush(t);
+}
+
 static void
 term_execute_or_enqueue_action(struct vterm *t, struct term_action *a)
 {
-   term_execute_or_enqueue_action_template(t,
-                                           &t->rb_data,
-                                           a,
-                                           (void *)&term_execute_action);
+   term_execute_or_enqueue_action_template(
+      t,
+      &t->rb_data,
+      a,
+      (void *)&term_execute_action_and_flush
+   );
 }
 
 static void
@@ -79,6 +95,7 @@ vterm_write(term *t, const char *buf, size_t len, u8 color)
 
    if (in_panic()) {
       term_action_write(t, buf, (u32)len, color);
+      term_flush(t);
       return;
    }
 
@@ -147,6 +164,13 @@ vterm_set_filter(term *_t, term_filter func, void *ctx)
    t->filter_ctx = ctx;
 }
 
+static void
+vterm_set_filter_trans_table(term *_t, const s16 *table)
+{
+   struct vterm *const t = _t;
+   t->filter_trans_table = table;
+}
+
 static bool
 vterm_is_initialized(term *_t)
 {
@@ -110,6 +110,22 @@ term_action_write(struct vterm *const t, const char *buf, u32 len, u8 color)
          continue;
       }
 
+      if (LIKELY(t->filter_trans_table != NULL)) {
+
+         /* Fast path: write the whole run of plain printable chars */
+         const s16 *const table = t->filter_trans_table;
+         u32 n = 0;
+
+         while (i + n < len && table[(u8)buf[i + n]] >= 32)
+            n++;
+
+         if (n) {
+            term_internal_write_run(t, buf + i, n, table, color);
+            i += n - 1;
+            continue;
+         }
+      }
+
       /*
        * NOTE: We MUST store buf[i] in a local variable because the filter
        * function is absolutely allowed to modify its contents!!
@@ -364,6 +380,7 @@ term_action_pause_output(struct vterm *const t)
       t->vi->disable_static_elems_refresh();
 
    t->vi->disable_cursor();
+   term_flush(t);
    t->saved_vi = t->vi;
    t->vi = &no_output_vi;
 }
@@ -374,6 +391,9 @@ static void
 term_action_restart_output(struct vterm *const t)
 {
    t->vi = t->saved_vi;
+
+   /* The screen might show anything: for example, another term */
+   term_invalidate_screen_rows(t);
    term_redraw(t);
 
    if (t->scroll == t->max_scroll)
@@ -45,6 +45,7 @@ struct vterm {
                                  the screen scrolls for the first time */
    u32 total_buffer_rows;     /* >= term rows */
    u32 extra_buffer_rows;     /* => total_buffer_rows - rows. Always >= 0 */
+   u32 *screen_rows;          /* buffer row shown by each screen row */
 
    u16 saved_cur_row;         /* keeps primary buffer's cursor's row */
    u16 saved_cur_col;         /* keeps primary buffer's cursor's col */
@@ -66,6 +67,7 @@ struct vterm {
 
    term_filter filter;
    void *filter_ctx;
+   const s16 *filter_trans_table;
 };
 
 static struct vterm first_instance;
@@ -83,6 +85,7 @@ static void no_vi_scroll_one_line_up(void) { }
 static void no_vi_redraw_static_elements(void) { }
 static void no_vi_disable_static_elems_refresh(void) { }
 static void no_vi_enable_static_elems_refresh(void) { }
+static void no_vi_flush(void) { }
 
 static const struct video_interface no_output_vi =
 {
@@ -95,7 +98,8 @@ static const struct video_interface no_output_vi =
    no_vi_scroll_one_line_up,
    no_vi_redraw_static_elements,
    no_vi_disable_static_elems_refresh,
-   no_vi_enable_static_elems_refresh
+   no_vi_enable_static_elems_refresh,
+   no_vi_flush,
 };
 
 /* --------------------------------------------------------- */
@@ -169,6 +173,12 @@ static ALWAYS_INLINE u8 get_curr_cell_fg_color(struct vterm *t)
    return vgaentry_get_fg(buf_get_entry(t, t->r, t->c));
 }
 
+static ALWAYS_INLINE void term_flush(struct vterm *t)
+{
+   if (t->vi->flush)
+      t->vi->flush();
+}
+
 static void term_int_enable_cursor(struct vterm *t, bool val)
 {
    if (val == 0) {
@@ -185,6 +195,36 @@ static void term_int_enable_cursor(struct vterm *t, bool val)
    }
 }
 
+#define SCREEN_ROW_UNKNOWN  ((u32)-1)
+
+static void term_invalidate_screen_rows(struct vterm *t)
+{
+   if (t->screen_rows)
+      memset(t->screen_rows, 0xff, t->rows * sizeof(u32));
+}
+
+/*
+ * Tell if the screen row `row` needs to be re-drawn to show the buffer row
+ * `buf_row`, and remember that it will show it. When the buffer row shown
+ * changed (scroll), re-drawing is not necessary if the content is the same.
+ * Otherwise, the caller wants to re-draw the row because its content changed.
+ */
+static bool term_screen_row_needs_redraw(struct vterm *t, u16 row, u32 buf_row)
+{
+   if (!t->screen_rows)
+      return true;
+
+   const u32 old = t->screen_rows[row];
+   t->screen_rows[row] = buf_row;
+
+   if (old == buf_row || old == SCREEN_ROW_UNKNOWN)
+      return true;
+
+   return !!memcmp(&t->buffer[old * t->cols],
+                   &t->buffer[buf_row * t->cols],
+                   t->cols * 2);
+}
+
 static void term_redraw2(struct vterm *t, u16 s, u16 e)
 {
    const bool fpu_allowed = !in_irq() && !in_panic();
@@ -195,8 +235,10 @@ static void term_redraw2(struct vterm *t, u16 s, u16 e)
    if (fpu_allowed)
       fpu_context_begin();
 
-   for (u16 row = s; row < e; row++)
-      t->vi->set_row(row, get_buf_row(t, row), fpu_allowed);
+   for (u16 row = s; row < e; row++) {
+      if (term_screen_row_needs_redraw(t, row, calc_buf_row(t, row)))
+         t->vi->set_row(row, get_buf_row(t, row), fpu_allowed);
+   }
 
    if (fpu_allowed)
       fpu_context_end();
@@ -378,8 +420,17 @@ static void term_internal_incr_row(struct vterm *t)
    t->max_scroll++;
 
    if (t->vi->scroll_one_line_up) {
+
       t->scroll++;
       t->vi->scroll_one_line_up();
+
+      if (t->screen_rows) {
+         memmove(t->screen_rows,
+                 t->screen_rows + 1,
+                 (t->rows - 1u) * sizeof(u32));
+         t->screen_rows[t->rows - 1] = SCREEN_ROW_UNKNOWN;
+      }
+
    } else {
       ts_set_scroll(t, t->max_scroll);
    }
@@ -395,6 +446,47 @@ static void term_internal_write_printable_char(struct vterm *t, u8 c, u8 color)
    t->c++;
 }
 
+/*
+ * Write a run of printable chars, translated through `table`, one row segment
+ * at a time. Long segments are pushed to the video interface with a single
+ * set_row() call instead of one set_char_at() per char.
+ */
+static void
+term_internal_write_run(struct vterm *t,
+                        const char *buf,
+                        u32 len,
+                        const s16 *table,
+                        u8 color)
+{
+   while (len > 0) {
+
+      if (t->c == t->cols) {
+         t->c = 0;
+         term_internal_incr_row(t);
+      }
+
+      const u16 n = (u16)MIN(len, (u32)(t->cols - t->c));
+      u16 *const row = get_buf_row(t, t->r) + t->c;
+
+      for (u16 i = 0; i < n; i++)
+         row[i] = make_vgaentry((u8)table[(u8)buf[i]], color);
+
+      if (n >= t->cols / 2) {
+
+         term_redraw2(t, t->r, t->r + 1);
+
+      } else {
+
+         for (u16 i = 0; i < n; i++)
+            t->vi->set_char_at(t->r, t->c + i, row[i]);
+      }
+
+      t->c += n;
+      buf += n;
+      len -= n;
+   }
+}
+
 static void term_internal_write_tab(struct vterm *t, u8 color)
 {
    int rem = t->cols - t->c - 1;
@@ -570,6 +662,7 @@ debug_term_dump_font_table(term *_t)
 
    term_internal_incr_row(t);
    t->c = 0;
+   term_flush(t);
 }
 
 #endif
@@ -615,6 +708,11 @@ dispose_term(term *_t)
       kfree_array_obj(t->screen_buf_copy, u16, t->rows * t->cols);
       t->screen_buf_copy = NULL;
    }
+
+   if (t->screen_rows) {
+      kfree_array_obj(t->screen_rows, u32, t->rows);
+      t->screen_rows = NULL;
+   }
 }
 
 static void
@@ -651,6 +749,13 @@ static u32 term_calc_extra_buf_rows(u16 rows, u16 cols)
    if (kopt_big_scroll_buf)
       buf_size *= 4;
 
+   if (kopt_scrollback > 0) {
+
+      /* Explicit number of scrollback rows (kopt), within a sane limit */
+      const u32 max_rows = (TERM_MAX_SCROLL_BUF_SIZE / 2) / cols - rows;
+      return MIN((u32)kopt_scrollback, max_rows);
+   }
+
    return (buf_size / 2) / cols - rows;
 }
 
@@ -710,6 +815,10 @@ init_vterm(term *_t,
 
    if (t->buffer) {
 
+      /* Optional: without it, term_redraw2() always re-draws all the rows */
+      if ((t->screen_rows = kalloc_array_obj(u32, t->rows)))
+         term_invalidate_screen_rows(t);
+
       t->main_tabs_buf = kzmalloc(t->cols * t->rows);
 
       if (t->main_tabs_buf) {
@@ -719,6 +828,10 @@ init_vterm(term *_t,
       } else {
 
          if (t != &first_instance) {
+
+            if (t->screen_rows)
+               kfree_array_obj(t->screen_rows, u32, t->rows);
+
             kfree2(t->buffer, 2 * t->total_buffer_rows * t->cols);
             return -ENOMEM;
          }
@@ -750,6 +863,7 @@ init_vterm(term *_t,
    t->cursor_enabled = true;
    t->vi->enable_cursor();
    term_int_move_cur(t, 0, 0);
+   term_flush(t);
    t->initialized = true;
    printk("video_term: buffer rows: %u (%u screens)\n",
           t->total_buffer_rows, t->total_buffer_rows / t->rows);
@@ -779,6 +893,7 @@ static const struct term_interface intf = {
    .pause_output = vterm_pause_output,
    .restart_output = vterm_restart_output,
    .set_filter = vterm_set_filter,
+   .set_filter_trans_table = vterm_set_filter_trans_table,
 
    .get_first_term = vterm_get_first_inst,
    .video_term_init = init_vterm,
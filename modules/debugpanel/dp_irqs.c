@@ -72,6 +72,45 @@ static void debug_dump_masked_irqs(void)
    dp_writeln("");
 }
 
+static u32 ns_to_us32(u64 ns)
+{
+   return (u32)MIN(ns / 1000, (u64)UINT32_MAX);
+}
+
+static void debug_dump_threaded_irqs(void)
+{
+   struct threaded_irq *ti;
+   struct irq_thread_stats s;
+
+   if (!irq_get_threaded_handler(0))
+      return;
+
+   dp_writeln("");
+   dp_writeln("Threaded IRQs");
+   dp_writeln("");
+   dp_writeln(
+      E_COLOR_BR_WHITE
+      "   %-6s %3s %8s %8s %6s %9s %9s" RESET_ATTRS,
+      "Name", "IRQ", "Wakeups", "Coalesc", "Drop", "AvgLat", "MaxLat"
+   );
+
+   for (int i = 0; (ti = irq_get_threaded_handler(i)) != NULL; i++) {
+
+      irq_get_thread_stats(ti, &s);
+
+      dp_writeln(
+         "   %-6s %3u %8u %8u %6u %7uus %7uus",
+         ti->name,
+         ti->irq,
+         s.wakeups,
+         s.coalesced,
+         s.dropped,
+         ns_to_us32(s.wakeups ? s.tot_latency_ns / s.wakeups : 0),
+         ns_to_us32(s.max_latency_ns)
+      );
+   }
+}
+
 static void dp_show_irq_stats(void)
 {
    row = dp_screen_start_row;
@@ -81,6 +120,7 @@ static void dp_show_irq_stats(void)
    debug_dump_spur_irq_count();
    debug_dump_unhandled_irq_count();
    debug_dump_masked_irqs();
+   debug_dump_threaded_irqs();
 }
 
 static struct dp_screen dp_irqs_screen =
@@ -83,6 +83,7 @@ static void dp_show_opts(void)
    DUMP_BOOL_OPT(KERNEL_SELFTESTS);
    DUMP_BOOL_OPT(KERNEL_STACK_ISOLATION);
    DUMP_BOOL_OPT(KERNEL_SYMBOLS);
+   DUMP_BOOL_OPT(KMALLOC_FREE_LISTS);
    DUMP_BOOL_OPT(KRN_PRINTK_ON_CURR_TTY);
    DUMP_BOOL_OPT(BOOT_INTERACTIVE);
    DUMP_BOOL_OPT(KERNEL_64BIT_OFFT);
@@ -91,6 +92,7 @@ static void dp_show_opts(void)
    DUMP_LABEL("Disabled by default");
    DUMP_BOOL_OPT(KRN_NO_SYS_WARN);
    DUMP_BOOL_OPT(KRN_PAGE_FAULT_PRINTK);
+   DUMP_BOOL_OPT(KRN_PRINTK_ASYNC);
    DUMP_BOOL_OPT(KERNEL_UBSAN);
    DUMP_BOOL_OPT(TERM_BIG_SCROLL_BUF);
    DUMP_BOOL_OPT(KRN_RESCHED_ENABLE_PREEMPT);
@@ -11,6 +11,7 @@
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/cmdline.h>
 #include <tilck/kernel/datetime.h>
+#include <tilck/kernel/worker_thread.h>
 
 #include <tilck/mods/tracing.h>
 
@@ -382,7 +383,7 @@ dp_tasks_handle_sel_mode_keypress_t(void)
       struct task *ti = get_task(sel_tid);
 
       if (ti)
-         ti->traced = !ti->traced;
+         set_task_traced(ti, !ti->traced);
 
       enable_preemption();
    }
@@ -573,12 +574,53 @@ void dp_dump_task_list(bool kernel_tasks, bool plain_text)
       dp_writeln("");
 }
 
+static u32 ns_to_us32(u64 ns)
+{
+   return (u32)MIN(ns / 1000, (u64)UINT32_MAX);
+}
+
+static void dp_dump_wth_stats(void)
+{
+   struct worker_thread *wth;
+   struct wth_stats s;
+   const char *name;
+
+   dp_writeln("");
+   dp_writeln(
+      E_COLOR_BR_WHITE
+      " %-10s %4s %5s %5s %5s %5s %8s %8s %8s %8s" RESET_ATTRS,
+      "Worker", "Prio", "QSize", "MaxQ", "Ovfl", "Drop",
+      "AvgLat", "MaxLat", "AvgRun", "MaxRun"
+   );
+
+   for (int i = 0; (wth = wth_get_by_index(i)) != NULL; i++) {
+
+      wth_get_stats(wth, &s);
+      name = wth_get_name(wth);
+
+      dp_writeln(
+         " %-10s %4d %5u %5u %5u %5u %6uus %6uus %6uus %6uus",
+         name ? name : "generic",
+         wth_get_priority(wth),
+         wth_get_queue_size(wth),
+         s.max_depth,
+         s.overflowed,
+         s.dropped,
+         ns_to_us32(s.jobs ? s.tot_latency_ns / s.jobs : 0),
+         ns_to_us32(s.max_latency_ns),
+         ns_to_us32(s.jobs ? s.tot_run_ns / s.jobs : 0),
+         ns_to_us32(s.max_run_ns)
+      );
+   }
+}
+
 static void dp_show_tasks(void)
 {
    row = dp_screen_start_row;
 
    show_actions_menu();
    dp_dump_task_list(true, false);
+   dp_dump_wth_stats();
 }
 
 static void dp_tasks_enter(void)
@@ -468,7 +468,7 @@ dp_tracing_get_traced_list_str_cb(void *obj, void *arg)
    }
 
    /* Disable tracing */
-   ti->traced = false;
+   set_task_traced(ti, false);
    return 0;
 }
 
@@ -486,7 +486,7 @@ dp_set_task_as_traced(const char *tidstr, int *traced_cnt)
       ti = get_task((int)tid);
 
       if (ti) {
-         ti->traced = true;
+         set_task_traced(ti, true);
          (*traced_cnt)++;
       }
    }
@@ -228,6 +228,7 @@ static struct video_interface framebuffer_vi =
    fb_draw_banner,
    fb_disable_banner_refresh,
    fb_enable_banner_refresh,
+   NULL,  /* flush: the framebuffer is always written directly */
 };
 
 
@@ -256,7 +256,7 @@ static int kb_irq_handler_read_scancodes(void)
    return count;
 }
 
-static enum irq_action keyboard_irq_handler(void *ctx)
+static enum irq_action keyboard_irq_check(void *ctx)
 {
    ASSERT(are_interrupts_enabled());
    ASSERT(!is_preemption_enabled());
@@ -278,44 +278,12 @@ static enum irq_action keyboard_irq_handler(void *ctx)
       return IRQ_HANDLED;
    }
 
-   if (UNLIKELY(in_panic())) {
-
-      /*
-       * During panic() typically IRQs are completely disabled BUT, when the
-       * the -panic_kb is passed to the kernel cmdline, we allow just PS/2 KB
-       * IRQs to run, so that we can scroll the term buffer. Because we don't
-       * have the timer IRQ, we have to process everything in the IRQ handler
-       * itself. For the panic case, that's totally fine.
-       *
-       * When kopt_sercon is enabled, we allow IRQ 4 instead of IRQ 1.
-       */
-      ulong val;
-      disable_interrupts(&val);
-      {
-         kb_irq_bottom_half(NULL);
-      }
-      enable_interrupts(&val);
-      return IRQ_HANDLED;
-   }
-
-   /* Everything is fine: we read at least one scancode */
-   if (!wth_enqueue_on(kb_worker_thread, &kb_irq_bottom_half, NULL)) {
-
-      /*
-       * While on real hardware this should NEVER happen, on some slow emulators
-       * that's totally possible. For example, on this pure browser emulator:
-       * https://copy.sh/v86/
-       *
-       * If we scroll fast up and down immediately after boot while the
-       * fb_pre_render_char_scanlines() function has not completed yet,
-       * the scroll will be so slow that sometimes the queue of tasks for this
-       * bottom half will fill up.
-       */
-
-      printk("WARNING: KB: unable to enqueue job\n");
-   }
-
-   return IRQ_HANDLED;
+   /*
+    * Everything is fine: we read at least one scancode. The bottom half will
+    * process all the scancodes in the ring buffer, including the ones read by
+    * any IRQ coalesced with the pending wakeup.
+    */
+   return IRQ_WAKE_THREAD;
 }
 
 static u8 kb_translate_to_mediumraw(struct key_event ke)
@@ -353,7 +321,12 @@ static struct kb_dev ps2_keyboard = {
    .translate_to_mediumraw = kb_translate_to_mediumraw,
 };
 
-DEFINE_IRQ_HANDLER_NODE(keyboard, keyboard_irq_handler, &ps2_keyboard);
+DEFINE_THREADED_IRQ(keyboard,
+                    "kb",
+                    &keyboard_irq_check,
+                    &kb_irq_bottom_half,
+                    &ps2_keyboard,
+                    0);
 
 static bool hw_8042_init_first_steps(void)
 {
@@ -467,7 +440,9 @@ init_kb_internal(void)
    kb_set_typematic_byte(0);
 
    create_kb_worker_thread();
-   irq_install_handler(X86_PC_KEYBOARD_IRQ, &keyboard);
+   irq_install_threaded_handler(X86_PC_KEYBOARD_IRQ,
+                                &keyboard,
+                                kb_worker_thread);
    register_keyboard_device(&ps2_keyboard);
 }
 
@@ -15,6 +15,10 @@
 #include <tilck/kernel/user.h>
 #include <tilck/kernel/process.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/sync.h>
+#include <tilck/kernel/process_mm.h>
+
+#include <sys/mman.h>      // system header
 
 #include "sb16.h"
 
@@ -25,24 +29,26 @@ struct sb16_info sb16_info;
 static u16 sb16_major;
 
 /*
- * Shared state between the IRQ handler and the rest of the code.
+ * Playback state, shared with the IRQ handler.
+ *
+ * The DMA ring is made of `frag_count` fragments of `frag_size` bytes at the
+ * beginning of the DMA buffer: the DMA controller loops over it while the DSP
+ * raises an IRQ after each fragment. The hw/appl positions and the rest of the
+ * state visible to the user space live in the `st` page, which can be mapped
+ * read-only by the player: see TILCK_SOUND_MMAP_STATUS_OFF.
  *
- * NOTE: it's not necessary to use atomics because most of the time we disable
- * the interrupts while accessing the following state variables. In other cases,
- * like in sb16_ioctl_wait_for_completion() do just poll on sb16_playing:
- * volatile is mandatory, but no need for atomics. It's worth remarking that
- * in the simple model used by this driver, only ONE task at a time can acquire
- * and use this sound device. Therefore, no need for need for any kind of fancy
- * synchronization mechanisms.
+ * The IRQ handler touches only `st` and the DSP: everywhere else, that state
+ * is accessed with the interrupts disabled. The rest is protected by `mutex`,
+ * together with `cond`, signalled after every fragment played.
  */
-static volatile bool producer_is_sleeping;
-static volatile bool sb16_have_slot[2];
-static volatile bool sb16_playing;
-static volatile u8 sb16_slot;
+static struct tilck_sound_status *st;
+static struct kmutex mutex;
+static struct kcond cond;
+static bool hw_programmed;
+static bool draining;
 
 /* DSP config */
 static struct tilck_sound_params dsp_params;
-static u32 curr_buf_sz;
 
 /* The task currently owning the sound device */
 static struct task *owner;
@@ -60,44 +66,65 @@ sb16_alloc_buf(void)
 
    /* The buffer must be aligned at 64-KB boundary */
    ASSERT((sb16_info.buf_paddr & (64 * KB - 1)) == 0);
+
+   if (!(st = kzmalloc(PAGE_SIZE)))
+      return -ENOMEM;
+
+   ASSERT(IS_PAGE_ALIGNED(st));
+   st->frag_size = SB16_DEFAULT_FRAG_SIZE;
+   st->ring_size = SB16_DEFAULT_FRAG_SIZE * SB16_DEFAULT_FRAG_COUNT;
    return 0;
 }
 
 static enum irq_action
-sb16_handle_irq(void *ctx)
+sb16_irq_check(void *ctx)
 {
-   SB16_DBG("sb16, irq, completed slot: %u\n", sb16_slot);
-
-   /* Mark the current slot as "used" */
-   sb16_have_slot[sb16_slot] = false;
-
-   /* Switch to the other slot */
-   sb16_slot = !sb16_slot;
-
    /* ACK the hardware */
    sb16_irq_ack();
 
-   if (!sb16_have_slot[sb16_slot]) {
+   if (!st->playing)
+      return IRQ_HANDLED;
 
-      SB16_DBG("sb16, irq, no data for slot %u: STOP\n", sb16_slot);
-      /* We don't have data ready in the new slot, stop */
-      sb16_pause();
-      sb16_playing = false;
+   st->hw_pos += st->frag_size;
+   SB16_DBG("sb16, irq, hw_pos: %u\n", st->hw_pos);
 
-   } else {
+   if (st->appl_pos - st->hw_pos < st->frag_size) {
 
-      SB16_DBG("sb16, irq, switch to slot: %u\n", sb16_slot);
-   }
+      /* The next fragment is not ready: stop */
+      SB16_DBG("sb16, irq, no data at hw_pos %u: STOP\n", st->hw_pos);
+      sb16_pause();
+      st->playing = false;
 
-   if (producer_is_sleeping) {
-      if (owner && owner->state == TASK_STATE_SLEEPING)
-         task_change_state(owner, TASK_STATE_RUNNABLE);
+      if (!draining)
+         st->underruns++;
    }
 
-   return IRQ_HANDLED;
+   /* Waking up the writers is not time-critical */
+   return IRQ_WAKE_THREAD;
 }
 
-DEFINE_IRQ_HANDLER_NODE(dsp_irq_node, &sb16_handle_irq, NULL);
+static void
+sb16_irq_thread(void *ctx)
+{
+   kmutex_lock(&mutex);
+   {
+      kcond_signal_all(&cond);
+   }
+   kmutex_unlock(&mutex);
+}
+
+/*
+ * sb16_irq_check() ACKs the DSP and accounts the fragment by itself: keep the
+ * line unmasked while the thread runs, otherwise the IRQs of the fragments
+ * completed in the meantime would be lost and hw_pos would drift behind the
+ * DMA.
+ */
+DEFINE_THREADED_IRQ(dsp_irq_node,
+                    "sb16",
+                    &sb16_irq_check,
+                    &sb16_irq_thread,
+                    NULL,
+                    IRQ_THREAD_FL_NO_MASK);
 
 
 static int
@@ -105,7 +132,7 @@ sb16_install_irq_handler(void)
 {
    sb16_info.irq = sb16_get_irq();
    printk("sb16: using irq #%u\n", sb16_info.irq);
-   irq_install_handler(sb16_info.irq, &dsp_irq_node);
+   irq_install_threaded_handler(sb16_info.irq, &dsp_irq_node, NULL);
    return 0;
 }
 
@@ -115,6 +142,27 @@ sb16_read(fs_handle h, char *user_buf, size_t size, offt *pos)
    return 0;
 }
 
+static inline u32
+sb16_frame_size(void)
+{
+   return (u32)(dsp_params.bits / 8) * dsp_params.channels;
+}
+
+/* Committed data, not played yet */
+static u32
+sb16_get_filled(void)
+{
+   ulong var;
+   u32 ret;
+
+   disable_interrupts(&var);
+   {
+      ret = st->appl_pos - st->hw_pos;
+   }
+   enable_interrupts(&var);
+   return ret;
+}
+
 static void
 sb16_fill_buf_with_mute(void *buf, size_t len)
 {
@@ -126,53 +174,100 @@ sb16_fill_buf_with_mute(void *buf, size_t len)
       memset16(buf, mute, len / 2);
 }
 
+/* Reset the ring: the positions, the hw state and its contents */
 static void
-sb16_fill_slot_with_mute(u8 slot)
+sb16_reset_ring(void)
 {
-   u8 *buf = sb16_info.buf + (slot << 15);
-   sb16_fill_buf_with_mute(buf, 32 * KB);
+   ulong var;
+   ASSERT(!st->playing);
+
+   disable_interrupts(&var);
+   {
+      st->hw_pos = 0;
+      st->appl_pos = 0;
+      hw_programmed = false;
+   }
+   enable_interrupts(&var);
+
+   if (dsp_params.bits)
+      sb16_fill_buf_with_mute(sb16_info.buf, st->ring_size);
 }
 
+/*
+ * Start (or resume, after a stop) the playback, when there's enough data.
+ * Unless `force` is true, half of the ring has to be filled first.
+ */
 static void
-do_start_play(u8 next_slot, u32 sz)
+sb16_start_if_ready(bool force)
 {
-   static bool played_anything;
+   const u32 filled = sb16_get_filled();
+   const u32 threshold = force ? st->frag_size : st->ring_size / 2;
+   ulong var;
 
-   bool currently_playing;
+   ASSERT(kmutex_is_curr_task_holding_lock(&mutex));
 
-   disable_interrupts_forced();
+   if (st->playing || filled < MAX(threshold, st->frag_size))
+      return;
+
+   SB16_DBG("sb16: start, hw_pos: %u, filled: %u\n", st->hw_pos, filled);
+
+   disable_interrupts(&var);
    {
-      /* Mark the data in the next slot as "ready" */
-      SB16_DBG("write(): mark slot %u as available\n", next_slot);
-      sb16_have_slot[next_slot] = true;
-      currently_playing = sb16_playing;
-   }
-   enable_interrupts_forced();
+      st->playing = true;
 
-   if (!currently_playing) {
+      if (!hw_programmed) {
 
-      SB16_DBG("write(): not playing, START!\n");
-      ASSERT(next_slot == 0);
-      sb16_slot = next_slot;
-      sb16_have_slot[1] = false;
-      sb16_fill_slot_with_mute(1);
+         ASSERT(st->hw_pos % st->ring_size == 0);
+         sb16_program_dma(dsp_params.bits, st->ring_size);
+         sb16_program(&dsp_params, st->frag_size);
+         hw_programmed = true;
 
-      sb16_playing = true;
-      curr_buf_sz = MAX(sz, played_anything ? 4 * KB : 8 * KB);
-      played_anything = true;
+      } else {
 
-      sb16_program_dma(dsp_params.bits, sz < 32 * KB ? sz : 64 * KB);
-      sb16_program(&dsp_params, curr_buf_sz);
+         /* The DSP stopped exactly at the beginning of this fragment */
+         sb16_continue();
+      }
+   }
+   enable_interrupts(&var);
+}
 
-   } else {
+static void
+sb16_commit(u32 bytes, bool force_start)
+{
+   ulong var;
 
-      SB16_DBG("write(): playing slot %u, do nothing\n", !next_slot);
+   disable_interrupts(&var);
+   {
+      st->appl_pos += bytes;
    }
+   enable_interrupts(&var);
+
+   sb16_start_if_ready(force_start);
+}
+
+/* Copy user data in the ring, at appl_pos, dealing with the wrap-around */
+static int
+sb16_copy_to_ring(const char *user_buf, u32 sz)
+{
+   const u32 off = st->appl_pos & (st->ring_size - 1);
+   const u32 sz1 = MIN(sz, st->ring_size - off);
+
+   if (copy_from_user(sb16_info.buf + off, user_buf, sz1))
+      return -EFAULT;
+
+   if (sz1 < sz && copy_from_user(sb16_info.buf, user_buf + sz1, sz - sz1))
+      return -EFAULT;
+
+   return 0;
 }
 
 static ssize_t
 sb16_write(fs_handle h, char *user_buf, size_t size, offt *pos)
 {
+   struct fs_handle_base *hb = h;
+   u32 space, sz;
+   ssize_t rc;
+
    if (get_curr_task() != owner) {
       /* The current task, does not own the resource */
       return -EPERM;
@@ -183,104 +278,170 @@ sb16_write(fs_handle h, char *user_buf, size_t size, offt *pos)
       return -EINVAL;
    }
 
-   const size_t sz = MIN(size, 32 * KB);
-   bool must_sleep;
-   u8 next_slot;
-   u8 *dest_buf;
+   /* Accept only whole frames */
+   size -= size % sb16_frame_size();
 
-   do {
+   if (!size)
+      return -EINVAL;
 
-      must_sleep = false;
-      disable_interrupts_forced();
-      {
-         if (sb16_playing) {
+   kmutex_lock(&mutex);
 
-            next_slot = !sb16_slot;
+   while (!(space = st->ring_size - sb16_get_filled())) {
 
-            if (sb16_have_slot[next_slot] || curr_buf_sz < 32 * KB) {
+      /* The ring is full, therefore we must be playing */
+      ASSERT(st->playing);
 
-               if (curr_buf_sz < 32 * KB)
-                  SB16_DBG("force sleep on write() because buf < 32KB\n");
+      if (hb->fl_flags & O_NONBLOCK) {
+         rc = -EAGAIN;
+         goto out;
+      }
 
-               must_sleep = true;
-            }
+      SB16_DBG("write(): ring full, wait\n");
+      kcond_wait(&cond, &mutex, KCOND_WAIT_FOREVER);
 
-         } else {
-            next_slot = 0;
-         }
+      if (pending_signals()) {
+         rc = -EINTR;
+         goto out;
       }
-      enable_interrupts_forced();
+   }
 
-      if (must_sleep) {
+   sz = (u32)MIN(size, space);
 
-         SB16_DBG("write() requires to sleep (waiting for slot)\n");
+   if ((rc = sb16_copy_to_ring(user_buf, sz)))
+      goto out;
 
-         producer_is_sleeping = true;
-         kernel_sleep_ms(100);
-         task_cancel_wakeup_timer(get_curr_task());
+   sb16_commit(sz, false);
+   rc = (ssize_t)sz;
 
-         if (pending_signals())
-            return -EINTR;
+out:
+   kmutex_unlock(&mutex);
+   return rc;
+}
 
-         producer_is_sleeping = false;
-      }
+static int
+sb16_write_ready(fs_handle h)
+{
+   return owner && dsp_params.bits && sb16_get_filled() < st->ring_size;
+}
 
-   } while (must_sleep);
+static struct kcond *
+sb16_get_wready_cond(fs_handle h)
+{
+   return &cond;
+}
 
-   SB16_DBG("write(): using slot: %u\n", next_slot);
-   dest_buf = sb16_info.buf + (next_slot << 15);
+static int
+sb16_ioctl_sound_setup(struct tilck_sound_params *user_params)
+{
+   struct tilck_sound_params params;
+   int rc = 0;
 
-   if (copy_from_user(dest_buf, user_buf, sz))
+   if (get_curr_task() != owner) {
+      /* The current task, does not own the resource */
+      return -EPERM;
+   }
+
+   if (copy_from_user(&params, user_params, sizeof(params)))
       return -EFAULT;
 
-   if (sz < 32 * KB) {
+   if (!(params.sample_rate <= 44100 &&
+         (params.bits == 8 || params.bits == 16) &&
+         (params.channels == 1 || params.channels == 2) &&
+         (params.sign == 0 || params.sign == 1)))
+   {
+      return -EINVAL;
+   }
+
+   kmutex_lock(&mutex);
+   {
+      if (!st->playing) {
+         dsp_params = params;
+         sb16_reset_ring();
+      } else {
+         rc = -EBUSY;
+      }
+   }
+   kmutex_unlock(&mutex);
+   return rc;
+}
+
+static int
+sb16_ioctl_set_frags(struct tilck_sound_frags *user_frags)
+{
+   struct tilck_sound_frags f;
+   int rc = 0;
 
-      if (dsp_params.bits == 16 || dsp_params.channels == 2) {
+   if (get_curr_task() != owner)
+      return -EPERM;
+
+   if (copy_from_user(&f, user_frags, sizeof(f)))
+      return -EFAULT;
 
-         if (sz % 2)
-            return -EINVAL;
+   if (!IN_RANGE_INC(f.frag_size, 1 * KB, 32 * KB) ||
+       !IN_RANGE_INC(f.frag_count, 2, 64) ||
+       (f.frag_size & (f.frag_size - 1)) ||
+       (f.frag_count & (f.frag_count - 1)) ||
+       f.frag_size * f.frag_count > 64 * KB)
+   {
+      return -EINVAL;
+   }
 
-         if (dsp_params.bits == 16 && dsp_params.channels == 2)
-            if (sz % 4)
-               return -EINVAL;
+   kmutex_lock(&mutex);
+   {
+      if (!st->playing) {
+         st->frag_size = f.frag_size;
+         st->ring_size = f.frag_size * f.frag_count;
+         sb16_reset_ring();
+      } else {
+         rc = -EBUSY;
       }
+   }
+   kmutex_unlock(&mutex);
+   return rc;
+}
+
+static int
+sb16_ioctl_get_status(struct tilck_sound_status *user_status)
+{
+   struct tilck_sound_status s;
+   ulong var;
 
-      SB16_DBG("write(): small buf %u, fill %u with mute\n", sz, 32*KB - sz);
-      sb16_fill_buf_with_mute(dest_buf + sz, 32 * KB - sz);
+   disable_interrupts(&var);
+   {
+      s = *st;
    }
+   enable_interrupts(&var);
+
+   if (copy_to_user(user_status, &s, sizeof(s)))
+      return -EFAULT;
 
-   do_start_play(next_slot, sz);
-   return (ssize_t)sz;
+   return 0;
 }
 
+/* Make `bytes` written by the player directly in the mmap-ed ring playable */
 static int
-sb16_ioctl_sound_setup(struct tilck_sound_params *user_params)
+sb16_ioctl_commit(ulong bytes)
 {
-   if (get_curr_task() != owner) {
-      /* The current task, does not own the resource */
+   int rc = 0;
+
+   if (get_curr_task() != owner)
       return -EPERM;
-   }
 
-   if (sb16_playing)
-      return -EBUSY;
+   if (!dsp_params.bits)
+      return -EINVAL;
 
-   if (copy_from_user(&dsp_params, user_params, sizeof(dsp_params)))
-      return -EFAULT;
+   if (bytes % sb16_frame_size())
+      return -EINVAL;
 
-   if (dsp_params.sample_rate <= 44100 &&
-       (dsp_params.bits == 8 || dsp_params.bits == 16) &&
-       (dsp_params.channels == 1 || dsp_params.channels == 2) &&
-       (dsp_params.sign == 0 || dsp_params.sign == 1))
+   kmutex_lock(&mutex);
    {
-      sb16_have_slot[0] = false;
-      sb16_have_slot[1] = false;
-      sb16_fill_slot_with_mute(0);
-      sb16_fill_slot_with_mute(1);
-      return 0;
+      if (bytes <= st->ring_size - sb16_get_filled())
+         sb16_commit((u32)bytes, false);
+      else
+         rc = -EINVAL;
    }
-
-   bzero(&dsp_params, sizeof(dsp_params));
-   return -EINVAL;
+   kmutex_unlock(&mutex);
+   return rc;
 }
 
 static void
@@ -290,6 +451,19 @@ sb16_release_on_exit(struct task *ti)
    disable_interrupts_forced();
    {
       owner = NULL;
+
+      /*
+       * Drop whatever is left to play. The DSP might have been stopped in
+       * the middle of a fragment: the next playback will re-program it.
+       */
+      if (st->playing) {
+         sb16_pause();
+         st->playing = false;
+      }
+
+      st->hw_pos = 0;
+      st->appl_pos = 0;
+      hw_programmed = false;
    }
    enable_interrupts_forced();
    SB16_DBG("sb16: release ownership from TID: %d\n", ti->tid);
@@ -358,24 +532,45 @@ sb16_ioctl_get_info(struct tilck_sound_card_info *user_info)
 static int
 sb16_ioctl_wait_for_completion(void)
 {
+   u32 filled, partial;
+   int rc = 0;
+
    if (get_curr_task() != owner) {
       /* The current task does not own the resource */
       return -EPERM;
    }
 
-   while (sb16_playing) {
+   kmutex_lock(&mutex);
+
+   /* Complete the last fragment with silence and play everything */
+   if ((filled = sb16_get_filled()) && (partial = filled % st->frag_size)) {
 
-      producer_is_sleeping = true;
-      kernel_sleep_ms(100);
-      task_cancel_wakeup_timer(get_curr_task());
+      const u32 pad = st->frag_size - partial;
+      const u32 off = st->appl_pos & (st->ring_size - 1);
 
-      if (pending_signals())
-         return -EINTR;
+      sb16_fill_buf_with_mute(sb16_info.buf + off, pad);
+      sb16_commit(pad, true);
 
-      producer_is_sleeping = false;
+   } else {
+
+      sb16_start_if_ready(true);
    }
 
-   return 0;
+   draining = true;
+
+   while (st->playing) {
+
+      kcond_wait(&cond, &mutex, KCOND_WAIT_FOREVER);
+
+      if (pending_signals()) {
+         rc = -EINTR;
+         break;
+      }
+   }
+
+   draining = false;
+   kmutex_unlock(&mutex);
+   return rc;
 }
 
 static int
@@ -398,11 +593,72 @@ sb16_ioctl(fs_handle h, ulong request, void *user_argp)
       case TILCK_IOCTL_SOUND_WAIT_COMPLETION:
          return sb16_ioctl_wait_for_completion();
 
+      case TILCK_IOCTL_SOUND_SET_FRAGS:
+         return sb16_ioctl_set_frags(user_argp);
+
+      case TILCK_IOCTL_SOUND_GET_STATUS:
+         return sb16_ioctl_get_status(user_argp);
+
+      case TILCK_IOCTL_SOUND_COMMIT:
+         return sb16_ioctl_commit((ulong)user_argp);
+
       default:
          return -EINVAL;
    }
 }
 
+static int
+sb16_mmap(struct user_mapping *um, pdir_t *pdir, int flags)
+{
+   const size_t tot_size = TILCK_SOUND_MMAP_RING_OFF + 64 * KB;
+   const bool rw = !!(um->prot & PROT_WRITE);
+   size_t off = um->off;
+   ulong vaddr = um->vaddr;
+   ulong paddr;
+   int rc;
+
+   ASSERT(IS_PAGE_ALIGNED(um->len));
+
+   if (um->off + um->len > tot_size)
+      return -EINVAL;
+
+   /* The status page is read-only */
+   if (rw && um->off < TILCK_SOUND_MMAP_RING_OFF)
+      return -EACCES;
+
+   if (flags & VFS_MM_DONT_MMAP)
+      return 0;
+
+   for (; off < um->off + um->len; off += PAGE_SIZE, vaddr += PAGE_SIZE) {
+
+      if (off < TILCK_SOUND_MMAP_RING_OFF)
+         paddr = LIN_VA_TO_PA(st);
+      else
+         paddr = sb16_info.buf_paddr + off - TILCK_SOUND_MMAP_RING_OFF;
+
+      rc = map_page(pdir,
+                    (void *)vaddr,
+                    paddr,
+                    PAGING_FL_US | PAGING_FL_SHARED | (rw ? PAGING_FL_RW : 0));
+
+      if (rc) {
+         unmap_pages_permissive(pdir,
+                                um->vaddrp,
+                                (off - um->off) >> PAGE_SHIFT,
+                                false);
+         return rc;
+      }
+   }
+
+   return 0;
+}
+
+static int
+sb16_munmap(struct user_mapping *um, void *vaddrp, size_t len)
+{
+   return generic_fs_munmap(um, vaddrp, len);
+}
+
 static int
 create_sb16_device(int minor,
                    enum vfs_entry_type *type,
@@ -412,11 +668,15 @@ create_sb16_device(int minor,
       .read = sb16_read,
       .write = sb16_write,
       .ioctl = sb16_ioctl,
+      .mmap = sb16_mmap,
+      .munmap = sb16_munmap,
+      .write_ready = sb16_write_ready,
+      .get_wready_cond = sb16_get_wready_cond,
    };
 
    *type = VFS_CHAR_DEV;
    nfo->fops = &static_ops_sb16;
-   nfo->spec_flags = VFS_SPFL_NO_USER_COPY;
+   nfo->spec_flags = VFS_SPFL_NO_USER_COPY | VFS_SPFL_MMAP_SUPPORTED;
    return 0;
 }
 
@@ -434,14 +694,17 @@ init_sb16(void)
    printk("sb16: hw init success, version: %u.%u\n",
           sb16_info.ver_major, sb16_info.ver_minor);
 
-   if (sb16_install_irq_handler() < 0)
-      return;
-
    if (sb16_alloc_buf() < 0) {
       printk("sb16: failed to alloc buffer\n");
       return;
    }
 
+   kmutex_init(&mutex, 0);
+   kcond_init(&cond);
+
+   if (sb16_install_irq_handler() < 0)
+      return;
+
    outb(DSP_WRITE, DSP_ENABLE_SPKR);
 
    struct driver_info *di = kalloc_obj(struct driver_info);
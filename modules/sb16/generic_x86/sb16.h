@@ -5,6 +5,10 @@
 
 #define SB16_DBG_ENABLED       0
 
+/* Default DMA ring: 4 fragments of 8 KB */
+#define SB16_DEFAULT_FRAG_SIZE       (8 * KB)
+#define SB16_DEFAULT_FRAG_COUNT      4
+
 #define DSP_MIXER          0x224
 #define DSP_MIXER_DATA     0x225
 #define DSP_RESET          0x226
@@ -47,8 +51,13 @@ extern struct sb16_info sb16_info;
 u8 sb16_get_irq(void);
 int sb16_detect_dsp_hw_and_reset(void);
 int sb16_check_version(void);
+/*
+ * Both the DMA and the DSP are always programmed in AUTO-INIT mode: the DMA
+ * controller loops over the first `buf_sz` bytes of the buffer, while the DSP
+ * raises an IRQ after every `block_sz` bytes.
+ */
 void sb16_program_dma(u8 bits, u32 buf_sz);
-void sb16_program(struct tilck_sound_params *params, u32 buf_sz);
+void sb16_program(struct tilck_sound_params *params, u32 block_sz);
 void sb16_generate_test_sound(void);
 
 static inline void sb16_irq_ack(void)
@@ -146,14 +146,7 @@ sb16_program_dma(u8 bits, u32 buf_sz)
       channel = DMA_CHANNEL_5;
    }
 
-   dma_mode = DMA_SINGLE_MODE | DMA_READ_TX | channel;
-
-   if (buf_sz == 64 * KB) {
-      SB16_DBG("prog DMA in AUTO INIT mode\n");
-      dma_mode |= DMA_AUTO_INIT;
-   } else {
-      SB16_DBG("prog DMA in SINGLE CYCLE mode\n");
-   }
+   dma_mode = DMA_SINGLE_MODE | DMA_READ_TX | DMA_AUTO_INIT | channel;
 
    outb(mask_reg_cmd, DMA_MASK_CHANNEL | channel);
    outb(rst_ff_cmd, 1);
@@ -180,24 +173,15 @@ sb16_set_sample_rate(u16 sample_rate)
 }
 
 void
-sb16_program(struct tilck_sound_params *p, u32 buf_sz)
+sb16_program(struct tilck_sound_params *p, u32 block_sz)
 {
-   u8 prog_mode = 0;
+   u8 prog_mode = DSP_PLAY | DSP_AUTO_INIT;
    u8 sound_fmt = 0;
    u32 samples_cnt;
 
-   prog_mode |= DSP_PLAY;
-
-   if (buf_sz == 32 * KB) {
-      SB16_DBG("prog DSP in AUTO_INIT mode\n");
-      prog_mode |= DSP_AUTO_INIT;
-   } else {
-      SB16_DBG("prog DSP in SINGLE CYCLE mode\n");
-   }
-
    if (p->bits == 8) {
 
-      samples_cnt = buf_sz;
+      samples_cnt = block_sz;
       prog_mode |= DSP_8_BIT_PROG;
 
       sb16_curr_pause_cmd = DSP_8_BIT_PAUSE;
@@ -206,7 +190,7 @@ sb16_program(struct tilck_sound_params *p, u32 buf_sz)
 
    } else {
 
-      samples_cnt = buf_sz >> 1;
+      samples_cnt = block_sz >> 1;
       prog_mode |= DSP_16_BIT_PROG;
 
       sb16_curr_pause_cmd = DSP_16_BIT_PAUSE;
@@ -129,6 +129,27 @@ void init_serial_port(u16 port)
    outb(port + UART_IER, IER_RCV_AVAIL_INTR);
 }
 
+bool serial_set_baud_rate(u16 port, u32 base_baud, u32 baud)
+{
+   u32 div;
+
+   if (!baud || base_baud % baud)
+      return false;
+
+   div = base_baud / baud;
+
+   if (div > 0xffff)
+      return false;
+
+   uart_set_divisor_latch(port, (u16)div);
+   return true;
+}
+
+void serial_enable_rx_irq(u16 port, bool enable)
+{
+   outb(port + UART_IER, enable ? IER_RCV_AVAIL_INTR : IER_NO_INTR);
+}
+
 bool serial_read_ready(u16 port)
 {
    return !!(inb(port + UART_LSR) & LSR_DATA_READY);
@@ -2,7 +2,6 @@
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/common/printk.h>
-#include <tilck/common/atomics.h>
 
 #include <tilck/kernel/modules.h>
 #include <tilck/kernel/hal.h>
@@ -11,6 +10,8 @@
 #include <tilck/kernel/cmdline.h>
 #include <tilck/kernel/tty.h>
 #include <tilck/kernel/sched.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/safe_ringbuf.h>
 
 #include <tilck/mods/serial.h>
 
@@ -21,8 +22,10 @@ struct serial_device {
    const char *name;
    u16 ioport;
    struct tty *tty;
-   ATOMIC(int) jobs_cnt;
-   struct worker_thread *wth;
+
+   /* RX ring: filled by the IRQ handler, drained by the worker thread */
+   struct safe_ringbuf rx_rb;
+   volatile bool rx_throttled;   /* RX IRQ disabled because rx_rb was full */
 };
 
 struct serial_device legacy_serial_ports[] =
@@ -48,49 +51,64 @@ struct serial_device legacy_serial_ports[] =
 static void ser_bh_handler(void *ctx)
 {
    struct serial_device *const dev = ctx;
-   struct tty *const t = dev->tty;
-   const u16 p = dev->ioport;
-   char c;
+   char buf[64];
+   ulong var;
+   u32 n;
 
-   while (serial_read_ready(p)) {
+   do {
 
-      c = serial_read(p);
-      tty_send_keyevent(t, make_key_event(0, c, true), true);
-   }
+      for (n = 0; n < sizeof(buf); n++)
+         if (!safe_ringbuf_read_1(&dev->rx_rb, &buf[n]))
+            break;
+
+      if (n)
+         tty_send_input(dev->tty, buf, n, true);
+
+   } while (n == sizeof(buf));
 
-   dev->jobs_cnt--;
+   disable_interrupts(&var);
+   {
+      if (dev->rx_throttled) {
+         dev->rx_throttled = false;
+         serial_enable_rx_irq(dev->ioport, true);
+      }
+   }
+   enable_interrupts(&var);
 }
 
-static enum irq_action serial_con_irq_handler(void *ctx)
+static enum irq_action serial_con_irq_check(void *ctx)
 {
    struct serial_device *const dev = ctx;
+   const u16 p = dev->ioport;
+   bool was_empty;
+   char c;
 
-   if (!serial_read_ready(dev->ioport))
+   if (dev->rx_throttled || !serial_read_ready(p))
       return IRQ_NOT_HANDLED; /* Not an IRQ from this "device" [irq sharing] */
 
-   if (dev->jobs_cnt >= 2)
-      return IRQ_HANDLED;
-
-   if (UNLIKELY(in_panic())) {
-
-      /* Special panic-only trick: see the comment in keyboard_irq_handler() */
-      ulong val;
-      disable_interrupts(&val);
-      {
-         dev->jobs_cnt++;
-         ser_bh_handler(dev);
+   /*
+    * Drain the whole HW FIFO here, in the IRQ handler, so that the FIFO won't
+    * overrun while the worker thread is busy with the tty input processing.
+    */
+   do {
+
+      if (safe_ringbuf_is_full(&dev->rx_rb)) {
+
+         /*
+          * Stop accepting data until the worker thread makes some room.
+          * The data in excess stays in the UART.
+          */
+         dev->rx_throttled = true;
+         serial_enable_rx_irq(p, false);
+         break;
       }
-      enable_interrupts(&val);
-      return IRQ_HANDLED;
-   }
 
-   if (!wth_enqueue_on(dev->wth, &ser_bh_handler, dev)) {
-      printk("Serial: WARNING: hit job queue limit\n");
-      return IRQ_HANDLED;
-   }
+      c = serial_read(p);
+      safe_ringbuf_write_1(&dev->rx_rb, &c, &was_empty);
 
-   dev->jobs_cnt++;
-   return IRQ_HANDLED;
+   } while (serial_read_ready(p));
+
+   return IRQ_WAKE_THREAD;
 }
 
 void early_init_serial_ports(void)
@@ -101,10 +119,38 @@ void early_init_serial_ports(void)
    init_serial_port(COM4);
 }
 
-DEFINE_IRQ_HANDLER_NODE(com1, serial_con_irq_handler, &legacy_serial_ports[0]);
-DEFINE_IRQ_HANDLER_NODE(com2, serial_con_irq_handler, &legacy_serial_ports[1]);
-DEFINE_IRQ_HANDLER_NODE(com3, serial_con_irq_handler, &legacy_serial_ports[2]);
-DEFINE_IRQ_HANDLER_NODE(com4, serial_con_irq_handler, &legacy_serial_ports[3]);
+#define DEFINE_SERIAL_IRQ(var, n)                                          \
+   DEFINE_THREADED_IRQ(var,                                                \
+                       #var,                                               \
+                       &serial_con_irq_check,                              \
+                       &ser_bh_handler,                                    \
+                       &legacy_serial_ports[n],                            \
+                       IRQ_THREAD_FL_NO_MASK)
+
+DEFINE_SERIAL_IRQ(com1, 0);
+DEFINE_SERIAL_IRQ(com2, 1);
+DEFINE_SERIAL_IRQ(com3, 2);
+DEFINE_SERIAL_IRQ(com4, 3);
+
+static void init_serial_device(struct serial_device *dev, int n)
+{
+   const u16 rx_buf_sz = SERIAL_RX_BUF_SIZE;
+   char *rx_buf;
+
+   if (!(rx_buf = kmalloc(rx_buf_sz)))
+      panic("Serial: unable to alloc the RX buffer");
+
+   dev->tty = get_serial_tty(n);
+   safe_ringbuf_init(&dev->rx_rb, rx_buf_sz, 1, rx_buf);
+
+   if (!serial_set_baud_rate(dev->ioport,
+                             (u32)kopt_serial_base_baud,
+                             (u32)kopt_serial_baud))
+   {
+      printk("Serial: unsupported baud rate %ld (base: %ld) for %s\n",
+             kopt_serial_baud, kopt_serial_base_baud, dev->name);
+   }
+}
 
 static void init_serial_comm(void)
 {
@@ -119,18 +165,13 @@ static void init_serial_comm(void)
    }
    enable_preemption();
 
-   for (int i = 0; i < ARRAY_SIZE(legacy_serial_ports); i++) {
-
-      struct serial_device *dev = &legacy_serial_ports[i];
-
-      dev->tty = get_serial_tty((int)i);
-      dev->wth = wth;
-   }
+   for (int i = 0; i < ARRAY_SIZE(legacy_serial_ports); i++)
+      init_serial_device(&legacy_serial_ports[i], i);
 
-   irq_install_handler(X86_PC_COM1_COM3_IRQ, &com1);
-   irq_install_handler(X86_PC_COM1_COM3_IRQ, &com3);
-   irq_install_handler(X86_PC_COM2_COM4_IRQ, &com2);
-   irq_install_handler(X86_PC_COM2_COM4_IRQ, &com4);
+   irq_install_threaded_handler(X86_PC_COM1_COM3_IRQ, &com1, wth);
+   irq_install_threaded_handler(X86_PC_COM1_COM3_IRQ, &com3, wth);
+   irq_install_threaded_handler(X86_PC_COM2_COM4_IRQ, &com2, wth);
+   irq_install_threaded_handler(X86_PC_COM2_COM4_IRQ, &com4, wth);
 }
 
 static struct module serial_module = {
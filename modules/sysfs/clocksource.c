@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/timer.h>
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * The clocksource can change at runtime (e.g. it falls back to the PIT when
+ * the TSC turns out to be unstable): always read it on load.
+ */
+
+static offt
+clocksource_name_load(struct sysobj *obj,
+                      void *data,
+                      void *buf,
+                      offt buf_sz,
+                      offt off)
+{
+   struct clocksource_info nfo;
+   ASSERT(off == 0);
+
+   timer_get_clocksource(&nfo);
+   return snprintk(buf, (size_t)buf_sz, "%s\n", nfo.name);
+}
+
+static offt
+clocksource_freq_load(struct sysobj *obj,
+                      void *data,
+                      void *buf,
+                      offt buf_sz,
+                      offt off)
+{
+   struct clocksource_info nfo;
+   ASSERT(off == 0);
+
+   timer_get_clocksource(&nfo);
+   return snprintk(buf, (size_t)buf_sz, "%u\n", nfo.freq_khz);
+}
+
+static offt
+clocksource_res_load(struct sysobj *obj,
+                     void *data,
+                     void *buf,
+                     offt buf_sz,
+                     offt off)
+{
+   struct clocksource_info nfo;
+   ASSERT(off == 0);
+
+   timer_get_clocksource(&nfo);
+   return snprintk(buf, (size_t)buf_sz, "%u\n", nfo.res_ns);
+}
+
+static const struct sysobj_prop_type ptype_clocksource_name = {
+   .load = &clocksource_name_load
+};
+
+static const struct sysobj_prop_type ptype_clocksource_freq = {
+   .load = &clocksource_freq_load
+};
+
+static const struct sysobj_prop_type ptype_clocksource_res = {
+   .load = &clocksource_res_load
+};
+
+DEF_STATIC_SYSOBJ_PROP(current, &ptype_clocksource_name);
+DEF_STATIC_SYSOBJ_PROP(freq_khz, &ptype_clocksource_freq);
+DEF_STATIC_SYSOBJ_PROP(resolution_ns, &ptype_clocksource_res);
+
+void sysfs_create_clocksource_obj(void)
+{
+   struct sysobj *cs;
+
+   cs = sysfs_create_custom_obj(
+      "clocksource",
+      NULL,       /* hooks */
+      &prop_current, NULL,
+      &prop_freq_khz, NULL,
+      &prop_resolution_ns, NULL,
+      NULL
+   );
+
+   if (!cs)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "clocksource", cs))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs clocksource obj");
+}
@@ -41,6 +41,7 @@ DEF_STATIC_CONF_RO(BOOL,  selftests,               KERNEL_SELFTESTS);
 DEF_STATIC_CONF_RO(BOOL,  stack_isolation,         KERNEL_STACK_ISOLATION);
 DEF_STATIC_CONF_RO(BOOL,  symbols,                 KERNEL_SYMBOLS);
 DEF_STATIC_CONF_RO(BOOL,  printk_on_curr_tty,      KRN_PRINTK_ON_CURR_TTY);
+DEF_STATIC_CONF_RO(BOOL,  printk_async,            KRN_PRINTK_ASYNC);
 DEF_STATIC_CONF_RO(BOOL,  resched_enable_preempt,  KRN_RESCHED_ENABLE_PREEMPT);
 DEF_STATIC_CONF_RO(BOOL,  big_io_buf,              KERNEL_BIG_IO_BUF);
 DEF_STATIC_CONF_RO(BOOL,  gcov,                    KERNEL_GCOV);
@@ -105,6 +106,7 @@ void sysfs_create_config_obj(void)
       SYSOBJ_CONF_PROP_PAIR(stack_isolation),
       SYSOBJ_CONF_PROP_PAIR(symbols),
       SYSOBJ_CONF_PROP_PAIR(printk_on_curr_tty),
+      SYSOBJ_CONF_PROP_PAIR(printk_async),
       SYSOBJ_CONF_PROP_PAIR(resched_enable_preempt),
       SYSOBJ_CONF_PROP_PAIR(big_io_buf),
       SYSOBJ_CONF_PROP_PAIR(gcov),
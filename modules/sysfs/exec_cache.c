@@ -0,0 +1,67 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/elf_loader.h>
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * The counters of the exec image cache. The data of each property is the
+ * offset of its counter in struct exec_cache_stats.
+ */
+
+static offt
+exec_cache_counter_load(struct sysobj *obj,
+                        void *data,
+                        void *buf,
+                        offt buf_sz,
+                        offt off)
+{
+   struct exec_cache_stats stats;
+   ASSERT(off == 0);
+
+   exec_cache_get_stats(&stats);
+   return snprintk(buf, (size_t)buf_sz, "%lu\n",
+                   *(ulong *)((char *)&stats + (ulong)data));
+}
+
+static const struct sysobj_prop_type ptype_exec_cache_counter = {
+   .load = &exec_cache_counter_load
+};
+
+DEF_STATIC_SYSOBJ_PROP(hits, &ptype_exec_cache_counter);
+DEF_STATIC_SYSOBJ_PROP(misses, &ptype_exec_cache_counter);
+DEF_STATIC_SYSOBJ_PROP(invalidations, &ptype_exec_cache_counter);
+DEF_STATIC_SYSOBJ_PROP(entries, &ptype_exec_cache_counter);
+
+#define COUNTER_OFF(name) \
+   TO_PTR(OFFSET_OF(struct exec_cache_stats, name))
+
+void sysfs_create_exec_cache_obj(void)
+{
+   struct sysobj *ec;
+
+   ec = sysfs_create_custom_obj(
+      "exec_cache",
+      NULL,       /* hooks */
+      &prop_hits, COUNTER_OFF(hits),
+      &prop_misses, COUNTER_OFF(misses),
+      &prop_invalidations, COUNTER_OFF(invalidations),
+      &prop_entries, COUNTER_OFF(entries),
+      NULL
+   );
+
+   if (!ec)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "exec_cache", ec))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs exec_cache obj");
+}
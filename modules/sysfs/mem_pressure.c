@@ -0,0 +1,75 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/mem_pressure.h>
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * The memory pressure counters. The data of each property is the offset of
+ * its counter in struct mem_pressure_stats.
+ */
+
+static offt
+mem_pressure_counter_load(struct sysobj *obj,
+                          void *data,
+                          void *buf,
+                          offt buf_sz,
+                          offt off)
+{
+   struct mem_pressure_stats stats;
+   ASSERT(off == 0);
+
+   mem_pressure_get_stats(&stats);
+   return snprintk(buf, (size_t)buf_sz, "%lu\n",
+                   *(ulong *)((char *)&stats + (ulong)data));
+}
+
+static const struct sysobj_prop_type ptype_mem_pressure_counter = {
+   .load = &mem_pressure_counter_load
+};
+
+DEF_STATIC_SYSOBJ_PROP(free_kb, &ptype_mem_pressure_counter);
+DEF_STATIC_SYSOBJ_PROP(low_wmark_kb, &ptype_mem_pressure_counter);
+DEF_STATIC_SYSOBJ_PROP(high_wmark_kb, &ptype_mem_pressure_counter);
+DEF_STATIC_SYSOBJ_PROP(direct_reclaims, &ptype_mem_pressure_counter);
+DEF_STATIC_SYSOBJ_PROP(bg_reclaims, &ptype_mem_pressure_counter);
+DEF_STATIC_SYSOBJ_PROP(reclaimed_kb, &ptype_mem_pressure_counter);
+DEF_STATIC_SYSOBJ_PROP(fault_waits, &ptype_mem_pressure_counter);
+DEF_STATIC_SYSOBJ_PROP(oom_kills, &ptype_mem_pressure_counter);
+
+#define COUNTER_OFF(name) \
+   TO_PTR(OFFSET_OF(struct mem_pressure_stats, name))
+
+void sysfs_create_mem_pressure_obj(void)
+{
+   struct sysobj *mp;
+
+   mp = sysfs_create_custom_obj(
+      "mem_pressure",
+      NULL,       /* hooks */
+      &prop_free_kb, COUNTER_OFF(free_kb),
+      &prop_low_wmark_kb, COUNTER_OFF(low_wmark_kb),
+      &prop_high_wmark_kb, COUNTER_OFF(high_wmark_kb),
+      &prop_direct_reclaims, COUNTER_OFF(direct_reclaims),
+      &prop_bg_reclaims, COUNTER_OFF(bg_reclaims),
+      &prop_reclaimed_kb, COUNTER_OFF(reclaimed_kb),
+      &prop_fault_waits, COUNTER_OFF(fault_waits),
+      &prop_oom_kills, COUNTER_OFF(oom_kills),
+      NULL
+   );
+
+   if (!mp)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "mem_pressure", mp))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs mem_pressure obj");
+}
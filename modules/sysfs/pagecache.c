@@ -0,0 +1,69 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/fs/pagecache.h>
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * The counters of the page cache. The data of each property is the
+ * offset of its counter in struct pagecache_stats.
+ */
+
+static offt
+pagecache_counter_load(struct sysobj *obj,
+                        void *data,
+                        void *buf,
+                        offt buf_sz,
+                        offt off)
+{
+   struct pagecache_stats stats;
+   ASSERT(off == 0);
+
+   pagecache_get_stats(&stats);
+   return snprintk(buf, (size_t)buf_sz, "%lu\n",
+                   *(ulong *)((char *)&stats + (ulong)data));
+}
+
+static const struct sysobj_prop_type ptype_pagecache_counter = {
+   .load = &pagecache_counter_load
+};
+
+DEF_STATIC_SYSOBJ_PROP(pages, &ptype_pagecache_counter);
+DEF_STATIC_SYSOBJ_PROP(dirty, &ptype_pagecache_counter);
+DEF_STATIC_SYSOBJ_PROP(hits, &ptype_pagecache_counter);
+DEF_STATIC_SYSOBJ_PROP(misses, &ptype_pagecache_counter);
+DEF_STATIC_SYSOBJ_PROP(evictions, &ptype_pagecache_counter);
+
+#define COUNTER_OFF(name) \
+   TO_PTR(OFFSET_OF(struct pagecache_stats, name))
+
+void sysfs_create_pagecache_obj(void)
+{
+   struct sysobj *pc;
+
+   pc = sysfs_create_custom_obj(
+      "pagecache",
+      NULL,       /* hooks */
+      &prop_pages, COUNTER_OFF(pages),
+      &prop_dirty, COUNTER_OFF(dirty),
+      &prop_hits, COUNTER_OFF(hits),
+      &prop_misses, COUNTER_OFF(misses),
+      &prop_evictions, COUNTER_OFF(evictions),
+      NULL
+   );
+
+   if (!pc)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "pagecache", pc))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs pagecache obj");
+}
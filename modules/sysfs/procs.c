@@ -0,0 +1,147 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/string_util.h>
+
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/sched.h>
+#include <tilck/mods/sysfs.h>
+#include <tilck/mods/sysfs_utils.h>
+
+/*
+ * The per-process memory usage, as a table with one line for each user
+ * process. All the sizes are in KB, while the fault counters are plain
+ * numbers. Sysfs objects cannot be unregistered, that's why there are no
+ * per-pid directories.
+ */
+
+#define PROCS_MEM_LINE_MAX          128
+
+static const char procs_mem_header[] =
+   "  pid private_kb shared_kb cow_kb pt_kb kernel_kb maxrss_kb"
+   "   minflt   cowflt\n";
+
+struct procs_mem_ctx {
+
+   char *buf;
+   size_t buf_sz;
+   size_t used;
+};
+
+static bool is_user_proc(struct task *ti)
+{
+   return !is_kernel_thread(ti) &&
+          is_main_thread(ti) &&
+          ti->state != TASK_STATE_ZOMBIE;
+}
+
+static int procs_count_cb(void *obj, void *arg)
+{
+   if (is_user_proc(obj))
+      (*(size_t *)arg)++;
+
+   return 0;
+}
+
+static int procs_mem_line_cb(void *obj, void *arg)
+{
+   struct task *ti = obj;
+   struct procs_mem_ctx *ctx = arg;
+   struct proc_mem_usage mu;
+   const ulong pg_kb = PAGE_SIZE / KB;
+   int rc;
+
+   if (!is_user_proc(ti))
+      return 0;
+
+   if (ctx->buf_sz - ctx->used < PROCS_MEM_LINE_MAX)
+      return 1; /* stop: new processes appeared after get_buf_sz() */
+
+   process_get_mem_usage(ti->pi, &mu);
+
+   rc = snprintk(ctx->buf + ctx->used,
+                 ctx->buf_sz - ctx->used,
+                 "%5d %10lu %9lu %6lu %5lu %9lu %9lu %8lu %8lu\n",
+                 ti->pi->pid,
+                 mu.pages.private_pages * pg_kb,
+                 mu.pages.shared_pages * pg_kb,
+                 mu.pages.cow_pages * pg_kb,
+                 mu.pages.pt_pages * pg_kb,
+                 (ulong)(mu.kernel_bytes / KB),
+                 mu.counters.max_rss * pg_kb,
+                 mu.counters.minflt,
+                 mu.counters.cow_faults);
+
+   ctx->used += (size_t)rc;
+   return 0;
+}
+
+static offt
+procs_mem_get_buf_sz(struct sysobj *obj, void *data)
+{
+   size_t n = 0;
+
+   disable_preemption();
+   {
+      iterate_over_tasks(&procs_count_cb, &n);
+   }
+   enable_preemption();
+
+   /* Leave some room for a few processes created before load() */
+   return (offt)((n + 4) * PROCS_MEM_LINE_MAX);
+}
+
+static offt
+procs_mem_load(struct sysobj *obj, void *data, void *buf, offt buf_sz, offt off)
+{
+   struct procs_mem_ctx ctx = {
+      .buf = buf,
+      .buf_sz = (size_t)buf_sz,
+      .used = 0,
+   };
+
+   ASSERT(off == 0);
+   ASSERT(ctx.buf_sz >= PROCS_MEM_LINE_MAX);
+
+   memcpy(ctx.buf, procs_mem_header, sizeof(procs_mem_header) - 1);
+   ctx.used = sizeof(procs_mem_header) - 1;
+
+   disable_preemption();
+   {
+      iterate_over_tasks(&procs_mem_line_cb, &ctx);
+   }
+   enable_preemption();
+   return (offt)ctx.used;
+}
+
+static const struct sysobj_prop_type ptype_procs_mem = {
+   .get_buf_sz = &procs_mem_get_buf_sz,
+   .load = &procs_mem_load,
+};
+
+DEF_STATIC_SYSOBJ_PROP(mem, &ptype_procs_mem);
+
+void sysfs_create_procs_obj(void)
+{
+   struct sysobj *procs;
+
+   procs = sysfs_create_custom_obj(
+      "procs",
+      NULL,       /* hooks */
+      &prop_mem, NULL,
+      NULL
+   );
+
+   if (!procs)
+      goto fail;
+
+   if (sysfs_register_obj(NULL, &sysfs_root_obj, "procs", procs))
+      goto fail;
+
+   /* Success */
+   return;
+
+fail:
+   panic("Unable to create the sysfs procs obj");
+}
@@ -25,6 +25,11 @@
 #include "lock_and_retain.c.h"
 
 void sysfs_create_config_obj(void);
+void sysfs_create_clocksource_obj(void);
+void sysfs_create_exec_cache_obj(void);
+void sysfs_create_pagecache_obj(void);
+void sysfs_create_mem_pressure_obj(void);
+void sysfs_create_procs_obj(void);
 static struct mnt_fs *sysfs;
 
 static int
@@ -756,6 +761,11 @@ init_sysfs(void)
       panic("Unable to create default objects");
 
    sysfs_create_config_obj();
+   sysfs_create_clocksource_obj();
+   sysfs_create_exec_cache_obj();
+   sysfs_create_pagecache_obj();
+   sysfs_create_mem_pressure_obj();
+   sysfs_create_procs_obj();
 }
 
 static struct module sysfs_module = {
@@ -17,6 +17,7 @@ set(
    general_kmalloc
    general_kfree
    kmalloc_get_first_heap
+   get_sys_time
    vfs_dup
    vfs_close
    use_kernel_arg
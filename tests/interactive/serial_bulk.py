@@ -0,0 +1,52 @@
+# SPDX-License-Identifier: BSD-2-Clause
+# pylint: skip-file
+#
+# NOTE: this file, as all the others in this directory, run in the same global
+# context as their runner (run_interactive_test).
+#
+# Stream 1 MB of random data through the serial tty (/dev/ttyS0, in raw mode)
+# and check that Tilck received all of it, unchanged.
+
+import random
+import hashlib
+
+# pySerial is optional, as for dump_coverage_data(): skip the test without it
+try:
+   import serial # type: ignore
+except ImportError:
+   serial = None
+   msg_print("[SKIP] serial_bulk: the pySerial module is not installed")
+
+SER_BULK_SIZE = 1024 * 1024
+
+if serial:
+
+   rnd = random.Random(1234)
+   data = rnd.getrandbits(8 * SER_BULK_SIZE).to_bytes(SER_BULK_SIZE, "little")
+   expected = hashlib.sha1(data).hexdigest()
+
+   with serial.Serial(g_serial_pts, timeout = 1) as ser:
+
+      # Make the shell on ttyS0 read exactly SER_BULK_SIZE bytes, in raw mode
+      ser.write("\n".encode("latin-1"))
+      ser.write(
+         "stty raw -echo -iexten; head -c {} > /tmp/ser_bulk; stty sane\n"
+         .format(SER_BULK_SIZE)
+         .encode("latin-1")
+      )
+
+      time.sleep(1)
+      ser.reset_input_buffer()
+
+      for i in range(0, SER_BULK_SIZE, 4096):
+         ser.write(data[i:i+4096])
+
+      ser.flush()
+
+   send_to_vm_and_find_text(
+      r"sleep 2; ls -l /tmp/ser_bulk; sha1sum /tmp/ser_bulk{ret}",
+      False,
+      [str(SER_BULK_SIZE), expected]
+   )
+
+   send_string_to_vm(r"rm /tmp/ser_bulk; clear{ret}")
@@ -10,6 +10,9 @@ def env_bool(x):
 def env_int(x, val):
    return Const(int(os.environ.get(x, str(val))))
 
+def env_str(x, val):
+   return Const(os.environ.get(x, val))
+
 VM_MEMORY_SIZE_IN_MB = env_int('TILCK_VM_MEM', 128)
 GEN_TEST_DATA = env_bool('GEN_TEST_DATA')
 IN_TRAVIS = env_bool('TRAVIS')
@@ -19,6 +22,8 @@ CI = env_bool('CI')
 DUMP_COV = env_bool('DUMP_COV')
 REPORT_COV = env_bool('REPORT_COV')
 VERBOSE = env_bool('VERBOSE')
+SC_BENCH_BASELINE = env_str('TILCK_SC_BENCH_BASELINE', '')
+SC_BENCH_TOLERANCE = env_int('TILCK_SC_BENCH_TOLERANCE', 25)
 IN_ANY_CI = Const(IN_TRAVIS.val or IN_CIRCLECI.val or IN_AZURE.val or CI.val)
 
 ReloadAsConstModule(__name__)
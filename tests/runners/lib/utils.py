@@ -37,6 +37,7 @@ class Fail(Enum):
    some_tests_failed       = 14
    no_tests_matching       = 15
    other                   = 16
+   perf_regression         = 17
 
 # Globals
 __g_fail_reason = Fail.success
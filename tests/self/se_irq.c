@@ -0,0 +1,47 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/irq.h>
+#include <tilck/kernel/self_tests.h>
+
+#ifdef __i386__
+
+/*
+ * Measures the interrupt controller's overhead of an IRQ round-trip: the line
+ * is masked and acknowledged on entry and unmasked on exit. Run it with and
+ * without the `-noapic` kernel option in order to compare the I/O APIC with
+ * the legacy PIC.
+ */
+void selftest_irq_ctrl_perf(void)
+{
+   const int iters = 10000;
+   const int irq = X86_PC_FLOPPY_IRQ;
+   const bool was_masked = irq_is_masked(irq);
+   u64 start, duration;
+
+   disable_interrupts_forced();
+   {
+      start = RDTSC();
+
+      for (int i = 0; i < iters; i++) {
+         irq_mask_and_send_eoi(irq);
+         irq_clear_mask(irq);
+      }
+
+      duration = RDTSC() - start;
+
+      if (was_masked)
+         irq_set_mask(irq);
+   }
+   enable_interrupts_forced();
+
+   printk("IRQ controller round-trip (%s): %llu cycles\n",
+          irq_get_controller_name(), duration / iters);
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(irq_ctrl_perf, se_short, &selftest_irq_ctrl_perf)
+#endif
@@ -0,0 +1,532 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * kmalloc benchmark & fragmentation suite
+ * -----------------------------------------
+ *
+ * Runs a fixed matrix of (allocation path) x (size distribution) x (object
+ * lifetime) workloads, each one with its own deterministic PRNG seed, in order
+ * to make the results comparable across commits. Results are emitted as CSV
+ * lines, prefixed by a record type, so they can be easily grepped out of the
+ * kernel log or of the unit tests output:
+ *
+ *    KMALLOC_BENCH,<case columns>
+ *    KMALLOC_BENCH_HEAP,<per-heap fragmentation columns>
+ *
+ * The per-heap fragmentation is measured when the working set of a case is
+ * fully allocated (before draining it) as:
+ *
+ *    ext_frag = 1 - largest_free_block / total_free_mem
+ *
+ * Latencies are collected in a log-linear histogram with 8 sub-buckets per
+ * power of 2, therefore the reported p50/p99 values have a ~12% resolution.
+ */
+
+#include <tilck/common/basic_defs.h>
+#include <tilck/common/printk.h>
+#include <tilck/common/utils.h>
+
+#include <tilck_gen_headers/config_kmalloc.h>
+
+#include <tilck/kernel/hal.h>
+#include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/kmalloc_debug.h>
+#include <tilck/kernel/datetime.h>
+#include <tilck/kernel/process.h>
+#include <tilck/kernel/process_mm.h>
+#include <tilck/kernel/fs/vfs_base.h>
+#include <tilck/kernel/self_tests.h>
+
+#define KB_HIST_BUCKETS              256
+#define KB_MAX_MIX_ENTRIES            64
+#define KB_MAX_MIX_CHUNK_SIZE   (64 * KB)
+#define KB_PEAK_SAMPLE_INTERVAL       32
+
+struct kb_obj {
+   void *ptr;
+   size_t size;
+};
+
+struct kb_mix_entry {
+   size_t size;
+   size_t count;
+};
+
+struct kb_path {
+
+   const char *name;
+   u32 window;                       /* max number of live objects */
+   u32 ops;                          /* number of allocations per case */
+   bool page_sizes;                  /* use the `pages` distribution only */
+
+   void *(*alloc)(size_t size, u32 align);
+   void (*free)(void *ptr, size_t size);
+};
+
+struct kb_dist {
+   const char *name;
+   size_t (*get_size)(void);
+};
+
+struct kb_lifetime {
+   const char *name;
+   void (*run)(const struct kb_path *p, const struct kb_dist *d);
+};
+
+static u32 kb_rand_state;
+static struct kb_obj *kb_objs;
+static u32 kb_alloc_hist[KB_HIST_BUCKETS];
+static u32 kb_free_hist[KB_HIST_BUCKETS];
+static size_t kb_mem_baseline;
+static size_t kb_peak_mem;
+static u32 kb_alloc_count;
+static u32 kb_free_count;
+static const char *kb_case_name;
+
+static struct kb_mix_entry kb_mix[KB_MAX_MIX_ENTRIES];
+static u32 kb_mix_len;
+static size_t kb_mix_tot;
+static bool kb_mix_recorded;
+
+/* xorshift32: deterministic and cheap, without any float math */
+static u32 kb_rand(void)
+{
+   u32 x = kb_rand_state;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   return kb_rand_state = x;
+}
+
+static u32 kb_ilog2(ulong v)
+{
+   u32 r = 0;
+
+   while (v >>= 1)
+      r++;
+
+   return r;
+}
+
+static u32 kb_hist_bucket(u64 val)
+{
+   u32 c = val > UINT32_MAX ? UINT32_MAX : (u32)val;
+   u32 e;
+
+   if (c < 8)
+      return c;
+
+   e = kb_ilog2(c);
+   return 8 + (e - 3) * 8 + ((c >> (e - 3)) & 7);
+}
+
+static u32 kb_hist_bucket_val(u32 idx)
+{
+   u32 e, m;
+
+   if (idx < 8)
+      return idx;
+
+   e = (idx - 8) / 8 + 3;
+   m = (idx - 8) % 8;
+   return (8 + m) << (e - 3);
+}
+
+static u32 kb_hist_percentile(u32 *hist, u32 count, u32 pct)
+{
+   const u32 target = (u32)(((u64)count * pct + 99) / 100);
+   u32 sum = 0;
+
+   for (u32 i = 0; i < KB_HIST_BUCKETS; i++) {
+
+      sum += hist[i];
+
+      if (sum >= target && sum > 0)
+         return kb_hist_bucket_val(i);
+   }
+
+   return 0;
+}
+
+static size_t kb_get_heaps_mem_allocated(void)
+{
+   struct debug_kmalloc_heap_info hi;
+   size_t tot = 0;
+
+   for (int i = 0; i < KMALLOC_HEAPS_COUNT; i++) {
+
+      if (!debug_kmalloc_get_heap_info(i, &hi))
+         break;
+
+      tot += hi.mem_allocated;
+   }
+
+   return tot;
+}
+
+static void kb_sample_peak_mem(void)
+{
+   const size_t mem = kb_get_heaps_mem_allocated();
+
+   if (mem > kb_mem_baseline)
+      kb_peak_mem = MAX(kb_peak_mem, mem - kb_mem_baseline);
+}
+
+/* Size distributions */
+
+static size_t kb_dist_uniform(void)
+{
+   return 1 + kb_rand() % 4096;
+}
+
+/*
+ * Power-law: the probability of picking a size in [2^k, 2^(k+1)) halves at
+ * each k, from 8 bytes to 64 KB. In other words, the expected number of bytes
+ * allocated in each power-of-two range is roughly the same.
+ */
+static size_t kb_dist_power_law(void)
+{
+   const u32 r = kb_rand();
+   const u32 k = 3 + MIN(r ? get_first_set_bit_index32(r) : 32u, 12u);
+   return ((size_t)1 << k) + kb_rand() % ((size_t)1 << k);
+}
+
+/*
+ * Kernel object mix: with KMALLOC_HEAVY_STATS, use the chunk sizes (and their
+ * counts) actually recorded by kmalloc since boot. Otherwise, fall back to
+ * some common kernel objects with rough relative frequencies.
+ */
+static size_t kb_dist_kobjs(void)
+{
+   size_t r = kb_rand() % kb_mix_tot;
+
+   for (u32 i = 0; i < kb_mix_len; i++) {
+
+      if (r < kb_mix[i].count)
+         return kb_mix[i].size;
+
+      r -= kb_mix[i].count;
+   }
+
+   NOT_REACHED();
+}
+
+static size_t kb_dist_pages(void)
+{
+   return PAGE_SIZE * (1 + kb_rand() % 16);
+}
+
+static void kb_mix_add(size_t size, size_t count)
+{
+   if (kb_mix_len == ARRAY_SIZE(kb_mix))
+      return;
+
+   kb_mix[kb_mix_len++] = (struct kb_mix_entry) { size, count };
+   kb_mix_tot += count;
+}
+
+static void kb_init_kobjs_mix(void)
+{
+   struct debug_kmalloc_chunks_ctx ctx;
+   size_t size, count;
+
+   kb_mix_len = 0;
+   kb_mix_tot = 0;
+
+   if (KMALLOC_HEAVY_STATS) {
+
+      disable_preemption();
+      {
+         debug_kmalloc_chunks_stats_start_read(&ctx);
+
+         while (debug_kmalloc_chunks_stats_next(&ctx, &size, &count)) {
+            if (size <= KB_MAX_MIX_CHUNK_SIZE)
+               kb_mix_add(size, count);
+         }
+      }
+      enable_preemption();
+   }
+
+   kb_mix_recorded = kb_mix_len > 0;
+
+   if (kb_mix_recorded)
+      return;
+
+   kb_mix_add(sizeof(struct user_mapping), 16);
+   kb_mix_add(sizeof(struct fs_handle_base), 8);
+   kb_mix_add(sizeof(struct task), 2);
+   kb_mix_add(sizeof(struct process), 2);
+   kb_mix_add(16, 16);
+   kb_mix_add(32, 16);
+   kb_mix_add(64, 8);
+   kb_mix_add(256, 4);
+   kb_mix_add(PAGE_SIZE, 8);
+   kb_mix_add(4 * PAGE_SIZE, 1);
+}
+
+/* Allocation paths */
+
+static void *kb_kmalloc(size_t size, u32 align)
+{
+   return kmalloc(size);
+}
+
+static void *kb_aligned_kmalloc(size_t size, u32 align)
+{
+   return aligned_kmalloc(size, align);
+}
+
+static void *kb_vmalloc(size_t size, u32 align)
+{
+   return vmalloc(size);
+}
+
+/*
+ * Pick a power-of-two alignment between 1 and MIN(size, PAGE_SIZE), derived
+ * from the size itself in order to not alter the sequence of random sizes:
+ * that allows kmalloc() and aligned_kmalloc() to be compared on the same
+ * workload.
+ */
+static u32 kb_get_align(size_t size)
+{
+   const u32 max_order = kb_ilog2(MIN(size, (size_t)PAGE_SIZE));
+
+   return 1u << (size % (max_order + 1));
+}
+
+static void kb_do_alloc(const struct kb_path *p, size_t size, u32 idx)
+{
+   const u32 align = kb_get_align(size);
+   u64 start, duration;
+   void *ptr;
+
+   start = RDTSC();
+   ptr = p->alloc(size, align);
+   duration = RDTSC() - start;
+
+   if (!ptr)
+      panic("kmalloc bench [%s]: unable to alloc %zu bytes", kb_case_name, size);
+
+   kb_objs[idx] = (struct kb_obj) { ptr, size };
+   kb_alloc_hist[kb_hist_bucket(duration)]++;
+
+   if (!(++kb_alloc_count % KB_PEAK_SAMPLE_INTERVAL))
+      kb_sample_peak_mem();
+}
+
+static void kb_do_free(const struct kb_path *p, u32 idx)
+{
+   struct kb_obj *o = &kb_objs[idx];
+   u64 start, duration;
+
+   if (!o->ptr)
+      return;
+
+   start = RDTSC();
+   p->free(o->ptr, o->size);
+   duration = RDTSC() - start;
+
+   o->ptr = NULL;
+   kb_free_hist[kb_hist_bucket(duration)]++;
+   kb_free_count++;
+}
+
+static void kb_print_heaps_frag(void)
+{
+   struct debug_kmalloc_heap_info hi;
+   size_t free_mem, largest;
+   u32 frag;
+
+   for (int i = 0; i < KMALLOC_HEAPS_COUNT; i++) {
+
+      if (!debug_kmalloc_get_heap_info(i, &hi))
+         break;
+
+      disable_preemption();
+      {
+         largest = debug_kmalloc_get_heap_largest_free_block(i);
+      }
+      enable_preemption();
+
+      free_mem = hi.size - hi.mem_allocated;
+      frag = free_mem ? (u32)(100 - (u64)largest * 100 / free_mem) : 0;
+
+      printk(NO_PREFIX "KMALLOC_BENCH_HEAP,%s,%d,%zu,%zu,%zu,%u\n",
+             kb_case_name, i, hi.size / KB, free_mem / KB, largest / KB, frag);
+   }
+}
+
+static void kb_drain(const struct kb_path *p)
+{
+   for (u32 i = 0; i < p->window; i++)
+      kb_do_free(p, i);
+}
+
+/* Object lifetimes */
+
+/* Allocate `window` objects, then free them all in the same order */
+static void
+kb_lifetime_batch(const struct kb_path *p, const struct kb_dist *d)
+{
+   const u32 rounds = MAX(p->ops / p->window, 1u);
+
+   for (u32 r = 0; r < rounds; r++) {
+
+      for (u32 i = 0; i < p->window; i++)
+         kb_do_alloc(p, d->get_size(), i);
+
+      kb_sample_peak_mem();
+
+      if (r == rounds - 1)
+         kb_print_heaps_frag();
+
+      kb_drain(p);
+   }
+}
+
+/*
+ * Producer/consumer: objects are released in FIFO order, after other `window`
+ * objects have been allocated.
+ */
+static void
+kb_lifetime_fifo(const struct kb_path *p, const struct kb_dist *d)
+{
+   for (u32 i = 0; i < p->ops; i++) {
+      kb_do_free(p, i % p->window);
+      kb_do_alloc(p, d->get_size(), i % p->window);
+   }
+
+   kb_sample_peak_mem();
+   kb_print_heaps_frag();
+   kb_drain(p);
+}
+
+/* Random lifetimes: each allocation replaces a random live object */
+static void
+kb_lifetime_random(const struct kb_path *p, const struct kb_dist *d)
+{
+   for (u32 i = 0; i < p->ops; i++) {
+      const u32 idx = kb_rand() % p->window;
+      kb_do_free(p, idx);
+      kb_do_alloc(p, d->get_size(), idx);
+   }
+
+   kb_sample_peak_mem();
+   kb_print_heaps_frag();
+   kb_drain(p);
+}
+
+static const struct kb_path kb_paths[] = {
+   { "kmalloc", 512, 8192, false, &kb_kmalloc, &kfree2 },
+   { "aligned_kmalloc", 512, 8192, false, &kb_aligned_kmalloc, &aligned_kfree2},
+   { "vmalloc", 32, 512, true, &kb_vmalloc, &vfree2 },
+};
+
+static const struct kb_dist kb_dists[] = {
+   { "uniform", &kb_dist_uniform },
+   { "power_law", &kb_dist_power_law },
+   { "kobjs", &kb_dist_kobjs },
+};
+
+static const struct kb_dist kb_pages_dist = { "pages", &kb_dist_pages };
+
+static const struct kb_lifetime kb_lifetimes[] = {
+   { "batch", &kb_lifetime_batch },
+   { "fifo", &kb_lifetime_fifo },
+   { "random", &kb_lifetime_random },
+};
+
+static void
+kb_run_case(const struct kb_path *p,
+            const struct kb_dist *d,
+            const struct kb_lifetime *l)
+{
+   static char name[64];
+   u64 start, duration, ops_per_sec = 0;
+   u32 ops;
+
+   snprintk(name, sizeof(name), "%s-%s-%s", p->name, d->name, l->name);
+   kb_case_name = name;
+
+   kb_rand_state = 0x2545f491;
+   kb_peak_mem = 0;
+   kb_alloc_count = 0;
+   kb_free_count = 0;
+   bzero(kb_alloc_hist, sizeof(kb_alloc_hist));
+   bzero(kb_free_hist, sizeof(kb_free_hist));
+   bzero(kb_objs, p->window * sizeof(struct kb_obj));
+   kb_mem_baseline = kb_get_heaps_mem_allocated();
+
+   start = get_sys_time();
+   l->run(p, d);
+   duration = get_sys_time() - start;
+
+   ops = kb_alloc_count + kb_free_count;
+
+   if (duration)
+      ops_per_sec = (u64)ops * BILLION / duration;
+
+   printk(NO_PREFIX "KMALLOC_BENCH,%s,%s,%s,%s,%u,%" PRIu64 ",%u,%u,%u,%u,%zu\n",
+          name, p->name, d->name, l->name, ops, ops_per_sec,
+          kb_hist_percentile(kb_alloc_hist, kb_alloc_count, 50),
+          kb_hist_percentile(kb_alloc_hist, kb_alloc_count, 99),
+          kb_hist_percentile(kb_free_hist, kb_free_count, 50),
+          kb_hist_percentile(kb_free_hist, kb_free_count, 99),
+          kb_peak_mem / KB);
+}
+
+void selftest_kmalloc_bench(void)
+{
+   u32 max_window = 0;
+
+   printk("*** kmalloc bench ***\n");
+
+   for (int i = 0; i < ARRAY_SIZE(kb_paths); i++)
+      max_window = MAX(max_window, kb_paths[i].window);
+
+   kb_objs = kalloc_array_obj(struct kb_obj, max_window);
+
+   if (!kb_objs)
+      panic("No enough memory for the 'kb_objs' buffer");
+
+   kb_init_kobjs_mix();
+   printk("kobjs mix: %s, %u distinct sizes\n",
+          kb_mix_recorded ? "recorded by kmalloc" : "built-in", kb_mix_len);
+
+   printk(NO_PREFIX "KMALLOC_BENCH,case,path,dist,lifetime,ops,ops_per_sec,"
+          "alloc_p50,alloc_p99,free_p50,free_p99,peak_kb\n");
+   printk(NO_PREFIX "KMALLOC_BENCH_HEAP,case,heap,size_kb,free_kb,"
+          "largest_free_kb,ext_frag_pct\n");
+
+   for (int i = 0; i < ARRAY_SIZE(kb_paths); i++) {
+
+      const struct kb_path *p = &kb_paths[i];
+
+      for (int j = 0; j < ARRAY_SIZE(kb_dists); j++) {
+
+         const struct kb_dist *d = p->page_sizes ? &kb_pages_dist : &kb_dists[j];
+
+         if (p->page_sizes && j > 0)
+            break;
+
+         for (int k = 0; k < ARRAY_SIZE(kb_lifetimes); k++) {
+
+            if (se_is_stop_requested())
+               goto out;
+
+            kb_run_case(p, d, &kb_lifetimes[k]);
+         }
+      }
+   }
+
+out:
+   kfree_array_obj(kb_objs, struct kb_obj, max_window);
+   kb_objs = NULL;
+
+   if (se_is_stop_requested())
+      se_interrupted_end();
+   else
+      se_regular_end();
+}
+
+REGISTER_SELF_TEST(kmalloc_bench, se_long, &selftest_kmalloc_bench)
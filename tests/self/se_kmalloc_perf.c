@@ -4,8 +4,11 @@
 #include <tilck/common/printk.h>
 #include <tilck/common/utils.h>
 
+#include <tilck_gen_headers/config_kmalloc.h>
+
 #include <tilck/kernel/hal.h>
 #include <tilck/kernel/kmalloc.h>
+#include <tilck/kernel/kmalloc_debug.h>
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/self_tests.h>
 
@@ -49,10 +52,9 @@ static void kmalloc_perf_per_size(u32 size)
           size, duration / (u64) iters);
 }
 
-void selftest_kmalloc_perf(void)
+static void kmalloc_perf_run(void)
 {
    const int iters = 1000;
-   printk("*** kmalloc perf test ***\n");
 
    allocations = kalloc_array_obj(void *, 10000);
 
@@ -91,11 +93,51 @@ void selftest_kmalloc_perf(void)
    }
 
    kfree_array_obj(allocations, void *, 10000);
+}
 
+static void kmalloc_perf_end(void)
+{
    if (se_is_stop_requested())
       se_interrupted_end();
    else
       se_regular_end();
 }
 
+void selftest_kmalloc_perf(void)
+{
+   printk("*** kmalloc perf test ***\n");
+   kmalloc_perf_run();
+   kmalloc_perf_end();
+}
+
 REGISTER_SELF_TEST(kmalloc_perf, se_long, &selftest_kmalloc_perf)
+
+/*
+ * Compare the performance of kmalloc with and without the per-order free lists
+ * in the main heaps. In the first case, the allocations are made by descending
+ * the metadata tree, starting from the root.
+ */
+void selftest_kmalloc_perf_cmp(void)
+{
+   if (!KMALLOC_FREE_LISTS) {
+      printk("kmalloc free lists are NOT compiled in: nothing to compare\n");
+      se_regular_end();
+      return;
+   }
+
+   printk("*** kmalloc perf test: metadata tree only ***\n");
+   debug_kmalloc_set_free_lists(false);
+   kmalloc_perf_run();
+   debug_kmalloc_set_free_lists(true);
+
+   if (se_is_stop_requested()) {
+      se_interrupted_end();
+      return;
+   }
+
+   printk("*** kmalloc perf test: with free lists ***\n");
+   kmalloc_perf_run();
+   kmalloc_perf_end();
+}
+
+REGISTER_SELF_TEST(kmalloc_perf_cmp, se_long, &selftest_kmalloc_perf_cmp)
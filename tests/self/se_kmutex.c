@@ -12,6 +12,8 @@
 #include <tilck/kernel/debug_utils.h>
 #include <tilck/kernel/self_tests.h>
 #include <tilck/kernel/timer.h>
+#include <tilck/kernel/hrtimer.h>
+#include <tilck/kernel/worker_thread.h>
 
 #define KMUTEX_SEK_TH_ITERS 100000
 #define KMUTEX_TH_COUNT        128
@@ -428,3 +430,125 @@ end:
 }
 
 REGISTER_SELF_TEST(kmutex_ord, se_med, &selftest_kmutex_ord)
+
+/* -------------------------------------------------- */
+/*               Priority inheritance test            */
+/* -------------------------------------------------- */
+
+/*
+ * Classic priority inversion: a regular (low) task holds a mutex, a high
+ * priority worker thread wants it, while a medium priority worker thread
+ * hogs the CPU. Without priority inheritance, the high priority task would
+ * wait for the medium one to complete (PI_MED_SPIN_MS), while with it, it
+ * waits at most for the low task to complete its critical section.
+ */
+
+#define PI_LOW_WORK_MS        20
+#define PI_MED_SPIN_MS       500
+#define PI_MAX_WAIT_MS       (4 * PI_LOW_WORK_MS)
+
+static struct kmutex pi_mutex;
+static struct worker_thread *pi_wth_hi, *pi_wth_med;
+static volatile bool pi_low_locked;
+static volatile bool pi_hi_done;
+static volatile bool pi_med_done;
+static u64 pi_hi_wait_ns;
+
+static void kmutex_pi_low_th(void *unused)
+{
+   kmutex_lock(&pi_mutex);
+   {
+      pi_low_locked = true;
+
+      for (int i = 0; i < PI_LOW_WORK_MS; i++)
+         delay_us(1000);
+   }
+   kmutex_unlock(&pi_mutex);
+}
+
+static void kmutex_pi_med_job(void *unused)
+{
+   for (int i = 0; i < PI_MED_SPIN_MS && !se_is_stop_requested(); i++)
+      delay_us(1000);
+
+   pi_med_done = true;
+}
+
+static void kmutex_pi_hi_job(void *unused)
+{
+   u64 start = hrtimer_now();
+
+   kmutex_lock(&pi_mutex);
+   {
+      pi_hi_wait_ns = hrtimer_now() - start;
+   }
+   kmutex_unlock(&pi_mutex);
+   pi_hi_done = true;
+}
+
+void selftest_kmutex_pi()
+{
+   struct kmutex_pi_stats stats;
+   bool ok;
+   int tid;
+
+   if (!pi_wth_hi) {
+
+      disable_preemption();
+      {
+         pi_wth_hi = wth_create_thread("se_pi_hi", 10, 4);
+         pi_wth_med = wth_create_thread("se_pi_med", 20, 4);
+      }
+      enable_preemption();
+      VERIFY(pi_wth_hi != NULL);
+      VERIFY(pi_wth_med != NULL);
+   }
+
+   kmutex_init(&pi_mutex, 0);
+   kmutex_reset_pi_stats();
+   pi_low_locked = pi_hi_done = pi_med_done = false;
+   pi_hi_wait_ns = 0;
+
+   tid = kthread_create(&kmutex_pi_low_th, 0, NULL);
+   VERIFY(tid > 0);
+
+   while (!pi_low_locked)
+      kernel_yield();
+
+   /*
+    * Enqueue both the jobs with preemption disabled: the high priority one
+    * will run first and block on the mutex, then the scheduler will have to
+    * choose between the medium priority worker and the (boosted) low task.
+    */
+   disable_preemption();
+   {
+      ok = wth_enqueue_on(pi_wth_med, &kmutex_pi_med_job, NULL);
+      ok = ok && wth_enqueue_on(pi_wth_hi, &kmutex_pi_hi_job, NULL);
+   }
+   enable_preemption();
+   VERIFY(ok);
+
+   while (!pi_hi_done || !pi_med_done)
+      kernel_yield();
+
+   kthread_join(tid, true);
+   kmutex_get_pi_stats(&stats);
+   kmutex_destroy(&pi_mutex);
+
+   printk("kmutex_pi: high prio task waited: %" PRIu64 " us\n",
+          pi_hi_wait_ns / 1000);
+
+   printk("kmutex_pi: inversions: %u, max inversion: %" PRIu64 " us\n",
+          stats.inversions, stats.max_inversion_ns / 1000);
+
+   if (se_is_stop_requested()) {
+      se_interrupted_end();
+      return;
+   }
+
+   VERIFY(stats.inversions == 1);
+   VERIFY(pi_hi_wait_ns < (u64)PI_MAX_WAIT_MS * 1000 * 1000);
+   se_regular_end();
+}
+
+REGISTER_SELF_TEST(kmutex_pi, se_med, &selftest_kmutex_pi)
@@ -22,11 +22,16 @@ CMD_ENTRY(bad_read,     TT_SHORT,  true)
 CMD_ENTRY(bad_write,    TT_SHORT,  true)
 CMD_ENTRY(fork_perf,    TT_LONG,   true)
 CMD_ENTRY(vfork_perf,   TT_LONG,   true)
+CMD_ENTRY(fork_storm,   TT_MED,    true)
+CMD_ENTRY(exec_perf,    TT_LONG,   true)
 CMD_ENTRY(syscall_perf, TT_MED,    true)
+CMD_ENTRY(sc_bench,     TT_LONG,   true)
 CMD_ENTRY(fpu,          TT_SHORT,  true)
 CMD_ENTRY(brk,          TT_SHORT,  true)
 CMD_ENTRY(mmap,         TT_MED,    true)
 CMD_ENTRY(mmap2,        TT_SHORT,  true)
+CMD_ENTRY(hugepage,     TT_MED,    true)
+CMD_ENTRY(munmap_perf,  TT_MED,    true)
 CMD_ENTRY(kcow,         TT_SHORT,  true)
 CMD_ENTRY(wpid1,        TT_SHORT,  true)
 CMD_ENTRY(wpid2,        TT_SHORT,  true)
@@ -73,10 +78,22 @@ CMD_ENTRY(select1,      TT_SHORT,  true)
 CMD_ENTRY(select2,      TT_SHORT,  true)
 CMD_ENTRY(select3,      TT_SHORT,  true)
 CMD_ENTRY(select4,      TT_SHORT,  true)
+CMD_ENTRY(nanosleep_jitter, TT_SHORT,  true)
+CMD_ENTRY(clock_mono,   TT_SHORT,  true)
+CMD_ENTRY(nanosleep_huge, TT_SHORT,  true)
+CMD_ENTRY(timerfd,      TT_SHORT,  true)
+CMD_ENTRY(eventfd,      TT_SHORT,  true)
+CMD_ENTRY(posix_timers, TT_SHORT,  true)
+CMD_ENTRY(notify_latency, TT_SHORT,  true)
+CMD_ENTRY(sched_rt,     TT_SHORT,  true)
+CMD_ENTRY(rt_latency,   TT_SHORT,  true)
+CMD_ENTRY(rt_throttle,  TT_SHORT,  true)
+CMD_ENTRY(sched_kthreads, TT_SHORT,  true)
 CMD_ENTRY(execve0,      TT_SHORT,  true)
 CMD_ENTRY(vfork0,       TT_SHORT,  true)
 CMD_ENTRY(extra,        TT_MED,    true)
 CMD_ENTRY(fatmm1,       TT_SHORT,  true)
+CMD_ENTRY(fatsf1,       TT_SHORT,  true)
 CMD_ENTRY(sigmask,      TT_SHORT,  true)
 CMD_ENTRY(sig1,         TT_SHORT,  true)
 CMD_ENTRY(sig2,         TT_SHORT,  true)
@@ -98,3 +115,4 @@ CMD_ENTRY(sigsegv5,     TT_SHORT,  true)
 CMD_ENTRY(getuids,      TT_SHORT,  true)
 CMD_ENTRY(getrusage,    TT_SHORT,  true)
 CMD_ENTRY(exit_cb,      TT_SHORT,  true)
+CMD_ENTRY(mem_usage,    TT_SHORT,  true)
@@ -13,6 +13,7 @@
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/mman.h>
+#include <sys/sendfile.h>
 #include <sys/time.h>
 #include <dirent.h>
 
@@ -101,3 +102,57 @@ err_end:
    close(fd);
    return 1;
 }
+
+int cmd_fatsf1(int argc, char **argv)
+{
+   int in_fd, out_fd, rc;
+   char buf1[4096], buf2[4096];
+   const char *test_file_name = DEVSHELL_PATH;
+   const char *out_file_name = "/tmp/sendfile_out";
+   const size_t off_begin = 1234;
+   struct stat statbuf;
+   off_t off = off_begin;
+   size_t file_size, tot;
+
+   in_fd = open(test_file_name, O_RDONLY);
+   DEVSHELL_CMD_ASSERT(in_fd > 0);
+
+   rc = fstat(in_fd, &statbuf);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   file_size = statbuf.st_size;
+
+   out_fd = open(out_file_name, O_CREAT | O_TRUNC | O_RDWR, 0644);
+   DEVSHELL_CMD_ASSERT(out_fd > 0);
+
+   printf("- sendfile() from '%s', offset: %zu\n", test_file_name, off_begin);
+
+   for (tot = 0; tot < file_size - off_begin; tot += (size_t)rc) {
+      rc = sendfile(out_fd, in_fd, &off, file_size);
+      DEVSHELL_CMD_ASSERT(rc > 0);
+   }
+
+   DEVSHELL_CMD_ASSERT(tot == file_size - off_begin);
+   DEVSHELL_CMD_ASSERT((size_t)off == file_size);
+
+   /* sendfile() with an offset must not move the file position */
+   DEVSHELL_CMD_ASSERT(lseek(in_fd, 0, SEEK_CUR) == 0);
+
+   printf("- Compare the copy with pread()\n");
+
+   for (size_t t = 0; t < tot; t += (size_t)rc) {
+
+      rc = pread(in_fd, buf1, sizeof(buf1), (off_t)(off_begin + t));
+      DEVSHELL_CMD_ASSERT(rc > 0);
+
+      DEVSHELL_CMD_ASSERT(pread(out_fd, buf2, (size_t)rc, (off_t)t) == rc);
+      DEVSHELL_CMD_ASSERT(!memcmp(buf1, buf2, (size_t)rc));
+   }
+
+   close(out_fd);
+   close(in_fd);
+   rc = unlink(out_file_name);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("DONE\n");
+   return 0;
+}
@@ -136,6 +136,198 @@ int cmd_vfork_perf(int argc, char **argv)
    return do_fork_perf(&vfork);
 }
 
+static long read_exec_cache_counter(const char *name)
+{
+   char path[64];
+   long val = -1;
+   FILE *fh;
+
+   sprintf(path, "/syst/exec_cache/%s", name);
+
+   if ((fh = fopen(path, "r"))) {
+
+      if (fscanf(fh, "%ld", &val) != 1)
+         val = -1;
+
+      fclose(fh);
+   }
+
+   return val;
+}
+
+/* Exec the same binary (busybox) over and over, like shell scripts do */
+int cmd_exec_perf(int argc, char **argv)
+{
+   static const char busybox_path[] = "/bin/busybox";
+   static char *const child_argv[] = { "busybox", "true", NULL };
+
+   const int iters = 10000;
+   long hits, misses;
+   int rc, wstatus, child_pid;
+   struct stat statbuf;
+   ull_t start, duration;
+
+   if (stat(busybox_path, &statbuf) < 0) {
+      printf(PFX "[SKIP] because busybox is not present\n");
+      return 0;
+   }
+
+   hits = read_exec_cache_counter("hits");
+   misses = read_exec_cache_counter("misses");
+   start = RDTSC();
+
+   for (int i = 0; i < iters; i++) {
+
+      child_pid = vfork();
+
+      if (child_pid < 0) {
+         perror("vfork() failed");
+         return 1;
+      }
+
+      if (!child_pid) {
+         execv(busybox_path, child_argv);
+         _exit(127); // exec failed
+      }
+
+      rc = waitpid(child_pid, &wstatus, 0);
+
+      if (rc != child_pid) {
+         printf("waitpid() returned %d [expected: %d]\n", rc, child_pid);
+         return 1;
+      }
+
+      if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+         printf("busybox true failed, wstatus: %d\n", wstatus);
+         return 1;
+      }
+   }
+
+   duration = RDTSC() - start;
+   printf("vfork + exec + wait: %llu cycles\n", duration / iters);
+
+   if (hits >= 0 && misses >= 0) {
+
+      hits = read_exec_cache_counter("hits") - hits;
+      misses = read_exec_cache_counter("misses") - misses;
+      printf("exec cache hits: %ld, misses: %ld\n", hits, misses);
+
+      /* Only the first exec can miss the cache */
+      DEVSHELL_CMD_ASSERT(hits >= iters - 1);
+      DEVSHELL_CMD_ASSERT(misses <= 1);
+   }
+
+   return 0;
+}
+
+#define FORK_STORM_TASKS 1000
+
+static int fork_storm_pids[FORK_STORM_TASKS];
+
+static int cmp_int(const void *a, const void *b)
+{
+   return *(const int *)a - *(const int *)b;
+}
+
+/*
+ * Runs in its own process group: forks FORK_STORM_TASKS children, all alive
+ * at the same time, and then kills them all with a single kill(0, sig).
+ */
+static int fork_storm_leader(void)
+{
+   int n, rc, wstatus, pgid, failed = 0;
+   ull_t start, duration;
+
+   /* Out-of-range group ids must be rejected */
+   DEVSHELL_CMD_ASSERT(setpgid(0, 1 << 20) < 0);
+
+   DEVSHELL_CMD_ASSERT(setpgid(0, 0) == 0);
+   pgid = getpid();
+   start = RDTSC();
+
+   for (n = 0; n < FORK_STORM_TASKS; n++) {
+
+      rc = fork();
+
+      if (rc < 0) {
+         perror("fork() failed");
+         failed = 1;
+         break;
+      }
+
+      if (!rc) {
+         pause();
+         exit(0); // exit from the child
+      }
+
+      fork_storm_pids[n] = rc;
+   }
+
+   duration = RDTSC() - start;
+   printf("Forked %d children, avg cycles per fork: %llu\n",
+          n, n ? duration / (ull_t)n : 0);
+
+   for (int i = 0; i < n; i++) {
+      if (getpgid(fork_storm_pids[i]) != pgid) {
+         printf("Child %d is not in group %d\n", fork_storm_pids[i], pgid);
+         failed = 1;
+      }
+   }
+
+   qsort(fork_storm_pids, (size_t)n, sizeof(fork_storm_pids[0]), &cmp_int);
+
+   for (int i = 1; i < n; i++) {
+      if (fork_storm_pids[i] == fork_storm_pids[i - 1]) {
+         printf("Duplicate pid: %d\n", fork_storm_pids[i]);
+         failed = 1;
+      }
+   }
+
+   /* Kill all the children in the group, but not ourselves */
+   signal(SIGUSR1, SIG_IGN);
+
+   if (kill(0, SIGUSR1) < 0) {
+      perror("kill(0, SIGUSR1) failed");
+      failed = 1;
+   }
+
+   for (int i = 0; i < n; i++) {
+
+      rc = waitpid(fork_storm_pids[i], &wstatus, 0);
+
+      if (rc != fork_storm_pids[i]) {
+         printf("waitpid() returned %d [expected: %d]\n",
+                rc, fork_storm_pids[i]);
+         failed = 1;
+         continue;
+      }
+
+      if (!WIFSIGNALED(wstatus) || WTERMSIG(wstatus) != SIGUSR1) {
+         printf("Child %d did not die because of SIGUSR1\n", rc);
+         failed = 1;
+      }
+   }
+
+   return failed;
+}
+
+int cmd_fork_storm(int argc, char **argv)
+{
+   int rc, pid, wstatus;
+
+   pid = fork();
+   DEVSHELL_CMD_ASSERT(pid >= 0);
+
+   if (!pid)
+      exit(fork_storm_leader());
+
+   rc = waitpid(pid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == pid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+   DEVSHELL_CMD_ASSERT(WEXITSTATUS(wstatus) == 0);
+   return 0;
+}
+
 int cmd_execve0(int argc, char **argv)
 {
    int rc, pid, wstatus;
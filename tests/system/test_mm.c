@@ -14,6 +14,7 @@
 #include <sys/stat.h>
 #include <sys/syscall.h>
 #include <sys/mman.h>
+#include <sys/resource.h>
 
 #include "devshell.h"
 #include "sysenter.h"
@@ -159,6 +160,178 @@ int cmd_mmap2(int argc, char **argv)
    return 0;
 }
 
+#ifndef MADV_HUGEPAGE
+   #define MADV_HUGEPAGE 14
+#endif
+
+#define HP_BUF_SIZE        (24 * MB)
+#define HP_BIG_PAGE_SIZE    (4 * MB)
+#define HP_PAGE_SIZE           4096
+#define HP_BENCH_PASSES          16
+
+static inline unsigned hp_pattern(size_t off)
+{
+   return (unsigned)(off * 2654435761u) ^ 0xA5A5A5A5;
+}
+
+static void hp_fill(char *buf, size_t len)
+{
+   for (size_t off = 0; off < len; off += sizeof(unsigned))
+      *(unsigned *)(buf + off) = hp_pattern(off);
+}
+
+static bool hp_check(char *buf, size_t start, size_t end)
+{
+   for (size_t off = start; off < end; off += sizeof(unsigned)) {
+      if (*(unsigned *)(buf + off) != hp_pattern(off)) {
+         printf("Unexpected data at offset %zu\n", off);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+/*
+ * Touch one cache line per 4 KB page, on the whole buffer: with 4 KB pages,
+ * that means (almost) one TLB miss per access.
+ */
+static ull_t hp_bench_strided_reads(char *buf, size_t len)
+{
+   volatile unsigned sum = 0;
+   ull_t start, duration, best = ~0ull;
+
+   for (int pass = 0; pass < HP_BENCH_PASSES; pass++) {
+
+      const size_t line_off = ((size_t)pass * 64) % HP_PAGE_SIZE;
+      start = RDTSC();
+
+      for (size_t off = line_off; off < len; off += HP_PAGE_SIZE)
+         sum += *(unsigned *)(buf + off);
+
+      duration = RDTSC() - start;
+
+      if (duration < best)
+         best = duration;
+   }
+
+   return best / (len / HP_PAGE_SIZE);
+}
+
+int cmd_hugepage(int argc, char **argv)
+{
+   ull_t cycles_4k, cycles_4m;
+   int rc, child, wstatus;
+   size_t hole_off;
+   char *buf;
+
+   buf = mmap(NULL,
+              HP_BUF_SIZE,
+              PROT_READ | PROT_WRITE,
+              MAP_ANONYMOUS | MAP_PRIVATE,
+              -1,
+              0);
+
+   DEVSHELL_CMD_ASSERT(buf != (void *)-1);
+
+   hp_fill(buf, HP_BUF_SIZE);
+   cycles_4k = hp_bench_strided_reads(buf, HP_BUF_SIZE);
+
+   printf("madvise(MADV_HUGEPAGE) on %d MB...\n", HP_BUF_SIZE / MB);
+   rc = madvise(buf, HP_BUF_SIZE, MADV_HUGEPAGE);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(hp_check(buf, 0, HP_BUF_SIZE));
+
+   cycles_4m = hp_bench_strided_reads(buf, HP_BUF_SIZE);
+
+   printf("Avg. cycles per strided read, 4 KB pages: %llu\n", cycles_4k);
+   printf("Avg. cycles per strided read, 4 MB pages: %llu\n", cycles_4m);
+
+   /* CoW on fork(): the child's writes must not be visible to the parent */
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+      memset(buf, 0xCC, HP_BUF_SIZE);
+      exit(0);
+   }
+
+   waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+   DEVSHELL_CMD_ASSERT(hp_check(buf, 0, HP_BUF_SIZE));
+
+   /* Now the child is dead: writing must not copy the big pages again */
+   hp_fill(buf, HP_BUF_SIZE);
+
+   /* Make a hole in the middle of an aligned chunk, forcing a split */
+   hole_off = HP_BIG_PAGE_SIZE - ((ulong)buf & (HP_BIG_PAGE_SIZE - 1));
+   hole_off += HP_BIG_PAGE_SIZE / 2;
+   rc = munmap(buf + hole_off, HP_PAGE_SIZE);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   DEVSHELL_CMD_ASSERT(hp_check(buf, 0, hole_off));
+   DEVSHELL_CMD_ASSERT(hp_check(buf, hole_off + HP_PAGE_SIZE, HP_BUF_SIZE));
+
+   rc = munmap(buf, hole_off);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = munmap(buf + hole_off + HP_PAGE_SIZE,
+               HP_BUF_SIZE - hole_off - HP_PAGE_SIZE);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   return 0;
+}
+
+#define MUNMAP_PERF_ITERS          8
+
+/*
+ * Measures the cost of un-mapping populated anonymous mappings of various
+ * sizes, where the page tables have to be walked and the TLB invalidated.
+ */
+int cmd_munmap_perf(int argc, char **argv)
+{
+   static const size_t sizes[] = {
+      16 * KB, 64 * KB, 256 * KB, 1 * MB, 4 * MB, 16 * MB
+   };
+
+   for (unsigned i = 0; i < ARRAY_SIZE(sizes); i++) {
+
+      const size_t size = sizes[i];
+      const size_t pages = size / HP_PAGE_SIZE;
+      ull_t start, tot = 0;
+      char *buf;
+      int rc;
+
+      for (int iter = 0; iter < MUNMAP_PERF_ITERS; iter++) {
+
+         buf = mmap(NULL,
+                    size,
+                    PROT_READ | PROT_WRITE,
+                    MAP_ANONYMOUS | MAP_PRIVATE,
+                    -1,
+                    0);
+
+         DEVSHELL_CMD_ASSERT(buf != (void *)-1);
+
+         /* Populate the mapping and the TLB */
+         for (size_t off = 0; off < size; off += HP_PAGE_SIZE)
+            buf[off] = (char)off;
+
+         start = RDTSC();
+         rc = munmap(buf, size);
+         tot += RDTSC() - start;
+
+         DEVSHELL_CMD_ASSERT(rc == 0);
+      }
+
+      tot /= MUNMAP_PERF_ITERS;
+
+      printf("munmap %5u KB: %8llu cycles (%4llu cycles/page)\n",
+             (unsigned)(size / KB), tot, tot / pages);
+   }
+
+   return 0;
+}
+
 static size_t fork_oom_alloc_size;
 
 static void fork_oom_child(void *buf)
@@ -391,3 +564,91 @@ int cmd_fork_oom(int argc, char **argv)
    free(buf);
    return rc;
 }
+
+static char mem_usage_buf[64 * KB];
+
+/* Look for our line in /syst/procs/mem and return its private_kb column */
+static long read_procs_mem_private_kb(void)
+{
+   char line[256];
+   long private_kb = -1;
+   int pid;
+   FILE *fh;
+
+   if (!(fh = fopen("/syst/procs/mem", "r")))
+      return -1;
+
+   while (fgets(line, sizeof(line), fh)) {
+
+      if (sscanf(line, "%d %ld", &pid, &private_kb) == 2 && pid == getpid())
+         break;
+
+      private_kb = -1;
+   }
+
+   fclose(fh);
+   return private_kb;
+}
+
+static void mem_usage_child(void)
+{
+   const long buf_kb = sizeof(mem_usage_buf) / KB;
+   struct rusage r0, r1;
+   long min_faults;
+   int rc;
+
+   rc = getrusage(RUSAGE_SELF, &r0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Every page of the buffer is shared with the parent: CoW faults */
+   memset(mem_usage_buf, 2, sizeof(mem_usage_buf));
+
+   rc = getrusage(RUSAGE_SELF, &r1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   printf("Child: minflt: %ld -> %ld, maxrss: %ld KB\n",
+          r0.ru_minflt, r1.ru_minflt, r1.ru_maxrss);
+
+   min_faults = (long)(sizeof(mem_usage_buf) / (size_t)getpagesize());
+   DEVSHELL_CMD_ASSERT(r1.ru_minflt >= r0.ru_minflt + min_faults);
+   DEVSHELL_CMD_ASSERT(r1.ru_maxrss >= buf_kb);
+
+   if (getenv("TILCK")) {
+
+      long private_kb = read_procs_mem_private_kb();
+      printf("Child: private memory: %ld KB\n", private_kb);
+      DEVSHELL_CMD_ASSERT(private_kb >= buf_kb);
+   }
+
+   exit(0);
+}
+
+/* Check the memory accounting of getrusage() and /syst/procs/mem */
+int cmd_mem_usage(int argc, char **argv)
+{
+   int child_pid, wstatus, rc;
+
+   if (FORK_NO_COW) {
+      printf(PFX "[SKIP] because FORK_NO_COW=1\n");
+      return 0;
+   }
+
+   /* Make sure all the pages are mapped and private before fork() */
+   memset(mem_usage_buf, 1, sizeof(mem_usage_buf));
+
+   child_pid = fork();
+   DEVSHELL_CMD_ASSERT(child_pid >= 0);
+
+   if (!child_pid)
+      mem_usage_child();
+
+   rc = waitpid(child_pid, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child_pid);
+
+   if (!WIFEXITED(wstatus) || WEXITSTATUS(wstatus) != 0) {
+      printf("Child exited with status: %d\n", WEXITSTATUS(wstatus));
+      return 1;
+   }
+
+   return 0;
+}
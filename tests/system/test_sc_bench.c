@@ -0,0 +1,562 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+/*
+ * Syscall latency benchmarks
+ * ----------------------------
+ *
+ * Measure the cost in cycles of a set of syscalls, calling each one of them
+ * both with `int 0x80` and with `sysenter`. Each syscall is measured
+ * individually (one RDTSC pair per call) and for each benchmark min, median
+ * and p99 are reported, both in a human-readable table and as CSV lines:
+ *
+ *    SC_BENCH,<bench>,<entry>,<iters>,<min>,<median>,<p99>
+ *
+ * Those lines are parsed by the system test runner, which can compare them
+ * against a stored baseline (see tests/runners/single_test_run).
+ *
+ * Usage: sc_bench [<bench name substring>]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/select.h>
+
+#include "devshell.h"
+#include "sysenter.h"
+
+#define SCB_MAX_ITERS             2000
+#define SCB_MAX_RESULTS             64
+#define SCB_IO_SIZE                 64
+#define SCB_TEST_FILE  "/tmp/sc_bench_file"
+#define SCB_EXEC_CHILD_OPT "--exec-child"
+
+#define SCALL5(e, n, a1, a2, a3, a4, a5)                                     \
+   ((e)->call((n), (ulong)(a1), (ulong)(a2), (ulong)(a3),                    \
+              (ulong)(a4), (ulong)(a5)))
+
+#define SCALL(e, n, a1, a2, a3)                                              \
+   SCALL5(e, n, a1, a2, a3, 0, 0)
+
+#define MEASURE(i, expr)                                                     \
+   do {                                                                      \
+      ull_t __start = RDTSC();                                               \
+      expr;                                                                  \
+      s[i] = RDTSC() - __start;                                              \
+   } while (0)
+
+struct scb_entry {
+   const char *name;
+   int (*call)(int n, ulong a1, ulong a2, ulong a3, ulong a4, ulong a5);
+};
+
+struct scb_bench {
+   const char *name;
+   int iters;
+   void (*func)(const struct scb_entry *e, ull_t *samples, int n);
+};
+
+struct scb_result {
+   const char *bench;
+   const char *entry;
+   int iters;
+   ull_t min;
+   ull_t median;
+   ull_t p99;
+};
+
+/* The 32-bit versions of the time structs, as expected by the raw syscalls */
+struct scb_timespec32 {
+   long tv_sec;
+   long tv_nsec;
+};
+
+struct scb_timeval32 {
+   long tv_sec;
+   long tv_usec;
+};
+
+struct scb_old_mmap_args {
+   ulong addr;
+   ulong len;
+   ulong prot;
+   ulong flags;
+   ulong fd;
+   ulong offset;
+};
+
+static ull_t samples[SCB_MAX_ITERS];
+static struct scb_result results[SCB_MAX_RESULTS];
+static int results_count;
+static volatile int sigusr1_count;
+static char io_buf[SCB_IO_SIZE];
+
+static int
+scb_int80_call(int n, ulong a1, ulong a2, ulong a3, ulong a4, ulong a5)
+{
+   int ret;
+
+#ifdef __i386__
+
+   asmVolatile ("int $0x80"
+                : "=a" (ret)
+                : "a" (n), "b" (a1), "c" (a2), "d" (a3), "S" (a4), "D" (a5)
+                : "memory", "cc");
+
+#else
+
+   abort();
+
+#endif
+
+   return ret;
+}
+
+static int
+scb_sysenter_call(int n, ulong a1, ulong a2, ulong a3, ulong a4, ulong a5)
+{
+   return sysenter_call5(n, a1, a2, a3, a4, a5);
+}
+
+static const struct scb_entry entries[] = {
+   { "int80", &scb_int80_call },
+   { "sysenter", &scb_sysenter_call },
+};
+
+static void bench_getpid(const struct scb_entry *e, ull_t *s, int n)
+{
+   for (int i = 0; i < n; i++)
+      MEASURE(i, SCALL(e, SYS_getpid, 0, 0, 0));
+}
+
+static void bench_ramfs_write(const struct scb_entry *e, ull_t *s, int n)
+{
+   int fd, rc = 0;
+
+   fd = open(SCB_TEST_FILE, O_CREAT | O_TRUNC | O_WRONLY, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   for (int i = 0; i < n; i++)
+      MEASURE(i, rc = SCALL(e, SYS_write, fd, io_buf, SCB_IO_SIZE));
+
+   DEVSHELL_CMD_ASSERT(rc == SCB_IO_SIZE);
+   close(fd);
+}
+
+static void bench_ramfs_read(const struct scb_entry *e, ull_t *s, int n)
+{
+   int fd, rc = 0;
+
+   /* Setup: create a file large enough for all the reads */
+   fd = open(SCB_TEST_FILE, O_CREAT | O_TRUNC | O_RDWR, 0644);
+
+   if (fd < 0) {
+      perror("open(" SCB_TEST_FILE ") failed");
+      DEVSHELL_CMD_ASSERT(fd >= 0);
+   }
+
+   for (int i = 0; i < n; i++) {
+      rc = write(fd, io_buf, SCB_IO_SIZE);
+      DEVSHELL_CMD_ASSERT(rc == SCB_IO_SIZE);
+   }
+
+   rc = (int)lseek(fd, 0, SEEK_SET);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < n; i++) {
+      MEASURE(i, rc = SCALL(e, SYS_read, fd, io_buf, SCB_IO_SIZE));
+      DEVSHELL_CMD_ASSERT(rc == SCB_IO_SIZE);
+   }
+
+   close(fd);
+}
+
+static void bench_pipe_write(const struct scb_entry *e, ull_t *s, int n)
+{
+   int fds[2], rc;
+
+   rc = pipe(fds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < n; i++) {
+      MEASURE(i, rc = SCALL(e, SYS_write, fds[1], io_buf, SCB_IO_SIZE));
+      DEVSHELL_CMD_ASSERT(rc == SCB_IO_SIZE);
+      rc = read(fds[0], io_buf, SCB_IO_SIZE);
+      DEVSHELL_CMD_ASSERT(rc == SCB_IO_SIZE);
+   }
+
+   close(fds[0]);
+   close(fds[1]);
+}
+
+static void bench_pipe_read(const struct scb_entry *e, ull_t *s, int n)
+{
+   int fds[2], rc;
+
+   rc = pipe(fds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < n; i++) {
+      rc = write(fds[1], io_buf, SCB_IO_SIZE);
+      DEVSHELL_CMD_ASSERT(rc == SCB_IO_SIZE);
+      MEASURE(i, rc = SCALL(e, SYS_read, fds[0], io_buf, SCB_IO_SIZE));
+      DEVSHELL_CMD_ASSERT(rc == SCB_IO_SIZE);
+   }
+
+   close(fds[0]);
+   close(fds[1]);
+}
+
+/*
+ * Write a single '\r' on the tty: that goes through the whole tty output path
+ * (and the serial port, when used as console), without messing up the output.
+ * Reading from the tty is not measured, because that requires user input.
+ */
+static void bench_tty_write(const struct scb_entry *e, ull_t *s, int n)
+{
+   int rc = 0;
+
+   for (int i = 0; i < n; i++)
+      MEASURE(i, rc = SCALL(e, SYS_write, 1, "\r", 1));
+
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   printf("\n");
+}
+
+static void bench_devnull_write(const struct scb_entry *e, ull_t *s, int n)
+{
+   int fd, rc = 0;
+
+   fd = open("/dev/null", O_WRONLY);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   for (int i = 0; i < n; i++)
+      MEASURE(i, rc = SCALL(e, SYS_write, fd, io_buf, SCB_IO_SIZE));
+
+   DEVSHELL_CMD_ASSERT(rc == SCB_IO_SIZE);
+   close(fd);
+}
+
+static void bench_devnull_read(const struct scb_entry *e, ull_t *s, int n)
+{
+   int fd, rc = 0;
+
+   fd = open("/dev/null", O_RDONLY);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+
+   for (int i = 0; i < n; i++)
+      MEASURE(i, rc = SCALL(e, SYS_read, fd, io_buf, SCB_IO_SIZE));
+
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   close(fd);
+}
+
+static void bench_open(const struct scb_entry *e, ull_t *s, int n)
+{
+   int fd = 0;
+
+   for (int i = 0; i < n; i++) {
+      MEASURE(i, fd = SCALL(e, SYS_open, SCB_TEST_FILE, O_RDONLY, 0));
+      DEVSHELL_CMD_ASSERT(fd > 0);
+      close(fd);
+   }
+}
+
+static void bench_close(const struct scb_entry *e, ull_t *s, int n)
+{
+   int fd, rc = 0;
+
+   for (int i = 0; i < n; i++) {
+      fd = open(SCB_TEST_FILE, O_RDONLY);
+      DEVSHELL_CMD_ASSERT(fd > 0);
+      MEASURE(i, rc = SCALL(e, SYS_close, fd, 0, 0));
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+}
+
+static void bench_stat(const struct scb_entry *e, ull_t *s, int n)
+{
+   static char statbuf[256]; /* struct stat64, as expected by the kernel */
+   int rc = 0;
+
+   for (int i = 0; i < n; i++)
+      MEASURE(i, rc = SCALL(e, SYS_stat64, SCB_TEST_FILE, statbuf, 0));
+
+   DEVSHELL_CMD_ASSERT(rc == 0);
+}
+
+/* Round-trip: fork() + exit() in the child + waitpid() in the parent */
+static void bench_fork(const struct scb_entry *e, ull_t *s, int n)
+{
+   int pid, rc, wstatus;
+   ull_t start;
+
+   for (int i = 0; i < n; i++) {
+
+      start = RDTSC();
+      pid = SCALL(e, SYS_fork, 0, 0, 0);
+
+      if (!pid)
+         SCALL(e, SYS_exit, 0, 0, 0);
+
+      rc = SCALL(e, SYS_waitpid, pid, &wstatus, 0);
+      s[i] = RDTSC() - start;
+
+      DEVSHELL_CMD_ASSERT(pid > 0);
+      DEVSHELL_CMD_ASSERT(rc == pid);
+   }
+}
+
+/*
+ * Round-trip: vfork() + execve() of `devshell -c sc_bench --exec-child`, which
+ * exits immediately, + waitpid() in the parent. Therefore, this measurement
+ * includes the startup cost of devshell as well.
+ */
+static void bench_vfork_execve(const struct scb_entry *e, ull_t *s, int n)
+{
+   const char *devshell_path = get_devshell_path();
+   char *child_argv[] = {
+      "devshell", "-c", "sc_bench", SCB_EXEC_CHILD_OPT, NULL
+   };
+   int pid, rc, wstatus, null_fd;
+   ull_t start;
+
+   null_fd = open("/dev/null", O_WRONLY);
+   DEVSHELL_CMD_ASSERT(null_fd > 0);
+
+   for (int i = 0; i < n; i++) {
+
+      start = RDTSC();
+      pid = vfork();
+
+      if (!pid) {
+         dup2(null_fd, 1);
+         SCALL(e, SYS_execve, devshell_path, child_argv, shell_env);
+         _exit(1);
+      }
+
+      rc = SCALL(e, SYS_waitpid, pid, &wstatus, 0);
+      s[i] = RDTSC() - start;
+
+      DEVSHELL_CMD_ASSERT(pid > 0);
+      DEVSHELL_CMD_ASSERT(rc == pid);
+      DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+   }
+
+   close(null_fd);
+}
+
+static void bench_mmap(const struct scb_entry *e, ull_t *s, int n)
+{
+   struct scb_old_mmap_args args = {
+      .len = 4 * KB,
+      .prot = PROT_READ | PROT_WRITE,
+      .flags = MAP_PRIVATE | MAP_ANONYMOUS,
+      .fd = (ulong)-1,
+   };
+   void *ptr = NULL;
+
+   for (int i = 0; i < n; i++) {
+      MEASURE(i, ptr = (void *)SCALL(e, SYS_mmap, &args, 0, 0));
+      DEVSHELL_CMD_ASSERT(ptr != MAP_FAILED);
+      munmap(ptr, 4 * KB);
+   }
+}
+
+static void bench_munmap(const struct scb_entry *e, ull_t *s, int n)
+{
+   void *ptr;
+   int rc = 0;
+
+   for (int i = 0; i < n; i++) {
+
+      ptr = mmap(NULL, 4 * KB, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+      DEVSHELL_CMD_ASSERT(ptr != MAP_FAILED);
+      MEASURE(i, rc = SCALL(e, SYS_munmap, ptr, 4 * KB, 0));
+      DEVSHELL_CMD_ASSERT(rc == 0);
+   }
+}
+
+static void bench_poll(const struct scb_entry *e, ull_t *s, int n)
+{
+   struct pollfd pfd;
+   int fds[2], rc = 0;
+
+   rc = pipe(fds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   pfd = (struct pollfd) { .fd = fds[1], .events = POLLOUT };
+
+   for (int i = 0; i < n; i++)
+      MEASURE(i, rc = SCALL(e, SYS_poll, &pfd, 1, 0));
+
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   close(fds[0]);
+   close(fds[1]);
+}
+
+static void bench_select(const struct scb_entry *e, ull_t *s, int n)
+{
+   struct scb_timeval32 tv;
+   fd_set wfds;
+   int fds[2], rc = 0;
+
+   rc = pipe(fds);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < n; i++) {
+
+      FD_ZERO(&wfds);
+      FD_SET(fds[1], &wfds);
+      tv = (struct scb_timeval32) { 0, 0 };
+
+      MEASURE(i, rc = SCALL5(e, SYS__newselect,
+                             fds[1] + 1, NULL, &wfds, NULL, &tv));
+
+      DEVSHELL_CMD_ASSERT(rc == 1);
+   }
+
+   close(fds[0]);
+   close(fds[1]);
+}
+
+static void bench_nanosleep0(const struct scb_entry *e, ull_t *s, int n)
+{
+   struct scb_timespec32 req = { 0, 0 };
+   int rc = 0;
+
+   for (int i = 0; i < n; i++)
+      MEASURE(i, rc = SCALL(e, SYS_nanosleep, &req, NULL, 0));
+
+   DEVSHELL_CMD_ASSERT(rc == 0);
+}
+
+static void sigusr1_handler(int sig)
+{
+   sigusr1_count++;
+}
+
+/* Round-trip: kill(self) + signal handler + sigreturn */
+static void bench_signal(const struct scb_entry *e, ull_t *s, int n)
+{
+   const int pid = getpid();
+   int rc = 0;
+
+   sigusr1_count = 0;
+   signal(SIGUSR1, &sigusr1_handler);
+
+   for (int i = 0; i < n; i++)
+      MEASURE(i, rc = SCALL(e, SYS_kill, pid, SIGUSR1, 0));
+
+   signal(SIGUSR1, SIG_DFL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(sigusr1_count == n);
+}
+
+static const struct scb_bench benches[] = {
+   { "getpid",          2000, &bench_getpid },
+   { "ramfs_write",     1000, &bench_ramfs_write },
+   { "ramfs_read",      1000, &bench_ramfs_read },
+   { "pipe_write",      1000, &bench_pipe_write },
+   { "pipe_read",       1000, &bench_pipe_read },
+   { "tty_write",        200, &bench_tty_write },
+   { "devnull_write",   2000, &bench_devnull_write },
+   { "devnull_read",    2000, &bench_devnull_read },
+   { "open",            1000, &bench_open },
+   { "close",           1000, &bench_close },
+   { "stat",            1000, &bench_stat },
+   { "fork_exit_wait",   200, &bench_fork },
+   { "vfork_execve",      50, &bench_vfork_execve },
+   { "mmap",            1000, &bench_mmap },
+   { "munmap",          1000, &bench_munmap },
+   { "poll",            2000, &bench_poll },
+   { "select",          2000, &bench_select },
+   { "nanosleep0",      1000, &bench_nanosleep0 },
+   { "signal",          1000, &bench_signal },
+};
+
+static int cmp_ull(const void *a, const void *b)
+{
+   const ull_t x = *(const ull_t *)a;
+   const ull_t y = *(const ull_t *)b;
+   return x < y ? -1 : (x > y ? 1 : 0);
+}
+
+static void
+run_bench(const struct scb_bench *b, const struct scb_entry *e)
+{
+   struct scb_result *r = &results[results_count++];
+   const int n = b->iters;
+
+   DEVSHELL_CMD_ASSERT(n <= SCB_MAX_ITERS);
+   DEVSHELL_CMD_ASSERT(results_count <= SCB_MAX_RESULTS);
+
+   b->func(e, samples, n);
+   qsort(samples, (size_t)n, sizeof(samples[0]), &cmp_ull);
+
+   *r = (struct scb_result) {
+      .bench = b->name,
+      .entry = e->name,
+      .iters = n,
+      .min = samples[0],
+      .median = samples[n / 2],
+      .p99 = samples[n * 99 / 100],
+   };
+
+   printf("%-16s %-9s %6d %10llu %10llu %10llu\n",
+          r->bench, r->entry, r->iters, r->min, r->median, r->p99);
+}
+
+int cmd_sc_bench(int argc, char **argv)
+{
+   const char *filter = argc > 0 ? argv[0] : NULL;
+   int fd;
+
+   if (filter && !strcmp(filter, SCB_EXEC_CHILD_OPT))
+      return 0; /* we've been exec-ed by bench_vfork_execve() */
+
+   memset(io_buf, 'x', sizeof(io_buf));
+   results_count = 0;
+
+   /* Make sure the test file exists before running benchmarks like `stat` */
+   fd = open(SCB_TEST_FILE, O_CREAT | O_WRONLY, 0644);
+   DEVSHELL_CMD_ASSERT(fd > 0);
+   close(fd);
+
+   printf("%-16s %-9s %6s %10s %10s %10s\n",
+          "bench", "entry", "iters", "min", "median", "p99");
+
+   for (int i = 0; i < ARRAY_SIZE(benches); i++) {
+
+      if (filter && !strstr(benches[i].name, filter))
+         continue;
+
+      for (int j = 0; j < ARRAY_SIZE(entries); j++)
+         run_bench(&benches[i], &entries[j]);
+   }
+
+   printf("\n");
+
+   for (int i = 0; i < results_count; i++) {
+
+      const struct scb_result *r = &results[i];
+
+      printf("SC_BENCH,%s,%s,%d,%llu,%llu,%llu\n",
+             r->bench, r->entry, r->iters, r->min, r->median, r->p99);
+   }
+
+   unlink(SCB_TEST_FILE);
+   return 0;
+}
@@ -0,0 +1,375 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+
+#include "devshell.h"
+
+#ifndef SCHED_RESET_ON_FORK
+   #define SCHED_RESET_ON_FORK 0x40000000
+#endif
+
+#define RT_TEST_PRIO                        10
+#define RT_LATENCY_ITERS                    50
+#define RT_LATENCY_DELAY_NS     (2 * 1000 * 1000)
+#define RT_MAX_LATENCY_NS      (20 * 1000 * 1000)
+#define RT_LATENCY_HOGS                      3
+#define RT_HOG_DURATION_NS  (2000ull * 1000 * 1000)
+
+/*
+ * NOTE: libmusl deliberately doesn't implement sched_setscheduler() and
+ * friends, because on Linux they operate on threads, not on processes. Use
+ * the raw syscalls instead.
+ */
+
+static int set_sched(int pid, int policy, int prio)
+{
+   struct sched_param p = { .sched_priority = prio };
+   return (int)syscall(SYS_sched_setscheduler, pid, policy, &p);
+}
+
+static int get_sched(int pid)
+{
+   return (int)syscall(SYS_sched_getscheduler, pid);
+}
+
+static int get_sched_prio(int pid)
+{
+   struct sched_param p = { .sched_priority = -1 };
+   int rc = (int)syscall(SYS_sched_getparam, pid, &p);
+   return rc ? rc : p.sched_priority;
+}
+
+static int set_sched_prio(int pid, int prio)
+{
+   struct sched_param p = { .sched_priority = prio };
+   return (int)syscall(SYS_sched_setparam, pid, &p);
+}
+
+static u64 mono_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static void wait_child_ok(pid_t pid)
+{
+   int wstatus;
+   int rc = waitpid(pid, &wstatus, 0);
+
+   DEVSHELL_CMD_ASSERT(rc == pid);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus));
+   DEVSHELL_CMD_ASSERT(WEXITSTATUS(wstatus) == 0);
+}
+
+static void rt_api_child(void)
+{
+   struct timespec ts;
+   pid_t child;
+   int rc;
+
+   /* SCHED_FIFO */
+   rc = set_sched(0, SCHED_FIFO, RT_TEST_PRIO);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(get_sched(0) == SCHED_FIFO);
+   DEVSHELL_CMD_ASSERT(get_sched(getpid()) == SCHED_FIFO);
+   DEVSHELL_CMD_ASSERT(get_sched_prio(0) == RT_TEST_PRIO);
+
+   rc = sched_rr_get_interval(0, &ts);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(ts.tv_sec == 0 && ts.tv_nsec == 0);
+
+   /* SCHED_RR */
+   rc = set_sched(0, SCHED_RR, RT_TEST_PRIO + 1);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(get_sched(0) == SCHED_RR);
+   DEVSHELL_CMD_ASSERT(get_sched_prio(0) == RT_TEST_PRIO + 1);
+
+   rc = sched_rr_get_interval(0, &ts);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(ts.tv_sec > 0 || ts.tv_nsec > 0);
+
+   /* sched_setparam() keeps the policy */
+   rc = set_sched_prio(0, RT_TEST_PRIO + 2);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(get_sched(0) == SCHED_RR);
+   DEVSHELL_CMD_ASSERT(get_sched_prio(0) == RT_TEST_PRIO + 2);
+
+   /* Invalid priorities */
+   rc = set_sched(0, SCHED_FIFO, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   rc = set_sched(0, SCHED_FIFO, 100);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   rc = set_sched(0, SCHED_OTHER, 1);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   rc = set_sched(0, 1234, 1);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   DEVSHELL_CMD_ASSERT(get_sched(0) == SCHED_RR);
+
+   /* The policy is inherited by fork() */
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+      bool ok = get_sched(0) == SCHED_RR &&
+                get_sched_prio(0) == RT_TEST_PRIO + 2;
+      exit(ok ? 0 : 1);
+   }
+
+   wait_child_ok(child);
+
+   /* ... unless SCHED_RESET_ON_FORK is set */
+   rc = set_sched(0, SCHED_FIFO | SCHED_RESET_ON_FORK, RT_TEST_PRIO);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(get_sched(0) == (SCHED_FIFO | SCHED_RESET_ON_FORK));
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+      bool ok = get_sched(0) == SCHED_OTHER && get_sched_prio(0) == 0;
+      exit(ok ? 0 : 1);
+   }
+
+   wait_child_ok(child);
+
+   /* Back to SCHED_OTHER */
+   rc = set_sched(0, SCHED_OTHER, 0);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(get_sched(0) == SCHED_OTHER);
+   DEVSHELL_CMD_ASSERT(get_sched_prio(0) == 0);
+   exit(0);
+}
+
+/* The API of the SCHED_FIFO and SCHED_RR scheduling classes */
+int cmd_sched_rt(int argc, char **argv)
+{
+   pid_t child;
+   int rc;
+
+   DEVSHELL_CMD_ASSERT(sched_get_priority_max(SCHED_FIFO) == 99);
+   DEVSHELL_CMD_ASSERT(sched_get_priority_min(SCHED_FIFO) == 1);
+   DEVSHELL_CMD_ASSERT(sched_get_priority_max(SCHED_RR) == 99);
+   DEVSHELL_CMD_ASSERT(sched_get_priority_min(SCHED_RR) == 1);
+   DEVSHELL_CMD_ASSERT(sched_get_priority_max(SCHED_OTHER) == 0);
+   DEVSHELL_CMD_ASSERT(sched_get_priority_min(SCHED_OTHER) == 0);
+   DEVSHELL_CMD_ASSERT(get_sched(0) == SCHED_OTHER);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child)
+      rt_api_child();
+
+   wait_child_ok(child);
+
+   /* The child has been reaped: its pid is not valid anymore */
+   rc = get_sched(child);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == ESRCH);
+   rc = set_sched(-1, SCHED_OTHER, 0);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   return 0;
+}
+
+/* Tilck's kernel threads have tids in [10000, 11024]: see KERNEL_TID_START */
+#define KTID_START                       10000
+#define KTID_END                         11024
+
+/* The scheduling class of the kernel threads (e.g. idle) cannot be changed */
+int cmd_sched_kthreads(int argc, char **argv)
+{
+   int found = 0;
+   int rc;
+
+   if (!getenv("TILCK")) {
+      printf(PFX "[SKIP] because we're not running on Tilck\n");
+      return 0;
+   }
+
+   for (int tid = KTID_START; tid <= KTID_END; tid++) {
+
+      if (get_sched(tid) < 0)
+         continue; /* no such kernel thread */
+
+      found++;
+
+      rc = set_sched(tid, SCHED_FIFO, 99);
+      DEVSHELL_CMD_ASSERT(rc < 0 && errno == EPERM);
+
+      rc = set_sched_prio(tid, 1);
+      DEVSHELL_CMD_ASSERT(rc < 0 && errno == EPERM);
+
+      DEVSHELL_CMD_ASSERT(get_sched(tid) == SCHED_OTHER);
+   }
+
+   /* At least the idle task must be there */
+   printf("Kernel threads checked: %d\n", found);
+   DEVSHELL_CMD_ASSERT(found > 0);
+   return 0;
+}
+
+static pid_t spawn_cpu_hog(void)
+{
+   pid_t pid = fork();
+   DEVSHELL_CMD_ASSERT(pid >= 0);
+
+   if (!pid) {
+      while (true) { }
+   }
+
+   return pid;
+}
+
+static void kill_cpu_hog(pid_t pid)
+{
+   int wstatus;
+
+   kill(pid, SIGKILL);
+   DEVSHELL_CMD_ASSERT(waitpid(pid, &wstatus, 0) == pid);
+}
+
+/*
+ * Wake-up latency of a task sleeping for RT_LATENCY_DELAY_NS, with the given
+ * policy, while RT_LATENCY_HOGS fair CPU-bound tasks are running.
+ */
+static u64 measure_wakeup_to_run(int policy, int prio)
+{
+   u64 target, lat, tot = 0, max = 0;
+   struct timespec ts;
+   int pipefd[2];
+   pid_t child;
+   int rc;
+
+   rc = pipe(pipefd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      close(pipefd[0]);
+
+      if (set_sched(0, policy, prio))
+         exit(1);
+
+      for (int i = 0; i < RT_LATENCY_ITERS; i++) {
+
+         target = mono_ns() + RT_LATENCY_DELAY_NS;
+         ts.tv_sec = (time_t)(target / 1000000000ull);
+         ts.tv_nsec = (long)(target % 1000000000ull);
+
+         while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL))
+            { }
+
+         lat = mono_ns() - target;
+         tot += lat;
+         max = MAX(max, lat);
+      }
+
+      if (write(pipefd[1], &tot, sizeof(tot)) != sizeof(tot))
+         exit(1);
+
+      if (write(pipefd[1], &max, sizeof(max)) != sizeof(max))
+         exit(1);
+
+      exit(0);
+   }
+
+   close(pipefd[1]);
+   rc = read(pipefd[0], &tot, sizeof(tot));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(tot));
+   rc = read(pipefd[0], &max, sizeof(max));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(max));
+   close(pipefd[0]);
+   wait_child_ok(child);
+
+   printf("[%-11s] wakeup-to-run latency: avg %6" PRIu64 " us, "
+          "max %6" PRIu64 " us\n",
+          policy == SCHED_OTHER ? "SCHED_OTHER" : "SCHED_FIFO",
+          tot / RT_LATENCY_ITERS / 1000, max / 1000);
+
+   return max;
+}
+
+/* Wake-up latency of RT tasks vs. regular tasks, under a CPU-bound load */
+int cmd_rt_latency(int argc, char **argv)
+{
+   pid_t hogs[RT_LATENCY_HOGS];
+   u64 rt_max;
+
+   for (int i = 0; i < RT_LATENCY_HOGS; i++)
+      hogs[i] = spawn_cpu_hog();
+
+   measure_wakeup_to_run(SCHED_OTHER, 0);
+   rt_max = measure_wakeup_to_run(SCHED_FIFO, RT_TEST_PRIO);
+
+   for (int i = 0; i < RT_LATENCY_HOGS; i++)
+      kill_cpu_hog(hogs[i]);
+
+   DEVSHELL_CMD_ASSERT(rt_max < RT_MAX_LATENCY_NS);
+   return 0;
+}
+
+/*
+ * A runaway SCHED_FIFO task must not lock up the system: check that a regular
+ * task can still run, before the RT one completes.
+ */
+int cmd_rt_throttle(int argc, char **argv)
+{
+   u64 rt_end, now;
+   int pipefd[2];
+   pid_t child;
+   int rc;
+
+   rc = pipe(pipefd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      close(pipefd[0]);
+
+      if (set_sched(0, SCHED_FIFO, RT_TEST_PRIO))
+         exit(1);
+
+      rt_end = mono_ns() + RT_HOG_DURATION_NS;
+
+      while ((now = mono_ns()) < rt_end) { }
+
+      if (write(pipefd[1], &now, sizeof(now)) != sizeof(now))
+         exit(1);
+
+      exit(0);
+   }
+
+   close(pipefd[1]);
+
+   /* Let the RT task start spinning, then check that we got the CPU back */
+   usleep(50 * 1000);
+   now = mono_ns();
+
+   rc = read(pipefd[0], &rt_end, sizeof(rt_end));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(rt_end));
+   close(pipefd[0]);
+   wait_child_ok(child);
+
+   printf("Regular task ran %" PRIu64 " ms before the RT task ended\n",
+          rt_end > now ? (rt_end - now) / 1000000 : 0);
+
+   DEVSHELL_CMD_ASSERT(now < rt_end);
+   return 0;
+}
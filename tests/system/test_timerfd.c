@@ -0,0 +1,435 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+
+#include "devshell.h"
+
+#define LATENCY_ITERS                30
+#define LATENCY_DELAY_NS      (2 * 1000 * 1000)
+
+static u64 mono_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static struct itimerspec make_itimerspec(u64 value_ns, u64 interval_ns)
+{
+   return (struct itimerspec) {
+      .it_interval = {
+         .tv_sec = (time_t)(interval_ns / 1000000000ull),
+         .tv_nsec = (long)(interval_ns % 1000000000ull),
+      },
+      .it_value = {
+         .tv_sec = (time_t)(value_ns / 1000000000ull),
+         .tv_nsec = (long)(value_ns % 1000000000ull),
+      },
+   };
+}
+
+static void wait_readable(int fd)
+{
+   struct pollfd pfd = { .fd = fd, .events = POLLIN };
+   int rc;
+
+   do {
+      rc = poll(&pfd, 1, -1);
+   } while (rc < 0 && errno == EINTR);
+
+   DEVSHELL_CMD_ASSERT(rc == 1);
+   DEVSHELL_CMD_ASSERT(pfd.revents & POLLIN);
+}
+
+/* One-shot, periodic and non-blocking timerfd behavior */
+int cmd_timerfd(int argc, char **argv)
+{
+   struct itimerspec its, old;
+   u64 cnt, t0, elapsed;
+   int fd, rc;
+
+   fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   /* Not armed: reading must fail with EAGAIN */
+   rc = read(fd, &cnt, sizeof(cnt));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   /* Short reads are not allowed */
+   rc = read(fd, &cnt, sizeof(cnt) - 1);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   /* One-shot timer: 20 ms */
+   t0 = mono_ns();
+   its = make_itimerspec(20 * 1000 * 1000, 0);
+   rc = timerfd_settime(fd, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   rc = timerfd_gettime(fd, &its);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(its.it_value.tv_sec || its.it_value.tv_nsec);
+
+   wait_readable(fd);
+   elapsed = mono_ns() - t0;
+
+   rc = read(fd, &cnt, sizeof(cnt));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(cnt));
+   DEVSHELL_CMD_ASSERT(cnt == 1);
+   printf("one-shot: expired after %" PRIu64 " us\n", elapsed / 1000);
+
+   /* Tolerate one tick of error on the coarse clock */
+   DEVSHELL_CMD_ASSERT(elapsed + 10 * 1000 * 1000 >= 20 * 1000 * 1000);
+
+   /* Now it's disarmed */
+   rc = timerfd_gettime(fd, &its);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(!its.it_value.tv_sec && !its.it_value.tv_nsec);
+
+   /* Periodic timer: 5 ms, let it expire several times before reading */
+   its = make_itimerspec(5 * 1000 * 1000, 5 * 1000 * 1000);
+   rc = timerfd_settime(fd, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   usleep(60 * 1000);
+
+   rc = read(fd, &cnt, sizeof(cnt));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(cnt));
+   printf("periodic: %" PRIu64 " expirations in ~60 ms\n", cnt);
+   DEVSHELL_CMD_ASSERT(cnt >= 5);
+
+   /* Disarm it, getting the old value back */
+   its = make_itimerspec(0, 0);
+   rc = timerfd_settime(fd, 0, &its, &old);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(old.it_interval.tv_nsec == 5 * 1000 * 1000);
+
+   /* An absolute time in the past expires immediately */
+   its = make_itimerspec(1000, 0);
+   rc = timerfd_settime(fd, TFD_TIMER_ABSTIME, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   wait_readable(fd);
+
+   rc = read(fd, &cnt, sizeof(cnt));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(cnt) && cnt == 1);
+
+   /* Invalid values */
+   its = make_itimerspec(0, 0);
+   its.it_value.tv_nsec = 1000000000;
+   rc = timerfd_settime(fd, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   rc = timerfd_settime(0, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+#ifdef TFD_TIMER_CANCEL_ON_SET
+   if (getenv("TILCK")) {
+      /* Not supported on Tilck: it must be rejected, not ignored */
+      its = make_itimerspec(1000, 0);
+      rc = timerfd_settime(fd,
+                           TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET,
+                           &its,
+                           NULL);
+      DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   }
+#endif
+
+   close(fd);
+   return 0;
+}
+
+/* Counter and semaphore semantics of eventfd */
+int cmd_eventfd(int argc, char **argv)
+{
+   u64 val;
+   int fd, rc;
+
+   fd = eventfd(3, EFD_NONBLOCK);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   val = 4;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val) && val == 7);
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   /* Overflow */
+   val = 0xfffffffffffffffeull;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc == sizeof(val));
+
+   val = 1;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+
+   val = 0xffffffffffffffffull;
+   rc = write(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+   close(fd);
+
+   /* Semaphore mode */
+   fd = eventfd(2, EFD_NONBLOCK | EFD_SEMAPHORE);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   for (int i = 0; i < 2; i++) {
+      rc = read(fd, &val, sizeof(val));
+      DEVSHELL_CMD_ASSERT(rc == sizeof(val) && val == 1);
+   }
+
+   rc = read(fd, &val, sizeof(val));
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EAGAIN);
+   close(fd);
+   return 0;
+}
+
+static volatile int posix_timer_signals;
+
+static void posix_timer_sig_handler(int signum)
+{
+   posix_timer_signals++;
+}
+
+/* POSIX per-process timers delivering signals */
+int cmd_posix_timers(int argc, char **argv)
+{
+   struct sigevent sev = {0};
+   struct itimerspec its;
+   timer_t tid;
+   int rc;
+
+   signal(SIGUSR1, &posix_timer_sig_handler);
+
+   sev.sigev_notify = SIGEV_SIGNAL;
+   sev.sigev_signo = SIGUSR1;
+
+   rc = timer_create(CLOCK_MONOTONIC, &sev, &tid);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* Periodic, 10 ms */
+   its = make_itimerspec(10 * 1000 * 1000, 10 * 1000 * 1000);
+   rc = timer_settime(tid, 0, &its, NULL);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   for (int i = 0; i < 100 && posix_timer_signals < 5; i++)
+      usleep(10 * 1000);
+
+   printf("Got %d signals\n", posix_timer_signals);
+   DEVSHELL_CMD_ASSERT(posix_timer_signals >= 5);
+
+   rc = timer_getoverrun(tid);
+   DEVSHELL_CMD_ASSERT(rc >= 0);
+
+   rc = timer_gettime(tid, &its);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+   DEVSHELL_CMD_ASSERT(its.it_interval.tv_nsec == 10 * 1000 * 1000);
+
+   rc = timer_delete(tid);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   /* The timer's id is not valid anymore */
+   rc = timer_gettime(tid, &its);
+   DEVSHELL_CMD_ASSERT(rc < 0 && errno == EINVAL);
+
+   signal(SIGUSR1, SIG_DFL);
+   return 0;
+}
+
+static void
+print_latency(const char *name, u64 tot, u64 max)
+{
+   printf("%-28s avg: %6" PRIu64 " us, max: %6" PRIu64 " us\n",
+          name, tot / LATENCY_ITERS / 1000, max / 1000);
+}
+
+/* Delay between a timerfd's expiration and the wake up of its poller */
+static void measure_timerfd_latency(void)
+{
+   struct itimerspec its = make_itimerspec(LATENCY_DELAY_NS, 0);
+   u64 target, lat, tot = 0, max = 0;
+   u64 cnt;
+   int fd, rc;
+
+   fd = timerfd_create(CLOCK_MONOTONIC, 0);
+   DEVSHELL_CMD_ASSERT(fd >= 0);
+
+   for (int i = 0; i < LATENCY_ITERS; i++) {
+
+      target = mono_ns() + LATENCY_DELAY_NS;
+      rc = timerfd_settime(fd, 0, &its, NULL);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+
+      wait_readable(fd);
+      lat = mono_ns();
+      lat = lat > target ? lat - target : 0;
+
+      rc = read(fd, &cnt, sizeof(cnt));
+      DEVSHELL_CMD_ASSERT(rc == sizeof(cnt));
+
+      tot += lat;
+      max = MAX(max, lat);
+   }
+
+   close(fd);
+   print_latency("timerfd", tot, max);
+}
+
+/*
+ * The workaround used without timerfd: a helper process sleeping until the
+ * deadline and then writing to a pipe.
+ */
+static void measure_sleep_pipe_latency(void)
+{
+   u64 target, lat, tot = 0, max = 0;
+   struct timespec ts;
+   int pipefd[2];
+   int rc, wstatus;
+   pid_t child;
+
+   rc = pipe(pipefd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      close(pipefd[0]);
+
+      for (int i = 0; i < LATENCY_ITERS; i++) {
+
+         target = mono_ns() + LATENCY_DELAY_NS;
+         ts.tv_sec = (time_t)(target / 1000000000ull);
+         ts.tv_nsec = (long)(target % 1000000000ull);
+
+         while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL))
+            { }
+
+         if (write(pipefd[1], &target, sizeof(target)) != sizeof(target))
+            exit(1);
+      }
+
+      exit(0);
+   }
+
+   close(pipefd[1]);
+
+   for (int i = 0; i < LATENCY_ITERS; i++) {
+
+      wait_readable(pipefd[0]);
+      lat = mono_ns();
+
+      rc = read(pipefd[0], &target, sizeof(target));
+      DEVSHELL_CMD_ASSERT(rc == sizeof(target));
+
+      lat = lat > target ? lat - target : 0;
+      tot += lat;
+      max = MAX(max, lat);
+   }
+
+   close(pipefd[0]);
+   waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+   print_latency("sleep + pipe", tot, max);
+}
+
+/*
+ * Delay between a write from another process and the wake up of the poller,
+ * using either an eventfd or a pipe. The writer waits for an ack before the
+ * next iteration, in order to never coalesce two events.
+ */
+static void measure_wakeup_latency(bool use_eventfd)
+{
+   u64 t0, lat, tot = 0, max = 0;
+   int pipefd[2], ackfd[2];
+   int rfd, wfd, rc, wstatus;
+   char ack = 0;
+   pid_t child;
+
+   if (use_eventfd) {
+      rfd = wfd = eventfd(0, 0);
+      DEVSHELL_CMD_ASSERT(rfd >= 0);
+   } else {
+      rc = pipe(pipefd);
+      DEVSHELL_CMD_ASSERT(rc == 0);
+      rfd = pipefd[0];
+      wfd = pipefd[1];
+   }
+
+   rc = pipe(ackfd);
+   DEVSHELL_CMD_ASSERT(rc == 0);
+
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+
+      for (int i = 0; i < LATENCY_ITERS; i++) {
+
+         t0 = mono_ns();
+
+         if (write(wfd, &t0, sizeof(t0)) != sizeof(t0))
+            exit(1);
+
+         if (read(ackfd[0], &ack, 1) != 1)
+            exit(1);
+      }
+
+      exit(0);
+   }
+
+   for (int i = 0; i < LATENCY_ITERS; i++) {
+
+      wait_readable(rfd);
+      lat = mono_ns();
+
+      rc = read(rfd, &t0, sizeof(t0));
+      DEVSHELL_CMD_ASSERT(rc == sizeof(t0));
+
+      lat = lat > t0 ? lat - t0 : 0;
+      tot += lat;
+      max = MAX(max, lat);
+
+      rc = write(ackfd[1], &ack, 1);
+      DEVSHELL_CMD_ASSERT(rc == 1);
+   }
+
+   waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(WIFEXITED(wstatus) && WEXITSTATUS(wstatus) == 0);
+
+   close(ackfd[0]);
+   close(ackfd[1]);
+   close(rfd);
+
+   if (!use_eventfd)
+      close(wfd);
+
+   print_latency(use_eventfd ? "eventfd wakeup" : "pipe wakeup", tot, max);
+}
+
+/*
+ * Compare the notification latency of timerfd and eventfd with the pipe-based
+ * workarounds. Just report the numbers: they depend too much on the machine.
+ */
+int cmd_notify_latency(int argc, char **argv)
+{
+   measure_timerfd_latency();
+   measure_sleep_pipe_latency();
+   measure_wakeup_latency(true);
+   measure_wakeup_latency(false);
+   return 0;
+}
@@ -0,0 +1,193 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+#include "devshell.h"
+
+#define JITTER_ITERS                 50
+
+static u64 mono_ns(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (u64)ts.tv_sec * 1000000000ull + (u64)ts.tv_nsec;
+}
+
+static int
+run_jitter_test(const char *name, u64 req_ns, bool abs)
+{
+   u64 t0, t1, start, end, act, min_act = (u64)-1, max_act = 0;
+   struct timespec req, target;
+   int rc;
+
+   start = mono_ns();
+
+   for (int i = 0; i < JITTER_ITERS; i++) {
+
+      t0 = mono_ns();
+
+      if (abs) {
+
+         target.tv_sec = (time_t)((t0 + req_ns) / 1000000000ull);
+         target.tv_nsec = (long)((t0 + req_ns) % 1000000000ull);
+         rc = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &target, NULL);
+
+      } else {
+
+         req.tv_sec = (time_t)(req_ns / 1000000000ull);
+         req.tv_nsec = (long)(req_ns % 1000000000ull);
+         rc = nanosleep(&req, NULL) ? errno : 0;
+      }
+
+      t1 = mono_ns();
+
+      if (rc) {
+         printf("ERROR: %s failed with: %s\n", name, strerror(rc));
+         return 1;
+      }
+
+      act = t1 - t0;
+      min_act = MIN(min_act, act);
+      max_act = MAX(max_act, act);
+   }
+
+   end = mono_ns();
+
+   printf("%-16s req: %7" PRIu64 " us, avg: %7" PRIu64 " us, "
+          "min: %7" PRIu64 " us, max: %7" PRIu64 " us\n",
+          name, req_ns / 1000,
+          (end - start) / JITTER_ITERS / 1000,
+          min_act / 1000, max_act / 1000);
+
+   /*
+    * The clock itself might have a coarse resolution, so the single samples
+    * cannot be trusted. But, on the whole run, we must never sleep less than
+    * requested (modulo one tick of tolerance).
+    */
+   if ((end - start) + 10 * 1000 * 1000 < req_ns * JITTER_ITERS) {
+      printf("ERROR: slept less than requested\n");
+      return 1;
+   }
+
+   return 0;
+}
+
+/*
+ * Report the requested vs. actual durations of short sleeps, both relative
+ * (nanosleep) and absolute (clock_nanosleep + TIMER_ABSTIME).
+ */
+int cmd_nanosleep_jitter(int argc, char **argv)
+{
+   static const u64 durations_ns[] = {
+      50 * 1000, 200 * 1000, 1000 * 1000, 5 * 1000 * 1000,
+   };
+
+   for (int i = 0; i < ARRAY_SIZE(durations_ns); i++) {
+
+      if (run_jitter_test("nanosleep", durations_ns[i], false))
+         return 1;
+
+      if (run_jitter_test("clock_nanosleep", durations_ns[i], true))
+         return 1;
+   }
+
+   return 0;
+}
+
+/*
+ * Check that CLOCK_MONOTONIC never goes backwards and that, thanks to the
+ * clocksource, its resolution is better than the timer tick.
+ */
+int cmd_clock_mono(int argc, char **argv)
+{
+   struct timespec res;
+   u64 prev, now, min_step = (u64)-1;
+   char buf[32] = {0};
+   FILE *fh;
+
+   if (clock_getres(CLOCK_MONOTONIC, &res)) {
+      printf("ERROR: clock_getres() failed: %s\n", strerror(errno));
+      return 1;
+   }
+
+   if ((fh = fopen("/syst/clocksource/current", "r"))) {
+      if (!fgets(buf, sizeof(buf), fh))
+         buf[0] = 0;
+      fclose(fh);
+   }
+
+   printf("clocksource: %s", buf[0] ? buf : "<unknown>\n");
+   printf("CLOCK_MONOTONIC resolution: %ld ns\n", res.tv_nsec);
+
+   prev = mono_ns();
+
+   for (int i = 0; i < 100 * 1000; i++) {
+
+      now = mono_ns();
+
+      if (now < prev) {
+         printf("ERROR: time went backwards by %" PRIu64 " ns\n", prev - now);
+         return 1;
+      }
+
+      if (now > prev)
+         min_step = MIN(min_step, now - prev);
+
+      prev = now;
+   }
+
+   printf("Min observed step: %" PRIu64 " ns\n", min_step);
+
+   if (res.tv_sec > 0 || res.tv_nsec <= 0) {
+      printf("ERROR: unexpected resolution\n");
+      return 1;
+   }
+
+   return 0;
+}
+
+/*
+ * A huge relative sleep must not wrap around into a short one: 18446744074 s
+ * in ns is just above 2^64 and would become a ~290 ms sleep if the conversion
+ * didn't saturate.
+ */
+int cmd_nanosleep_huge(int argc, char **argv)
+{
+   struct timespec req = { .tv_sec = 0, .tv_nsec = 0 };
+   int wstatus;
+   pid_t child;
+   int rc;
+
+   if (sizeof(req.tv_sec) < 8) {
+      printf(PFX "[SKIP] because time_t is 32-bit\n");
+      return 0;
+   }
+
+   req.tv_sec = (time_t)18446744074ull;
+   child = fork();
+   DEVSHELL_CMD_ASSERT(child >= 0);
+
+   if (!child) {
+      clock_nanosleep(CLOCK_MONOTONIC, 0, &req, NULL);
+      exit(1); /* we should never wake up */
+   }
+
+   usleep(500 * 1000);
+
+   rc = waitpid(child, &wstatus, WNOHANG);
+   DEVSHELL_CMD_ASSERT(rc == 0); /* still sleeping */
+
+   kill(child, SIGKILL);
+   rc = waitpid(child, &wstatus, 0);
+   DEVSHELL_CMD_ASSERT(rc == child);
+   DEVSHELL_CMD_ASSERT(WIFSIGNALED(wstatus));
+   return 0;
+}
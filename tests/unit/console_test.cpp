@@ -7,6 +7,8 @@
 #include <vector>
 #include <random>
 #include <memory>
+#include <string>
+#include <chrono>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -145,9 +147,12 @@ static void test_vi_set_char_at(u16 row, u16 col, u16 entry)
    test_video_framebuffer[row][col] = entry;
 }
 
+static int set_row_calls;
+
 static void test_vi_set_row(u16 row, u16 *data, bool fpu_allowed)
 {
    ASSERT_LT(row, TEST_TERM_ROWS);
+   set_row_calls++;
 
    memcpy(&test_video_framebuffer[row],
           data,
@@ -193,6 +198,7 @@ static const struct video_interface test_console_vi =
    NULL, /* redraw_static_elements */
    NULL, /* disable_static_elems_refresh */
    NULL, /* enable_static_elems_refresh */
+   NULL, /* flush */
 };
 
 class console_test : public Test {
@@ -271,3 +277,141 @@ TEST_F(console_test, cursor_move)
       +--------------------+
    )");
 }
+
+TEST_F(console_test, runs_and_escapes)
+{
+   console_write("ab\033[31mcd\033[0mef\033(0q\033(Bgh");
+   console_test_dump_screen(true);
+
+   EXPECT_EQ(vgaentry_get_char(test_video_framebuffer[0][1]), 'b');
+   EXPECT_EQ(vgaentry_get_char(test_video_framebuffer[0][2]), 'c');
+   EXPECT_EQ(vgaentry_get_fg(test_video_framebuffer[0][2]), COLOR_RED);
+   EXPECT_EQ(vgaentry_get_char(test_video_framebuffer[0][4]), 'e');
+   EXPECT_NE(vgaentry_get_fg(test_video_framebuffer[0][4]), COLOR_RED);
+
+   /* 'q' in the gfx charset is a horizontal line, not a 'q' */
+   EXPECT_NE(vgaentry_get_char(test_video_framebuffer[0][6]), 'q');
+   EXPECT_EQ(vgaentry_get_char(test_video_framebuffer[0][7]), 'g');
+   EXPECT_EQ(vgaentry_get_char(test_video_framebuffer[0][8]), 'h');
+}
+
+static string screen_row_str(int row)
+{
+   string s;
+
+   for (int j = 0; j < TEST_TERM_COLS; j++)
+      s += (char)vgaentry_get_char(test_video_framebuffer[row][j]);
+
+   return s.substr(0, s.find_last_not_of(' ') + 1);
+}
+
+TEST_F(console_test, scrollback)
+{
+   for (int i = 0; i < 10; i++)
+      console_write(("line " + to_string(i) + "\n").c_str());
+
+   EXPECT_EQ(screen_row_str(0), "line 6");
+   EXPECT_EQ(screen_row_str(3), "line 9");
+
+   t->tintf->scroll_up(t->tstate, 2);
+   EXPECT_EQ(screen_row_str(0), "line 4");
+   EXPECT_EQ(screen_row_str(4), "line 8");
+
+   t->tintf->scroll_down(t->tstate, 1);
+   EXPECT_EQ(screen_row_str(0), "line 5");
+   EXPECT_EQ(screen_row_str(4), "line 9");
+
+   t->tintf->scroll_down(t->tstate, 100);
+   EXPECT_EQ(screen_row_str(0), "line 6");
+   EXPECT_EQ(screen_row_str(4), "");
+}
+
+TEST_F(console_test, scroll_skips_unchanged_rows)
+{
+   /* Many identical rows: scrolling the view doesn't change them */
+   for (int i = 0; i < 10; i++)
+      console_write("same\n");
+
+   for (int i = 0; i < 10; i++)
+      console_write("\n");
+
+   set_row_calls = 0;
+   t->tintf->scroll_up(t->tstate, 1);
+
+   /* All the rows on the screen were and still are blank */
+   EXPECT_EQ(set_row_calls, 0);
+   EXPECT_EQ(screen_row_str(0), "");
+
+   /* Only the first row changes: blank -> "same" */
+   t->tintf->scroll_up(t->tstate, 6);
+   EXPECT_EQ(screen_row_str(0), "same");
+   EXPECT_EQ(screen_row_str(1), "");
+   EXPECT_EQ(set_row_calls, 1);
+}
+
+class console_bench : public console_test {
+public:
+
+   /* Write `data` in tty-sized chunks, `iters` times. Returns bytes/sec */
+   double bench_write(const string &data, int iters) {
+
+      const size_t chunk = 4 * KB;
+      const auto start = chrono::steady_clock::now();
+
+      for (int i = 0; i < iters; i++)
+         for (size_t off = 0; off < data.size(); off += chunk)
+            console_write(data.c_str() + off, min(chunk, data.size() - off));
+
+      const auto end = chrono::steady_clock::now();
+      const double sec = chrono::duration<double>(end - start).count();
+      return (double)data.size() * iters / sec;
+   }
+
+   void report(const char *name, double bps) {
+      cout << "[ INFO     ] " << name << ": ";
+      cout << (u64)(bps / KB) << " KB/s" << endl;
+   }
+};
+
+TEST_F(console_bench, plain_text)
+{
+   string data;
+
+   for (int i = 0; i < 1000; i++)
+      data += "The quick brown fox jumps over the lazy dog, again\n";
+
+   report("plain text", bench_write(data, 20));
+}
+
+TEST_F(console_bench, ansi_colored_text)
+{
+   string data;
+
+   for (int i = 0; i < 1000; i++) {
+      data += "\033[1;3" + to_string(1 + i % 7) + "m" + "drwxr-xr-x";
+      data += "\033[0m 2 root root 4096 \033[34mdirectory_name\033[0m\n";
+   }
+
+   report("ANSI colored text", bench_write(data, 20));
+}
+
+TEST_F(console_bench, vim_style_redraw)
+{
+   string data;
+
+   for (int screen = 0; screen < 50; screen++) {
+
+      data += "\033[?25l\033[H";
+
+      for (int r = 1; r < TEST_TERM_ROWS; r++) {
+         data += "\033[" + to_string(r) + ";1H";
+         data += "\033[33m" + to_string(screen + r) + "\033[m int x = 0;";
+         data += "\033[K";
+      }
+
+      data += "\033[" + to_string(TEST_TERM_ROWS) + ";1H\033[7m-- INSERT --";
+      data += "\033[m\033[K\033[1;5H\033[?25h";
+   }
+
+   report("vim-style redraw", bench_write(data, 100));
+}
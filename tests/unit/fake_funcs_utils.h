@@ -6,5 +6,6 @@
 extern "C" {
    void initialize_test_kernel_heap();
    extern bool mock_kmalloc;
+   extern bool mock_sys_time;
    extern bool suppress_printk;
 }
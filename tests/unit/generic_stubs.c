@@ -32,6 +32,12 @@ void gdt_install() { }
 void idt_install() { }
 void irq_install() { }
 void hw_timer_setup() { }
+u32 hw_timer_get_elapsed_ns() { return 0; }
+u32 hw_timer_get_freq_khz() { return 1193; }
+bool hw_has_tsc() { return false; }
+void hw_hrtimer_calib_start() { }
+bool hw_hrtimer_calib_end() { return false; }
+void hw_hrtimer_program() { }
 void irq_install_handler() { }
 void irq_uninstall_handler() { }
 void setup_sysenter_interface() { }
@@ -51,11 +57,14 @@ void fpu_context_end() { }
 void map_zero_pages() { NOT_REACHED(); }
 void dump_var_mtrrs() { }
 void set_page_rw() { }
+void set_pages_rw() { }
 void poweroff() { NOT_REACHED(); }
 int get_irq_num(void *ctx) { return -1; }
 int get_int_num(void *ctx) { return -1; }
 void retain_pageframes_mapped_at() { }
 void release_pageframes_mapped_at() { }
+u32 get_pageframe_ref_count() { return 1; }
+void pdir_get_user_mem_usage() { }
 bool irq_is_masked() { NOT_REACHED(); return false; }
 
 void *hi_vmem_reserve(size_t size) { return NULL; }
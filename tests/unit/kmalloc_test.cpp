@@ -8,6 +8,7 @@
 #include <unordered_map>
 #include <random>
 #include <memory>
+#include <set>
 
 #include <gtest/gtest.h>
 #include <gmock/gmock.h>
@@ -19,8 +20,10 @@
 extern "C" {
 
    #include <tilck/common/utils.h>
+   #include <tilck_gen_headers/config_kmalloc.h>
 
    #include <tilck/kernel/kmalloc.h>
+   #include <tilck/kernel/kmalloc_debug.h>
    #include <tilck/kernel/paging.h>
    #include <tilck/kernel/self_tests.h>
 
@@ -148,6 +151,19 @@ TEST_F(kmalloc_test, glibc_malloc_comparative_perf_test)
    mock_kmalloc = false;
 }
 
+TEST_F(kmalloc_test, perf_test_no_free_lists)
+{
+   debug_kmalloc_set_free_lists(false);
+   selftest_kmalloc_perf();
+}
+
+TEST_F(kmalloc_test, bench)
+{
+   mock_sys_time = true;
+   selftest_kmalloc_bench();
+   mock_sys_time = false;
+}
+
 #endif
 
 TEST_F(kmalloc_test, chaos_test)
@@ -181,6 +197,134 @@ TEST_F(kmalloc_test, chaos_test)
    }
 }
 
+/*
+ * Check that the free lists of the heap `h` contain exactly its maximal free
+ * blocks, as described by the metadata nodes.
+ */
+static void
+check_free_lists(struct kmalloc_heap *h)
+{
+   struct block_node *nodes = (struct block_node *)h->metadata_nodes;
+   set<pair<ulong, size_t>> expected, actual;
+   int node_count = 1;
+   int n = 0;
+
+   for (size_t s = h->size; s >= h->min_block_size; s >>= 1) {
+
+      for (int j = n; j < n + node_count; j++) {
+
+         const bool is_free = !(nodes[j].raw & (FL_NODE_SPLIT | FL_NODE_FULL));
+         const bool parent_split = j == 0 || nodes[NODE_PARENT(j)].split;
+
+         if (is_free && parent_split)
+            expected.insert(make_pair((ulong)node_to_ptr(h, j, s), s));
+      }
+
+      node_count <<= 1;
+      n = NODE_LEFT(n);
+   }
+
+   for (u32 i = 0; i < KMALLOC_FREE_LISTS_COUNT; i++) {
+
+      struct list *l = &h->free_lists[i];
+      struct list_node *ln;
+
+      EXPECT_EQ(!list_is_empty(l), !!(h->free_lists_mask & (1u << i)));
+
+      for (ln = l->first; ln != (struct list_node *)l; ln = ln->next)
+         actual.insert(make_pair((ulong)ln, (size_t)1 << i));
+   }
+
+   EXPECT_EQ(expected, actual);
+}
+
+static void
+check_all_free_lists(void)
+{
+   for (int h = 0; h < KMALLOC_HEAPS_COUNT && heaps[h]; h++) {
+
+      if (!heaps[h]->free_lists_on)
+         continue;
+
+      ASSERT_NO_FATAL_FAILURE({ check_free_lists(heaps[h]); }) << "heap: " << h;
+   }
+}
+
+TEST_F(kmalloc_test, free_lists)
+{
+   random_device rdev;
+   const auto seed = rdev();
+   default_random_engine e(seed);
+   lognormal_distribution<> dist(9.0, 2);
+   vector<pair<void *, size_t>> allocs;
+   vector<pair<void *, size_t>> multi_step_allocs;
+   unique_ptr<u8[]> meta_before[KMALLOC_HEAPS_COUNT];
+
+   cout << "[ INFO     ] random seed: " << seed << endl;
+
+   if (!KMALLOC_FREE_LISTS) {
+      cout << "[ INFO     ] KMALLOC_FREE_LISTS is disabled: skip" << endl;
+      return;
+   }
+
+   for (int h = 0; h < KMALLOC_HEAPS_COUNT && heaps[h]; h++) {
+      ASSERT_TRUE(heaps[h]->free_lists_on);
+      meta_before[h].reset(new u8[heaps[h]->metadata_size]);
+   }
+
+   save_heaps_metadata(meta_before);
+   ASSERT_NO_FATAL_FAILURE({ check_all_free_lists(); });
+
+   for (int iter = 0; iter < 50; iter++) {
+
+      for (int i = 0; i < 200; i++) {
+
+         size_t s = round(dist(e));
+
+         if (s <= SMALL_HEAP_SIZE / 16)
+            continue;
+
+         if (i % 16 == 0) {
+
+            /* Same kind of allocation as user_valloc_and_map() */
+            s = pow2_round_up_at(s, PAGE_SIZE);
+            void *r = general_kmalloc(&s, KMALLOC_FL_MULTI_STEP | PAGE_SIZE);
+
+            if (r)
+               multi_step_allocs.push_back(make_pair(r, s));
+
+            continue;
+         }
+
+         if (void *r = kmalloc(s))
+            allocs.push_back(make_pair(r, s));
+      }
+
+      ASSERT_NO_FATAL_FAILURE({ check_all_free_lists(); }) << "iter: " << iter;
+      shuffle(allocs.begin(), allocs.end(), e);
+
+      for (size_t i = 0; i < allocs.size() / 2; i++)
+         kfree2(allocs[i].first, allocs[i].second);
+
+      allocs.erase(allocs.begin(), allocs.begin() + allocs.size() / 2);
+
+      for (auto &p : multi_step_allocs) {
+
+         size_t s = p.second;
+         general_kfree(p.first, &s, KFREE_FL_ALLOW_SPLIT | KFREE_FL_MULTI_STEP);
+      }
+
+      multi_step_allocs.clear();
+      ASSERT_NO_FATAL_FAILURE({ check_all_free_lists(); }) << "iter: " << iter;
+   }
+
+   for (const auto &p : allocs)
+      kfree2(p.first, p.second);
+
+   ASSERT_NO_FATAL_FAILURE({ check_all_free_lists(); });
+   ASSERT_NO_FATAL_FAILURE({ check_heaps_metadata(meta_before); });
+}
+
 #define COLOR_RED           "\033[31m"
 #define COLOR_YELLOW        "\033[93m"
 #define COLOR_BRIGHT_GREEN  "\033[92m"
@@ -0,0 +1,97 @@
+/* SPDX-License-Identifier: BSD-2-Clause */
+
+#include <string>
+#include <gtest/gtest.h>
+
+using namespace std;
+
+extern "C" {
+   #include <tilck/kernel/kmsg.h>
+}
+
+static string kmsg_read_all(u32 *pos, u32 chunk_size, bool *any_lost)
+{
+   char buf[256];
+   string ret;
+   bool lost;
+   u32 n;
+
+   *any_lost = false;
+   chunk_size = min(chunk_size, (u32)sizeof(buf));
+
+   while ((n = kmsg_read(pos, buf, chunk_size, &lost))) {
+      *any_lost = *any_lost || lost;
+      ret.append(buf, n);
+   }
+
+   return ret;
+}
+
+TEST(kmsg, basic)
+{
+   u32 pos = kmsg_get_end_pos();
+   bool lost;
+   string s;
+
+   kmsg_append("[prefix] ", 9, "hello\n", 6);
+   kmsg_append(NULL, 0, "world\n", 6);
+
+   s = kmsg_read_all(&pos, 256, &lost);
+   EXPECT_EQ(s, "[prefix] hello\nworld\n");
+   EXPECT_FALSE(lost);
+   EXPECT_EQ(pos, kmsg_get_end_pos());
+   EXPECT_FALSE(kmsg_has_data(pos));
+
+   /* Nothing more to read */
+   s = kmsg_read_all(&pos, 256, &lost);
+   EXPECT_EQ(s, "");
+}
+
+TEST(kmsg, small_reads_and_wrap_around)
+{
+   u32 pos = kmsg_get_end_pos();
+   string expected, s;
+   char line[64];
+   bool lost;
+
+   /* Write more than the log size, reading everything while writing */
+   for (int i = 0; i < (int)(3 * KMSG_BUF_SIZE / 32); i++) {
+
+      int n = snprintf(line, sizeof(line), "line %d\n", i);
+      kmsg_append(line, (u32)n, NULL, 0);
+      expected += line;
+
+      if (i % 8 == 7) {
+         s += kmsg_read_all(&pos, 7, &lost);
+         ASSERT_FALSE(lost);
+      }
+   }
+
+   s += kmsg_read_all(&pos, 7, &lost);
+   ASSERT_FALSE(lost);
+   EXPECT_EQ(s, expected);
+}
+
+TEST(kmsg, lost_data)
+{
+   u32 pos = kmsg_get_end_pos();
+   char chunk[100];
+   bool lost;
+   string s;
+
+   for (u32 i = 0; i < 4 * KMSG_BUF_SIZE / sizeof(chunk); i++) {
+      memset(chunk, 'a' + (int)(i % 26), sizeof(chunk));
+      kmsg_append(chunk, sizeof(chunk), NULL, 0);
+   }
+
+   s = kmsg_read_all(&pos, 256, &lost);
+
+   EXPECT_TRUE(lost);
+   EXPECT_EQ(s.size(), (size_t)KMSG_BUF_SIZE);
+   EXPECT_EQ(pos, kmsg_get_end_pos());
+   EXPECT_EQ(kmsg_get_end_pos() - kmsg_get_first_pos(), (u32)KMSG_BUF_SIZE);
+
+   /* The last chunk must be intact */
+   EXPECT_EQ(s.substr(s.size() - sizeof(chunk)),
+             string(sizeof(chunk), chunk[0]));
+}
@@ -0,0 +1,59 @@
+#include <gtest/gtest.h>
+
+using namespace std;
+using namespace testing;
+
+extern "C" {
+   #include <tilck/kernel/mem_pressure.h>
+}
+
+static size_t shrinker_calls[2];
+static size_t shrinker_requests[2];
+
+static size_t fake_shrink0(size_t bytes)
+{
+   shrinker_calls[0]++;
+   shrinker_requests[0] = bytes;
+   return 60;
+}
+
+static size_t fake_shrink1(size_t bytes)
+{
+   shrinker_calls[1]++;
+   shrinker_requests[1] = bytes;
+   return 60;
+}
+
+TEST(mem_pressure, shrinkers)
+{
+   struct shrinker s0 = { .node = {}, .name = "s0", .shrink = &fake_shrink0 };
+   struct shrinker s1 = { .node = {}, .name = "s1", .shrink = &fake_shrink1 };
+   struct mem_pressure_stats stats_before, stats;
+
+   mem_pressure_get_stats(&stats_before);
+   register_shrinker(&s0);
+   register_shrinker(&s1);
+
+   /* The first shrinker is enough */
+   ASSERT_EQ(mem_reclaim(50), 60U);
+   ASSERT_EQ(shrinker_calls[0], 1U);
+   ASSERT_EQ(shrinker_calls[1], 0U);
+   ASSERT_EQ(shrinker_requests[0], 50U);
+
+   /* The second one is asked just for the remaining bytes */
+   ASSERT_EQ(mem_reclaim(100), 120U);
+   ASSERT_EQ(shrinker_calls[0], 2U);
+   ASSERT_EQ(shrinker_calls[1], 1U);
+   ASSERT_EQ(shrinker_requests[0], 100U);
+   ASSERT_EQ(shrinker_requests[1], 40U);
+
+   unregister_shrinker(&s0);
+   unregister_shrinker(&s1);
+
+   ASSERT_EQ(mem_reclaim(100), 0U);
+   ASSERT_EQ(shrinker_calls[0], 2U);
+   ASSERT_EQ(shrinker_calls[1], 1U);
+
+   mem_pressure_get_stats(&stats);
+   ASSERT_EQ(stats.direct_reclaims, stats_before.direct_reclaims + 3);
+}
@@ -4,6 +4,7 @@
 #include <stdarg.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
 
 #include <tilck/common/basic_defs.h>
 #include <tilck/kernel/datetime.h>
@@ -25,9 +26,11 @@ volatile bool __in_kernel_shutdown;
 volatile bool __in_panic_debugger;
 void *__kernel_pdir;
 bool mock_kmalloc = false; /* see the comments above __wrap_general_kmalloc() */
+bool mock_sys_time = false; /* see the comments above __wrap_get_sys_time() */
 
 void *__real_general_kmalloc(size_t *size, u32 flags);
 void __real_general_kfree(void *ptr, size_t *size, u32 flags);
+u64 __real_get_sys_time(void);
 
 void panic(const char *fmt, ...)
 {
@@ -126,3 +129,21 @@ void *__wrap_kmalloc_get_first_heap(size_t *size)
 
    return buf;
 }
+
+/*
+ * In the unit tests there's no timer IRQ, therefore the system time never
+ * advances. Tests measuring throughput (e.g. the kmalloc bench) can set
+ * `mock_sys_time` in order to make get_sys_time() return the host's monotonic
+ * clock instead.
+ */
+
+u64 __wrap_get_sys_time(void)
+{
+   struct timespec ts;
+
+   if (!mock_sys_time)
+      return __real_get_sys_time();
+
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return (u64)ts.tv_sec * BILLION + (u64)ts.tv_nsec;
+}
@@ -13,6 +13,7 @@ DEF_0(wrap, check_in_irq_handler, void)
 DEF_2(wrap, general_kmalloc, void *, size_t *, u32)
 DEF_3(wrap, general_kfree, void, void *, size_t *, u32)
 DEF_1(wrap, kmalloc_get_first_heap, void *, size_t *)
+DEF_0(wrap, get_sys_time, u64)
 DEF_0(real, experiment_bar, bool)
 DEF_1(real, experiment_foo, int, int)
 DEF_2(real, vfs_dup, int, fs_handle, fs_handle *)
@@ -166,24 +166,51 @@ TEST_F(vfs_fat32, fseek)
    close(fd);
 }
 
-TEST_F(vfs_fat32, pread_not_supported)
+TEST_F(vfs_fat32, pread)
 {
    const char *fatpart_file_path = "/bigfile";
+   const char *real_file_path = PROJ_BUILD_DIR "/test_sysroot/bigfile";
+   random_device rdev;
+   const auto seed = rdev();
+   default_random_engine engine(seed);
+   char buf_tilck[1000];
+   char buf_linux[1000];
    fs_handle h = NULL;
-   char buf[32];
-   int rc;
+   ssize_t rc, linux_rc;
+   int fd;
+
+   cout << "[ INFO     ] random seed: " << seed << endl;
+
+   fd = open(real_file_path, O_RDONLY);
+   ASSERT_GE(fd, 0);
+
+   const off_t file_size = lseek(fd, 0, SEEK_END);
+   uniform_int_distribution<off_t> dist(0, file_size + 100);
 
    rc = vfs_open(fatpart_file_path, &h, 0, O_RDONLY);
    ASSERT_TRUE(rc == 0);
    ASSERT_TRUE(h != NULL);
 
-   rc = vfs_pread(h, buf, sizeof(buf), 0 /* offset */);
-   EXPECT_EQ(rc, -EPERM);
+   for (int i = 0; i < 1000; i++) {
+
+      const off_t off = dist(engine);
+
+      memset(buf_tilck, 0, sizeof(buf_tilck));
+      memset(buf_linux, 0, sizeof(buf_linux));
 
-   rc = vfs_pread(h, buf, sizeof(buf), 10 /* offset */);
-   EXPECT_EQ(rc, -EPERM);
+      linux_rc = pread(fd, buf_linux, sizeof(buf_linux), off);
+      rc = vfs_pread(h, buf_tilck, sizeof(buf_tilck), (offt)off);
+
+      ASSERT_EQ(rc, linux_rc) << "Offset: " << off << endl;
+      ASSERT_EQ(memcmp(buf_tilck, buf_linux, sizeof(buf_linux)), 0)
+         << "Offset: " << off << endl;
+   }
+
+   /* pread() does not move the file position */
+   ASSERT_EQ(vfs_seek(h, 0, SEEK_CUR), 0);
 
    vfs_close(h);
+   close(fd);
 }
 
 class vfs_ramfs : public vfs_test_base {
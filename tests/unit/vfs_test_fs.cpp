@@ -159,5 +159,7 @@ extern const struct fs_ops static_fsops_testfs = {
    .fs_shunlock          = vfs_test_fs_shunlock,
    .exlock_noblk         = nullptr,
    .exunlock             = nullptr,
+   .get_page             = nullptr,
+   .release_page         = nullptr,
 };
 
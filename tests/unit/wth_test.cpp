@@ -20,6 +20,8 @@ extern "C" {
    #include <tilck/kernel/kmalloc.h>
    #include <tilck/kernel/worker_thread.h>
    #include "kernel/wth_int.h" // private header
+
+   extern ATOMIC(int) __in_irq_count;
 }
 
 using namespace std;
@@ -34,6 +36,8 @@ static void destroy_last_worker_thread(void)
    const u32 queue_size = t->rb.max_elems;
    assert(t != NULL);
 
+   while (wth_process_single_job(t)) { }   /* free the overflow nodes */
+   wth_free_spare_nodes(t);
    safe_ringbuf_destory(&t->rb);
    kfree_array_obj(t->jobs, struct wjob, queue_size);
    kfree_obj(t, struct worker_thread);
@@ -82,10 +86,10 @@ TEST_F(worker_thread_test, base)
 
    res = wth_enqueue_on(wth, &simple_func1, TO_PTR(1234));
 
-   // There is no more space left, expecting the ADD failed.
-   ASSERT_FALSE(res);
+   // There is no more space left in the ring: the job went to the overflow list
+   ASSERT_TRUE(res);
 
-   for (int i = 0; i < max_jobs; i++) {
+   for (int i = 0; i < max_jobs + 1; i++) {
       ASSERT_NO_FATAL_FAILURE({ res = wth_process_single_job(wth); });
       ASSERT_TRUE(res);
    }
@@ -157,7 +161,9 @@ TEST_F(worker_thread_test, chaos)
 
    lognormal_distribution<> dist(3.0, 2.5);
 
+   struct wth_stats stats;
    int slots_used = 0;
+   u32 dropped = 0;
    bool res = false;
 
    for (int iters = 0; iters < 10000; iters++) {
@@ -167,8 +173,10 @@ TEST_F(worker_thread_test, chaos)
 
       for (int i = 0; i < c; i++) {
 
-         if (slots_used == max_jobs) {
+         /* Once the overflow list is full, the jobs must be dropped */
+         if (wth->overflow_cnt == WTH_MAX_OVERFLOW_JOBS) {
             ASSERT_FALSE(wth_enqueue_on(wth, &simple_func1, TO_PTR(1234)));
+            dropped++;
             break;
          }
 
@@ -192,4 +200,86 @@ TEST_F(worker_thread_test, chaos)
          slots_used--;
       }
    }
+
+   /* The pending jobs never exceed the ring plus the overflow list limit */
+   wth_get_stats(wth, &stats);
+   ASSERT_EQ(stats.dropped, dropped);
+   ASSERT_LE(stats.max_depth, (u32)(max_jobs + WTH_MAX_OVERFLOW_JOBS));
+}
+
+static int order_next;
+
+static void order_func(void *arg)
+{
+   ASSERT_EQ((long)arg, order_next);
+   order_next++;
+}
+
+TEST_F(worker_thread_test, overflow_order)
+{
+   struct worker_thread *wth = wth_find_worker(WTH_PRIO_HIGHEST);
+   const int max_jobs = wth_get_queue_size(wth);
+   const int tot = 5 * max_jobs;
+   struct wth_stats stats;
+   int enqueued = 0, n;
+
+   order_next = 0;
+
+   // Interleave enqueues and batches, always keeping the ring full.
+   for (int i = 0; i < 3 * max_jobs; i++)
+      ASSERT_TRUE(wth_enqueue_on(wth, &order_func, TO_PTR(enqueued++)));
+
+   ASSERT_NO_FATAL_FAILURE({ n = wth_process_jobs_batch(wth); });
+   ASSERT_EQ(n, WTH_JOBS_BATCH);
+
+   while (enqueued < tot)
+      ASSERT_TRUE(wth_enqueue_on(wth, &order_func, TO_PTR(enqueued++)));
+
+   do {
+      ASSERT_NO_FATAL_FAILURE({ n = wth_process_jobs_batch(wth); });
+   } while (n > 0);
+
+   ASSERT_EQ(order_next, tot);
+
+   wth_get_stats(wth, &stats);
+   ASSERT_EQ(stats.jobs, (u64)tot);
+   ASSERT_EQ(stats.max_depth, (u32)(tot - WTH_JOBS_BATCH));
+   ASSERT_EQ(stats.overflowed, (u32)(tot - max_jobs));
+   ASSERT_EQ(stats.dropped, 0u);
+}
+
+TEST_F(worker_thread_test, irq_context_overflow)
+{
+   struct worker_thread *wth = wth_find_worker(WTH_PRIO_HIGHEST);
+   const int max_jobs = wth_get_queue_size(wth);
+   const int spares = (int)wth->spare_cnt;
+   struct wth_stats stats;
+   int enqueued = 0;
+   bool res;
+
+   ASSERT_GT(spares, 0);
+   order_next = 0;
+
+   // In IRQ context, only the ring and the pre-allocated nodes can be used.
+   __in_irq_count = 1;
+
+   while (wth_enqueue_on(wth, &order_func, TO_PTR(enqueued)))
+      enqueued++;
+
+   __in_irq_count = 0;
+
+   ASSERT_EQ(enqueued, max_jobs + spares);
+
+   wth_get_stats(wth, &stats);
+   ASSERT_EQ(stats.dropped, 1u);
+   ASSERT_EQ(wth->spare_target, (u32)MIN(2 * spares, WTH_MAX_SPARE_NODES));
+
+   for (int i = 0; i < enqueued; i++) {
+      ASSERT_NO_FATAL_FAILURE({ res = wth_process_single_job(wth); });
+      ASSERT_TRUE(res);
+   }
+
+   ASSERT_NO_FATAL_FAILURE({ res = wth_process_single_job(wth); });
+   ASSERT_FALSE(res);
+   ASSERT_EQ(order_next, enqueued);
 }
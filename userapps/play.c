@@ -514,6 +514,7 @@ int main(int argc, char **argv)
 {
    int rc, cmd_rc, devfd;
    struct tilck_sound_card_info nfo;
+   struct tilck_sound_status status;
 
    parse_args(argc-1, argv+1);
 
@@ -559,6 +560,11 @@ int main(int argc, char **argv)
       return 1;
    }
 
+   if (ioctl(devfd, TILCK_IOCTL_SOUND_GET_STATUS, &status) == 0) {
+      if (status.underruns)
+         printf("Underruns: %u\n", status.underruns);
+   }
+
    rc = ioctl(devfd, TILCK_IOCTL_SOUND_RELEASE, NULL);
 
    if (rc < 0) {